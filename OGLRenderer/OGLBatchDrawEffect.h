@@ -1,64 +1,93 @@
-// OGLBatchDrawEffect.h
-// OpenGL implementation derived from BatchDrawEffect
-// Using the power of TextureArrays and large vertex arrays, this type is intended to allow
-// rendering of many animated vertex objects as one draw call
-#pragma once
-#ifndef OGL_BATCH_DRAW_EFFECT_H
-#define OGL_BATCH_DRAW_EFFECT_H
-
-#include "../Renderer/BatchDrawEffect.h"
-
-namespace GamePrototype
-{
-    class OGLBatchDrawEffect : public BatchDrawEffect
-    {
-    public:
-        explicit OGLBatchDrawEffect(const EffectInitInfo&);
-
-    protected:
-
-        // IEffect
-        virtual bool Init() override;
-        virtual int NumPasses() const override;
-        virtual bool PrePass(int, const EffectStatePtr&) override;
-        virtual bool Collect(const Graphics::RenderObjectPtr&) override;
-        virtual bool Collect(const std::vector<Graphics::RenderObjectPtr>&) override;
-        virtual bool Collect(const Graphics::SceneNodePtr&) override;
-        virtual bool Draw(const Graphics::CameraDrawInfo&, const Graphics::RenderStateInfo&, const EffectStatePtr&) override;
-        virtual bool PostPass(const EffectStatePtr&) override;
-        virtual void ClearForNextFrame() override;
-        virtual int GetID() const override;
-        virtual void Free() override;
-        virtual int GetEffectType() const override;
-        virtual bool PostSceneGraph() override;
-
-    private:
-
-        bool DrawStaticPass(const Graphics::CameraDrawInfo&, const Graphics::RenderStateInfo&);
-        bool DrawDynamicPass(const Graphics::CameraDrawInfo&, const Graphics::RenderStateInfo&);
-
-        bool CheckBuffers();
-
-        MultiDrawPtr                            m_dynamicMultiDrawObjectPtr;
-        MultiDrawPtr                            m_staticMultiDrawObjectPtr;
-        MultiDrawPtr                            m_alphaDynamicMultiDrawObjectPtr;
-        MultiDrawPtr                            m_alphaStaticMultiDrawObjectPtr;
-        int                                     m_id;
-        int                                     m_currentPass;
-        const int                               m_effectType;            // IEffectMgr::EffectType enum
-        std::vector<ShaderPtr>                  m_cachedShaderPtrs;
-        bool                                    m_bIsFirstDynamic;
-        bool                                    m_bIsFirstStatic;
-        bool                                    m_bIsFirstAlphaDynamic;
-        bool                                    m_bIsFirstAlphaStatic;
-        bool                                    m_bIsInitialized;
-        TexturePackPtr                          m_texPackPtr;
-        TexturePackPtr                          m_alphaTexPackPtr;
-        std::vector<DrawPackageDataPtr>         m_staticPackages;
-        std::vector<DrawPackageDataPtr>         m_dynamicPackages;
-        bool                                    m_bSetStaticPackages;
-        bool                                    m_bSetDynamicPackages;
-    };
-}
-
+// OGLBatchDrawEffect.h
+// OpenGL implementation derived from BatchDrawEffect
+// Using the power of TextureArrays and large vertex arrays, this type is intended to allow
+// rendering of many animated vertex objects as one draw call
+#pragma once
+#ifndef OGL_BATCH_DRAW_EFFECT_H
+#define OGL_BATCH_DRAW_EFFECT_H
+
+#include "OGLDrawCommandBuffer.h"
+
+#include "../Renderer/BatchDrawEffect.h"
+
+namespace GamePrototype
+{
+    class OGLBatchDrawEffect : public BatchDrawEffect
+    {
+    public:
+        explicit OGLBatchDrawEffect(const EffectInitInfo&);
+
+    protected:
+
+        // IEffect
+        virtual bool Init() override;
+        virtual int NumPasses() const override;
+        virtual bool PrePass(int, const EffectStatePtr&) override;
+        virtual bool Collect(const Graphics::RenderObjectPtr&) override;
+        virtual bool Collect(const std::vector<Graphics::RenderObjectPtr>&) override;
+        virtual bool Collect(const Graphics::SceneNodePtr&) override;
+        virtual bool Draw(const Graphics::CameraDrawInfo&, const Graphics::RenderStateInfo&, const EffectStatePtr&) override;
+        virtual bool PostPass(const EffectStatePtr&) override;
+        virtual void ClearForNextFrame() override;
+        virtual int GetID() const override;
+        virtual void Free() override;
+        virtual int GetEffectType() const override;
+        virtual bool PostSceneGraph() override;
+
+        // BatchDrawEffect
+        virtual DrawPackagePtr BuildDrawPackage(const Graphics::RenderObjectPtr&) override;
+
+    private:
+
+        bool DrawStaticPass(const Graphics::CameraDrawInfo&, const Graphics::RenderStateInfo&);
+        bool DrawDynamicPass(const Graphics::CameraDrawInfo&, const Graphics::RenderStateInfo&);
+
+        // draws the bin's visible set (culling in Draw()) from its command region, written first when bChanged.
+        // Goes through RenderIndirect(GLuint buffer, GLintptr offset, GLsizei count) of the bin's object
+        // (MultiDrawArraysStaticIndirectObject for static bins, MultiDrawArrayObject for dynamic ones), which
+        // must do what Render() does (shader state, VAO, texture arrays, per instance uniforms), except that
+        // it issues one glMultiDrawArraysIndirect of count commands from offset (bytes) in buffer, bound as
+        // GL_DRAW_INDIRECT_BUFFER, instead of the commands it was fed. Returns false on a GL error
+        bool DrawVisible(const MultiDrawPtr&, DrawPackageBins::BinIndex, bool bChanged);
+
+        bool CheckBuffers();
+        bool UpdateStaticBuffers();
+
+        MultiDrawPtr                            m_dynamicMultiDrawObjectPtr;
+        MultiDrawPtr                            m_staticMultiDrawObjectPtr;
+        MultiDrawPtr                            m_alphaDynamicMultiDrawObjectPtr;
+        MultiDrawPtr                            m_alphaStaticMultiDrawObjectPtr;
+        // builder inputs, filled once in Init()
+        std::vector<MultiDrawPtr>               m_dynamicDrawList;
+        std::vector<MultiDrawPtr>               m_staticDrawList;
+        int                                     m_id;
+        int                                     m_currentPass;
+        const int                               m_effectType;            // IEffectMgr::EffectType enum
+        std::vector<ShaderPtr>                  m_cachedShaderPtrs;
+        bool                                    m_bIsFirstDynamic;
+        bool                                    m_bIsFirstStatic;
+        bool                                    m_bIsFirstAlphaDynamic;
+        bool                                    m_bIsFirstAlphaStatic;
+        bool                                    m_bIsInitialized;
+        TexturePackPtr                          m_texPackPtr;
+        TexturePackPtr                          m_alphaTexPackPtr;
+        bool                                    m_bSetStaticPackages;
+        bool                                    m_bSetDynamicPackages;
+
+        // the draw commands of the visible sets, one region per set written this frame
+        struct CommandRegion
+        {
+            GLintptr                            offset;
+            GLsizei                             count;
+        };
+
+        OGLDrawCommandBufferPtr                 m_drawCommandBufferPtr;
+        CommandRegion                           m_commandRegions[s_kNumCommandSets][DrawPackageBins::kMaxBins];    // see GetCommandSet()
+        std::vector<DrawCommand>                m_drawCommands;          // scratch
+
+        // draw commands of all the visible sets a frame writes
+        static const uint32_t s_kMaxDrawCommandsPerFrame = 65536;
+    };
+}
+
 #endif // OGL_BATCH_DRAW_EFFECT_H
\ No newline at end of file
@@ -0,0 +1,94 @@
+// OGLDrawCommandBuffer.cpp
+#include "stdafx.h"
+#include "OGLDrawCommandBuffer.h"
+#include "RenderUtilities.h"
+
+namespace GamePrototype
+{
+	namespace
+	{
+		// GL's DrawArraysIndirectCommand: count, instanceCount, first, baseInstance
+		const GLsizeiptr kCommandSize = 4*sizeof(GLuint);
+	}
+
+	OGLDrawCommandBuffer::OGLDrawCommandBuffer()
+	:
+	m_buffer(0),
+	m_commandsPerFrame(0),
+	m_used(0)
+	{
+	}
+
+	OGLDrawCommandBuffer::~OGLDrawCommandBuffer()
+	{
+		Shutdown();
+	}
+
+	bool OGLDrawCommandBuffer::Init(uint32_t commandsPerFrame)
+	{
+		assert(commandsPerFrame > 0);
+		if (m_buffer != 0)
+		{
+			return true;
+		}
+
+		m_commandsPerFrame = commandsPerFrame;
+		m_used = 0;
+
+		glGenBuffers(1, &m_buffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_buffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, kCommandSize*m_commandsPerFrame, nullptr, GL_STREAM_DRAW);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+		if (ErrorUtilities::IsOpenGLError())
+		{
+			Log::PrintError("OGLDrawCommandBuffer::Init() failed to create buffer!");
+			Shutdown();
+			return false;
+		}
+
+		return true;
+	}
+
+	void OGLDrawCommandBuffer::Shutdown()
+	{
+		if (m_buffer != 0)
+		{
+			glDeleteBuffers(1, &m_buffer);
+			m_buffer = 0;
+		}
+
+		m_used = 0;
+	}
+
+	void OGLDrawCommandBuffer::BeginFrame()
+	{
+		if (m_buffer != 0 && m_used > 0)
+		{
+			// orphaned, draws already issued keep the old storage
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_buffer);
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, kCommandSize*m_commandsPerFrame, nullptr, GL_STREAM_DRAW);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		}
+
+		m_used = 0;
+	}
+
+	bool OGLDrawCommandBuffer::Write(const void* pCommands, uint32_t count, GLintptr& offset)
+	{
+		if (m_buffer == 0 || count > m_commandsPerFrame - m_used)
+		{
+			Log::PrintError("OGLDrawCommandBuffer::Write() out of draw commands for this frame!");
+			return false;
+		}
+
+		offset = static_cast<GLintptr>(m_used)*kCommandSize;
+		m_used += count;
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_buffer);
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, offset, kCommandSize*count, pCommands);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+		return true;
+	}
+}
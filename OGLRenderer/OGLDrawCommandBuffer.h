@@ -0,0 +1,45 @@
+// OGLDrawCommandBuffer.h
+// GL_DRAW_INDIRECT_BUFFER of draw commands (DrawArraysIndirectCommand), orphaned at the start of every frame.
+// Within a frame commands are written front to back, so a region a pass drew from is never rewritten by a
+// later pass of the frame, and earlier frames keep reading the storage they were issued with
+#pragma once
+#ifndef OGL_DRAW_COMMAND_BUFFER_H
+#define OGL_DRAW_COMMAND_BUFFER_H
+
+#include <memory>
+
+namespace GamePrototype
+{
+    class OGLDrawCommandBuffer
+    {
+    public:
+        OGLDrawCommandBuffer();
+        ~OGLDrawCommandBuffer();
+
+        OGLDrawCommandBuffer(const OGLDrawCommandBuffer&) = delete;
+        OGLDrawCommandBuffer& operator=(const OGLDrawCommandBuffer&) = delete;
+
+        // with the GL context current
+        bool Init(uint32_t commandsPerFrame);
+        void Shutdown();
+
+        // fresh storage for the next frame's commands
+        void BeginFrame();
+
+        // copies count commands (16 bytes each) into this frame's storage, offset is in bytes for the
+        // indirect draw. False when the frame has fewer than count left
+        bool Write(const void* pCommands, uint32_t count, GLintptr& offset);
+
+        GLuint GetBuffer() const { return m_buffer; }
+
+    private:
+
+        GLuint                                  m_buffer;
+        uint32_t                                m_commandsPerFrame;
+        uint32_t                                m_used;             // commands written this frame
+    };
+
+    typedef std::shared_ptr<OGLDrawCommandBuffer> OGLDrawCommandBufferPtr;
+}
+
+#endif // OGL_DRAW_COMMAND_BUFFER_H
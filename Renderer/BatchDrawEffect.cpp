@@ -3,6 +3,9 @@
 #include "stdafx.h"
 #endif
 
+#include <algorithm>
+#include <cstring>
+
 #include "BatchDrawEffect.h"
 #include "Renderer.h"
 #include "EffectInitInfo.h"
@@ -12,12 +15,968 @@ namespace GamePrototype
 	BatchDrawEffect::BatchDrawEffect(const EffectInitInfo& info)
 	:
 	m_renderer(info.m_renderer),
-	m_materialList(info.m_materials.begin(), info.m_materials.end())
+	m_materialList(info.m_materials.begin(), info.m_materials.end()),
+	m_bParallelCollect(false),
+	m_numBuildsInFlight(0),
+	m_bAsyncPackageBuilds(false),
+	m_framesSincePrune(0),
+	m_bFrustumCulling(false),
+	m_bLodSelection(false),
+	m_sortViewMat{},
+	m_bHasSortView(false),
+	m_bDepthSorting(false),
+	m_bOrderIndependentAlpha(false),
+	m_bShadowCastersBuilt(false)
+	{
+		m_packageBins.SetArena(&m_frameArena);
+	}
+
+	BatchDrawEffect::~BatchDrawEffect()
 	{
+		// the prepare jobs reference this effect
+		WaitForPackageBuilds();
 	}
 
 	const Graphics::MaterialList& BatchDrawEffect::GetMaterials() const
 	{
 		return m_materialList;
 	}
+
+	void BatchDrawEffect::SetParallelCollect(bool bEnable, const WorkerPoolPtr& poolPtr)
+	{
+		m_bParallelCollect = bEnable;
+		if (poolPtr)
+		{
+			m_workerPoolPtr = poolPtr;
+		}
+
+		if (!m_bParallelCollect)
+		{
+			m_collectBuckets.clear();
+		}
+	}
+
+	void BatchDrawEffect::SetAsyncPackageBuilds(bool bEnable, const WorkerPoolPtr& poolPtr)
+	{
+		if (!bEnable && m_bAsyncPackageBuilds)
+		{
+			// anything still in flight is handed out before switching back to inline builds
+			WaitForPackageBuilds();
+			PublishBuiltPackages();
+		}
+
+		m_bAsyncPackageBuilds = bEnable;
+		if (poolPtr)
+		{
+			m_workerPoolPtr = poolPtr;
+		}
+	}
+
+	void BatchDrawEffect::SetPackageCacheFuncs(const DrawPackageCache::KeyFunc& keyFunc, const DrawPackageCache::InstanceFunc& instanceFunc)
+	{
+		m_packageKeyFunc = keyFunc;
+		m_packageInstanceFunc = instanceFunc;
+
+		if (!m_packageKeyFunc || !m_packageInstanceFunc)
+		{
+			// objects already sharing keep their packages, nothing new joins them
+			m_packageCache.Clear();
+		}
+	}
+
+	void BatchDrawEffect::SetPackageDiskCache(const DrawPackageDiskCachePtr& diskCachePtr, const DrawPackageDiskCache::Codec& codec)
+	{
+		m_diskCachePtr = diskCachePtr;
+		m_diskCacheCodec = codec;
+	}
+
+	bool BatchDrawEffect::SetDrawCommandFunc(const DrawCommandFunc& drawCommandFunc)
+	{
+		if (!drawCommandFunc && IsCullingInDraw())
+		{
+			Log::PrintError("BatchDrawEffect::SetDrawCommandFunc() culling, LOD selection and depth sorting need a draw command function!");
+			return false;
+		}
+
+		m_drawCommandFunc = drawCommandFunc;
+		return true;
+	}
+
+	bool BatchDrawEffect::SetFrustumCulling(bool bEnable)
+	{
+		if (bEnable && !m_drawCommandFunc)
+		{
+			Log::PrintError("BatchDrawEffect::SetFrustumCulling() needs a draw command function!");
+			return false;
+		}
+
+		m_bFrustumCulling = bEnable;
+		return true;
+	}
+
+	bool BatchDrawEffect::SetLodSelection(bool bEnable)
+	{
+		if (bEnable && !m_drawCommandFunc)
+		{
+			Log::PrintError("BatchDrawEffect::SetLodSelection() needs a draw command function!");
+			return false;
+		}
+
+		m_bLodSelection = bEnable;
+		return true;
+	}
+
+	bool BatchDrawEffect::SetDepthSorting(bool bEnable)
+	{
+		if (bEnable && !m_drawCommandFunc)
+		{
+			Log::PrintError("BatchDrawEffect::SetDepthSorting() needs a draw command function!");
+			return false;
+		}
+
+		m_bDepthSorting = bEnable;
+		return true;
+	}
+
+	void BatchDrawEffect::SetSortView(const Graphics::CameraDrawInfo& cdi)
+	{
+		memcpy(m_sortViewMat, cdi.viewMat.Get(), sizeof(m_sortViewMat));
+		m_bHasSortView = true;
+	}
+
+	void BatchDrawEffect::SetOrderIndependentAlpha(bool bEnable)
+	{
+		m_bOrderIndependentAlpha = bEnable;
+	}
+
+	void BatchDrawEffect::SortPackages()
+	{
+		if (!m_bDepthSorting || !m_bHasSortView)
+		{
+			return;
+		}
+
+		// NOTE: dynamic bounds are new every frame, their keys can not be kept like the static ones
+		const DrawPackageBins::BinIndex dynamicBins[] = { DrawPackageBins::kDynamicOpaque, DrawPackageBins::kDynamicAlpha };
+		for (DrawPackageBins::BinIndex binIndex : dynamicBins)
+		{
+			DrawPackageBin& bin = m_packageBins.Get(binIndex);
+			if (bin.Size() < 2 || (binIndex == DrawPackageBins::kDynamicAlpha && m_bOrderIndependentAlpha))
+			{
+				continue;
+			}
+
+			const DepthSorter::Order order = (binIndex == DrawPackageBins::kDynamicAlpha) ? DepthSorter::kBackToFront : DepthSorter::kFrontToBack;
+			m_depthSorter.Sort(m_sortViewMat, bin.centerX.data(), bin.centerY.data(), bin.centerZ.data(), bin.radius.data(),
+				bin.Size(), order, m_dynamicSortOrder);
+			bin.Permute(m_dynamicSortOrder);
+		}
+	}
+
+	void BatchDrawEffect::OrderStaticVisible(DrawPackageBins::BinIndex binIndex)
+	{
+		if (!m_bDepthSorting || !m_bHasSortView || (binIndex == DrawPackageBins::kStaticAlpha && m_bOrderIndependentAlpha))
+		{
+			return;
+		}
+
+		const StaticPackageRegistry& registry = GetStaticRegistry(binIndex);
+		StaticSortOrder& sortOrder = m_staticSortOrders[(binIndex == DrawPackageBins::kStaticAlpha) ? 1 : 0];
+
+		// keys are only worth recomputing when the camera or the packages moved
+		if (!sortOrder.bValid || sortOrder.generation != registry.GetGeneration() || sortOrder.boundsVersion != registry.GetBoundsVersion() ||
+			memcmp(sortOrder.viewMat, m_sortViewMat, sizeof(m_sortViewMat)) != 0)
+		{
+			const DepthSorter::Order order = (binIndex == DrawPackageBins::kStaticAlpha) ? DepthSorter::kBackToFront : DepthSorter::kFrontToBack;
+			m_depthSorter.Sort(m_sortViewMat, registry.GetBounds(), order, sortOrder.order);
+
+			sortOrder.ranks.resize(sortOrder.order.size());
+			for (size_t i = 0; i < sortOrder.order.size(); ++i)
+			{
+				sortOrder.ranks[sortOrder.order[i]] = static_cast<uint32_t>(i);
+			}
+
+			memcpy(sortOrder.viewMat, m_sortViewMat, sizeof(m_sortViewMat));
+			sortOrder.generation = registry.GetGeneration();
+			sortOrder.boundsVersion = registry.GetBoundsVersion();
+			sortOrder.bValid = true;
+		}
+
+		std::vector<uint32_t>& visible = m_cullResults[binIndex].visible;
+		if (visible.size() == sortOrder.order.size())
+		{
+			visible = sortOrder.order;
+			return;
+		}
+
+		const std::vector<uint32_t>& ranks = sortOrder.ranks;
+		std::sort(visible.begin(), visible.end(), [&ranks](uint32_t lhs, uint32_t rhs)
+		{
+			return ranks[lhs] < ranks[rhs];
+		});
+	}
+
+	DrawPackagePtr BatchDrawEffect::AcquireDrawPackage(const Graphics::RenderObjectPtr& objPtr)
+	{
+		DrawPackagePtr dpPtr = objPtr->GetDrawPackage();
+		if (dpPtr)
+		{
+			return dpPtr;
+		}
+
+		DrawPackageCache::Identity identity;
+		const bool bHasKey = m_packageKeyFunc && m_packageKeyFunc(*objPtr, identity);
+		const DrawPackageCache::Key key = bHasKey ? DrawPackageCache::MakeKey(identity) : 0;
+
+		// NOTE: without an instance function the key only addresses the disk cache, nothing is shared
+		const bool bShared = bHasKey && m_packageInstanceFunc;
+		if (bShared)
+		{
+			DrawPackagePtr prototypePtr = m_packageCache.Find(key, identity);
+			if (prototypePtr)
+			{
+				dpPtr = m_packageInstanceFunc(prototypePtr, objPtr);
+				objPtr->SetDrawPackage(dpPtr);
+				return dpPtr;
+			}
+		}
+
+		if (bHasKey)
+		{
+			dpPtr = LoadFromDiskCache(objPtr, key);
+			if (dpPtr)
+			{
+				if (bShared)
+				{
+					m_packageCache.Insert(key, identity, dpPtr);
+				}
+
+				objPtr->SetDrawPackage(dpPtr);
+				return dpPtr;
+			}
+		}
+
+		if (m_bAsyncPackageBuilds)
+		{
+			// an identical object's build is already in flight, pick its package up from the cache once it lands
+			if (!bShared || m_pendingKeys.find(key) == m_pendingKeys.end())
+			{
+				RequestPackageBuild(objPtr, bHasKey, bShared, key, identity);
+			}
+		}
+		else
+		{
+			dpPtr = BuildDrawPackage(objPtr);
+			objPtr->SetDrawPackage(dpPtr);
+
+			if (bHasKey)
+			{
+				if (bShared)
+				{
+					m_packageCache.Insert(key, identity, dpPtr);
+				}
+
+				StoreToDiskCache(*objPtr, key, dpPtr);
+			}
+		}
+
+		return dpPtr;
+	}
+
+	DrawPackagePtr BatchDrawEffect::LoadFromDiskCache(const Graphics::RenderObjectPtr& objPtr, DrawPackageCache::Key key)
+	{
+		if (!m_diskCachePtr || !m_diskCacheCodec.assetHashFunc || !m_diskCacheCodec.deserializeFunc)
+		{
+			return DrawPackagePtr();
+		}
+
+		DrawPackageCache::Key assetHash = 0;
+		const uint8_t* pBytes = nullptr;
+		size_t size = 0;
+		if (!m_diskCacheCodec.assetHashFunc(*objPtr, assetHash) || !m_diskCachePtr->Find(key, assetHash, pBytes, size))
+		{
+			return DrawPackagePtr();
+		}
+
+		return m_diskCacheCodec.deserializeFunc(objPtr, pBytes, size);
+	}
+
+	void BatchDrawEffect::StoreToDiskCache(const Graphics::RenderObject& obj, DrawPackageCache::Key key, const DrawPackagePtr& dpPtr)
+	{
+		if (!dpPtr || !m_diskCachePtr || !m_diskCacheCodec.assetHashFunc || !m_diskCacheCodec.serializeFunc)
+		{
+			return;
+		}
+
+		DrawPackageCache::Key assetHash = 0;
+		std::vector<uint8_t> bytes;
+		if (m_diskCacheCodec.assetHashFunc(obj, assetHash) && m_diskCacheCodec.serializeFunc(dpPtr, bytes))
+		{
+			m_diskCachePtr->Store(key, assetHash, std::move(bytes));
+		}
+	}
+
+	void BatchDrawEffect::PublishBuiltPackages()
+	{
+		PreparedBuild prepared;
+		while (m_preparedBuilds.Pop(prepared))
+		{
+			// NOTE: a failed preparation or build publishes a null package, the next Collect() simply asks again
+			DrawPackagePtr dpPtr;
+			if (prepared.bPrepared)
+			{
+				dpPtr = BuildDrawPackage(prepared.objPtr);
+			}
+
+			prepared.objPtr->SetDrawPackage(dpPtr);
+			m_pendingBuilds.erase(prepared.objPtr.get());
+
+			if (prepared.bShared)
+			{
+				m_pendingKeys.erase(prepared.key);
+				m_packageCache.Insert(prepared.key, prepared.identity, dpPtr);
+			}
+
+			if (prepared.bHasKey)
+			{
+				StoreToDiskCache(*prepared.objPtr, prepared.key, dpPtr);
+			}
+
+			// release on this thread, not whichever one pops next
+			prepared = PreparedBuild();
+		}
+	}
+
+	void BatchDrawEffect::WaitForPackageBuilds()
+	{
+		std::unique_lock<std::mutex> lock(m_buildCountMutex);
+		m_buildsDoneCondition.wait(lock, [this]() { return m_numBuildsInFlight == 0; });
+	}
+
+	void BatchDrawEffect::DiscardPackageBuilds()
+	{
+		WaitForPackageBuilds();
+
+		PreparedBuild prepared;
+		while (m_preparedBuilds.Pop(prepared))
+		{
+			prepared = PreparedBuild();
+		}
+
+		m_pendingBuilds.clear();
+		m_pendingKeys.clear();
+	}
+
+	bool BatchDrawEffect::CollectList(const std::vector<Graphics::RenderObjectPtr>& list)
+	{
+		if (!m_bParallelCollect || list.size() < s_kMinParallelCollectCount)
+		{
+			for (const auto& node : list)
+			{
+				if (!Collect(node))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		// the serial path stops at the first null object, keeping whatever was collected before it.
+		// Missing DrawPackages are built (or requested) here as well, since the builders are not thread safe
+		bool bResult = true;
+		size_t count = list.size();
+		for (size_t i = 0; i < count; ++i)
+		{
+			const Graphics::RenderObjectPtr& objPtr = list[i];
+			if (!objPtr)
+			{
+				count = i;
+				bResult = false;
+				break;
+			}
+
+			AcquireDrawPackage(objPtr);
+		}
+
+		return CollectParallel(list, count) && bResult;
+	}
+
+	void BatchDrawEffect::GatherPackageData(const Graphics::RenderObject& obj, const DrawPackagePtr& dpPtr, DrawPackageBins& bins) const
+	{
+		BoundingSphere bounds;
+		if (m_boundsFunc && !m_boundsFunc(obj, bounds))
+		{
+			bounds = BoundingSphere();
+		}
+
+		uint64_t transformKey = DrawPackageBin::s_kUnknownTransform;
+		if (m_transformFunc && !m_transformFunc(obj, transformKey))
+		{
+			transformKey = DrawPackageBin::s_kUnknownTransform;
+		}
+
+		for (size_t i = 0; i < dpPtr->GetNumDataEntries(); ++i)
+		{
+			uint32_t lodLevel = 0;
+			uint32_t lodCount = 1;
+			if (m_lodFunc && !m_lodFunc(obj, i, lodLevel, lodCount))
+			{
+				lodLevel = 0;
+				lodCount = 1;
+			}
+
+			assert(lodLevel < lodCount && lodCount <= LodSelector::s_kMaxLevels);
+
+			// without selection every level would be drawn on top of each other
+			if (lodLevel != 0 && !m_bLodSelection)
+			{
+				continue;
+			}
+
+			DrawPackageDataPtr dataPtr;
+			if (dpPtr->GetData(i, dataPtr))
+			{
+				bins.Add(std::move(dataPtr), bounds, static_cast<uint8_t>(lodLevel), static_cast<uint8_t>(lodCount), transformKey, &obj);
+			}
+		}
+	}
+
+	bool BatchDrawEffect::CullDynamicBin(DrawPackageBins::BinIndex binIndex, const Frustum* pFrustum, const LodSelector* pLods)
+	{
+		const DrawPackageBin& bin = m_packageBins.Get(binIndex);
+		CullResult& result = m_cullResults[binIndex];
+		result.commandSet = 0;
+
+		const size_t count = bin.Size();
+		result.visible.resize(count);
+
+		size_t numVisible = count;
+		if (pFrustum)
+		{
+			numVisible = FrustumCuller::Cull(*pFrustum, bin.centerX.data(), bin.centerY.data(), bin.centerZ.data(),
+				bin.radius.data(), count, result.visible.data());
+		}
+		else
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				result.visible[i] = static_cast<uint32_t>(i);
+			}
+		}
+
+		result.visible.resize(numVisible);
+
+		if (pLods)
+		{
+			SelectLods(binIndex, *pLods);
+		}
+
+		RecordCullStats(binIndex);
+		return IsVisibleSetChanged(binIndex);
+	}
+
+	bool BatchDrawEffect::CullStaticBin(DrawPackageBins::BinIndex binIndex, const Frustum* pFrustum, const LodSelector* pLods)
+	{
+		StaticPackageRegistry& registry = GetStaticRegistry(binIndex);
+		CullResult& result = m_cullResults[binIndex];
+		result.commandSet = 0;
+
+		result.visible.clear();
+		if (pFrustum)
+		{
+			registry.QueryFrustum(*pFrustum, result.visible);
+		}
+		else
+		{
+			for (size_t i = 0; i < registry.GetPackages().size(); ++i)
+			{
+				result.visible.push_back(static_cast<uint32_t>(i));
+			}
+		}
+
+		OrderStaticVisible(binIndex);
+
+		if (pLods)
+		{
+			SelectLods(binIndex, *pLods);
+		}
+
+		RecordCullStats(binIndex);
+		return IsVisibleSetChanged(binIndex);
+	}
+
+	void BatchDrawEffect::SetShadowLights(const std::vector<ShadowLightVolume>& lights)
+	{
+		assert(lights.size() <= s_kMaxShadowLights);
+
+		const size_t numLights = (lights.size() < s_kMaxShadowLights) ? lights.size() : s_kMaxShadowLights;
+		m_shadowLights.assign(lights.begin(), lights.begin() + numLights);
+		m_bShadowCastersBuilt = false;
+	}
+
+	const std::vector<uint32_t>& BatchDrawEffect::GetShadowCasters(size_t lightIndex, DrawPackageBins::BinIndex binIndex)
+	{
+		assert(lightIndex < m_shadowLights.size());
+		BuildShadowCasterLists();
+		return m_shadowCasters[lightIndex][binIndex];
+	}
+
+	bool BatchDrawEffect::SelectShadowCasters(const Graphics::CameraDrawInfo& cdi, DrawPackageBins::BinIndex binIndex, bool& bChanged, const LodSelector* pLods)
+	{
+		bChanged = false;
+
+		size_t lightIndex = 0;
+		if (!FindShadowLight(cdi, lightIndex))
+		{
+			return false;
+		}
+
+		BuildShadowCasterLists();
+
+		CullResult& result = m_cullResults[binIndex];
+		result.commandSet = 1 + lightIndex;
+		result.visible = m_shadowCasters[lightIndex][binIndex];
+
+		// dynamic bins are in order already, the registries are not
+		const bool bStatic = (binIndex == DrawPackageBins::kStaticOpaque || binIndex == DrawPackageBins::kStaticAlpha);
+		if (bStatic)
+		{
+			OrderStaticVisible(binIndex);
+		}
+
+		// the caster lists hold every level
+		if (pLods)
+		{
+			SelectLods(binIndex, *pLods);
+		}
+
+		RecordCullStats(binIndex);
+
+		bChanged = IsVisibleSetChanged(binIndex);
+		return true;
+	}
+
+	bool BatchDrawEffect::FindShadowLight(const Graphics::CameraDrawInfo& cdi, size_t& lightIndex) const
+	{
+		for (size_t light = 0; light < m_shadowLights.size(); ++light)
+		{
+			for (const Math::mat4& viewProj : m_shadowLights[light].viewProjs)
+			{
+				if (memcmp(viewProj.Get(), cdi.viewProjMat.Get(), Math::mat4::MAT4_SIZE*sizeof(float)) == 0)
+				{
+					lightIndex = light;
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	void BatchDrawEffect::BuildShadowCasterLists()
+	{
+		if (m_bShadowCastersBuilt)
+		{
+			return;
+		}
+
+		m_bShadowCastersBuilt = true;
+
+		for (size_t light = 0; light < m_shadowLights.size(); ++light)
+		{
+			const ShadowLightVolume& volume = m_shadowLights[light];
+
+			for (int bin = 0; bin < DrawPackageBins::kMaxBins; ++bin)
+			{
+				const DrawPackageBins::BinIndex binIndex = static_cast<DrawPackageBins::BinIndex>(bin);
+				std::vector<uint32_t>& casters = m_shadowCasters[light][bin];
+				casters.clear();
+
+				if (binIndex == DrawPackageBins::kStaticOpaque || binIndex == DrawPackageBins::kStaticAlpha)
+				{
+					StaticPackageRegistry& registry = GetStaticRegistry(binIndex);
+					if (volume.type == ShadowLightVolume::kFrustumVolume)
+					{
+						registry.QueryFrustum(volume.frustum, casters);
+					}
+					else
+					{
+						registry.QuerySphere(volume.sphere, casters);
+					}
+
+					continue;
+				}
+
+				const DrawPackageBin& packageBin = m_packageBins.Get(binIndex);
+				casters.resize(packageBin.Size());
+
+				size_t numCasters = 0;
+				if (volume.type == ShadowLightVolume::kFrustumVolume)
+				{
+					numCasters = FrustumCuller::Cull(volume.frustum, packageBin.centerX.data(), packageBin.centerY.data(),
+						packageBin.centerZ.data(), packageBin.radius.data(), packageBin.Size(), casters.data());
+				}
+				else
+				{
+					numCasters = FrustumCuller::CullSphere(volume.sphere, packageBin.centerX.data(), packageBin.centerY.data(),
+						packageBin.centerZ.data(), packageBin.radius.data(), packageBin.Size(), casters.data());
+				}
+
+				casters.resize(numCasters);
+			}
+		}
+	}
+
+	bool BatchDrawEffect::IsVisibleSetChanged(DrawPackageBins::BinIndex binIndex) const
+	{
+		const CullResult& result = m_cullResults[binIndex];
+		const BuiltSet& built = m_builtSets[result.commandSet][binIndex];
+		if (!built.bBuilt || result.visible != built.indices)
+		{
+			return true;
+		}
+
+		// static index lists are only comparable within one registry generation, and while nothing moved
+		if (binIndex == DrawPackageBins::kStaticOpaque || binIndex == DrawPackageBins::kStaticAlpha)
+		{
+			const StaticPackageRegistry& registry = (binIndex == DrawPackageBins::kStaticAlpha) ? m_alphaStaticRegistry : m_staticRegistry;
+			return built.generation != registry.GetGeneration() || built.boundsVersion != registry.GetBoundsVersion();
+		}
+
+		return false;
+	}
+
+	void BatchDrawEffect::RecordCullStats(DrawPackageBins::BinIndex binIndex)
+	{
+		const bool bStatic = (binIndex == DrawPackageBins::kStaticOpaque || binIndex == DrawPackageBins::kStaticAlpha);
+
+		CullStats& stats = m_cullStats[binIndex];
+		stats.numVisible = m_cullResults[binIndex].visible.size();
+		stats.numTotal = bStatic ? GetStaticRegistry(binIndex).GetPackages().size() : m_packageBins.Get(binIndex).Size();
+	}
+
+	void BatchDrawEffect::SelectLods(DrawPackageBins::BinIndex binIndex, const LodSelector& lodSelector)
+	{
+		std::vector<uint32_t>& visible = m_cullResults[binIndex].visible;
+
+		size_t numSelected = 0;
+		if (binIndex == DrawPackageBins::kStaticOpaque || binIndex == DrawPackageBins::kStaticAlpha)
+		{
+			// NOTE: a package shared between objects is picked once, for the union of their bounds
+			const StaticPackageRegistry& registry = GetStaticRegistry(binIndex);
+			numSelected = lodSelector.Filter(registry.GetBounds().data(), registry.GetLodLevels().data(),
+				registry.GetLodCounts().data(), visible.data(), visible.size());
+		}
+		else
+		{
+			const DrawPackageBin& bin = m_packageBins.Get(binIndex);
+			numSelected = lodSelector.Filter(bin.centerX.data(), bin.centerY.data(), bin.centerZ.data(), bin.radius.data(),
+				bin.lodLevels.data(), bin.lodCounts.data(), visible.data(), visible.size());
+		}
+
+		visible.resize(numSelected);
+	}
+
+	void BatchDrawEffect::BuildVisibleCommands(DrawPackageBins::BinIndex binIndex, std::vector<DrawCommand>& commands)
+	{
+		const CullResult& result = m_cullResults[binIndex];
+		BuiltSet& built = m_builtSets[result.commandSet][binIndex];
+		commands.clear();
+
+		DrawCommand command;
+		if (binIndex == DrawPackageBins::kStaticOpaque || binIndex == DrawPackageBins::kStaticAlpha)
+		{
+			// every instance of a package, laid out as AddToMultiDraw() fed them
+			const StaticPackageRegistry& registry = GetStaticRegistry(binIndex);
+			const std::vector<DrawPackageDataPtr>& packages = registry.GetPackages();
+			const std::vector<uint32_t>& instanceCounts = registry.GetInstanceCounts();
+			const std::vector<uint32_t>& instanceOffsets = registry.GetInstanceOffsets();
+
+			for (uint32_t index : result.visible)
+			{
+				for (uint32_t instance = 0; instance < instanceCounts[index]; ++instance)
+				{
+					if (m_drawCommandFunc(*packages[index], instanceOffsets[index] + instance, command))
+					{
+						commands.push_back(command);
+					}
+				}
+			}
+
+			built.generation = registry.GetGeneration();
+			built.boundsVersion = registry.GetBoundsVersion();
+		}
+		else
+		{
+			const DrawPackageBin& bin = m_packageBins.Get(binIndex);
+			for (uint32_t index : result.visible)
+			{
+				if (m_drawCommandFunc(*bin.packages[index], 0, command))
+				{
+					commands.push_back(command);
+				}
+			}
+		}
+
+		built.indices = result.visible;
+		built.bBuilt = true;
+	}
+
+	StaticPackageRegistry& BatchDrawEffect::GetStaticRegistry(DrawPackageBins::BinIndex binIndex)
+	{
+		assert(binIndex == DrawPackageBins::kStaticOpaque || binIndex == DrawPackageBins::kStaticAlpha);
+		return (binIndex == DrawPackageBins::kStaticAlpha) ? m_alphaStaticRegistry : m_staticRegistry;
+	}
+
+	bool BatchDrawEffect::UploadMovedInstances(const MultiDrawPtr& drawPtr, StaticPackageRegistry& registry,
+		InstanceTransform::Format format)
+	{
+		DirtyRangeTracker& dirty = registry.GetDirtyInstances();
+		if (dirty.IsEmpty())
+		{
+			return true;
+		}
+
+		const std::vector<InstanceRange>& ranges = dirty.Coalesce(s_kMaxDirtyInstanceGap);
+		if (m_instanceMatrixFunc)
+		{
+			for (const InstanceRange& range : ranges)
+			{
+				ComposeMovedInstances(*drawPtr, registry, range, format);
+			}
+		}
+
+		const bool bUploaded = drawPtr->UpdateInstances(ranges);
+		dirty.Clear();
+		return bUploaded;
+	}
+
+	bool BatchDrawEffect::ComposeMovedInstances(IMultiDraw& multiDraw, const StaticPackageRegistry& registry,
+		const InstanceRange& range, InstanceTransform::Format format)
+	{
+		const std::vector<const void*>& owners = registry.GetInstanceOwners();
+
+		m_composeParents.clear();
+		m_composeParentIndices.clear();
+		m_composeLocals.clear();
+		m_composeParentSlots.clear();
+
+		for (uint32_t instance = range.first; instance < range.first + range.count; ++instance)
+		{
+			const Graphics::RenderObject* pObj = static_cast<const Graphics::RenderObject*>(owners[instance]);
+			const float* pParent = nullptr;
+			const float* pLocal = nullptr;
+			if (!pObj || !m_instanceMatrixFunc(*pObj, pParent, pLocal))
+			{
+				return false;
+			}
+
+			// instances under one parent share its matrix
+			const uint32_t numParents = static_cast<uint32_t>(m_composeParents.size() / 16);
+			auto slot = m_composeParentSlots.emplace(pParent, numParents);
+			if (slot.second)
+			{
+				m_composeParents.insert(m_composeParents.end(), pParent, pParent + 16);
+			}
+
+			m_composeParentIndices.push_back(slot.first->second);
+			m_composeLocals.insert(m_composeLocals.end(), pLocal, pLocal + 16);
+		}
+
+		void* pDst = multiDraw.MapInstances(range.first, range.count);
+		if (!pDst)
+		{
+			return false;
+		}
+
+		InstanceTransform::ComposeBatch(format, m_composeParents.data(), m_composeParentIndices.data(),
+			m_composeLocals.data(), range.count, pDst);
+		return true;
+	}
+
+	void BatchDrawEffect::AddToMultiDraw(const MultiDrawPtr& drawPtr, const StaticPackageRegistry& registry, bool& bIsFirst)
+	{
+		const std::vector<DrawPackageDataPtr>& packages = registry.GetPackages();
+		const std::vector<uint32_t>& instanceCounts = registry.GetInstanceCounts();
+
+		for (size_t i = 0; i < packages.size(); ++i)
+		{
+			for (uint32_t instance = 0; instance < instanceCounts[i]; ++instance)
+			{
+				if (bIsFirst)
+				{
+					drawPtr->Add(packages[i], IMultiDraw::FirstToken());
+					bIsFirst = false;
+				}
+				else
+				{
+					drawPtr->Add(packages[i]);
+				}
+			}
+		}
+	}
+
+	void BatchDrawEffect::ResetFrameAllocations()
+	{
+		m_packageBins.ReleaseStorage();
+		for (auto& bucket : m_collectBuckets)
+		{
+			bucket.bins.ReleaseStorage();
+		}
+
+		m_frameArena.Reset();
+
+		// the command regions were written into last frame's part of the command buffers
+		for (auto& builtSets : m_builtSets)
+		{
+			for (auto& built : builtSets)
+			{
+				built.bBuilt = false;
+			}
+		}
+
+		m_bShadowCastersBuilt = false;
+
+		// expired cache entries are only dropped lazily on lookup otherwise
+		if (++m_framesSincePrune >= s_kPackageCachePruneFrames)
+		{
+			m_packageCache.Prune();
+			m_framesSincePrune = 0;
+		}
+
+		m_packageBins.ReserveFromLastFrame();
+		for (auto& bucket : m_collectBuckets)
+		{
+			bucket.bins.ReserveFromLastFrame();
+		}
+	}
+
+	void BatchDrawEffect::RequestPackageBuild(const Graphics::RenderObjectPtr& objPtr, bool bHasKey, bool bShared,
+		DrawPackageCache::Key key, const DrawPackageCache::Identity& identity)
+	{
+		if (!m_pendingBuilds.insert(objPtr.get()).second)
+		{
+			// already on its way
+			return;
+		}
+
+		if (bShared)
+		{
+			m_pendingKeys.insert(key);
+		}
+
+		WorkerPoolPtr poolPtr = GetWorkerPool();
+		assert(poolPtr);
+
+		{
+			std::lock_guard<std::mutex> lock(m_buildCountMutex);
+			++m_numBuildsInFlight;
+		}
+
+		// CPU side work only, BuildDrawPackage() runs in PublishBuiltPackages() on the render thread
+		PreparedBuild request;
+		request.objPtr = objPtr;
+		request.key = key;
+		request.identity = identity;
+		request.bHasKey = bHasKey;
+		request.bShared = bShared;
+		request.bPrepared = false;
+
+		PreparePackageFunc prepareFunc = m_preparePackageFunc;
+		poolPtr->Submit([this, request, prepareFunc]() mutable
+		{
+			request.bPrepared = !prepareFunc || prepareFunc(*request.objPtr);
+
+			// the only reference the job keeps goes back with the result
+			m_preparedBuilds.Push(std::move(request));
+
+			std::lock_guard<std::mutex> lock(m_buildCountMutex);
+			if (--m_numBuildsInFlight == 0)
+			{
+				m_buildsDoneCondition.notify_all();
+			}
+		});
+	}
+
+	WorkerPoolPtr BatchDrawEffect::GetWorkerPool() const
+	{
+		return m_workerPoolPtr ? m_workerPoolPtr : WorkerPool::GetDefault();
+	}
+
+	bool BatchDrawEffect::CollectParallel(const std::vector<Graphics::RenderObjectPtr>& list, size_t count)
+	{
+		if (count == 0)
+		{
+			return true;
+		}
+
+		WorkerPoolPtr poolPtr = GetWorkerPool();
+		assert(poolPtr);
+		if (!poolPtr)
+		{
+			return false;
+		}
+
+		// a few slices per thread so one slice full of multi entry packages doesn't hold up the rest
+		const size_t numBuckets = std::min(count, (poolPtr->GetNumWorkers() + 1) * 4);
+		const size_t sliceSize = (count + numBuckets - 1) / numBuckets;
+
+		if (m_collectBuckets.size() < numBuckets)
+		{
+			const size_t oldSize = m_collectBuckets.size();
+			m_collectBuckets.resize(numBuckets);
+			for (size_t i = oldSize; i < numBuckets; ++i)
+			{
+				m_collectBuckets[i].bins.SetArena(&m_frameArena);
+			}
+		}
+
+		struct SliceInfo
+		{
+			const std::vector<Graphics::RenderObjectPtr>*	pList;
+			size_t											count;
+			size_t											sliceSize;
+		};
+
+		const SliceInfo slices = { &list, count, sliceSize };
+
+		// NOTE: keep the capture small enough for std::function's local buffer, no heap allocation per frame
+		poolPtr->ParallelFor(numBuckets, [this, &slices](size_t bucketIndex)
+		{
+			PackageBucket& bucket = m_collectBuckets[bucketIndex];
+			bucket.bins.Clear();
+			bucket.bHasPackages = false;
+
+			const size_t begin = bucketIndex * slices.sliceSize;
+			const size_t end = std::min(slices.count, begin + slices.sliceSize);
+			for (size_t i = begin; i < end; ++i)
+			{
+				DrawPackagePtr dpPtr = (*slices.pList)[i]->GetDrawPackage();
+				if (dpPtr)
+				{
+					// calls the bounds and LOD functions on this worker, they are documented as thread safe
+					GatherPackageData(*(*slices.pList)[i], dpPtr, bucket.bins);
+					bucket.bHasPackages = true;
+				}
+			}
+		});
+
+		// merge the slices back in list order, which keeps the output identical to the serial path
+		bool bHasPackages = false;
+		for (size_t i = 0; i < numBuckets; ++i)
+		{
+			PackageBucket& bucket = m_collectBuckets[i];
+			m_packageBins.Append(bucket.bins);
+			bHasPackages |= bucket.bHasPackages;
+		}
+
+		// NOTE: the serial path registers once per object, the renderer only needs to hear it once
+		if (bHasPackages)
+		{
+			m_renderer.AddEffect(this);
+		}
+
+		return true;
+	}
 }
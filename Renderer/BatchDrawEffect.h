@@ -1,53 +1,460 @@
-// BatchDrawEffect.h
-// Using the power of TextureArrays and large vertex arrays, this type is intended to allow
-// rendering of many animated vertex objects as one draw call
-#pragma once
-#ifndef BATCH_DRAW_EFFECT_H
-#define BATCH_DRAW_EFFECT_H
-
-#include "IEffect.h"
-#include "IMultiDraw.h"
-#include "DrawPackageBuilder.h"
-#include "TexturePack.h"
-#include "IEffectImpl.h"
-
-namespace GamePrototype
-{
-	class Renderer;
-	struct EffectInitInfo;
-
-	class BatchDrawEffect : public IEffect
-	{
-	public:
-		explicit BatchDrawEffect(const EffectInitInfo&);
-
-		enum TotalPasses
-		{
-			kFirstPass,
-			kSecondPass,
-			kMaxPasses
-		};
-
-		enum MyShaderPassIndex
-		{
-			kStaticShadowShaderIndex,
-			kStaticShaderIndex,
-			kDynamicShadowShaderIndex,
-			kDynamicShaderIndex,
-			kStaticAlphaBlendShaderIndex,
-			kDynamicAlphaBlendShaderIndex,
-			kMaxShaderIndex
-		};
-
-	protected:
-
-		// IEffect
-		virtual Type GetType() const override { return kBase; }
-		virtual const Graphics::MaterialList& GetMaterials() const override;
-
-		Renderer&								m_renderer;
-		const Graphics::MaterialList			m_materialList;
-	};
-}
-
-#endif //BATCH_DRAW_EFFECT_H
+// BatchDrawEffect.h
+// Using the power of TextureArrays and large vertex arrays, this type is intended to allow
+// rendering of many animated vertex objects as one draw call
+#pragma once
+#ifndef BATCH_DRAW_EFFECT_H
+#define BATCH_DRAW_EFFECT_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "IEffect.h"
+#include "IMultiDraw.h"
+#include "DrawPackageBuilder.h"
+#include "TexturePack.h"
+#include "IEffectImpl.h"
+#include "WorkerPool.h"
+#include "StaticPackageRegistry.h"
+#include "DrawPackageBins.h"
+#include "FrameArena.h"
+#include "MPSCQueue.h"
+#include "DrawPackageCache.h"
+#include "DrawPackageDiskCache.h"
+#include "FrustumCuller.h"
+#include "LodSelector.h"
+#include "DepthSorter.h"
+#include "InstanceTransform.h"
+
+namespace GamePrototype
+{
+	class Renderer;
+	struct EffectInitInfo;
+
+	class BatchDrawEffect : public IEffect
+	{
+	public:
+		explicit BatchDrawEffect(const EffectInitInfo&);
+		virtual ~BatchDrawEffect() override;
+
+		enum TotalPasses
+		{
+			kFirstPass,
+			kSecondPass,
+			kMaxPasses
+		};
+
+		enum MyShaderPassIndex
+		{
+			kStaticShadowShaderIndex,
+			kStaticShaderIndex,
+			kDynamicShadowShaderIndex,
+			kDynamicShaderIndex,
+			kStaticAlphaBlendShaderIndex,
+			kDynamicAlphaBlendShaderIndex,
+			kMaxShaderIndex
+		};
+
+		// Collect(std::vector) is spread across a WorkerPool when the list is large enough.
+		// Per-frame package order is identical to the serial path. A null pool uses WorkerPool::GetDefault().
+		// With it on, the bounds and LOD functions below are called from several worker threads at once
+		void SetParallelCollect(bool bEnable, const WorkerPoolPtr& poolPtr = WorkerPoolPtr());
+		bool IsParallelCollect() const { return m_bParallelCollect; }
+
+		// DrawPackages missing at Collect() are no longer built inline: the object is handed to the WorkerPool
+		// for the prepare function below, and skipped until its package is built on the render thread in
+		// ClearForNextFrame(). Without a prepare function the builds are only deferred to there
+		void SetAsyncPackageBuilds(bool bEnable, const WorkerPoolPtr& poolPtr = WorkerPoolPtr());
+		bool IsAsyncPackageBuilds() const { return m_bAsyncPackageBuilds; }
+		size_t GetNumPendingPackageBuilds() const { return m_pendingBuilds.size(); }
+
+		// the CPU side of an async build (loading, decoding and processing the object's mesh and texture data),
+		// run on a worker thread so that the render thread's BuildDrawPackage() only has the uploads left.
+		// It must not touch the render context, the GPU or the IMultiDraw objects. Return false on failure,
+		// the next Collect() of the object asks again
+		typedef std::function<bool(const Graphics::RenderObject&)> PreparePackageFunc;
+		void SetPreparePackageFunc(const PreparePackageFunc& prepareFunc) { m_preparePackageFunc = prepareFunc; }
+
+		// objects whose key function reports the same content identity share one DrawPackage's vertex range
+		// and texture slot instead of each building their own (see DrawPackageCache). Sharing needs both
+		// functions, an empty one turns it off. Dynamic packages are never shared
+		void SetPackageCacheFuncs(const DrawPackageCache::KeyFunc& keyFunc,
+			const DrawPackageCache::InstanceFunc& instanceFunc = DrawPackageCache::InstanceFunc());
+		const DrawPackageCache& GetPackageCache() const { return m_packageCache; }
+
+		// packages missing from the DrawPackageCache are looked up on disk before being built, and new builds
+		// are stored for the next launch (call Save() on the disk cache when convenient, e.g. after loading).
+		// Needs the content key function above, but not the instance function. A null cache turns it off
+		void SetPackageDiskCache(const DrawPackageDiskCachePtr& diskCachePtr, const DrawPackageDiskCache::Codec& codec);
+
+		// world space bounds of an object, applied to every package it owns. Called from Collect(): with
+		// parallel collect on that is several worker threads at once, so it must be thread safe (only read
+		// the object, no shared scratch state). Return false for no bounds, such objects are never culled
+		typedef std::function<bool(const Graphics::RenderObject&, BoundingSphere&)> BoundsFunc;
+		void SetBoundsFunc(const BoundsFunc& boundsFunc) { m_boundsFunc = boundsFunc; }
+
+		// a version (or hash) of an object's world transform that changes whenever it moves, turns or scales.
+		// The static registries compare it to find the instances to re-upload. Thread safe like the bounds
+		// function. Without one, or when it returns false, only a change of the object's bounds marks its
+		// static instances moved
+		typedef std::function<bool(const Graphics::RenderObject&, uint64_t& transformKey)> TransformFunc;
+		void SetTransformFunc(const TransformFunc& transformFunc) { m_transformFunc = transformFunc; }
+
+		// an object's world matrix as parent * local, column major 4x4s left in place until the upload of the
+		// frame is done. With one, the moved static instances are composed in batches (objects under one parent
+		// share it) by InstanceTransform::ComposeBatch(), straight into their IMultiDraw object's mapped
+		// instance buffer. Render thread only. Without one, or when it returns false for an object in a range,
+		// the IMultiDraw object writes the range's matrices itself
+		typedef std::function<bool(const Graphics::RenderObject&, const float*& pParent, const float*& pLocal)> InstanceMatrixFunc;
+		void SetInstanceMatrixFunc(const InstanceMatrixFunc& instanceMatrixFunc) { m_instanceMatrixFunc = instanceMatrixFunc; }
+
+		// draw command of one instance of a package in its IMultiDraw object's buffers.
+		// Laid out like VkDrawIndirectCommand and GL's DrawArraysIndirectCommand
+		struct DrawCommand
+		{
+			uint32_t							vertexCount;
+			uint32_t							instanceCount;
+			uint32_t							firstVertex;
+			uint32_t							firstInstance;
+		};
+
+		// the IMultiDraw objects own the vertex ranges, so the draw command of a package comes from the client.
+		// instance: a static package's instance index in its IMultiDraw object's instance buffer (see
+		// StaticPackageRegistry::GetInstanceOffsets()), 0 for dynamic packages. Return false for nothing to draw.
+		// Culling, LOD selection and depth sorting need it, and it can not be cleared while any of them is on
+		typedef std::function<bool(const DrawPackageData&, uint32_t instance, DrawCommand&)> DrawCommandFunc;
+		bool SetDrawCommandFunc(const DrawCommandFunc& drawCommandFunc);
+		const DrawCommandFunc& GetDrawCommandFunc() const { return m_drawCommandFunc; }
+
+		// packages outside the camera frustum are not drawn. The IMultiDraw objects are still fed everything
+		// collected, once per frame (the static ones only when their registry changes): each Draw() culls and
+		// draws its visible part through draw commands of its own, written to a fresh region of the frame's
+		// command buffer, so nothing an earlier pass of the frame recorded against is rewritten. A pass that
+		// sees the same set as the one before it draws that region again. Static packages are queried from the
+		// registries' BVH. Fails without a draw command function
+		virtual bool SetFrustumCulling(bool bEnable);
+		bool IsFrustumCulling() const { return m_bFrustumCulling; }
+
+		struct CullStats
+		{
+			size_t								numVisible;
+			size_t								numTotal;
+
+			CullStats() : numVisible(0), numTotal(0) {}
+		};
+
+		// the last Draw() of the given bin
+		const CullStats& GetCullStats(DrawPackageBins::BinIndex binIndex) const { return m_cullStats[binIndex]; }
+
+		// level of detail. A DrawPackage may hold several versions of its mesh, each as its own data entries
+		// (and so its own vertex ranges in the IMultiDraw buffers). The LOD function reports the level of an
+		// entry (0 being the most detailed) and how many levels the object has. Return false for an entry
+		// without levels. Thread safe like the bounds function, it is called from the same place
+		typedef std::function<bool(const Graphics::RenderObject&, size_t entryIndex, uint32_t& level, uint32_t& numLevels)> LodFunc;
+		void SetLodFunc(const LodFunc& lodFunc) { m_lodFunc = lodFunc; }
+
+		// with selection on, each Draw() picks every object's level from its bounds under the pass camera
+		// (see LodSelector), and drops objects below the contribution threshold. Like culling, each Draw()
+		// then draws through its own commands. Off: only level 0 is collected. Fails without a draw command function
+		virtual bool SetLodSelection(bool bEnable);
+		bool IsLodSelection() const { return m_bLodSelection; }
+
+		// thresholds, may be tuned at any time
+		void SetLodSettings(const LodSettings& settings) { m_lodSettings = settings; }
+		const LodSettings& GetLodSettings() const { return m_lodSettings; }
+
+		// opaque packages are fed front to back, alpha blended ones back to front, ordered by the view depth of
+		// their bounds (see DepthSorter). The camera is the one of the last non shadow Draw(), so the order
+		// lags the camera by a frame. Dynamic bins are sorted once per frame before anything is fed, the
+		// order of the static registries is kept until the camera or the static set moves. Like culling,
+		// each Draw() then draws through its own commands. Fails without a draw command function
+		virtual bool SetDepthSorting(bool bEnable);
+		bool IsDepthSorting() const { return m_bDepthSorting; }
+
+		// shadow casting lights, one volume each: the light's frustum (spot/directional) or range (point),
+		// and the cameras (CameraDrawInfo::viewProjMat) its shadow map is drawn with, six for a cube map
+		struct ShadowLightVolume
+		{
+			enum VolumeType
+			{
+				kFrustumVolume,
+				kSphereVolume
+			};
+
+			VolumeType							type;
+			Frustum								frustum;
+			BoundingSphere						sphere;
+			std::vector<Math::mat4>				viewProjs;
+
+			explicit ShadowLightVolume(const Graphics::CameraDrawInfo& lightCamera) : type(kFrustumVolume), frustum(lightCamera), viewProjs(1, lightCamera.viewProjMat) {}
+			explicit ShadowLightVolume(const Frustum& f) : type(kFrustumVolume), frustum(f) {}
+			explicit ShadowLightVolume(const BoundingSphere& s) : type(kSphereVolume), sphere(s) {}
+		};
+
+		// with culling on, a shadow Draw() whose camera is one of a light's viewProjs (the exact matrix) only
+		// gets the casters touching that light, in any order of lights and passes. Each light's casters are
+		// written to command sets of their own once per frame, which every Draw() for the light draws.
+		// Set each frame the lights move, at most s_kMaxShadowLights. Empty, or a shadow Draw() matching no
+		// light: nothing is frustum culled for the pass, casters outside its view may still cast into it
+		void SetShadowLights(const std::vector<ShadowLightVolume>& lights);
+		size_t GetNumShadowLights() const { return m_shadowLights.size(); }
+
+		// this frame's casters for a light, indices into the bin (static bins: into the registry)
+		const std::vector<uint32_t>& GetShadowCasters(size_t lightIndex, DrawPackageBins::BinIndex);
+
+		// matches MAX_LIGHTS / ShadowMatBuf in the shaders
+		static const size_t						s_kMaxShadowLights = 9;
+
+	protected:
+
+		// IEffect
+		virtual Type GetType() const override { return kBase; }
+		virtual const Graphics::MaterialList& GetMaterials() const override;
+
+		// builds the DrawPackage for an object that does not have one yet. Builders touch the render context,
+		// so this is only ever called on the render thread, async builds included (see SetPreparePackageFunc())
+		virtual DrawPackagePtr BuildDrawPackage(const Graphics::RenderObjectPtr&) = 0;
+
+		// returns the object's DrawPackage, building it inline or requesting an async build.
+		// Null while an async build is pending
+		DrawPackagePtr AcquireDrawPackage(const Graphics::RenderObjectPtr&);
+
+		// render thread: builds the DrawPackages of the objects the workers finished preparing
+		void PublishBuiltPackages();
+		void WaitForPackageBuilds();
+
+		// render thread, when the IMultiDraw objects are about to go: waits for the workers and drops what
+		// they prepared without building it
+		void DiscardPackageBuilds();
+
+		// shared by both Collect() paths. Derived types make the same checks on their IMultiDraw objects
+		// as their Collect(RenderObjectPtr) first, since the parallel path does not go through it
+		bool CollectList(const std::vector<Graphics::RenderObjectPtr>&);
+		void GatherPackageData(const Graphics::RenderObject&, const DrawPackagePtr&, DrawPackageBins&) const;
+
+		// feeds a package list to an IMultiDraw object, passing FirstToken on the first Add() since the last reset
+		template <typename PackageList>
+		static void AddToMultiDraw(const MultiDrawPtr& drawPtr, const PackageList& packages, bool& bIsFirst)
+		{
+			for (const auto& dataPtr : packages)
+			{
+				if (bIsFirst)
+				{
+					drawPtr->Add(dataPtr, IMultiDraw::FirstToken());
+					bIsFirst = false;
+				}
+				else
+				{
+					drawPtr->Add(dataPtr);
+				}
+			}
+		}
+
+		// static registries repeat a package once per object sharing it
+		static void AddToMultiDraw(const MultiDrawPtr& drawPtr, const StaticPackageRegistry& registry, bool& bIsFirst);
+
+		// a static IMultiDraw object fed the whole registry re-uploads only the instances the registry saw move
+		// (IMultiDraw::UpdateInstances()), instead of a full Update(). Which object each instance belongs to is the
+		// registry's GetInstanceOwners(). Clears the registry's dirty instances. With an instance matrix function
+		// the ranges are first written in the object's instance format through IMultiDraw::MapInstances(first,
+		// count), which returns where those instances live in its (mapped or staging) instance buffer, at
+		// InstanceTransform::GetStride() bytes apart, or null. A range written there is uploaded as it is by the
+		// next UpdateInstances(), the others the object still writes itself
+		bool UploadMovedInstances(const MultiDrawPtr& drawPtr, StaticPackageRegistry& registry,
+			InstanceTransform::Format format = InstanceTransform::kMat4);
+
+		// Draw() draws the visible part of each IMultiDraw object through its own draw commands (culling,
+		// LOD selection or depth sorting on), instead of everything the object was fed
+		bool IsCullingInDraw() const { return m_bFrustumCulling || m_bLodSelection || m_bDepthSorting; }
+
+		// sort stage, before CheckBuffers() feeds anything. Orders this frame's dynamic bins in place
+		void SortPackages();
+
+		// the camera the next SortPackages() orders by, from non shadow Draw() calls
+		void SetSortView(const Graphics::CameraDrawInfo&);
+
+		// alpha blended packages are blended order independently (weighted blended OIT), depth sorting then
+		// leaves the alpha bins and registries in whatever order they were collected in
+		void SetOrderIndependentAlpha(bool bEnable);
+		bool IsOrderIndependentAlpha() const { return m_bOrderIndependentAlpha; }
+
+		// the pool given to SetParallelCollect()/SetAsyncPackageBuilds(), or WorkerPool::GetDefault()
+		WorkerPoolPtr GetWorkerPool() const;
+
+		// culls a dynamic bin for one Draw() (a null frustum keeps everything), then keeps the selected level of
+		// each object (null: no LOD selection) and records the bin's stats.
+		// Returns true when the result differs from the set whose commands were last built this frame, in
+		// which case new ones are built (BuildVisibleCommands()) and written to a fresh region. Otherwise the
+		// region written for the earlier pass is drawn again
+		bool CullDynamicBin(DrawPackageBins::BinIndex, const Frustum*, const LodSelector* pLods = nullptr);
+
+		// same for a static bin, answered by its registry's BVH
+		bool CullStaticBin(DrawPackageBins::BinIndex, const Frustum*, const LodSelector* pLods = nullptr);
+
+		// the draw commands of the bin's visible packages (static: every instance of them), in draw order
+		void BuildVisibleCommands(DrawPackageBins::BinIndex, std::vector<DrawCommand>& commands);
+
+		// which of the bin's command sets the last cull filled: 0 for a camera, 1 + light for a light's casters.
+		// Backends keep a command region per set and bin, so each light's stays put through the frame
+		static const size_t						s_kNumCommandSets = 1 + s_kMaxShadowLights;
+		size_t GetCommandSet(DrawPackageBins::BinIndex binIndex) const { return m_cullResults[binIndex].commandSet; }
+
+		// shadow passes with SetShadowLights(): picks the casters of the light drawn with the pass camera for
+		// the bin instead of culling against it. Returns false (and leaves the bin alone) if no light matches
+		bool HasShadowLights() const { return !m_shadowLights.empty(); }
+		bool SelectShadowCasters(const Graphics::CameraDrawInfo&, DrawPackageBins::BinIndex, bool& bChanged, const LodSelector* pLods = nullptr);
+
+		// called from ClearForNextFrame(). Everything allocated from m_frameArena is handed back
+		void ResetFrameAllocations();
+
+		Renderer&								m_renderer;
+		const Graphics::MaterialList			m_materialList;
+
+		// backs every per frame container below. Reset in ClearForNextFrame()
+		FrameArena								m_frameArena;
+
+		// this frame's collected packages, one bin per IMultiDraw object
+		DrawPackageBins							m_packageBins;
+
+		// static packages are retained across frames, the static IMultiDraw objects
+		// are only rebuilt when these report a change
+		StaticPackageRegistry					m_staticRegistry;
+		StaticPackageRegistry					m_alphaStaticRegistry;
+
+	private:
+
+		StaticPackageRegistry& GetStaticRegistry(DrawPackageBins::BinIndex);
+		void BuildShadowCasterLists();
+		bool FindShadowLight(const Graphics::CameraDrawInfo&, size_t& lightIndex) const;
+		bool IsVisibleSetChanged(DrawPackageBins::BinIndex) const;
+		void SelectLods(DrawPackageBins::BinIndex, const LodSelector&);
+		void OrderStaticVisible(DrawPackageBins::BinIndex);
+		void RecordCullStats(DrawPackageBins::BinIndex);
+
+		bool CollectParallel(const std::vector<Graphics::RenderObjectPtr>&, size_t count);
+		void RequestPackageBuild(const Graphics::RenderObjectPtr&, bool bHasKey, bool bShared,
+			DrawPackageCache::Key key, const DrawPackageCache::Identity& identity);
+		DrawPackagePtr LoadFromDiskCache(const Graphics::RenderObjectPtr&, DrawPackageCache::Key key);
+		void StoreToDiskCache(const Graphics::RenderObject&, DrawPackageCache::Key key, const DrawPackagePtr&);
+
+		// thread local output of one contiguous slice of the collected list.
+		// Slices are merged back in order, so no locking is needed while filling them
+		struct PackageBucket
+		{
+			DrawPackageBins						bins;
+			bool								bHasPackages;
+		};
+
+		std::vector<PackageBucket>				m_collectBuckets;
+		WorkerPoolPtr							m_workerPoolPtr;
+		bool									m_bParallelCollect;
+
+		// async DrawPackage builds. Prepared objects come back through a lock free queue
+		struct PreparedBuild
+		{
+			Graphics::RenderObjectPtr			objPtr;
+			DrawPackageCache::Key				key;
+			DrawPackageCache::Identity			identity;
+			bool								bHasKey;	// stored to the disk cache
+			bool								bShared;	// inserted into the DrawPackageCache
+			bool								bPrepared;
+		};
+
+		MPSCQueue<PreparedBuild>				m_preparedBuilds;
+		std::unordered_set<const Graphics::RenderObject*>	m_pendingBuilds;	// render thread only
+		PreparePackageFunc						m_preparePackageFunc;
+		std::mutex								m_buildCountMutex;
+		std::condition_variable					m_buildsDoneCondition;
+		size_t									m_numBuildsInFlight;	// guarded by m_buildCountMutex
+		bool									m_bAsyncPackageBuilds;
+
+		// content keyed sharing, render thread only
+		DrawPackageCache						m_packageCache;
+		DrawPackageCache::KeyFunc				m_packageKeyFunc;
+		DrawPackageCache::InstanceFunc			m_packageInstanceFunc;
+		std::unordered_set<DrawPackageCache::Key>	m_pendingKeys;		// async builds whose result goes in the cache
+		uint32_t								m_framesSincePrune;
+		DrawPackageDiskCachePtr					m_diskCachePtr;
+		DrawPackageDiskCache::Codec				m_diskCacheCodec;
+
+		// culling
+		struct CullResult
+		{
+			std::vector<uint32_t>				visible;	// indices into the bin (static: the registry)
+			size_t								commandSet;	// that 'visible' belongs to
+
+			CullResult() : commandSet(0) {}
+		};
+
+		// the set the last BuildVisibleCommands() wrote into a command set
+		struct BuiltSet
+		{
+			std::vector<uint32_t>				indices;
+			bool								bBuilt;		// this frame
+			uint32_t							generation;	// static: registry generation of 'indices'
+			uint32_t							boundsVersion;	// static: registry bounds version of 'indices'
+
+			BuiltSet() : bBuilt(false), generation(0), boundsVersion(0) {}
+		};
+
+		// ComposeBatch() of one moved range, false if the IMultiDraw object has to write it
+		bool ComposeMovedInstances(IMultiDraw&, const StaticPackageRegistry&, const InstanceRange&, InstanceTransform::Format);
+
+		BoundsFunc								m_boundsFunc;
+		TransformFunc							m_transformFunc;
+		InstanceMatrixFunc						m_instanceMatrixFunc;
+		std::vector<float>						m_composeParents;		// scratch, 16 floats per parent
+		std::vector<uint32_t>					m_composeParentIndices;	// scratch, per instance
+		std::vector<float>						m_composeLocals;		// scratch, 16 floats per instance
+		std::unordered_map<const float*, uint32_t>	m_composeParentSlots;	// scratch, parent -> index
+		DrawCommandFunc							m_drawCommandFunc;
+		CullResult								m_cullResults[DrawPackageBins::kMaxBins];
+		BuiltSet								m_builtSets[s_kNumCommandSets][DrawPackageBins::kMaxBins];
+		CullStats								m_cullStats[DrawPackageBins::kMaxBins];
+		bool									m_bFrustumCulling;
+
+		// level of detail
+		LodFunc									m_lodFunc;
+		LodSettings								m_lodSettings;
+		bool									m_bLodSelection;
+
+		// depth sorting. Static orders are indices into the registry, with each index's position in 'ranks'
+		struct StaticSortOrder
+		{
+			std::vector<uint32_t>				order;
+			std::vector<uint32_t>				ranks;
+			float								viewMat[16];
+			uint32_t							generation;
+			uint32_t							boundsVersion;
+			bool								bValid;
+
+			StaticSortOrder() : viewMat{}, generation(0), boundsVersion(0), bValid(false) {}
+		};
+
+		DepthSorter								m_depthSorter;
+		StaticSortOrder							m_staticSortOrders[2];		// opaque, alpha
+		std::vector<uint32_t>					m_dynamicSortOrder;
+		float									m_sortViewMat[16];
+		bool									m_bHasSortView;
+		bool									m_bDepthSorting;
+		bool									m_bOrderIndependentAlpha;
+
+		// per light caster lists, built on the first shadow Draw() of a frame
+		std::vector<ShadowLightVolume>			m_shadowLights;
+		std::vector<uint32_t>					m_shadowCasters[s_kMaxShadowLights][DrawPackageBins::kMaxBins];
+		bool									m_bShadowCastersBuilt;
+
+		static const uint32_t					s_kPackageCachePruneFrames = 300;
+
+		// clean instances between two moved ones before they are uploaded as one range (a mat4 each)
+		static const uint32_t					s_kMaxDirtyInstanceGap = 4;
+
+		// below this the wake up cost of the pool outweighs the work
+		static const size_t						s_kMinParallelCollectCount = 1024;
+	};
+}
+
+#endif //BATCH_DRAW_EFFECT_H
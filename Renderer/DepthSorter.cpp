@@ -0,0 +1,130 @@
+// DepthSorter.cpp
+#ifndef __linux__
+#include "stdafx.h"
+#endif
+
+#include <cfloat>
+#include <cstring>
+#include <utility>
+
+#include "DepthSorter.h"
+
+namespace GamePrototype
+{
+	namespace
+	{
+		// distance in front of the camera, which looks down -z in view space
+		inline float ViewDepth(const float* pViewMat, float x, float y, float z, float radius)
+		{
+			if (radius == FLT_MAX)
+			{
+				return FLT_MAX;
+			}
+
+			return -(pViewMat[2] * x + pViewMat[6] * y + pViewMat[10] * z + pViewMat[14]);
+		}
+	}
+
+	uint32_t DepthSorter::ToKey(float depth)
+	{
+		uint32_t bits;
+		memcpy(&bits, &depth, sizeof(bits));
+
+		// negatives: flip everything so larger magnitudes come first. Positives: set the sign bit so they
+		// come after the negatives
+		const uint32_t mask = (bits & 0x80000000u) ? 0xffffffffu : 0x80000000u;
+		return bits ^ mask;
+	}
+
+	void DepthSorter::Sort(const float* pViewMat, const float* pCenterX, const float* pCenterY, const float* pCenterZ,
+		const float* pRadius, size_t count, Order sortOrder, std::vector<uint32_t>& order)
+	{
+		m_keys.resize(count);
+		order.resize(count);
+
+		const uint32_t flip = (sortOrder == kBackToFront) ? 0xffffffffu : 0u;
+		for (size_t i = 0; i < count; ++i)
+		{
+			m_keys[i] = ToKey(ViewDepth(pViewMat, pCenterX[i], pCenterY[i], pCenterZ[i], pRadius[i])) ^ flip;
+			order[i] = static_cast<uint32_t>(i);
+		}
+
+		RadixSort(order);
+	}
+
+	void DepthSorter::Sort(const float* pViewMat, const std::vector<BoundingSphere>& bounds, Order sortOrder, std::vector<uint32_t>& order)
+	{
+		const size_t count = bounds.size();
+		m_keys.resize(count);
+		order.resize(count);
+
+		const uint32_t flip = (sortOrder == kBackToFront) ? 0xffffffffu : 0u;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const BoundingSphere& sphere = bounds[i];
+			m_keys[i] = ToKey(ViewDepth(pViewMat, sphere.center[0], sphere.center[1], sphere.center[2], sphere.radius)) ^ flip;
+			order[i] = static_cast<uint32_t>(i);
+		}
+
+		RadixSort(order);
+	}
+
+	void DepthSorter::RadixSort(std::vector<uint32_t>& order)
+	{
+		const size_t count = m_keys.size();
+		m_scratchKeys.resize(count);
+		m_scratchOrder.resize(count);
+
+		uint32_t* pKeys = m_keys.data();
+		uint32_t* pOrder = order.data();
+		uint32_t* pOutKeys = m_scratchKeys.data();
+		uint32_t* pOutOrder = m_scratchOrder.data();
+
+		// all four histograms in one read of the keys
+		size_t histograms[4][256] = {};
+		for (size_t i = 0; i < count; ++i)
+		{
+			const uint32_t key = pKeys[i];
+			++histograms[0][key & 0xff];
+			++histograms[1][(key >> 8) & 0xff];
+			++histograms[2][(key >> 16) & 0xff];
+			++histograms[3][key >> 24];
+		}
+
+		for (int pass = 0; pass < 4; ++pass)
+		{
+			size_t* pHistogram = histograms[pass];
+			const int shift = pass * 8;
+
+			// every key has the same digit, this pass would not move anything
+			if (count == 0 || pHistogram[(pKeys[0] >> shift) & 0xff] == count)
+			{
+				continue;
+			}
+
+			size_t offset = 0;
+			for (int digit = 0; digit < 256; ++digit)
+			{
+				const size_t digitCount = pHistogram[digit];
+				pHistogram[digit] = offset;
+				offset += digitCount;
+			}
+
+			for (size_t i = 0; i < count; ++i)
+			{
+				const size_t dst = pHistogram[(pKeys[i] >> shift) & 0xff]++;
+				pOutKeys[dst] = pKeys[i];
+				pOutOrder[dst] = pOrder[i];
+			}
+
+			std::swap(pKeys, pOutKeys);
+			std::swap(pOrder, pOutOrder);
+		}
+
+		// an odd number of passes left the result in the scratch buffers
+		if (pOrder != order.data())
+		{
+			memcpy(order.data(), pOrder, count * sizeof(uint32_t));
+		}
+	}
+}
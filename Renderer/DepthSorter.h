@@ -0,0 +1,47 @@
+// DepthSorter.h
+// View depth ordering for BatchDrawEffect's draw submission. Opaque packages go front to back so early
+// depth testing rejects what is hidden, translucent ones back to front so they blend correctly.
+// Keys are the view space depths of the package bounds' centers, flipped into unsigned integers that
+// sort like the floats did, and ordered with an LSD radix sort (8 bits a pass, passes where every key
+// has the same digit are skipped). Scratch memory is kept between calls
+#pragma once
+#ifndef DEPTH_SORTER_H
+#define DEPTH_SORTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "FrustumCuller.h"
+
+namespace GamePrototype
+{
+	class DepthSorter
+	{
+	public:
+		enum Order
+		{
+			kFrontToBack,
+			kBackToFront
+		};
+
+		// column major view matrix. Fills order with 0..count-1, sorted by the depth of each center.
+		// Objects without bounds (FLT_MAX radius) count as the farthest. Equal depths keep their input order
+		void Sort(const float* pViewMat, const float* pCenterX, const float* pCenterY, const float* pCenterZ,
+			const float* pRadius, size_t count, Order, std::vector<uint32_t>& order);
+		void Sort(const float* pViewMat, const std::vector<BoundingSphere>& bounds, Order, std::vector<uint32_t>& order);
+
+		// unsigned integer that orders the same way as the float
+		static uint32_t ToKey(float depth);
+
+	private:
+
+		void RadixSort(std::vector<uint32_t>& order);
+
+		std::vector<uint32_t>				m_keys;
+		std::vector<uint32_t>				m_scratchKeys;
+		std::vector<uint32_t>				m_scratchOrder;
+	};
+}
+
+#endif // DEPTH_SORTER_H
@@ -0,0 +1,118 @@
+// DirtyRangeTracker.cpp
+#ifndef __linux__
+#include "stdafx.h"
+#endif
+
+#include <algorithm>
+#include <cassert>
+
+#include "DirtyRangeTracker.h"
+
+namespace GamePrototype
+{
+	DirtyRangeTracker::DirtyRangeTracker()
+	:
+	m_size(0),
+	m_numDirty(0),
+	m_firstWord(1),
+	m_lastWord(0)
+	{
+	}
+
+	void DirtyRangeTracker::Resize(size_t count)
+	{
+		m_size = count;
+		m_words.assign((count + 63) / 64, 0);
+		m_ranges.clear();
+		m_numDirty = 0;
+		m_firstWord = 1;
+		m_lastWord = 0;
+	}
+
+	void DirtyRangeTracker::MarkDirty(uint32_t index)
+	{
+		assert(index < m_size);
+		if (index >= m_size)
+		{
+			return;
+		}
+
+		const size_t word = index / 64;
+		const uint64_t bit = uint64_t(1) << (index % 64);
+		if (m_words[word] & bit)
+		{
+			return;
+		}
+
+		m_words[word] |= bit;
+		++m_numDirty;
+
+		if (m_firstWord > m_lastWord)
+		{
+			m_firstWord = m_lastWord = word;
+		}
+		else
+		{
+			m_firstWord = std::min(m_firstWord, word);
+			m_lastWord = std::max(m_lastWord, word);
+		}
+	}
+
+	void DirtyRangeTracker::MarkDirty(uint32_t first, uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			MarkDirty(first + i);
+		}
+	}
+
+	const std::vector<InstanceRange>& DirtyRangeTracker::Coalesce(uint32_t maxGap)
+	{
+		m_ranges.clear();
+		if (m_numDirty == 0)
+		{
+			return m_ranges;
+		}
+
+		for (size_t word = m_firstWord; word <= m_lastWord; ++word)
+		{
+			uint64_t bits = m_words[word];
+			for (uint32_t bit = 0; bits != 0; ++bit, bits >>= 1)
+			{
+				if ((bits & 1) == 0)
+				{
+					continue;
+				}
+
+				const uint32_t index = static_cast<uint32_t>(word * 64 + bit);
+				if (!m_ranges.empty())
+				{
+					InstanceRange& last = m_ranges.back();
+					const uint32_t end = last.first + last.count;
+					if (index - end <= maxGap)
+					{
+						last.count = index - last.first + 1;
+						continue;
+					}
+				}
+
+				InstanceRange range = { index, 1 };
+				m_ranges.push_back(range);
+			}
+		}
+
+		return m_ranges;
+	}
+
+	void DirtyRangeTracker::Clear()
+	{
+		for (size_t word = m_firstWord; word <= m_lastWord; ++word)
+		{
+			m_words[word] = 0;
+		}
+
+		m_numDirty = 0;
+		m_firstWord = 1;
+		m_lastWord = 0;
+	}
+}
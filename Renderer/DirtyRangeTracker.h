@@ -0,0 +1,55 @@
+// DirtyRangeTracker.h
+// Which instances of a buffer changed since its last upload, as a bit per instance. Coalesce() turns them
+// into ascending ranges for partial uploads (buffer copy regions, glBufferSubData), merging ranges that
+// are only a few clean instances apart since one larger copy is cheaper than two small ones. Only the
+// words touched since the last Clear() are scanned or reset
+#pragma once
+#ifndef DIRTY_RANGE_TRACKER_H
+#define DIRTY_RANGE_TRACKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace GamePrototype
+{
+	struct InstanceRange
+	{
+		uint32_t							first;
+		uint32_t							count;
+	};
+
+	class DirtyRangeTracker
+	{
+	public:
+		DirtyRangeTracker();
+
+		// instances 0..count-1, all clean
+		void Resize(size_t count);
+		size_t GetSize() const { return m_size; }
+
+		void MarkDirty(uint32_t index);
+		void MarkDirty(uint32_t first, uint32_t count);
+
+		bool IsEmpty() const { return m_numDirty == 0; }
+		size_t GetNumDirty() const { return m_numDirty; }
+
+		// the dirty instances as ascending ranges. Ranges with at most maxGap clean instances between them
+		// become one. Valid until the next call
+		const std::vector<InstanceRange>& Coalesce(uint32_t maxGap);
+
+		// everything clean again, after an upload
+		void Clear();
+
+	private:
+
+		std::vector<uint64_t>				m_words;
+		std::vector<InstanceRange>			m_ranges;
+		size_t								m_size;
+		size_t								m_numDirty;
+		size_t								m_firstWord;		// touched words, m_firstWord > m_lastWord when none
+		size_t								m_lastWord;
+	};
+}
+
+#endif // DIRTY_RANGE_TRACKER_H
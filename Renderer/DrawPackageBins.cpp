@@ -0,0 +1,204 @@
+// DrawPackageBins.cpp
+#ifndef __linux__
+#include "stdafx.h"
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+#include "DrawPackageBins.h"
+
+namespace GamePrototype
+{
+	namespace
+	{
+		template <typename T>
+		void AppendColumn(FrameVector<T>& column, const FrameVector<T>& rhs)
+		{
+			column.insert(column.end(), rhs.begin(), rhs.end());
+		}
+
+		template <typename T>
+		void PermuteColumn(FrameVector<T>& column, const std::vector<uint32_t>& order)
+		{
+			// the old storage goes back with the rest of the arena
+			FrameVector<T> permuted(column.get_allocator());
+			permuted.reserve(order.size());
+			for (uint32_t index : order)
+			{
+				permuted.push_back(std::move(column[index]));
+			}
+
+			column.swap(permuted);
+		}
+
+		template <typename T>
+		void ReleaseColumn(FrameVector<T>& column)
+		{
+			FrameVector<T>(column.get_allocator()).swap(column);
+		}
+	}
+
+	void DrawPackageBin::Append(DrawPackageBin& rhs)
+	{
+		// rhs is emptied here, remember how big it got for its next frame
+		rhs.frameSize = std::max(rhs.frameSize, rhs.packages.size());
+
+		packages.insert(packages.end(),
+			std::make_move_iterator(rhs.packages.begin()),
+			std::make_move_iterator(rhs.packages.end()));
+
+		AppendColumn(centerX, rhs.centerX);
+		AppendColumn(centerY, rhs.centerY);
+		AppendColumn(centerZ, rhs.centerZ);
+		AppendColumn(radius, rhs.radius);
+		AppendColumn(lodLevels, rhs.lodLevels);
+		AppendColumn(lodCounts, rhs.lodCounts);
+		AppendColumn(transformKeys, rhs.transformKeys);
+		AppendColumn(owners, rhs.owners);
+
+		rhs.Clear();
+	}
+
+	void DrawPackageBin::Permute(const std::vector<uint32_t>& order)
+	{
+		assert(order.size() == packages.size());
+
+		PermuteColumn(packages, order);
+		PermuteColumn(centerX, order);
+		PermuteColumn(centerY, order);
+		PermuteColumn(centerZ, order);
+		PermuteColumn(radius, order);
+		PermuteColumn(lodLevels, order);
+		PermuteColumn(lodCounts, order);
+		PermuteColumn(transformKeys, order);
+		PermuteColumn(owners, order);
+	}
+
+	void DrawPackageBin::Clear()
+	{
+		packages.clear();
+		centerX.clear();
+		centerY.clear();
+		centerZ.clear();
+		radius.clear();
+		lodLevels.clear();
+		lodCounts.clear();
+		transformKeys.clear();
+		owners.clear();
+	}
+
+	void DrawPackageBin::SetArena(FrameArena* pArena)
+	{
+		assert(packages.empty());
+		DrawPackageList(FrameArenaAllocator<DrawPackageDataPtr>(pArena)).swap(packages);
+
+		FrameArenaAllocator<float> floatAllocator(pArena);
+		FrameFloatList(floatAllocator).swap(centerX);
+		FrameFloatList(floatAllocator).swap(centerY);
+		FrameFloatList(floatAllocator).swap(centerZ);
+		FrameFloatList(floatAllocator).swap(radius);
+
+		FrameArenaAllocator<uint8_t> byteAllocator(pArena);
+		FrameByteList(byteAllocator).swap(lodLevels);
+		FrameByteList(byteAllocator).swap(lodCounts);
+
+		FrameKeyList(FrameArenaAllocator<uint64_t>(pArena)).swap(transformKeys);
+		FrameOwnerList(FrameArenaAllocator<const void*>(pArena)).swap(owners);
+	}
+
+	void DrawPackageBin::ReleaseStorage()
+	{
+		// a bin that spiked once does not keep reserving its peak, the hint follows the last frame
+		reserveHint = std::max(frameSize, packages.size());
+		frameSize = 0;
+
+		DrawPackageList(packages.get_allocator()).swap(packages);
+		ReleaseColumn(centerX);
+		ReleaseColumn(centerY);
+		ReleaseColumn(centerZ);
+		ReleaseColumn(radius);
+		ReleaseColumn(lodLevels);
+		ReleaseColumn(lodCounts);
+		ReleaseColumn(transformKeys);
+		ReleaseColumn(owners);
+	}
+
+	void DrawPackageBin::ReserveFromLastFrame()
+	{
+		packages.reserve(reserveHint);
+		centerX.reserve(reserveHint);
+		centerY.reserve(reserveHint);
+		centerZ.reserve(reserveHint);
+		radius.reserve(reserveHint);
+		lodLevels.reserve(reserveHint);
+		lodCounts.reserve(reserveHint);
+		transformKeys.reserve(reserveHint);
+		owners.reserve(reserveHint);
+	}
+
+	bool DrawPackageBins::Empty() const
+	{
+		for (const auto& bin : m_bins)
+		{
+			if (!bin.Empty())
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	size_t DrawPackageBins::Size() const
+	{
+		size_t count = 0;
+		for (const auto& bin : m_bins)
+		{
+			count += bin.Size();
+		}
+
+		return count;
+	}
+
+	void DrawPackageBins::Append(DrawPackageBins& rhs)
+	{
+		for (int i = 0; i < kMaxBins; ++i)
+		{
+			m_bins[i].Append(rhs.m_bins[i]);
+		}
+	}
+
+	void DrawPackageBins::Clear()
+	{
+		for (auto& bin : m_bins)
+		{
+			bin.Clear();
+		}
+	}
+
+	void DrawPackageBins::SetArena(FrameArena* pArena)
+	{
+		for (auto& bin : m_bins)
+		{
+			bin.SetArena(pArena);
+		}
+	}
+
+	void DrawPackageBins::ReleaseStorage()
+	{
+		for (auto& bin : m_bins)
+		{
+			bin.ReleaseStorage();
+		}
+	}
+
+	void DrawPackageBins::ReserveFromLastFrame()
+	{
+		for (auto& bin : m_bins)
+		{
+			bin.ReserveFromLastFrame();
+		}
+	}
+}
@@ -0,0 +1,136 @@
+// DrawPackageBins.h
+// Collect-time bucketing of DrawPackageData for BatchDrawEffect. Every package is classified once
+// (static/dynamic x opaque/alpha) as it is collected, so each IMultiDraw object is fed by one linear
+// scan of its own bin instead of a HasAlpha() filter over a shared list.
+// Bins are stored as structure of arrays: per package data that later stages need (sorting, culling)
+// lives in parallel arrays indexed the same way as 'packages'. Storage comes from the effect's FrameArena
+#pragma once
+#ifndef DRAW_PACKAGE_BINS_H
+#define DRAW_PACKAGE_BINS_H
+
+#include <cstdint>
+#include <vector>
+
+#include "DrawPackageBuilder.h"
+#include "FrameArena.h"
+#include "FrustumCuller.h"
+
+namespace GamePrototype
+{
+	typedef FrameVector<DrawPackageDataPtr> DrawPackageList;
+	typedef FrameVector<float> FrameFloatList;
+	typedef FrameVector<uint8_t> FrameByteList;
+	typedef FrameVector<uint64_t> FrameKeyList;
+	typedef FrameVector<const void*> FrameOwnerList;
+
+	struct DrawPackageBin
+	{
+		DrawPackageList						packages;
+
+		// world space bounding sphere of each package's object
+		FrameFloatList						centerX;
+		FrameFloatList						centerY;
+		FrameFloatList						centerZ;
+		FrameFloatList						radius;
+
+		// level of detail of each package, and how many levels its object has (see LodSelector)
+		FrameByteList						lodLevels;
+		FrameByteList						lodCounts;
+
+		// version or hash of each package's object's world transform (see BatchDrawEffect::SetTransformFunc())
+		FrameKeyList						transformKeys;
+
+		// the object each package was collected from. Identity only, never dereferenced
+		FrameOwnerList						owners;
+
+		size_t								reserveHint;	// last frame's size, zero after an empty frame
+		size_t								frameSize;		// this frame's largest size, bins emptied by Append() included
+
+		DrawPackageBin() : reserveHint(0), frameSize(0) {}
+
+		size_t Size() const { return packages.size(); }
+		bool Empty() const { return packages.empty(); }
+
+		// objects without a transform key, their bounds alone tell whether they moved
+		static const uint64_t s_kUnknownTransform = ~0ULL;
+
+		void Push(DrawPackageDataPtr&& dataPtr, const BoundingSphere& bounds, uint8_t lodLevel, uint8_t lodCount,
+			uint64_t transformKey, const void* pOwner)
+		{
+			packages.push_back(std::move(dataPtr));
+			centerX.push_back(bounds.center[0]);
+			centerY.push_back(bounds.center[1]);
+			centerZ.push_back(bounds.center[2]);
+			radius.push_back(bounds.radius);
+			lodLevels.push_back(lodLevel);
+			lodCounts.push_back(lodCount);
+			transformKeys.push_back(transformKey);
+			owners.push_back(pOwner);
+		}
+
+		// moves rhs onto the end of this bin, leaving rhs empty
+		void Append(DrawPackageBin& rhs);
+
+		// reorders every column so that entry i is what was at order[i]
+		void Permute(const std::vector<uint32_t>& order);
+		void Clear();
+
+		// frame arena bookkeeping, see DrawPackageBins
+		void SetArena(FrameArena*);
+		void ReleaseStorage();
+		void ReserveFromLastFrame();
+	};
+
+	class DrawPackageBins
+	{
+	public:
+		enum BinIndex
+		{
+			kStaticOpaque,
+			kStaticAlpha,
+			kDynamicOpaque,
+			kDynamicAlpha,
+			kMaxBins
+		};
+
+		static BinIndex Classify(const DrawPackageData& data)
+		{
+			if (data.IsDynamic())
+			{
+				return data.HasAlpha() ? kDynamicAlpha : kDynamicOpaque;
+			}
+
+			return data.HasAlpha() ? kStaticAlpha : kStaticOpaque;
+		}
+
+		void Add(DrawPackageDataPtr&& dataPtr, const BoundingSphere& bounds, uint8_t lodLevel = 0, uint8_t lodCount = 1,
+			uint64_t transformKey = DrawPackageBin::s_kUnknownTransform, const void* pOwner = nullptr)
+		{
+			const BinIndex index = Classify(*dataPtr);
+			m_bins[index].Push(std::move(dataPtr), bounds, lodLevel, lodCount, transformKey, pOwner);
+		}
+
+		DrawPackageBin& Get(BinIndex index) { return m_bins[index]; }
+		const DrawPackageBin& Get(BinIndex index) const { return m_bins[index]; }
+
+		bool Empty() const;
+		size_t Size() const;
+
+		// moves every bin of rhs onto the end of the matching bin here
+		void Append(DrawPackageBins& rhs);
+		void Clear();
+
+		// all bins allocate from pArena. Only valid while the bins are empty
+		void SetArena(FrameArena* pArena);
+		// must be called before the arena is Reset(). Remembers this frame's sizes
+		void ReleaseStorage();
+		// after the arena is Reset(): one allocation per bin sized from last frame
+		void ReserveFromLastFrame();
+
+	private:
+
+		DrawPackageBin		m_bins[kMaxBins];
+	};
+}
+
+#endif // DRAW_PACKAGE_BINS_H
@@ -0,0 +1,126 @@
+// DrawPackageCache.cpp
+#ifndef __linux__
+#include "stdafx.h"
+#endif
+
+#include "DrawPackageCache.h"
+
+namespace GamePrototype
+{
+	DrawPackageCache::DrawPackageCache()
+	:
+	m_numHits(0),
+	m_numMisses(0),
+	m_numCollisions(0)
+	{
+	}
+
+	DrawPackagePtr DrawPackageCache::Find(Key key, const Identity& identity)
+	{
+		auto iter = m_entries.find(key);
+		if (iter != m_entries.end())
+		{
+			DrawPackagePtr dpPtr = iter->second.dpPtr.lock();
+			if (!dpPtr)
+			{
+				m_entries.erase(iter);
+			}
+			else if (iter->second.identity == identity)
+			{
+				++m_numHits;
+				return dpPtr;
+			}
+			else
+			{
+				// same hash, different content. The entry stays, this object builds its own package
+				++m_numCollisions;
+			}
+		}
+
+		++m_numMisses;
+		return DrawPackagePtr();
+	}
+
+	bool DrawPackageCache::Insert(Key key, const Identity& identity, const DrawPackagePtr& dpPtr)
+	{
+		if (!dpPtr || !IsShareable(*dpPtr))
+		{
+			return false;
+		}
+
+		auto iter = m_entries.find(key);
+		if (iter != m_entries.end() && iter->second.identity != identity && !iter->second.dpPtr.expired())
+		{
+			// a live entry keeps its slot, the colliding content simply isn't shared
+			return false;
+		}
+
+		Entry& entry = m_entries[key];
+		entry.identity = identity;
+		entry.dpPtr = dpPtr;
+		return true;
+	}
+
+	void DrawPackageCache::Prune()
+	{
+		for (auto iter = m_entries.begin(); iter != m_entries.end();)
+		{
+			if (iter->second.dpPtr.expired())
+			{
+				iter = m_entries.erase(iter);
+			}
+			else
+			{
+				++iter;
+			}
+		}
+	}
+
+	void DrawPackageCache::Clear()
+	{
+		m_entries.clear();
+		m_numHits = 0;
+		m_numMisses = 0;
+		m_numCollisions = 0;
+	}
+
+	bool DrawPackageCache::IsShareable(const DrawPackage& package)
+	{
+		for (size_t i = 0; i < package.GetNumDataEntries(); ++i)
+		{
+			DrawPackageDataPtr dataPtr;
+			if (package.GetData(i, dataPtr) && dataPtr->IsDynamic())
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void DrawPackageCache::AppendIdentity(Identity& identity, const void* pData, size_t size)
+	{
+		const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+		identity.insert(identity.end(), pBytes, pBytes + size);
+	}
+
+	DrawPackageCache::Key DrawPackageCache::HashBytes(const void* pData, size_t size, Key seed)
+	{
+		const Key kPrime = 1099511628211ULL;
+
+		Key hash = seed;
+		const unsigned char* pBytes = static_cast<const unsigned char*>(pData);
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= pBytes[i];
+			hash *= kPrime;
+		}
+
+		return hash;
+	}
+
+	DrawPackageCache::Key DrawPackageCache::HashCombine(Key seed, Key value)
+	{
+		return HashBytes(&value, sizeof(value), seed);
+	}
+}
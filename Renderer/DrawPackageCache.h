@@ -0,0 +1,82 @@
+// DrawPackageCache.h
+// Content keyed cache of built DrawPackages, so RenderObjects sharing the same mesh & material content
+// resolve to one vertex range and texture slot instead of each running the builders (and filling the
+// multi-draw vertex buffers & TexturePack) again.
+// The identity comes from a client supplied function, since only the client knows what makes two objects'
+// content identical (asset names, material values, ... AppendIdentity() helps build one). Lookups go by
+// its 64 bit hash, and every entry keeps the identity itself so a hash collision is a miss, not a wrong
+// package. Packages with dynamic entries are never cached. Entries are weak, a prototype goes away with
+// the last object using it
+#pragma once
+#ifndef DRAW_PACKAGE_CACHE_H
+#define DRAW_PACKAGE_CACHE_H
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "DrawPackageBuilder.h"
+#include "../Visuals/RenderObject.h"
+
+namespace GamePrototype
+{
+	class DrawPackageCache
+	{
+	public:
+		typedef uint64_t Key;
+		typedef std::vector<uint8_t> Identity;
+
+		// fills in the bytes that identify an object's content.
+		// Return false for objects that should never share (unique or procedural content)
+		typedef std::function<bool(const Graphics::RenderObject&, Identity&)> KeyFunc;
+
+		// makes the per object package for a cache hit: same vertex range & texture slot as the prototype,
+		// the object's own per instance data (transform). Nothing is shared without one, since the prototype
+		// package itself would draw every object at the prototype's transform
+		typedef std::function<DrawPackagePtr(const DrawPackagePtr& prototypePtr, const Graphics::RenderObjectPtr&)> InstanceFunc;
+
+		DrawPackageCache();
+
+		// key is MakeKey(identity)
+		DrawPackagePtr Find(Key key, const Identity& identity);
+		// returns false for packages that may not be shared (see IsShareable())
+		bool Insert(Key key, const Identity& identity, const DrawPackagePtr& dpPtr);
+
+		// drops entries whose packages no longer have any users
+		void Prune();
+		void Clear();
+
+		size_t GetNumEntries() const { return m_entries.size(); }
+		size_t GetNumHits() const { return m_numHits; }
+		size_t GetNumMisses() const { return m_numMisses; }
+		size_t GetNumCollisions() const { return m_numCollisions; }
+
+		// a package with dynamic entries holds one object's vertices, which change every frame
+		static bool IsShareable(const DrawPackage& package);
+
+		static Key MakeKey(const Identity& identity) { return HashBytes(identity.data(), identity.size()); }
+		static void AppendIdentity(Identity& identity, const void* pData, size_t size);
+
+		// 64 bit FNV-1a
+		static Key HashBytes(const void* pData, size_t size, Key seed = s_kHashSeed);
+		static Key HashCombine(Key seed, Key value);
+
+		static const Key s_kHashSeed = 14695981039346656037ULL;
+
+	private:
+
+		struct Entry
+		{
+			Identity						identity;
+			std::weak_ptr<DrawPackage>		dpPtr;
+		};
+
+		std::unordered_map<Key, Entry>	m_entries;
+		size_t							m_numHits;
+		size_t							m_numMisses;
+		size_t							m_numCollisions;
+	};
+}
+
+#endif // DRAW_PACKAGE_CACHE_H
@@ -0,0 +1,384 @@
+// DrawPackageDiskCache.cpp
+#ifndef __linux__
+#include "stdafx.h"
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <windows.h>
+#endif
+
+#include "DrawPackageDiskCache.h"
+
+namespace GamePrototype
+{
+	namespace
+	{
+		const intptr_t kInvalidHandle = -1;
+		const uint64_t kBlobAlignment = 16;
+
+		uint64_t AlignUp(uint64_t value)
+		{
+			return (value + kBlobAlignment - 1) & ~(kBlobAlignment - 1);
+		}
+
+		// atomically replaces targetPath with sourcePath, the old file stays in place on failure
+		bool ReplaceFile(const std::string& sourcePath, const std::string& targetPath)
+		{
+#ifdef __linux__
+			return std::rename(sourcePath.c_str(), targetPath.c_str()) == 0;
+#else
+			return MoveFileExA(sourcePath.c_str(), targetPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#endif
+		}
+	}
+
+	DrawPackageDiskCache::DrawPackageDiskCache(const std::string& path, uint32_t contentVersion)
+	:
+	m_path(path),
+	m_contentVersion(contentVersion),
+	m_pMapped(nullptr),
+	m_mappedSize(0),
+	m_fileHandle(kInvalidHandle),
+	m_mappingHandle(kInvalidHandle),
+	m_bDirty(false),
+	m_numHits(0),
+	m_numStale(0)
+	{
+	}
+
+	DrawPackageDiskCache::~DrawPackageDiskCache()
+	{
+		Close();
+	}
+
+	bool DrawPackageDiskCache::Open()
+	{
+		Close();
+
+		if (Map() && !ValidateMapping())
+		{
+			// wrong version or damaged, rewritten from scratch on the next Save()
+			Unmap();
+			m_bDirty = true;
+		}
+
+		return true;
+	}
+
+	void DrawPackageDiskCache::Close()
+	{
+		Unmap();
+		m_storedIndices.clear();
+		m_bDirty = false;
+	}
+
+	bool DrawPackageDiskCache::Find(Key key, Key assetHash, const uint8_t*& pBytes, size_t& size)
+	{
+		auto storedIter = m_storedIndices.find(key);
+		if (storedIter != m_storedIndices.end())
+		{
+			if (storedIter->second.assetHash == assetHash)
+			{
+				pBytes = storedIter->second.bytes.data();
+				size = storedIter->second.bytes.size();
+				++m_numHits;
+				return true;
+			}
+
+			m_storedIndices.erase(storedIter);
+			m_bDirty = true;
+			++m_numStale;
+			return false;
+		}
+
+		auto mappedIter = m_mappedIndices.find(key);
+		if (mappedIter != m_mappedIndices.end())
+		{
+			const FileEntry* pEntry = mappedIter->second;
+			if (pEntry->assetHash == assetHash)
+			{
+				pBytes = m_pMapped + pEntry->offset;
+				size = static_cast<size_t>(pEntry->size);
+				++m_numHits;
+				return true;
+			}
+
+			// the asset changed since this was built
+			m_mappedIndices.erase(mappedIter);
+			m_bDirty = true;
+			++m_numStale;
+		}
+
+		return false;
+	}
+
+	void DrawPackageDiskCache::Store(Key key, Key assetHash, std::vector<uint8_t>&& bytes)
+	{
+		StoredEntry& entry = m_storedIndices[key];
+		entry.assetHash = assetHash;
+		entry.bytes = std::move(bytes);
+
+		m_mappedIndices.erase(key);
+		m_bDirty = true;
+	}
+
+	bool DrawPackageDiskCache::Save()
+	{
+		if (!m_bDirty)
+		{
+			return true;
+		}
+
+		const std::string tempPath = m_path + ".tmp";
+
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file)
+			{
+				Log::PrintError("DrawPackageDiskCache::Save() unable to open temp cache file for writing!");
+				return false;
+			}
+
+			std::vector<FileEntry> table;
+			table.reserve(GetNumEntries());
+
+			uint64_t offset = AlignUp(sizeof(FileHeader));
+			const char padding[kBlobAlignment] = {};
+
+			// header is rewritten last, once the table offset is known
+			FileHeader header = {};
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(padding, static_cast<std::streamsize>(offset - sizeof(header)));
+
+			auto writeBlob = [&](Key key, Key assetHash, const uint8_t* pBytes, uint64_t size)
+			{
+				FileEntry entry;
+				entry.key = key;
+				entry.assetHash = assetHash;
+				entry.offset = offset;
+				entry.size = size;
+				table.push_back(entry);
+
+				file.write(reinterpret_cast<const char*>(pBytes), static_cast<std::streamsize>(size));
+
+				const uint64_t alignedEnd = AlignUp(offset + size);
+				file.write(padding, static_cast<std::streamsize>(alignedEnd - (offset + size)));
+				offset = alignedEnd;
+			};
+
+			for (const auto& mapped : m_mappedIndices)
+			{
+				writeBlob(mapped.first, mapped.second->assetHash, m_pMapped + mapped.second->offset, mapped.second->size);
+			}
+
+			for (const auto& stored : m_storedIndices)
+			{
+				writeBlob(stored.first, stored.second.assetHash, stored.second.bytes.data(), stored.second.bytes.size());
+			}
+
+			file.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size()*sizeof(FileEntry)));
+
+			header.magic = s_kMagic;
+			header.formatVersion = s_kFormatVersion;
+			header.contentVersion = m_contentVersion;
+			header.numEntries = static_cast<uint32_t>(table.size());
+			header.tableOffset = offset;
+
+			file.seekp(0);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+			if (!file)
+			{
+				Log::PrintError("DrawPackageDiskCache::Save() failed writing temp cache file!");
+				return false;
+			}
+		}
+
+		// NOTE: the mapping has to go before the file can be replaced (Windows will not rename over a mapped file)
+		Unmap();
+
+		if (!ReplaceFile(tempPath, m_path))
+		{
+			Log::PrintError("DrawPackageDiskCache::Save() unable to replace cache file!");
+			std::remove(tempPath.c_str());
+
+			// the old file is untouched: map it again and keep everything stored since, for the next Save()
+			if (Map() && ValidateMapping())
+			{
+				for (const auto& stored : m_storedIndices)
+				{
+					m_mappedIndices.erase(stored.first);
+				}
+			}
+			else
+			{
+				Unmap();
+			}
+
+			return false;
+		}
+
+		m_storedIndices.clear();
+		m_bDirty = false;
+		return Map() && ValidateMapping();
+	}
+
+	bool DrawPackageDiskCache::ValidateMapping()
+	{
+		if (m_mappedSize < sizeof(FileHeader))
+		{
+			return false;
+		}
+
+		FileHeader header;
+		memcpy(&header, m_pMapped, sizeof(header));
+
+		if (header.magic != s_kMagic || header.formatVersion != s_kFormatVersion || header.contentVersion != m_contentVersion)
+		{
+			return false;
+		}
+
+		const uint64_t tableSize = static_cast<uint64_t>(header.numEntries)*sizeof(FileEntry);
+		if (header.tableOffset > m_mappedSize || tableSize > m_mappedSize - header.tableOffset ||
+			header.tableOffset % kBlobAlignment != 0)
+		{
+			return false;
+		}
+
+		const FileEntry* pTable = reinterpret_cast<const FileEntry*>(m_pMapped + header.tableOffset);
+
+		m_mappedIndices.clear();
+		m_mappedIndices.reserve(header.numEntries);
+		for (uint32_t i = 0; i < header.numEntries; ++i)
+		{
+			const FileEntry& entry = pTable[i];
+			if (entry.offset > header.tableOffset || entry.size > header.tableOffset - entry.offset)
+			{
+				m_mappedIndices.clear();
+				return false;
+			}
+
+			m_mappedIndices[entry.key] = &entry;
+		}
+
+		return true;
+	}
+
+#ifdef __linux__
+	bool DrawPackageDiskCache::Map()
+	{
+		int fd = open(m_path.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+
+		struct stat fileStat;
+		if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0)
+		{
+			close(fd);
+			return false;
+		}
+
+		void* pMapped = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (pMapped == MAP_FAILED)
+		{
+			close(fd);
+			return false;
+		}
+
+		m_fileHandle = fd;
+		m_pMapped = static_cast<const uint8_t*>(pMapped);
+		m_mappedSize = static_cast<size_t>(fileStat.st_size);
+		return true;
+	}
+
+	void DrawPackageDiskCache::Unmap()
+	{
+		if (m_pMapped)
+		{
+			munmap(const_cast<uint8_t*>(m_pMapped), m_mappedSize);
+		}
+
+		if (m_fileHandle != kInvalidHandle)
+		{
+			close(static_cast<int>(m_fileHandle));
+		}
+
+		m_pMapped = nullptr;
+		m_mappedSize = 0;
+		m_fileHandle = kInvalidHandle;
+		m_mappedIndices.clear();
+	}
+#else
+	bool DrawPackageDiskCache::Map()
+	{
+		HANDLE hFile = CreateFileA(m_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (hFile == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart <= 0)
+		{
+			CloseHandle(hFile);
+			return false;
+		}
+
+		HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!hMapping)
+		{
+			CloseHandle(hFile);
+			return false;
+		}
+
+		void* pMapped = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+		if (!pMapped)
+		{
+			CloseHandle(hMapping);
+			CloseHandle(hFile);
+			return false;
+		}
+
+		m_fileHandle = reinterpret_cast<intptr_t>(hFile);
+		m_mappingHandle = reinterpret_cast<intptr_t>(hMapping);
+		m_pMapped = static_cast<const uint8_t*>(pMapped);
+		m_mappedSize = static_cast<size_t>(fileSize.QuadPart);
+		return true;
+	}
+
+	void DrawPackageDiskCache::Unmap()
+	{
+		if (m_pMapped)
+		{
+			UnmapViewOfFile(m_pMapped);
+		}
+
+		if (m_mappingHandle != kInvalidHandle)
+		{
+			CloseHandle(reinterpret_cast<HANDLE>(m_mappingHandle));
+		}
+
+		if (m_fileHandle != kInvalidHandle)
+		{
+			CloseHandle(reinterpret_cast<HANDLE>(m_fileHandle));
+		}
+
+		m_pMapped = nullptr;
+		m_mappedSize = 0;
+		m_fileHandle = kInvalidHandle;
+		m_mappingHandle = kInvalidHandle;
+		m_mappedIndices.clear();
+	}
+#endif
+}
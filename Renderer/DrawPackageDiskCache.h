@@ -0,0 +1,112 @@
+// DrawPackageDiskCache.h
+// Versioned on disk store for built DrawPackage data, so a later launch can skip the
+// DynamicDrawPackageBuilder/StaticDrawPackageBuilder work for content it has seen before.
+// The file is memory mapped on Open(), and entries are handed out as pointers into the mapping.
+// Each entry is keyed by the DrawPackageCache content key and stamped with the source asset hash it
+// was built from, so an entry whose asset has changed is treated as a miss and dropped on Save()
+#pragma once
+#ifndef DRAW_PACKAGE_DISK_CACHE_H
+#define DRAW_PACKAGE_DISK_CACHE_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "DrawPackageCache.h"
+
+namespace GamePrototype
+{
+	class DrawPackageDiskCache;
+	typedef std::shared_ptr<DrawPackageDiskCache> DrawPackageDiskCachePtr;
+
+	class DrawPackageDiskCache
+	{
+	public:
+		typedef DrawPackageCache::Key Key;
+
+		// the package layout is owned by the builders & IMultiDraw objects, so the client converts.
+		// Deserialize runs on the render thread and should copy straight into the multi-draw buffers,
+		// the bytes are only valid until the next Save() or Close()
+		struct Codec
+		{
+			std::function<bool(const Graphics::RenderObject&, Key& assetHash)>								assetHashFunc;
+			std::function<bool(const DrawPackagePtr&, std::vector<uint8_t>& bytes)>							serializeFunc;
+			std::function<DrawPackagePtr(const Graphics::RenderObjectPtr&, const uint8_t* pBytes, size_t size)>	deserializeFunc;
+		};
+
+		// bump contentVersion whenever the serialized package layout changes, older files are then ignored
+		DrawPackageDiskCache(const std::string& path, uint32_t contentVersion);
+		~DrawPackageDiskCache();
+
+		DrawPackageDiskCache(const DrawPackageDiskCache&) = delete;
+		DrawPackageDiskCache& operator=(const DrawPackageDiskCache&) = delete;
+
+		// maps the file. A missing, truncated or out of date file is not an error, the cache just starts empty
+		bool Open();
+		void Close();
+
+		bool Find(Key key, Key assetHash, const uint8_t*& pBytes, size_t& size);
+		void Store(Key key, Key assetHash, std::vector<uint8_t>&& bytes);
+
+		// writes every current entry (mapped ones still valid plus everything stored since Open()) to a temp file,
+		// swaps it in and maps the result. Does nothing if nothing was stored or invalidated.
+		// On failure the old file is mapped again and the stored entries are kept, so a later Save() can retry
+		bool Save();
+
+		size_t GetNumEntries() const { return m_mappedIndices.size() + m_storedIndices.size(); }
+		size_t GetNumHits() const { return m_numHits; }
+		size_t GetNumStale() const { return m_numStale; }
+
+		static const uint32_t s_kMagic = 0x434b5044;	// "DPKC"
+		static const uint32_t s_kFormatVersion = 1;
+
+	private:
+
+		struct FileHeader
+		{
+			uint32_t	magic;
+			uint32_t	formatVersion;
+			uint32_t	contentVersion;
+			uint32_t	numEntries;
+			uint64_t	tableOffset;
+		};
+
+		struct FileEntry
+		{
+			Key			key;
+			Key			assetHash;
+			uint64_t	offset;
+			uint64_t	size;
+		};
+
+		struct StoredEntry
+		{
+			Key						assetHash;
+			std::vector<uint8_t>	bytes;
+		};
+
+		bool Map();
+		void Unmap();
+		bool ValidateMapping();
+
+		const std::string							m_path;
+		const uint32_t								m_contentVersion;
+
+		// mapping, platform handles kept opaque so windows.h stays out of the header
+		const uint8_t*								m_pMapped;
+		size_t										m_mappedSize;
+		intptr_t									m_fileHandle;
+		intptr_t									m_mappingHandle;
+
+		std::unordered_map<Key, const FileEntry*>	m_mappedIndices;
+		std::unordered_map<Key, StoredEntry>		m_storedIndices;
+		bool										m_bDirty;
+		size_t										m_numHits;
+		size_t										m_numStale;
+	};
+}
+
+#endif // DRAW_PACKAGE_DISK_CACHE_H
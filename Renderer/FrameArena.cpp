@@ -0,0 +1,101 @@
+// FrameArena.cpp
+#ifndef __linux__
+#include "stdafx.h"
+#endif
+
+#include <algorithm>
+#include <cstdint>
+
+#include "FrameArena.h"
+
+namespace GamePrototype
+{
+	FrameArena::FrameArena(size_t initialSize)
+	:
+	m_numOverflows(0)
+	{
+		AddBlock(initialSize);
+	}
+
+	void* FrameArena::Allocate(size_t size, size_t alignment)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		Block* pBlock = &m_blocks.back();
+		uintptr_t base = reinterpret_cast<uintptr_t>(pBlock->memoryPtr.get());
+		size_t alignedOffset = ((base + pBlock->offset + alignment - 1) & ~(alignment - 1)) - base;
+
+		if (alignedOffset + size > pBlock->size)
+		{
+			// out of room this frame. Grab another block now, Reset() folds it into one
+			AddBlock(size + alignment);
+			++m_numOverflows;
+
+			pBlock = &m_blocks.back();
+			base = reinterpret_cast<uintptr_t>(pBlock->memoryPtr.get());
+			alignedOffset = ((base + alignment - 1) & ~(alignment - 1)) - base;
+		}
+
+		pBlock->offset = alignedOffset + size;
+		return pBlock->memoryPtr.get() + alignedOffset;
+	}
+
+	void FrameArena::Reset()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (m_blocks.size() > 1)
+		{
+			// last frame didn't fit. Replace everything with one block big enough for all of it
+			size_t total = 0;
+			for (const auto& block : m_blocks)
+			{
+				total += block.size;
+			}
+
+			m_blocks.clear();
+			AddBlock(total);
+		}
+
+		m_blocks.back().offset = 0;
+		m_numOverflows = 0;
+	}
+
+	size_t FrameArena::GetBytesUsed() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		size_t used = 0;
+		for (const auto& block : m_blocks)
+		{
+			used += block.offset;
+		}
+
+		return used;
+	}
+
+	size_t FrameArena::GetCapacity() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		size_t capacity = 0;
+		for (const auto& block : m_blocks)
+		{
+			capacity += block.size;
+		}
+
+		return capacity;
+	}
+
+	void FrameArena::AddBlock(size_t minSize)
+	{
+		// blocks at least double, so a frame that keeps growing settles quickly
+		size_t size = m_blocks.empty() ? minSize : std::max(minSize, m_blocks.back().size * 2);
+
+		Block block;
+		block.memoryPtr.reset(new unsigned char[size]);
+		block.size = size;
+		block.offset = 0;
+		m_blocks.push_back(std::move(block));
+	}
+}
@@ -0,0 +1,120 @@
+// FrameArena.h
+// Linear allocator for memory that only lives for one frame (Collect -> Draw). Allocation is a pointer
+// bump, deallocation is a no-op and Reset() hands everything back at once. When a frame outgrows the
+// arena, Reset() merges the overflow into one larger block, so in steady state no heap allocation occurs.
+// FrameArenaAllocator<T> lets standard containers draw from an arena (FrameVector<T>)
+#pragma once
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace GamePrototype
+{
+	class FrameArena
+	{
+	public:
+		explicit FrameArena(size_t initialSize = s_kDefaultSize);
+
+		FrameArena(const FrameArena&) = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+
+		// thread safe, Collect workers allocate from the same arena
+		void* Allocate(size_t size, size_t alignment);
+
+		// every allocation made since the last Reset() is invalid afterwards
+		void Reset();
+
+		size_t GetBytesUsed() const;
+		size_t GetCapacity() const;
+		// heap allocations the arena itself made since the last Reset(), 0 in steady state
+		size_t GetNumOverflows() const { return m_numOverflows; }
+
+		static const size_t s_kDefaultSize = 256 * 1024;
+
+	private:
+
+		struct Block
+		{
+			std::unique_ptr<unsigned char[]>	memoryPtr;
+			size_t								size;
+			size_t								offset;
+		};
+
+		void AddBlock(size_t minSize);
+
+		mutable std::mutex						m_mutex;
+		std::vector<Block>						m_blocks;	// back() is the one being bumped
+		size_t									m_numOverflows;
+	};
+
+	template <typename T>
+	class FrameArenaAllocator
+	{
+	public:
+		typedef T value_type;
+		typedef std::true_type propagate_on_container_move_assignment;
+		typedef std::true_type propagate_on_container_swap;
+
+		// a null arena falls back to the heap
+		FrameArenaAllocator(FrameArena* pArena = nullptr) noexcept
+		:
+		m_pArena(pArena)
+		{
+		}
+
+		template <typename U>
+		FrameArenaAllocator(const FrameArenaAllocator<U>& rhs) noexcept
+		:
+		m_pArena(rhs.GetArena())
+		{
+		}
+
+		T* allocate(size_t count)
+		{
+			if (m_pArena)
+			{
+				return static_cast<T*>(m_pArena->Allocate(count * sizeof(T), alignof(T)));
+			}
+
+			return static_cast<T*>(::operator new(count * sizeof(T)));
+		}
+
+		void deallocate(T* p, size_t)
+		{
+			// arena memory goes back in bulk on FrameArena::Reset()
+			if (!m_pArena)
+			{
+				::operator delete(p);
+			}
+		}
+
+		FrameArena* GetArena() const { return m_pArena; }
+
+	private:
+
+		FrameArena*		m_pArena;
+	};
+
+	template <typename T, typename U>
+	bool operator==(const FrameArenaAllocator<T>& lhs, const FrameArenaAllocator<U>& rhs)
+	{
+		return lhs.GetArena() == rhs.GetArena();
+	}
+
+	template <typename T, typename U>
+	bool operator!=(const FrameArenaAllocator<T>& lhs, const FrameArenaAllocator<U>& rhs)
+	{
+		return lhs.GetArena() != rhs.GetArena();
+	}
+
+	template <typename T>
+	using FrameVector = std::vector<T, FrameArenaAllocator<T>>;
+}
+
+#endif // FRAME_ARENA_H
@@ -0,0 +1,249 @@
+// FrustumCuller.cpp
+#ifndef __linux__
+#include "stdafx.h"
+#endif
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_CULLER_SSE
+#include <emmintrin.h>
+#endif
+
+#include "FrustumCuller.h"
+
+namespace GamePrototype
+{
+	BoundingSphere BoundingSphere::Merge(const BoundingSphere& a, const BoundingSphere& b)
+	{
+		if (a.IsInfinite() || b.IsInfinite())
+		{
+			return BoundingSphere();
+		}
+
+		const float dx = b.center[0] - a.center[0];
+		const float dy = b.center[1] - a.center[1];
+		const float dz = b.center[2] - a.center[2];
+		const float dist = std::sqrt(dx*dx + dy*dy + dz*dz);
+
+		// one already contains the other
+		if (dist + b.radius <= a.radius)
+		{
+			return a;
+		}
+
+		if (dist + a.radius <= b.radius)
+		{
+			return b;
+		}
+
+		const float radius = (dist + a.radius + b.radius) * 0.5f;
+		const float t = (radius - a.radius) / dist;
+		return BoundingSphere(a.center[0] + dx*t, a.center[1] + dy*t, a.center[2] + dz*t, radius);
+	}
+
+	Frustum::Frustum()
+	:
+	m_planes{}
+	{
+		// accepts everything
+		for (int i = 0; i < kMaxPlanes; ++i)
+		{
+			m_planes[i][3] = FLT_MAX;
+		}
+	}
+
+	Frustum::Frustum(const Graphics::CameraDrawInfo& cdi)
+	:
+	Frustum(cdi.viewMat, cdi.projMat)
+	{
+	}
+
+	Frustum::Frustum(const Math::mat4& viewMat, const Math::mat4& projMat)
+	:
+	m_planes{}
+	{
+		float viewProj[Math::mat4::MAT4_SIZE];
+		FrustumCuller::Multiply(projMat.Get(), viewMat.Get(), viewProj);
+		Extract(viewProj);
+	}
+
+	void Frustum::Extract(const float* pViewProj)
+	{
+		// rows of the column major clip matrix
+		float rows[4][4];
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int col = 0; col < 4; ++col)
+			{
+				rows[row][col] = pViewProj[col*4 + row];
+			}
+		}
+
+		for (int i = 0; i < 4; ++i)
+		{
+			m_planes[kLeft][i]		= rows[3][i] + rows[0][i];
+			m_planes[kRight][i]		= rows[3][i] - rows[0][i];
+			m_planes[kBottom][i]	= rows[3][i] + rows[1][i];
+			m_planes[kTop][i]		= rows[3][i] - rows[1][i];
+			m_planes[kNear][i]		= rows[3][i] + rows[2][i];
+			m_planes[kFar][i]		= rows[3][i] - rows[2][i];
+		}
+
+		for (auto& plane : m_planes)
+		{
+			const float length = std::sqrt(plane[0]*plane[0] + plane[1]*plane[1] + plane[2]*plane[2]);
+			if (length > 0.0f)
+			{
+				const float invLength = 1.0f / length;
+				plane[0] *= invLength;
+				plane[1] *= invLength;
+				plane[2] *= invLength;
+				plane[3] *= invLength;
+			}
+		}
+	}
+
+	bool Frustum::TestSphere(const BoundingSphere& sphere) const
+	{
+		return TestSphere(sphere.center[0], sphere.center[1], sphere.center[2], sphere.radius);
+	}
+
+	bool Frustum::TestSphere(float x, float y, float z, float radius) const
+	{
+		for (const auto& plane : m_planes)
+		{
+			if (plane[0]*x + plane[1]*y + plane[2]*z + plane[3] < -radius)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	size_t FrustumCuller::Cull(const Frustum& frustum, const float* pCenterX, const float* pCenterY, const float* pCenterZ,
+		const float* pRadius, size_t count, uint32_t* pVisible)
+	{
+		size_t numVisible = 0;
+		size_t i = 0;
+
+#if defined(__AVX__)
+		__m256 planes[Frustum::kMaxPlanes][4];
+		for (int p = 0; p < Frustum::kMaxPlanes; ++p)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				planes[p][c] = _mm256_set1_ps(frustum.GetPlane(p)[c]);
+			}
+		}
+
+		const __m256 signMask = _mm256_set1_ps(-0.0f);
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256 x = _mm256_loadu_ps(pCenterX + i);
+			const __m256 y = _mm256_loadu_ps(pCenterY + i);
+			const __m256 z = _mm256_loadu_ps(pCenterZ + i);
+			const __m256 negRadius = _mm256_xor_ps(_mm256_loadu_ps(pRadius + i), signMask);
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < Frustum::kMaxPlanes; ++p)
+			{
+				__m256 dist = _mm256_add_ps(_mm256_mul_ps(planes[p][0], x), planes[p][3]);
+				dist = _mm256_add_ps(dist, _mm256_mul_ps(planes[p][1], y));
+				dist = _mm256_add_ps(dist, _mm256_mul_ps(planes[p][2], z));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(dist, negRadius, _CMP_GE_OQ));
+			}
+
+			const int mask = _mm256_movemask_ps(inside);
+			for (int lane = 0; lane < 8; ++lane)
+			{
+				pVisible[numVisible] = static_cast<uint32_t>(i + lane);
+				numVisible += (mask >> lane) & 1;
+			}
+		}
+#elif defined(FRUSTUM_CULLER_SSE)
+		__m128 planes[Frustum::kMaxPlanes][4];
+		for (int p = 0; p < Frustum::kMaxPlanes; ++p)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				planes[p][c] = _mm_set1_ps(frustum.GetPlane(p)[c]);
+			}
+		}
+
+		const __m128 signMask = _mm_set1_ps(-0.0f);
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128 x = _mm_loadu_ps(pCenterX + i);
+			const __m128 y = _mm_loadu_ps(pCenterY + i);
+			const __m128 z = _mm_loadu_ps(pCenterZ + i);
+			const __m128 negRadius = _mm_xor_ps(_mm_loadu_ps(pRadius + i), signMask);
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < Frustum::kMaxPlanes; ++p)
+			{
+				__m128 dist = _mm_add_ps(_mm_mul_ps(planes[p][0], x), planes[p][3]);
+				dist = _mm_add_ps(dist, _mm_mul_ps(planes[p][1], y));
+				dist = _mm_add_ps(dist, _mm_mul_ps(planes[p][2], z));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, negRadius));
+			}
+
+			const int mask = _mm_movemask_ps(inside);
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				pVisible[numVisible] = static_cast<uint32_t>(i + lane);
+				numVisible += (mask >> lane) & 1;
+			}
+		}
+#endif
+
+		for (; i < count; ++i)
+		{
+			pVisible[numVisible] = static_cast<uint32_t>(i);
+			numVisible += frustum.TestSphere(pCenterX[i], pCenterY[i], pCenterZ[i], pRadius[i]) ? 1 : 0;
+		}
+
+		return numVisible;
+	}
+
+	size_t FrustumCuller::CullSphere(const BoundingSphere& volume, const float* pCenterX, const float* pCenterY,
+		const float* pCenterZ, const float* pRadius, size_t count, uint32_t* pVisible)
+	{
+		size_t numVisible = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const float dx = pCenterX[i] - volume.center[0];
+			const float dy = pCenterY[i] - volume.center[1];
+			const float dz = pCenterZ[i] - volume.center[2];
+
+			// unbounded packages carry FLT_MAX, which would overflow once squared
+			const bool bInfinite = (pRadius[i] == FLT_MAX);
+			const float reach = bInfinite ? 0.0f : pRadius[i] + volume.radius;
+
+			pVisible[numVisible] = static_cast<uint32_t>(i);
+			numVisible += (bInfinite || dx*dx + dy*dy + dz*dz <= reach*reach) ? 1 : 0;
+		}
+
+		return numVisible;
+	}
+
+	void FrustumCuller::Multiply(const float* pA, const float* pB, float* pResult)
+	{
+		for (int col = 0; col < 4; ++col)
+		{
+			for (int row = 0; row < 4; ++row)
+			{
+				float sum = 0.0f;
+				for (int k = 0; k < 4; ++k)
+				{
+					sum += pA[k*4 + row] * pB[col*4 + k];
+				}
+
+				pResult[col*4 + row] = sum;
+			}
+		}
+	}
+}
@@ -0,0 +1,85 @@
+// FrustumCuller.h
+// CPU visibility tests for BatchDrawEffect. Bounds are kept as spheres in structure of array columns
+// (see DrawPackageBin) so the plane tests run 4 (SSE) or 8 (AVX) packages at a time.
+// The AVX path is used when the translation unit is built with AVX enabled (/arch:AVX, -mavx),
+// SSE otherwise, with a scalar loop for the remainder and non x86 targets
+#pragma once
+#ifndef FRUSTUM_CULLER_H
+#define FRUSTUM_CULLER_H
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+
+#include "CameraDrawInfo.h"
+
+namespace GamePrototype
+{
+	struct BoundingSphere
+	{
+		float center[3];
+		float radius;
+
+		BoundingSphere() : center{}, radius(FLT_MAX) {}
+		BoundingSphere(float x, float y, float z, float r) : center{x, y, z}, radius(r) {}
+
+		// objects without bounds always pass every test
+		bool IsInfinite() const { return radius == FLT_MAX; }
+
+		// smallest sphere enclosing both
+		static BoundingSphere Merge(const BoundingSphere& a, const BoundingSphere& b);
+	};
+
+	class Frustum
+	{
+	public:
+		enum Plane
+		{
+			kLeft,
+			kRight,
+			kBottom,
+			kTop,
+			kNear,
+			kFar,
+			kMaxPlanes
+		};
+
+		Frustum();
+
+		// planes from projMat * viewMat, normals pointing inwards
+		explicit Frustum(const Graphics::CameraDrawInfo&);
+		Frustum(const Math::mat4& viewMat, const Math::mat4& projMat);
+
+		// column major clip matrix. NOTE: the near plane is taken for a -w..w depth range, which is
+		// conservative (never culls anything visible) for 0..w projections as well
+		void Extract(const float* pViewProj);
+
+		bool TestSphere(const BoundingSphere&) const;
+		bool TestSphere(float x, float y, float z, float radius) const;
+
+		const float* GetPlane(int index) const { return m_planes[index]; }
+
+	private:
+
+		float m_planes[kMaxPlanes][4];
+	};
+
+	class FrustumCuller
+	{
+	public:
+
+		// writes the index of every sphere touching the frustum to pVisible (room for count entries),
+		// in ascending order. Returns the number written
+		static size_t Cull(const Frustum&, const float* pCenterX, const float* pCenterY, const float* pCenterZ,
+			const float* pRadius, size_t count, uint32_t* pVisible);
+
+		// same for a sphere volume (point light range)
+		static size_t CullSphere(const BoundingSphere& volume, const float* pCenterX, const float* pCenterY,
+			const float* pCenterZ, const float* pRadius, size_t count, uint32_t* pVisible);
+
+		// column major a * b
+		static void Multiply(const float* pA, const float* pB, float* pResult);
+	};
+}
+
+#endif // FRUSTUM_CULLER_H
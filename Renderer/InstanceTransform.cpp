@@ -0,0 +1,330 @@
+// InstanceTransform.cpp
+#ifndef __linux__
+#include "stdafx.h"
+#endif
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define INSTANCE_TRANSFORM_SSE
+#include <emmintrin.h>
+#endif
+
+#include "FrustumCuller.h"
+#include "InstanceTransform.h"
+
+namespace GamePrototype
+{
+	namespace
+	{
+		// m[col*4 + row], column major
+		inline float At(const float* pMat4, int row, int col)
+		{
+			return pMat4[col*4 + row];
+		}
+
+		float Determinant3x3(const float* pMat4)
+		{
+			return At(pMat4, 0, 0) * (At(pMat4, 1, 1) * At(pMat4, 2, 2) - At(pMat4, 2, 1) * At(pMat4, 1, 2)) -
+				At(pMat4, 0, 1) * (At(pMat4, 1, 0) * At(pMat4, 2, 2) - At(pMat4, 2, 0) * At(pMat4, 1, 2)) +
+				At(pMat4, 0, 2) * (At(pMat4, 1, 0) * At(pMat4, 2, 1) - At(pMat4, 2, 0) * At(pMat4, 1, 1));
+		}
+
+		// x, y, z, w of the rotation r[row][col] (Shepperd)
+		void ToQuaternion(const float r[3][3], float* pQuat)
+		{
+			const float trace = r[0][0] + r[1][1] + r[2][2];
+			if (trace > 0.0f)
+			{
+				const float t = sqrtf(trace + 1.0f) * 2.0f;
+				pQuat[0] = (r[2][1] - r[1][2]) / t;
+				pQuat[1] = (r[0][2] - r[2][0]) / t;
+				pQuat[2] = (r[1][0] - r[0][1]) / t;
+				pQuat[3] = 0.25f * t;
+			}
+			else if (r[0][0] > r[1][1] && r[0][0] > r[2][2])
+			{
+				const float t = sqrtf(1.0f + r[0][0] - r[1][1] - r[2][2]) * 2.0f;
+				pQuat[0] = 0.25f * t;
+				pQuat[1] = (r[0][1] + r[1][0]) / t;
+				pQuat[2] = (r[0][2] + r[2][0]) / t;
+				pQuat[3] = (r[2][1] - r[1][2]) / t;
+			}
+			else if (r[1][1] > r[2][2])
+			{
+				const float t = sqrtf(1.0f + r[1][1] - r[0][0] - r[2][2]) * 2.0f;
+				pQuat[0] = (r[0][1] + r[1][0]) / t;
+				pQuat[1] = 0.25f * t;
+				pQuat[2] = (r[1][2] + r[2][1]) / t;
+				pQuat[3] = (r[0][2] - r[2][0]) / t;
+			}
+			else
+			{
+				const float t = sqrtf(1.0f + r[2][2] - r[0][0] - r[1][1]) * 2.0f;
+				pQuat[0] = (r[0][2] + r[2][0]) / t;
+				pQuat[1] = (r[1][2] + r[2][1]) / t;
+				pQuat[2] = 0.25f * t;
+				pQuat[3] = (r[1][0] - r[0][1]) / t;
+			}
+
+			const float length = sqrtf(pQuat[0] * pQuat[0] + pQuat[1] * pQuat[1] + pQuat[2] * pQuat[2] + pQuat[3] * pQuat[3]);
+			for (int i = 0; i < 4; ++i)
+			{
+				pQuat[i] /= length;
+			}
+		}
+
+#if defined(__AVX__)
+		// columns 0 and 1 or 2 and 3 of parent * local, from the same two columns of local
+		inline __m256 MultiplyColumnPair(const __m256 parent[4], const float* pLocalColumns)
+		{
+			// element k of each local column, broadcast within its lane
+			const __m256 local = _mm256_loadu_ps(pLocalColumns);
+			__m256 result = _mm256_mul_ps(parent[0], _mm256_permute_ps(local, _MM_SHUFFLE(0, 0, 0, 0)));
+			result = _mm256_add_ps(result, _mm256_mul_ps(parent[1], _mm256_permute_ps(local, _MM_SHUFFLE(1, 1, 1, 1))));
+			result = _mm256_add_ps(result, _mm256_mul_ps(parent[2], _mm256_permute_ps(local, _MM_SHUFFLE(2, 2, 2, 2))));
+			result = _mm256_add_ps(result, _mm256_mul_ps(parent[3], _mm256_permute_ps(local, _MM_SHUFFLE(3, 3, 3, 3))));
+			return result;
+		}
+#elif defined(INSTANCE_TRANSFORM_SSE)
+		inline __m128 MultiplyColumn(const __m128 parent[4], const float* pLocalColumn)
+		{
+			const __m128 local = _mm_loadu_ps(pLocalColumn);
+			__m128 result = _mm_mul_ps(parent[0], _mm_shuffle_ps(local, local, _MM_SHUFFLE(0, 0, 0, 0)));
+			result = _mm_add_ps(result, _mm_mul_ps(parent[1], _mm_shuffle_ps(local, local, _MM_SHUFFLE(1, 1, 1, 1))));
+			result = _mm_add_ps(result, _mm_mul_ps(parent[2], _mm_shuffle_ps(local, local, _MM_SHUFFLE(2, 2, 2, 2))));
+			result = _mm_add_ps(result, _mm_mul_ps(parent[3], _mm_shuffle_ps(local, local, _MM_SHUFFLE(3, 3, 3, 3))));
+			return result;
+		}
+#endif
+
+		// parent * local into pWorld, column major
+		inline void Compose(const float* pParent, const float* pLocal, float* pWorld)
+		{
+#if defined(__AVX__)
+			__m256 parent[4];
+			for (int k = 0; k < 4; ++k)
+			{
+				parent[k] = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pParent + k*4));
+			}
+			_mm256_storeu_ps(pWorld, MultiplyColumnPair(parent, pLocal));
+			_mm256_storeu_ps(pWorld + 8, MultiplyColumnPair(parent, pLocal + 8));
+#elif defined(INSTANCE_TRANSFORM_SSE)
+			__m128 parent[4];
+			for (int k = 0; k < 4; ++k)
+			{
+				parent[k] = _mm_loadu_ps(pParent + k*4);
+			}
+			for (int col = 0; col < 4; ++col)
+			{
+				_mm_storeu_ps(pWorld + col*4, MultiplyColumn(parent, pLocal + col*4));
+			}
+#else
+			FrustumCuller::Multiply(pParent, pLocal, pWorld);
+#endif
+		}
+
+		// kAffine3x4 from a column major world matrix: its rows are the first three after a transpose
+		inline void StoreAffine(const float* pWorld, float* pOut)
+		{
+#if defined(__AVX__) || defined(INSTANCE_TRANSFORM_SSE)
+			__m128 c0 = _mm_loadu_ps(pWorld);
+			__m128 c1 = _mm_loadu_ps(pWorld + 4);
+			__m128 c2 = _mm_loadu_ps(pWorld + 8);
+			__m128 c3 = _mm_loadu_ps(pWorld + 12);
+			_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+			_mm_storeu_ps(pOut, c0);
+			_mm_storeu_ps(pOut + 4, c1);
+			_mm_storeu_ps(pOut + 8, c2);
+#else
+			InstanceTransform::Encode(InstanceTransform::kAffine3x4, pWorld, pOut);
+#endif
+		}
+	}
+
+	size_t InstanceTransform::GetStride(Format format)
+	{
+		switch (format)
+		{
+		case kMat4:
+			return 16 * sizeof(float);
+		case kAffine3x4:
+			return 12 * sizeof(float);
+		case kQuatPosScale:
+			return 8 * sizeof(float);
+		default:
+			assert(false);
+			return 0;
+		}
+	}
+
+	void InstanceTransform::Encode(Format format, const float* pMat4, void* pDst)
+	{
+		float* pOut = static_cast<float*>(pDst);
+
+		switch (format)
+		{
+		case kMat4:
+			memcpy(pOut, pMat4, 16 * sizeof(float));
+			break;
+
+		case kAffine3x4:
+			// a row per vec4, the bottom row is always 0 0 0 1
+			for (int row = 0; row < 3; ++row)
+			{
+				for (int col = 0; col < 4; ++col)
+				{
+					pOut[row*4 + col] = At(pMat4, row, col);
+				}
+			}
+			break;
+
+		case kQuatPosScale:
+		{
+			// x y z w, then translation and scale. A mirroring matrix keeps a proper rotation with a
+			// negative scale
+			float scale = (sqrtf(At(pMat4, 0, 0) * At(pMat4, 0, 0) + At(pMat4, 1, 0) * At(pMat4, 1, 0) + At(pMat4, 2, 0) * At(pMat4, 2, 0)) +
+				sqrtf(At(pMat4, 0, 1) * At(pMat4, 0, 1) + At(pMat4, 1, 1) * At(pMat4, 1, 1) + At(pMat4, 2, 1) * At(pMat4, 2, 1)) +
+				sqrtf(At(pMat4, 0, 2) * At(pMat4, 0, 2) + At(pMat4, 1, 2) * At(pMat4, 1, 2) + At(pMat4, 2, 2) * At(pMat4, 2, 2))) / 3.0f;
+			if (Determinant3x3(pMat4) < 0.0f)
+			{
+				scale = -scale;
+			}
+
+			if (scale == 0.0f)
+			{
+				pOut[0] = pOut[1] = pOut[2] = 0.0f;
+				pOut[3] = 1.0f;
+			}
+			else
+			{
+				float r[3][3];
+				for (int row = 0; row < 3; ++row)
+				{
+					for (int col = 0; col < 3; ++col)
+					{
+						r[row][col] = At(pMat4, row, col) / scale;
+					}
+				}
+				ToQuaternion(r, pOut);
+			}
+
+			pOut[4] = At(pMat4, 0, 3);
+			pOut[5] = At(pMat4, 1, 3);
+			pOut[6] = At(pMat4, 2, 3);
+			pOut[7] = scale;
+			break;
+		}
+
+		default:
+			assert(false);
+			break;
+		}
+	}
+
+	void InstanceTransform::Decode(Format format, const void* pSrc, float* pMat4)
+	{
+		const float* pIn = static_cast<const float*>(pSrc);
+
+		switch (format)
+		{
+		case kMat4:
+			memcpy(pMat4, pIn, 16 * sizeof(float));
+			break;
+
+		case kAffine3x4:
+			for (int col = 0; col < 4; ++col)
+			{
+				for (int row = 0; row < 3; ++row)
+				{
+					pMat4[col*4 + row] = pIn[row*4 + col];
+				}
+				pMat4[col*4 + 3] = (col == 3) ? 1.0f : 0.0f;
+			}
+			break;
+
+		case kQuatPosScale:
+		{
+			const float x = pIn[0], y = pIn[1], z = pIn[2], w = pIn[3];
+			const float s = pIn[7];
+
+			const float r[3][3] =
+			{
+				{ 1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y - w * z), 2.0f * (x * z + w * y) },
+				{ 2.0f * (x * y + w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z - w * x) },
+				{ 2.0f * (x * z - w * y), 2.0f * (y * z + w * x), 1.0f - 2.0f * (x * x + y * y) }
+			};
+
+			for (int col = 0; col < 3; ++col)
+			{
+				for (int row = 0; row < 3; ++row)
+				{
+					pMat4[col*4 + row] = r[row][col] * s;
+				}
+				pMat4[col*4 + 3] = 0.0f;
+			}
+
+			pMat4[12] = pIn[4];
+			pMat4[13] = pIn[5];
+			pMat4[14] = pIn[6];
+			pMat4[15] = 1.0f;
+			break;
+		}
+
+		default:
+			assert(false);
+			break;
+		}
+	}
+
+	void InstanceTransform::ComposeBatch(Format format, const float* pParents, const uint32_t* pParentIndices,
+		const float* pLocals, size_t count, void* pDst)
+	{
+		const size_t stride = GetStride(format);
+		char* pOut = static_cast<char*>(pDst);
+
+		for (size_t i = 0; i < count; ++i, pOut += stride)
+		{
+			const float* pParent = pParents + (pParentIndices ? pParentIndices[i] : i) * 16;
+			const float* pLocal = pLocals + i * 16;
+
+			if (format == kMat4)
+			{
+				// already the final layout
+				Compose(pParent, pLocal, reinterpret_cast<float*>(pOut));
+				continue;
+			}
+
+			float world[16];
+			Compose(pParent, pLocal, world);
+			if (format == kAffine3x4)
+			{
+				StoreAffine(world, reinterpret_cast<float*>(pOut));
+			}
+			else
+			{
+				Encode(format, world, pOut);
+			}
+		}
+	}
+
+	float InstanceTransform::RoundTripError(Format format, const float* pMat4)
+	{
+		float encoded[16];
+		float decoded[16];
+		Encode(format, pMat4, encoded);
+		Decode(format, encoded, decoded);
+
+		float maxError = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			maxError = fmaxf(maxError, fabsf(decoded[i] - pMat4[i]));
+		}
+
+		return maxError;
+	}
+}
@@ -0,0 +1,53 @@
+// InstanceTransform.h
+// Encodings of a per instance world matrix for the static instance buffers. The full column major 4x4 is
+// 64 bytes per instance. The compact ones drop what a world matrix does not use:
+//   kAffine3x4: the top three rows, 48 bytes, any affine transform
+//   kQuatPosScale: rotation quaternion, translation and one scale, 32 bytes. Rotation and uniform scale
+//   only, shear and non uniform scale are lost (RoundTripError() tells how much)
+// The static vertex shaders read the instance buffer through Shaders/BatchDrawInstances.glsl, a readonly
+// std430 array of the format's layout, built with the matching BATCH_DRAW_INSTANCE_FORMAT. Its
+// InstanceWorldMatrix() rebuilds the matrix exactly as Decode() does
+#pragma once
+#ifndef INSTANCE_TRANSFORM_H
+#define INSTANCE_TRANSFORM_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace GamePrototype
+{
+	namespace InstanceTransform
+	{
+		// layouts, as vec4s: kMat4 the four columns, kAffine3x4 the top three rows, kQuatPosScale rotation
+		// x y z w then translation x y z and scale. Matches BATCH_DRAW_INSTANCE_FORMAT in BatchDrawInstances.glsl
+		enum Format
+		{
+			kMat4,
+			kAffine3x4,
+			kQuatPosScale,
+			kMaxFormats
+		};
+
+		// bytes per instance, a multiple of 16 so std430 arrays of them are tightly packed
+		size_t GetStride(Format);
+
+		// pMat4: column major 4x4 (Math::mat4::Get()). pDst receives GetStride() bytes
+		void Encode(Format, const float* pMat4, void* pDst);
+
+		// what the shader decodes pSrc to, column major
+		void Decode(Format, const void* pSrc, float* pMat4);
+
+		// world = parent * local for count instances, written to pDst in the format's layout at GetStride()
+		// bytes apart, straight into a mapped instance buffer: nothing in pDst is read back. pParents and
+		// pLocals are column major 4x4s. pParentIndices picks each instance's parent (null: the i-th), so
+		// instances under one parent share it. AVX or SSE2 when the build has them, scalar otherwise
+		void ComposeBatch(Format, const float* pParents, const uint32_t* pParentIndices, const float* pLocals,
+			size_t count, void* pDst);
+
+		// largest absolute difference between pMat4 and its encoded and decoded version, to check a
+		// compact format against the 4x4 path
+		float RoundTripError(Format, const float* pMat4);
+	}
+}
+
+#endif // INSTANCE_TRANSFORM_H
@@ -0,0 +1,109 @@
+// LodSelector.cpp
+#ifndef __linux__
+#include "stdafx.h"
+#endif
+
+#include <cfloat>
+#include <cmath>
+
+#include "LodSelector.h"
+
+namespace GamePrototype
+{
+	const uint32_t LodSelector::s_kCulled;
+	const uint32_t LodSelector::s_kMaxLevels;
+
+	LodSelector::LodSelector(const Graphics::CameraDrawInfo& cdi, const LodSettings& settings)
+	:
+	m_settings(settings),
+	m_eye{},
+	m_projScale(1.0f),
+	m_bOrthographic(false)
+	{
+		// column major, no scale in the view: eye = -transpose(R) * t
+		const float* pView = cdi.viewMat.Get();
+		for (int i = 0; i < 3; ++i)
+		{
+			m_eye[i] = -(pView[i*4 + 0] * pView[12] + pView[i*4 + 1] * pView[13] + pView[i*4 + 2] * pView[14]);
+		}
+
+		const float* pProj = cdi.projMat.Get();
+		m_projScale = std::fabs(pProj[5]);
+		m_bOrthographic = (pProj[11] == 0.0f);
+	}
+
+	float LodSelector::GetScreenSize(float x, float y, float z, float radius) const
+	{
+		if (radius == FLT_MAX)
+		{
+			return FLT_MAX;
+		}
+
+		// the viewport is 2 units high in NDC, a sphere's projected diameter is 2 * radius * projMat[1][1] / distance
+		if (m_bOrthographic)
+		{
+			return radius * m_projScale;
+		}
+
+		const float dx = x - m_eye[0];
+		const float dy = y - m_eye[1];
+		const float dz = z - m_eye[2];
+		const float distance = std::sqrt(dx*dx + dy*dy + dz*dz);
+		if (distance <= radius)
+		{
+			return FLT_MAX;
+		}
+
+		return radius * m_projScale / distance;
+	}
+
+	uint32_t LodSelector::Select(float x, float y, float z, float radius, uint32_t numLevels) const
+	{
+		const float screenSize = GetScreenSize(x, y, z, radius);
+		if (screenSize < m_settings.contributionScreenSize)
+		{
+			return s_kCulled;
+		}
+
+		uint32_t level = 0;
+		while (level < m_settings.screenSizes.size() && screenSize < m_settings.screenSizes[level])
+		{
+			++level;
+		}
+
+		return (level < numLevels) ? level : numLevels - 1;
+	}
+
+	size_t LodSelector::Filter(const float* pCenterX, const float* pCenterY, const float* pCenterZ, const float* pRadius,
+		const uint8_t* pLevels, const uint8_t* pNumLevels, uint32_t* pIndices, size_t count) const
+	{
+		size_t numKept = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const uint32_t index = pIndices[i];
+			if (Select(pCenterX[index], pCenterY[index], pCenterZ[index], pRadius[index], pNumLevels[index]) == pLevels[index])
+			{
+				pIndices[numKept++] = index;
+			}
+		}
+
+		return numKept;
+	}
+
+	size_t LodSelector::Filter(const BoundingSphere* pBounds, const uint8_t* pLevels, const uint8_t* pNumLevels,
+		uint32_t* pIndices, size_t count) const
+	{
+		size_t numKept = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const uint32_t index = pIndices[i];
+			const BoundingSphere& bounds = pBounds[index];
+			if (Select(bounds.center[0], bounds.center[1], bounds.center[2], bounds.radius, pNumLevels[index]) == pLevels[index])
+			{
+				pIndices[numKept++] = index;
+			}
+		}
+
+		return numKept;
+	}
+}
@@ -0,0 +1,64 @@
+// LodSelector.h
+// Per frame level of detail picking for BatchDrawEffect. Objects may come with several versions of their
+// mesh, each collected as its own DrawPackageData (its own vertex range in the IMultiDraw buffers). For a
+// camera, every object's level is picked from how much of the viewport height its bounding sphere covers,
+// and objects covering less than the contribution threshold are dropped altogether
+#pragma once
+#ifndef LOD_SELECTOR_H
+#define LOD_SELECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "CameraDrawInfo.h"
+#include "FrustumCuller.h"
+
+namespace GamePrototype
+{
+	struct LodSettings
+	{
+		// fractions of the viewport height, descending. An object covering less than screenSizes[n]
+		// is drawn with level n + 1 (or its last level, if it has fewer)
+		std::vector<float>					screenSizes;
+
+		// objects covering less than this are not drawn at all. 0 turns contribution culling off
+		float								contributionScreenSize;
+
+		LodSettings() : contributionScreenSize(0.0f) {}
+	};
+
+	class LodSelector
+	{
+	public:
+		LodSelector(const Graphics::CameraDrawInfo&, const LodSettings&);
+
+		// fraction of the viewport height the sphere covers. Spheres around the eye (or without bounds)
+		// cover all of it
+		float GetScreenSize(float x, float y, float z, float radius) const;
+
+		// level to draw an object of numLevels levels with, s_kCulled below the contribution threshold
+		uint32_t Select(float x, float y, float z, float radius, uint32_t numLevels) const;
+
+		// keeps the indices in pIndices whose package is at the selected level of its object, in order.
+		// Returns the number kept. Bounds and levels are indexed by the values in pIndices
+		size_t Filter(const float* pCenterX, const float* pCenterY, const float* pCenterZ, const float* pRadius,
+			const uint8_t* pLevels, const uint8_t* pNumLevels, uint32_t* pIndices, size_t count) const;
+		size_t Filter(const BoundingSphere* pBounds, const uint8_t* pLevels, const uint8_t* pNumLevels,
+			uint32_t* pIndices, size_t count) const;
+
+		static const uint32_t				s_kCulled = 0xffffffff;
+
+		// DrawPackageBin stores levels in a byte
+		static const uint32_t				s_kMaxLevels = 255;
+
+	private:
+
+		const LodSettings&					m_settings;
+		float								m_eye[3];
+		float								m_projScale;	// projMat[1][1]
+		bool								m_bOrthographic;
+	};
+}
+
+#endif // LOD_SELECTOR_H
@@ -0,0 +1,80 @@
+// MPSCQueue.h
+// Lock free multiple producer / single consumer queue (Vyukov's intrusive node queue).
+// Push() may be called from any thread, Pop() only from the one consumer thread.
+// Pop() can briefly report empty while a Push() is half way through; that item shows up on a later Pop()
+#pragma once
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <utility>
+
+namespace GamePrototype
+{
+	template <typename T>
+	class MPSCQueue
+	{
+	public:
+		MPSCQueue()
+		:
+		m_head(new Node()),
+		m_pTail(m_head.load())
+		{
+		}
+
+		~MPSCQueue()
+		{
+			T value;
+			while (Pop(value))
+			{
+			}
+
+			delete m_pTail;
+		}
+
+		MPSCQueue(const MPSCQueue&) = delete;
+		MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+		void Push(T value)
+		{
+			Node* pNode = new Node();
+			pNode->value = std::move(value);
+
+			Node* pPrev = m_head.exchange(pNode, std::memory_order_acq_rel);
+			pPrev->next.store(pNode, std::memory_order_release);
+		}
+
+		bool Pop(T& value)
+		{
+			Node* pTail = m_pTail;
+			Node* pNext = pTail->next.load(std::memory_order_acquire);
+			if (!pNext)
+			{
+				return false;
+			}
+
+			// pNext becomes the new stub node, its value is handed out
+			value = std::move(pNext->value);
+			pNext->value = T();
+			m_pTail = pNext;
+			delete pTail;
+
+			return true;
+		}
+
+	private:
+
+		struct Node
+		{
+			std::atomic<Node*>	next;
+			T					value;
+
+			Node() : next(nullptr), value() {}
+		};
+
+		std::atomic<Node*>		m_head;		// producers
+		Node*					m_pTail;	// consumer only
+	};
+}
+
+#endif // MPSC_QUEUE_H
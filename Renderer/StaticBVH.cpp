@@ -0,0 +1,351 @@
+// StaticBVH.cpp
+#ifndef __linux__
+#include "stdafx.h"
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "StaticBVH.h"
+
+namespace GamePrototype
+{
+	const uint32_t StaticBVH::s_kInvalidNode;
+	const uint32_t StaticBVH::s_kMaxLeafSize;
+
+	StaticBVH::StaticBVH()
+	{
+	}
+
+	void StaticBVH::Build(const std::vector<BoundingSphere>& bounds)
+	{
+		Clear();
+
+		m_primBounds = bounds;
+		m_primBoxes.resize(bounds.size());
+		m_primLeaf.assign(bounds.size(), s_kInvalidNode);
+
+		for (uint32_t i = 0; i < static_cast<uint32_t>(bounds.size()); ++i)
+		{
+			if (bounds[i].IsInfinite())
+			{
+				m_unbounded.push_back(i);
+			}
+			else
+			{
+				m_primBoxes[i] = SphereToAABB(bounds[i]);
+				m_primIndices.push_back(i);
+			}
+		}
+
+		if (m_primIndices.empty())
+		{
+			return;
+		}
+
+		// enough for one primitive per leaf, so BuildNode() never reallocates under itself
+		m_nodes.reserve(m_primIndices.size()*2);
+		BuildNode(s_kInvalidNode, 0, static_cast<uint32_t>(m_primIndices.size()));
+	}
+
+	void StaticBVH::Clear()
+	{
+		m_nodes.clear();
+		m_primIndices.clear();
+		m_primLeaf.clear();
+		m_primBoxes.clear();
+		m_primBounds.clear();
+		m_unbounded.clear();
+	}
+
+	void StaticBVH::UpdatePrimitive(uint32_t prim, const BoundingSphere& bounds)
+	{
+		assert(prim < m_primBounds.size());
+		assert(bounds.IsInfinite() == m_primBounds[prim].IsInfinite());
+
+		m_primBounds[prim] = bounds;
+
+		uint32_t nodeIndex = m_primLeaf[prim];
+		if (nodeIndex == s_kInvalidNode)
+		{
+			return;
+		}
+
+		m_primBoxes[prim] = SphereToAABB(bounds);
+		ComputeLeafBounds(m_nodes[nodeIndex]);
+
+		// grow or shrink every ancestor, stopping once one comes out unchanged
+		for (nodeIndex = m_nodes[nodeIndex].parent; nodeIndex != s_kInvalidNode; nodeIndex = m_nodes[nodeIndex].parent)
+		{
+			Node& node = m_nodes[nodeIndex];
+
+			AABB refit = m_nodes[node.first].bounds;
+			Merge(refit, m_nodes[node.second].bounds);
+
+			if (memcmp(&refit, &node.bounds, sizeof(AABB)) == 0)
+			{
+				break;
+			}
+
+			node.bounds = refit;
+		}
+	}
+
+	void StaticBVH::QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& visible) const
+	{
+		const size_t firstResult = visible.size();
+
+		if (!m_nodes.empty())
+		{
+			uint32_t stack[64];
+			int stackSize = 0;
+			stack[stackSize++] = 0;
+
+			while (stackSize > 0)
+			{
+				const Node& node = m_nodes[stack[--stackSize]];
+
+				const FrustumResult result = TestAABB(frustum, node.bounds);
+				if (result == kOutside)
+				{
+					continue;
+				}
+
+				if (result == kInside)
+				{
+					EmitSubtree(static_cast<uint32_t>(&node - m_nodes.data()), visible);
+				}
+				else if (node.count > 0)
+				{
+					for (uint32_t i = node.first; i < node.first + node.count; ++i)
+					{
+						const uint32_t prim = m_primIndices[i];
+						if (frustum.TestSphere(m_primBounds[prim]))
+						{
+							visible.push_back(prim);
+						}
+					}
+				}
+				else
+				{
+					assert(stackSize + 2 <= 64);
+					stack[stackSize++] = node.second;
+					stack[stackSize++] = node.first;
+				}
+			}
+		}
+
+		FinishQuery(firstResult, visible);
+	}
+
+	void StaticBVH::QuerySphere(const BoundingSphere& sphere, std::vector<uint32_t>& visible) const
+	{
+		const size_t firstResult = visible.size();
+
+		if (!m_nodes.empty())
+		{
+			uint32_t stack[64];
+			int stackSize = 0;
+			stack[stackSize++] = 0;
+
+			while (stackSize > 0)
+			{
+				const Node& node = m_nodes[stack[--stackSize]];
+				if (!TestAABB(sphere, node.bounds))
+				{
+					continue;
+				}
+
+				if (node.count > 0)
+				{
+					for (uint32_t i = node.first; i < node.first + node.count; ++i)
+					{
+						const uint32_t prim = m_primIndices[i];
+						const BoundingSphere& primBounds = m_primBounds[prim];
+
+						const float dx = primBounds.center[0] - sphere.center[0];
+						const float dy = primBounds.center[1] - sphere.center[1];
+						const float dz = primBounds.center[2] - sphere.center[2];
+						const float reach = primBounds.radius + sphere.radius;
+						if (dx*dx + dy*dy + dz*dz <= reach*reach)
+						{
+							visible.push_back(prim);
+						}
+					}
+				}
+				else
+				{
+					assert(stackSize + 2 <= 64);
+					stack[stackSize++] = node.second;
+					stack[stackSize++] = node.first;
+				}
+			}
+		}
+
+		FinishQuery(firstResult, visible);
+	}
+
+	uint32_t StaticBVH::BuildNode(uint32_t parent, uint32_t begin, uint32_t end)
+	{
+		const uint32_t nodeIndex = static_cast<uint32_t>(m_nodes.size());
+		m_nodes.push_back(Node());
+		m_nodes[nodeIndex].parent = parent;
+
+		if (end - begin <= s_kMaxLeafSize)
+		{
+			Node& leaf = m_nodes[nodeIndex];
+			leaf.first = begin;
+			leaf.second = s_kInvalidNode;
+			leaf.count = end - begin;
+			ComputeLeafBounds(leaf);
+
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				m_primLeaf[m_primIndices[i]] = nodeIndex;
+			}
+
+			return nodeIndex;
+		}
+
+		// median split along the widest spread of centers
+		float centerMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float centerMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			const BoundingSphere& bounds = m_primBounds[m_primIndices[i]];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				centerMin[axis] = std::min(centerMin[axis], bounds.center[axis]);
+				centerMax[axis] = std::max(centerMax[axis], bounds.center[axis]);
+			}
+		}
+
+		int splitAxis = 0;
+		for (int axis = 1; axis < 3; ++axis)
+		{
+			if (centerMax[axis] - centerMin[axis] > centerMax[splitAxis] - centerMin[splitAxis])
+			{
+				splitAxis = axis;
+			}
+		}
+
+		const uint32_t mid = begin + (end - begin) / 2;
+		std::nth_element(m_primIndices.begin() + begin, m_primIndices.begin() + mid, m_primIndices.begin() + end,
+			[this, splitAxis](uint32_t lhs, uint32_t rhs)
+		{
+			return m_primBounds[lhs].center[splitAxis] < m_primBounds[rhs].center[splitAxis];
+		});
+
+		const uint32_t first = BuildNode(nodeIndex, begin, mid);
+		const uint32_t second = BuildNode(nodeIndex, mid, end);
+
+		Node& node = m_nodes[nodeIndex];
+		node.first = first;
+		node.second = second;
+		node.count = 0;
+		node.bounds = m_nodes[first].bounds;
+		Merge(node.bounds, m_nodes[second].bounds);
+
+		return nodeIndex;
+	}
+
+	void StaticBVH::ComputeLeafBounds(Node& leaf) const
+	{
+		leaf.bounds = m_primBoxes[m_primIndices[leaf.first]];
+		for (uint32_t i = leaf.first + 1; i < leaf.first + leaf.count; ++i)
+		{
+			Merge(leaf.bounds, m_primBoxes[m_primIndices[i]]);
+		}
+	}
+
+	void StaticBVH::EmitSubtree(uint32_t nodeIndex, std::vector<uint32_t>& visible) const
+	{
+		const Node& node = m_nodes[nodeIndex];
+		if (node.count > 0)
+		{
+			for (uint32_t i = node.first; i < node.first + node.count; ++i)
+			{
+				visible.push_back(m_primIndices[i]);
+			}
+			return;
+		}
+
+		EmitSubtree(node.first, visible);
+		EmitSubtree(node.second, visible);
+	}
+
+	void StaticBVH::FinishQuery(size_t firstResult, std::vector<uint32_t>& visible) const
+	{
+		visible.insert(visible.end(), m_unbounded.begin(), m_unbounded.end());
+
+		// registry order, so the draw commands come out in the order the unculled path draws
+		std::sort(visible.begin() + firstResult, visible.end());
+	}
+
+	StaticBVH::AABB StaticBVH::SphereToAABB(const BoundingSphere& sphere)
+	{
+		AABB box;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			box.min[axis] = sphere.center[axis] - sphere.radius;
+			box.max[axis] = sphere.center[axis] + sphere.radius;
+		}
+
+		return box;
+	}
+
+	void StaticBVH::Merge(AABB& a, const AABB& b)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			a.min[axis] = std::min(a.min[axis], b.min[axis]);
+			a.max[axis] = std::max(a.max[axis], b.max[axis]);
+		}
+	}
+
+	StaticBVH::FrustumResult StaticBVH::TestAABB(const Frustum& frustum, const AABB& box)
+	{
+		FrustumResult result = kInside;
+
+		for (int i = 0; i < Frustum::kMaxPlanes; ++i)
+		{
+			const float* pPlane = frustum.GetPlane(i);
+
+			// corners furthest along and against the plane normal
+			float distFar = pPlane[3];
+			float distNear = pPlane[3];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				const bool bPositive = pPlane[axis] >= 0.0f;
+				distFar += pPlane[axis] * (bPositive ? box.max[axis] : box.min[axis]);
+				distNear += pPlane[axis] * (bPositive ? box.min[axis] : box.max[axis]);
+			}
+
+			if (distFar < 0.0f)
+			{
+				return kOutside;
+			}
+
+			if (distNear < 0.0f)
+			{
+				result = kIntersects;
+			}
+		}
+
+		return result;
+	}
+
+	bool StaticBVH::TestAABB(const BoundingSphere& sphere, const AABB& box)
+	{
+		float distSq = 0.0f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float closest = std::max(box.min[axis], std::min(sphere.center[axis], box.max[axis]));
+			const float delta = sphere.center[axis] - closest;
+			distSq += delta*delta;
+		}
+
+		return distSq <= sphere.radius*sphere.radius;
+	}
+}
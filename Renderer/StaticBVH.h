@@ -0,0 +1,84 @@
+// StaticBVH.h
+// Bounding volume hierarchy over the retained static packages of a StaticPackageRegistry.
+// Built once when the registered set changes, and refit leaf to root when a package's bounds move,
+// so frustum & light volume queries cost O(log n + visible) instead of a linear scan.
+// Primitives are identified by their index in the registry
+#pragma once
+#ifndef STATIC_BVH_H
+#define STATIC_BVH_H
+
+#include <cstdint>
+#include <vector>
+
+#include "FrustumCuller.h"
+
+namespace GamePrototype
+{
+	class StaticBVH
+	{
+	public:
+		StaticBVH();
+
+		void Build(const std::vector<BoundingSphere>& bounds);
+		void Clear();
+
+		// refits the path from the primitive's leaf up to the root. The primitive must not change between
+		// finite & infinite bounds (that needs a Build())
+		void UpdatePrimitive(uint32_t prim, const BoundingSphere& bounds);
+
+		// appends the primitives touching the volume to visible, in ascending order.
+		// Primitives without bounds are always included
+		void QueryFrustum(const Frustum&, std::vector<uint32_t>& visible) const;
+		void QuerySphere(const BoundingSphere&, std::vector<uint32_t>& visible) const;
+
+		size_t GetNumNodes() const { return m_nodes.size(); }
+		size_t GetNumPrimitives() const { return m_primBounds.size(); }
+
+	private:
+
+		struct AABB
+		{
+			float min[3];
+			float max[3];
+		};
+
+		// leaves: m_primIndices[first, first + count). Interior nodes: count == 0, children first & second
+		struct Node
+		{
+			AABB		bounds;
+			uint32_t	first;
+			uint32_t	second;
+			uint32_t	count;
+			uint32_t	parent;
+		};
+
+		enum FrustumResult
+		{
+			kOutside,
+			kIntersects,
+			kInside
+		};
+
+		uint32_t BuildNode(uint32_t parent, uint32_t begin, uint32_t end);
+		void ComputeLeafBounds(Node&) const;
+		void EmitSubtree(uint32_t nodeIndex, std::vector<uint32_t>& visible) const;
+		void FinishQuery(size_t firstResult, std::vector<uint32_t>& visible) const;
+
+		static AABB SphereToAABB(const BoundingSphere&);
+		static void Merge(AABB& a, const AABB& b);
+		static FrustumResult TestAABB(const Frustum&, const AABB&);
+		static bool TestAABB(const BoundingSphere&, const AABB&);
+
+		std::vector<Node>				m_nodes;
+		std::vector<uint32_t>			m_primIndices;		// leaf order
+		std::vector<uint32_t>			m_primLeaf;			// primitive -> leaf node
+		std::vector<AABB>				m_primBoxes;
+		std::vector<BoundingSphere>		m_primBounds;
+		std::vector<uint32_t>			m_unbounded;		// always visible
+
+		static const uint32_t			s_kInvalidNode = 0xffffffff;
+		static const uint32_t			s_kMaxLeafSize = 4;
+	};
+}
+
+#endif // STATIC_BVH_H
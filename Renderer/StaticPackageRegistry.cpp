@@ -0,0 +1,412 @@
+// StaticPackageRegistry.cpp
+#ifndef __linux__
+#include "stdafx.h"
+#endif
+
+#include <cassert>
+#include <cstring>
+
+#include "StaticPackageRegistry.h"
+
+namespace GamePrototype
+{
+	StaticPackageRegistry::StaticPackageRegistry()
+	:
+	m_bRebuildBVH(true),
+	m_generation(0),
+	m_boundsVersion(0),
+	m_frame(0),
+	m_matchFrame(0),
+	m_numAdded(0),
+	m_numRemoved(0),
+	m_bForceChange(false)
+	{
+	}
+
+	bool StaticPackageRegistry::Update(const DrawPackageBin& bin)
+	{
+		const DrawPackageList& collected = bin.packages;
+
+		m_numAdded = 0;
+		m_numRemoved = 0;
+
+		// steady state: the scene handed us exactly what it did last frame, nothing to look up
+		bool bSameAsLastFrame = !m_bForceChange && collected.size() == m_lastCollected.size();
+		for (size_t i = 0; bSameAsLastFrame && i < collected.size(); ++i)
+		{
+			bSameAsLastFrame = (collected[i].get() == m_lastCollected[i]);
+		}
+
+		if (bSameAsLastFrame)
+		{
+			MarkMovedInstances(bin);
+
+			if (!SameBoundsAsLastFrame(bin))
+			{
+				UpdateBounds(bin);
+			}
+
+			return false;
+		}
+
+		m_lastCollected.resize(collected.size());
+		for (size_t i = 0; i < collected.size(); ++i)
+		{
+			m_lastCollected[i] = collected[i].get();
+		}
+
+		bool bChanged = Diff(bin) || m_bForceChange;
+		m_bForceChange = false;
+
+		if (bChanged)
+		{
+			++m_generation;
+			m_bRebuildBVH = true;
+			UpdateInstanceOffsets();
+			AssignInstances(bin);
+		}
+		else
+		{
+			// same packages in a different order, every object still has its instance
+			MarkMovedInstances(bin);
+		}
+
+		UpdateBounds(bin);
+
+		return bChanged;
+	}
+
+	void StaticPackageRegistry::QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& visible)
+	{
+		UpdateBVH();
+		m_bvh.QueryFrustum(frustum, visible);
+	}
+
+	void StaticPackageRegistry::QuerySphere(const BoundingSphere& sphere, std::vector<uint32_t>& visible)
+	{
+		UpdateBVH();
+		m_bvh.QuerySphere(sphere, visible);
+	}
+
+	bool StaticPackageRegistry::SameBoundsAsLastFrame(const DrawPackageBin& bin) const
+	{
+		if (m_lastCollectedBounds.size() != bin.Size())
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < bin.Size(); ++i)
+		{
+			const BoundingSphere& last = m_lastCollectedBounds[i];
+			if (last.center[0] != bin.centerX[i] || last.center[1] != bin.centerY[i] ||
+				last.center[2] != bin.centerZ[i] || last.radius != bin.radius[i])
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void StaticPackageRegistry::UpdateBounds(const DrawPackageBin& bin)
+	{
+		++m_boundsVersion;
+
+		m_lastCollectedBounds.resize(bin.Size());
+		for (size_t i = 0; i < bin.Size(); ++i)
+		{
+			m_lastCollectedBounds[i] = BoundingSphere(bin.centerX[i], bin.centerY[i], bin.centerZ[i], bin.radius[i]);
+		}
+
+		// every object sharing a package has to be covered by its bounds
+		std::vector<BoundingSphere> bounds(m_packages.size());
+		std::vector<bool> bSeen(m_packages.size(), false);
+		for (size_t i = 0; i < bin.Size(); ++i)
+		{
+			auto iter = m_indices.find(bin.packages[i].get());
+			assert(iter != m_indices.end());
+
+			const BoundingSphere& sphere = m_lastCollectedBounds[i];
+			if (!bSeen[iter->second])
+			{
+				bounds[iter->second] = sphere;
+				bSeen[iter->second] = true;
+			}
+			else
+			{
+				bounds[iter->second] = BoundingSphere::Merge(bounds[iter->second], sphere);
+			}
+		}
+
+		if (m_bRebuildBVH || m_bounds.size() != bounds.size())
+		{
+			m_bounds.swap(bounds);
+			m_bRebuildBVH = true;
+			return;
+		}
+
+		for (size_t i = 0; i < bounds.size(); ++i)
+		{
+			const BoundingSphere& current = m_bounds[i];
+			if (memcmp(&current, &bounds[i], sizeof(BoundingSphere)) == 0)
+			{
+				continue;
+			}
+
+			// gaining or losing bounds moves the package in or out of the hierarchy
+			if (current.IsInfinite() != bounds[i].IsInfinite())
+			{
+				m_bRebuildBVH = true;
+			}
+
+			m_bounds[i] = bounds[i];
+			m_movedPackages.push_back(static_cast<uint32_t>(i));
+		}
+	}
+
+	void StaticPackageRegistry::UpdateBVH()
+	{
+		if (m_bRebuildBVH)
+		{
+			m_bvh.Build(m_bounds);
+			m_movedPackages.clear();
+			m_bRebuildBVH = false;
+			return;
+		}
+
+		for (uint32_t index : m_movedPackages)
+		{
+			m_bvh.UpdatePrimitive(index, m_bounds[index]);
+		}
+
+		m_movedPackages.clear();
+	}
+
+	void StaticPackageRegistry::MarkMovedInstances(const DrawPackageBin& bin)
+	{
+		// only called when Update() reports no change, so every package has as many instances as it is collected
+		++m_matchFrame;
+		m_unmatched.clear();
+
+		for (size_t i = 0; i < bin.Size(); ++i)
+		{
+			auto slotIter = m_instanceSlots.find(InstanceKey{ bin.packages[i].get(), bin.owners[i] });
+			if (slotIter == m_instanceSlots.end() || m_instanceMatched[slotIter->second] == m_matchFrame)
+			{
+				m_unmatched.push_back(static_cast<uint32_t>(i));
+				continue;
+			}
+
+			const uint32_t instance = slotIter->second;
+			m_instanceMatched[instance] = m_matchFrame;
+			MarkMovedInstance(instance, bin, i);
+		}
+
+		if (m_unmatched.empty())
+		{
+			return;
+		}
+
+		// a shared package changed hands: the newcomer takes an instance nobody collected this frame
+		m_occurrences.assign(m_packages.size(), 0);
+		for (uint32_t i : m_unmatched)
+		{
+			const DrawPackageData* pData = bin.packages[i].get();
+			auto iter = m_indices.find(pData);
+			assert(iter != m_indices.end());
+
+			const size_t index = iter->second;
+			uint32_t instance = m_instanceOffsets[index] + m_occurrences[index];
+			while (m_instanceMatched[instance] == m_matchFrame)
+			{
+				++instance;
+				++m_occurrences[index];
+			}
+
+			assert(m_occurrences[index] < m_instanceCounts[index]);
+
+			auto slotIter = m_instanceSlots.find(InstanceKey{ pData, m_instanceOwners[instance] });
+			if (slotIter != m_instanceSlots.end() && slotIter->second == instance)
+			{
+				m_instanceSlots.erase(slotIter);
+			}
+
+			m_instanceSlots.emplace(InstanceKey{ pData, bin.owners[i] }, instance);
+			m_instanceOwners[instance] = bin.owners[i];
+			m_instanceTransforms[instance] = bin.transformKeys[i];
+			m_instanceBounds[instance] = BoundingSphere(bin.centerX[i], bin.centerY[i], bin.centerZ[i], bin.radius[i]);
+			m_instanceMatched[instance] = m_matchFrame;
+			m_dirtyInstances.MarkDirty(instance);
+		}
+	}
+
+	void StaticPackageRegistry::MarkMovedInstance(uint32_t instance, const DrawPackageBin& bin, size_t index)
+	{
+		// objects without a transform key all share s_kUnknownTransform, their bounds decide
+		const BoundingSphere bounds(bin.centerX[index], bin.centerY[index], bin.centerZ[index], bin.radius[index]);
+		if (bin.transformKeys[index] != m_instanceTransforms[instance] ||
+			memcmp(&bounds, &m_instanceBounds[instance], sizeof(BoundingSphere)) != 0)
+		{
+			m_dirtyInstances.MarkDirty(instance);
+			m_instanceTransforms[instance] = bin.transformKeys[index];
+			m_instanceBounds[instance] = bounds;
+		}
+	}
+
+	void StaticPackageRegistry::AssignInstances(const DrawPackageBin& bin)
+	{
+		const size_t numInstances = m_dirtyInstances.GetSize();
+
+		// everything is fed again, nothing to mark
+		m_instanceSlots.clear();
+		m_instanceOwners.assign(numInstances, nullptr);
+		m_instanceTransforms.assign(numInstances, DrawPackageBin::s_kUnknownTransform);
+		m_instanceBounds.assign(numInstances, BoundingSphere());
+		m_instanceMatched.assign(numInstances, m_matchFrame);
+
+		m_occurrences.assign(m_packages.size(), 0);
+		for (size_t i = 0; i < bin.Size(); ++i)
+		{
+			auto iter = m_indices.find(bin.packages[i].get());
+			assert(iter != m_indices.end());
+
+			const uint32_t instance = m_instanceOffsets[iter->second] + m_occurrences[iter->second]++;
+			m_instanceSlots.emplace(InstanceKey{ bin.packages[i].get(), bin.owners[i] }, instance);
+			m_instanceOwners[instance] = bin.owners[i];
+			m_instanceTransforms[instance] = bin.transformKeys[i];
+			m_instanceBounds[instance] = BoundingSphere(bin.centerX[i], bin.centerY[i], bin.centerZ[i], bin.radius[i]);
+		}
+	}
+
+	void StaticPackageRegistry::UpdateInstanceOffsets()
+	{
+		m_instanceOffsets.resize(m_packages.size());
+
+		uint32_t numInstances = 0;
+		for (size_t i = 0; i < m_packages.size(); ++i)
+		{
+			m_instanceOffsets[i] = numInstances;
+			numInstances += m_instanceCounts[i];
+		}
+
+		m_dirtyInstances.Resize(numInstances);
+	}
+
+	void StaticPackageRegistry::Clear()
+	{
+		m_indices.clear();
+		m_packages.clear();
+		m_lastSeen.clear();
+		m_instanceCounts.clear();
+		m_frameCounts.clear();
+		m_lodLevels.clear();
+		m_lodCounts.clear();
+		m_lastCollected.clear();
+		m_lastCollectedBounds.clear();
+		m_bounds.clear();
+		m_movedPackages.clear();
+		m_instanceOffsets.clear();
+		m_occurrences.clear();
+		m_instanceSlots.clear();
+		m_instanceOwners.clear();
+		m_instanceTransforms.clear();
+		m_instanceBounds.clear();
+		m_instanceMatched.clear();
+		m_unmatched.clear();
+		m_dirtyInstances.Resize(0);
+		m_bvh.Clear();
+		m_bRebuildBVH = true;
+		++m_generation;
+		m_numAdded = 0;
+		m_numRemoved = 0;
+		m_bForceChange = false;
+	}
+
+	bool StaticPackageRegistry::Diff(const DrawPackageBin& bin)
+	{
+		const DrawPackageList& collected = bin.packages;
+
+		++m_frame;
+
+		size_t numTouched = 0;
+		for (size_t i = 0; i < collected.size(); ++i)
+		{
+			const DrawPackageDataPtr& dataPtr = collected[i];
+			auto iter = m_indices.find(dataPtr.get());
+			if (iter != m_indices.end())
+			{
+				// the same package may be collected more than once in a frame (shared between objects)
+				if (m_lastSeen[iter->second] != m_frame)
+				{
+					m_lastSeen[iter->second] = m_frame;
+					m_frameCounts[iter->second] = 1;
+					++numTouched;
+				}
+				else
+				{
+					++m_frameCounts[iter->second];
+				}
+			}
+			else
+			{
+				m_indices.emplace(dataPtr.get(), m_packages.size());
+				m_packages.push_back(dataPtr);
+				m_lastSeen.push_back(m_frame);
+				m_instanceCounts.push_back(1);
+				m_frameCounts.push_back(1);
+				m_lodLevels.push_back(bin.lodLevels[i]);
+				m_lodCounts.push_back(bin.lodCounts[i]);
+				++numTouched;
+				++m_numAdded;
+			}
+		}
+
+		bool bCountsChanged = false;
+
+		// everything retained was seen this frame, nothing to remove
+		if (numTouched != m_packages.size())
+		{
+			size_t writeIndex = 0;
+			for (size_t readIndex = 0; readIndex < m_packages.size(); ++readIndex)
+			{
+				if (m_lastSeen[readIndex] != m_frame)
+				{
+					m_indices.erase(m_packages[readIndex].get());
+					++m_numRemoved;
+					continue;
+				}
+
+				if (writeIndex != readIndex)
+				{
+					m_packages[writeIndex] = std::move(m_packages[readIndex]);
+					m_lastSeen[writeIndex] = m_lastSeen[readIndex];
+					m_instanceCounts[writeIndex] = m_instanceCounts[readIndex];
+					m_frameCounts[writeIndex] = m_frameCounts[readIndex];
+					m_lodLevels[writeIndex] = m_lodLevels[readIndex];
+					m_lodCounts[writeIndex] = m_lodCounts[readIndex];
+					m_indices[m_packages[writeIndex].get()] = writeIndex;
+				}
+
+				++writeIndex;
+			}
+
+			m_packages.resize(writeIndex);
+			m_lastSeen.resize(writeIndex);
+			m_instanceCounts.resize(writeIndex);
+			m_frameCounts.resize(writeIndex);
+			m_lodLevels.resize(writeIndex);
+			m_lodCounts.resize(writeIndex);
+		}
+
+		for (size_t i = 0; i < m_packages.size(); ++i)
+		{
+			if (m_instanceCounts[i] != m_frameCounts[i])
+			{
+				m_instanceCounts[i] = m_frameCounts[i];
+				bCountsChanged = true;
+			}
+		}
+
+		return m_numAdded > 0 || m_numRemoved > 0 || bCountsChanged;
+	}
+}
@@ -0,0 +1,137 @@
+// StaticPackageRegistry.h
+// Retained set of static DrawPackageData for BatchDrawEffect. Static geometry is collected every frame
+// like everything else, but the registry only reports a change (and the static IMultiDraw objects are only
+// rebuilt) when packages were actually added or removed since the last Update(), or a shared package
+// (see DrawPackageCache) changed how many times it was collected.
+// Package bounds are tracked as well and kept in a StaticBVH for culling queries. Moving bounds only
+// refit the hierarchy, they do not count as a change. An instance has moved when its transform key (see
+// DrawPackageBin::transformKeys) or its bounds changed, so with a key an object turning about its own center
+// counts too, and without one its bounds decide.
+// Instances are kept by object (see DrawPackageBin::owners), not by the order they were collected in, so
+// objects sharing a package keep theirs from frame to frame. The instances whose key changed, or that
+// changed hands, are marked dirty, so their transforms can be uploaded on their own
+#pragma once
+#ifndef STATIC_PACKAGE_REGISTRY_H
+#define STATIC_PACKAGE_REGISTRY_H
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "DirtyRangeTracker.h"
+#include "DrawPackageBins.h"
+#include "StaticBVH.h"
+
+namespace GamePrototype
+{
+	class StaticPackageRegistry
+	{
+	public:
+		StaticPackageRegistry();
+
+		// diff this frame's collected static packages against the retained set.
+		// Returns true if anything was added, removed or changed instance count
+		bool Update(const DrawPackageBin& collected);
+
+		// retained packages in registration order (removals keep the order of the rest)
+		const std::vector<DrawPackageDataPtr>& GetPackages() const { return m_packages; }
+
+		// how many times each retained package was collected, parallel to GetPackages().
+		// Greater than 1 only for packages shared between RenderObjects
+		const std::vector<uint32_t>& GetInstanceCounts() const { return m_instanceCounts; }
+
+		// first instance of each retained package, parallel to GetPackages(), as AddToMultiDraw() lays them out
+		const std::vector<uint32_t>& GetInstanceOffsets() const { return m_instanceOffsets; }
+
+		// the object behind each instance (see DrawPackageBin::owners). Assigned in collection order when
+		// Update() reports a change, kept as long as the object collects the package after that. An object
+		// taking over a shared package from one that no longer collects it gets the freed instance
+		const std::vector<const void*>& GetInstanceOwners() const { return m_instanceOwners; }
+
+		// instances whose transform key or bounds changed in an Update() that reported no change. A change
+		// resets it, since everything is fed again anyway. The caller clears it once the instances are uploaded
+		DirtyRangeTracker& GetDirtyInstances() { return m_dirtyInstances; }
+
+		// bumped whenever Update() reports a change, so index lists into GetPackages() can be checked
+		uint32_t GetGeneration() const { return m_generation; }
+
+		// indices into GetPackages(), ascending. Packages shared between objects use the union of their bounds
+		void QueryFrustum(const Frustum&, std::vector<uint32_t>& visible);
+		void QuerySphere(const BoundingSphere&, std::vector<uint32_t>& visible);
+		const std::vector<BoundingSphere>& GetBounds() const { return m_bounds; }
+
+		// bumped whenever GetBounds() may have changed, including moves that keep the generation
+		uint32_t GetBoundsVersion() const { return m_boundsVersion; }
+
+		// level of detail of each package and how many levels its object has, parallel to GetPackages()
+		const std::vector<uint8_t>& GetLodLevels() const { return m_lodLevels; }
+		const std::vector<uint8_t>& GetLodCounts() const { return m_lodCounts; }
+
+		// force the next Update() to report a change, e.g. after the IMultiDraw objects were reset
+		void Invalidate() { m_lastCollected.clear(); m_bForceChange = true; }
+		void Clear();
+
+		size_t GetNumAdded() const { return m_numAdded; }
+		size_t GetNumRemoved() const { return m_numRemoved; }
+
+	private:
+
+		bool Diff(const DrawPackageBin& collected);
+		bool SameBoundsAsLastFrame(const DrawPackageBin& collected) const;
+		void UpdateBounds(const DrawPackageBin& collected);
+		void UpdateBVH();
+		void MarkMovedInstances(const DrawPackageBin& collected);
+		void MarkMovedInstance(uint32_t instance, const DrawPackageBin& collected, size_t index);
+		void AssignInstances(const DrawPackageBin& collected);
+		void UpdateInstanceOffsets();
+
+		struct InstanceKey
+		{
+			const DrawPackageData*							pData;
+			const void*										pOwner;
+
+			bool operator==(const InstanceKey& rhs) const { return pData == rhs.pData && pOwner == rhs.pOwner; }
+		};
+
+		struct InstanceKeyHash
+		{
+			size_t operator()(const InstanceKey& key) const
+			{
+				return std::hash<const void*>()(key.pData) ^ (std::hash<const void*>()(key.pOwner) * 31);
+			}
+		};
+
+		std::unordered_map<const DrawPackageData*, size_t>	m_indices;			// package -> index into m_packages
+		std::vector<DrawPackageDataPtr>						m_packages;
+		std::vector<uint32_t>								m_lastSeen;			// parallel to m_packages
+		std::vector<uint32_t>								m_instanceCounts;	// parallel to m_packages
+		std::vector<uint32_t>								m_frameCounts;		// this Diff()'s counts, parallel to m_packages
+		std::vector<const DrawPackageData*>					m_lastCollected;	// cheap steady state check
+		std::vector<BoundingSphere>							m_lastCollectedBounds;
+		std::vector<BoundingSphere>							m_bounds;			// parallel to m_packages
+		std::vector<uint8_t>								m_lodLevels;		// parallel to m_packages
+		std::vector<uint8_t>								m_lodCounts;		// parallel to m_packages
+		std::vector<uint32_t>								m_movedPackages;	// waiting for a BVH refit
+		std::vector<uint32_t>								m_instanceOffsets;	// parallel to m_packages
+		std::vector<uint32_t>								m_occurrences;		// scratch, parallel to m_packages
+		std::unordered_map<InstanceKey, uint32_t, InstanceKeyHash>	m_instanceSlots;	// package, object -> instance
+		std::vector<const void*>							m_instanceOwners;	// per instance
+		std::vector<uint64_t>								m_instanceTransforms;	// per instance, last transform key
+		std::vector<BoundingSphere>							m_instanceBounds;	// per instance, last bounds
+		std::vector<uint32_t>								m_instanceMatched;	// per instance, m_matchFrame it was last collected
+		std::vector<uint32_t>								m_unmatched;		// scratch, collected entries without an instance
+		DirtyRangeTracker									m_dirtyInstances;
+		StaticBVH											m_bvh;
+		bool												m_bRebuildBVH;
+		uint32_t											m_generation;
+		uint32_t											m_boundsVersion;
+		uint32_t											m_frame;
+		uint32_t											m_matchFrame;
+		size_t												m_numAdded;
+		size_t												m_numRemoved;
+		bool												m_bForceChange;
+	};
+}
+
+#endif // STATIC_PACKAGE_REGISTRY_H
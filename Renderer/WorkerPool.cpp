@@ -0,0 +1,184 @@
+// WorkerPool.cpp
+#ifndef __linux__
+#include "stdafx.h"
+#endif
+
+#include "WorkerPool.h"
+
+namespace GamePrototype
+{
+	WorkerPool::WorkerPool(size_t numWorkers)
+	:
+	m_pTask(nullptr),
+	m_taskCount(0),
+	m_taskGeneration(0),
+	m_activeWorkers(0),
+	m_nextIndex(0),
+	m_finishedCount(0),
+	m_bShutdown(false)
+	{
+		if (numWorkers == 0)
+		{
+			unsigned int hwThreads = std::thread::hardware_concurrency();
+			numWorkers = (hwThreads > 1) ? hwThreads - 1 : 1;
+		}
+
+		m_threads.reserve(numWorkers);
+		for (size_t i = 0; i < numWorkers; ++i)
+		{
+			m_threads.emplace_back(&WorkerPool::WorkerLoop, this);
+		}
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_bShutdown = true;
+		}
+
+		m_wakeCondition.notify_all();
+
+		for (auto& thread : m_threads)
+		{
+			thread.join();
+		}
+	}
+
+	void WorkerPool::ParallelFor(size_t count, const IndexTask& task)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		// not worth waking anybody up for
+		if (count == 1 || m_threads.empty())
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				task(i);
+			}
+			return;
+		}
+
+		std::lock_guard<std::mutex> forLock(m_parallelForMutex);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_pTask = &task;
+			m_taskCount = count;
+			m_nextIndex = 0;
+			m_finishedCount = 0;
+			++m_taskGeneration;
+		}
+
+		m_wakeCondition.notify_all();
+
+		// the calling thread pulls indices too
+		RunIndices(task, count);
+
+		// NOTE: workers that picked up this generation must have left RunIndices() before
+		// the task (which lives on the caller's stack) goes out of scope
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_doneCondition.wait(lock, [this, count]()
+		{
+			return m_finishedCount.load() == count && m_activeWorkers == 0;
+		});
+
+		m_pTask = nullptr;
+		m_taskCount = 0;
+	}
+
+	void WorkerPool::Submit(Job job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_jobs.push_back(std::move(job));
+		}
+
+		m_wakeCondition.notify_one();
+	}
+
+	WorkerPoolPtr WorkerPool::GetDefault()
+	{
+		static WorkerPoolPtr s_defaultPoolPtr = std::make_shared<WorkerPool>();
+		return s_defaultPoolPtr;
+	}
+
+	void WorkerPool::WorkerLoop()
+	{
+		uint64_t lastGeneration = 0;
+
+		for (;;)
+		{
+			const IndexTask* pTask = nullptr;
+			size_t count = 0;
+			Job job;
+
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_wakeCondition.wait(lock, [this, lastGeneration]()
+				{
+					return m_bShutdown || (m_pTask && m_taskGeneration != lastGeneration) || !m_jobs.empty();
+				});
+
+				// ParallelFor() has a caller waiting on it, so it goes first
+				if (m_pTask && m_taskGeneration != lastGeneration)
+				{
+					lastGeneration = m_taskGeneration;
+					pTask = m_pTask;
+					count = m_taskCount;
+					++m_activeWorkers;
+				}
+				else if (!m_jobs.empty())
+				{
+					job = std::move(m_jobs.front());
+					m_jobs.pop_front();
+				}
+				else
+				{
+					// shutting down, and submitted jobs have all been run
+					return;
+				}
+			}
+
+			if (job)
+			{
+				job();
+				continue;
+			}
+
+			RunIndices(*pTask, count);
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				--m_activeWorkers;
+			}
+
+			m_doneCondition.notify_all();
+		}
+	}
+
+	void WorkerPool::RunIndices(const IndexTask& task, size_t count)
+	{
+		for (;;)
+		{
+			size_t index = m_nextIndex.fetch_add(1);
+			if (index >= count)
+			{
+				break;
+			}
+
+			task(index);
+
+			if (m_finishedCount.fetch_add(1) + 1 == count)
+			{
+				// take the lock so the notify cannot slip in between the caller's
+				// predicate check and its wait
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_doneCondition.notify_all();
+			}
+		}
+	}
+}
@@ -0,0 +1,73 @@
+// WorkerPool.h
+// Small fixed pool of worker threads for splitting render thread work (Collect & friends)
+// into independent index ranges. The calling thread participates, so a pool of N workers
+// runs N+1 ranges at a time. Fire and forget jobs (Submit()) run whenever no ParallelFor() is active.
+#pragma once
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace GamePrototype
+{
+	class WorkerPool;
+	typedef std::shared_ptr<WorkerPool> WorkerPoolPtr;
+
+	class WorkerPool
+	{
+	public:
+		typedef std::function<void(size_t)> IndexTask;
+		typedef std::function<void()> Job;
+
+		// 0 == one worker per hardware thread, minus the calling thread
+		explicit WorkerPool(size_t numWorkers = 0);
+		~WorkerPool();
+
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+
+		size_t GetNumWorkers() const { return m_threads.size(); }
+
+		// runs task(i) for every i in [0, count) and returns once all of them have finished.
+		// Which thread runs which index is unspecified, so tasks should only write to state owned by i.
+		void ParallelFor(size_t count, const IndexTask& task);
+
+		// queues a job for the next free worker and returns immediately
+		void Submit(Job job);
+
+		// lazily created pool shared by every effect that does not supply its own
+		static WorkerPoolPtr GetDefault();
+
+	private:
+
+		void WorkerLoop();
+		void RunIndices(const IndexTask& task, size_t count);
+
+		std::vector<std::thread>		m_threads;
+		std::mutex						m_mutex;
+		std::condition_variable			m_wakeCondition;
+		std::condition_variable			m_doneCondition;
+		std::mutex						m_parallelForMutex;	// one ParallelFor() in flight at a time
+
+		// current ParallelFor() state, guarded by m_mutex (indices are handed out atomically)
+		const IndexTask*				m_pTask;
+		size_t							m_taskCount;
+		uint64_t						m_taskGeneration;
+		size_t							m_activeWorkers;
+		std::atomic<size_t>				m_nextIndex;
+		std::atomic<size_t>				m_finishedCount;
+		bool							m_bShutdown;
+
+		std::deque<Job>					m_jobs;		// guarded by m_mutex
+	};
+}
+
+#endif // WORKER_POOL_H
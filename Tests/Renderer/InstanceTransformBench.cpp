@@ -0,0 +1,134 @@
+// InstanceTransformBench.cpp
+// Times InstanceTransform::ComposeBatch() against the scalar path (FrustumCuller::Multiply() then Encode())
+// for 10k, 100k and 1M instances in every format, instances spread over a few parents as in a scene. Each
+// time is the best of a few runs into a buffer written before, so page faults are not counted. The kernel
+// is whichever the build enables, so build it once per instruction set to compare:
+//
+//   g++ -std=c++17 -O2 [-mavx | -mavx2 -mfma] -I<engine include dir> -IRenderer -o InstanceTransformBench
+//       Tests/Renderer/InstanceTransformBench.cpp Renderer/InstanceTransform.cpp Renderer/FrustumCuller.cpp
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "FrustumCuller.h"
+#include "InstanceTransform.h"
+
+using namespace GamePrototype;
+
+namespace
+{
+	const size_t kCounts[] = { 10000, 100000, 1000000 };
+	const size_t kNumParents = 64;
+	const int kNumRuns = 5;
+
+	uint32_t g_seed = 12345;
+
+	float Random(float minValue, float maxValue)
+	{
+		g_seed = g_seed * 1664525u + 1013904223u;
+		return minValue + (maxValue - minValue) * static_cast<float>(g_seed >> 8) / 16777216.0f;
+	}
+
+	// rotation about z, uniform scale and translation, column major
+	void RandomTransform(float* pMat4)
+	{
+		const float angle = Random(-3.14159265f, 3.14159265f);
+		const float scale = Random(0.1f, 10.0f);
+		const float c = std::cos(angle) * scale, s = std::sin(angle) * scale;
+
+		const float mat[16] =
+		{
+			c, s, 0.0f, 0.0f,
+			-s, c, 0.0f, 0.0f,
+			0.0f, 0.0f, scale, 0.0f,
+			Random(-1000.0f, 1000.0f), Random(-1000.0f, 1000.0f), Random(-1000.0f, 1000.0f), 1.0f
+		};
+
+		for (int i = 0; i < 16; ++i)
+		{
+			pMat4[i] = mat[i];
+		}
+	}
+
+	void ComposeScalar(InstanceTransform::Format format, const float* pParents, const uint32_t* pParentIndices,
+		const float* pLocals, size_t count, void* pDst)
+	{
+		const size_t stride = InstanceTransform::GetStride(format);
+		char* pOut = static_cast<char*>(pDst);
+
+		for (size_t i = 0; i < count; ++i, pOut += stride)
+		{
+			float world[16];
+			FrustumCuller::Multiply(pParents + pParentIndices[i] * 16, pLocals + i * 16, world);
+			InstanceTransform::Encode(format, world, pOut);
+		}
+	}
+
+	// best of kNumRuns, in milliseconds
+	template <typename Func>
+	double Time(const Func& func)
+	{
+		double best = 1.0e30;
+		for (int run = 0; run < kNumRuns; ++run)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			func();
+			const auto end = std::chrono::steady_clock::now();
+			best = std::fmin(best, std::chrono::duration<double, std::milli>(end - start).count());
+		}
+
+		return best;
+	}
+}
+
+int main()
+{
+#if defined(__AVX__)
+	const char* pKernel = "AVX";
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	const char* pKernel = "SSE2";
+#else
+	const char* pKernel = "scalar";
+#endif
+
+	const size_t maxCount = kCounts[sizeof(kCounts) / sizeof(kCounts[0]) - 1];
+
+	std::vector<float> parents(kNumParents * 16);
+	std::vector<float> locals(maxCount * 16);
+	std::vector<uint32_t> parentIndices(maxCount);
+
+	for (size_t i = 0; i < kNumParents; ++i)
+	{
+		RandomTransform(&parents[i * 16]);
+	}
+
+	for (size_t i = 0; i < maxCount; ++i)
+	{
+		RandomTransform(&locals[i * 16]);
+		parentIndices[i] = static_cast<uint32_t>(i % kNumParents);
+	}
+
+	// touched once up front, like a mapped instance buffer that lives across frames
+	std::vector<float> dst(maxCount * 16, 0.0f);
+
+	const char* pFormatNames[] = { "kMat4", "kAffine3x4", "kQuatPosScale" };
+	const InstanceTransform::Format formats[] = { InstanceTransform::kMat4, InstanceTransform::kAffine3x4, InstanceTransform::kQuatPosScale };
+
+	printf("ComposeBatch(): %s kernel, best of %d runs\n", pKernel, kNumRuns);
+	printf("%-14s %10s %12s %12s %8s\n", "format", "instances", "scalar ms", "batch ms", "speedup");
+
+	for (int f = 0; f < 3; ++f)
+	{
+		for (size_t count : kCounts)
+		{
+			const double scalar = Time([&]() { ComposeScalar(formats[f], parents.data(), parentIndices.data(), locals.data(), count, dst.data()); });
+			const double batch = Time([&]() { InstanceTransform::ComposeBatch(formats[f], parents.data(), parentIndices.data(), locals.data(), count, dst.data()); });
+
+			printf("%-14s %10zu %12.3f %12.3f %7.2fx\n", pFormatNames[f], count, scalar, batch, scalar / batch);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,373 @@
+// InstanceTransformTest.cpp
+// Precision of the compact instance encodings against the full 4x4 path: every format's decoded matrix,
+// and the points it transforms, are compared with the matrix that went in, directly and through
+// ComposeBatch(). kAffine3x4 has to be exact. kQuatPosScale has to stay within float rounding for
+// rotation and uniform scale, and RoundTripError() has to report what it loses on anything else.
+// ComposeBatch()'s SSE2 or AVX kernel has to agree with the scalar path (FrustumCuller::Multiply() then
+// Encode()) to within a few ulps of the products summed, so FMA contraction on either side is fine:
+//
+//   g++ -std=c++17 -O2 [-mavx | -mavx2 -mfma] -I<engine include dir> -IRenderer -o InstanceTransformTest
+//       Tests/Renderer/InstanceTransformTest.cpp Renderer/InstanceTransform.cpp Renderer/FrustumCuller.cpp
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "FrustumCuller.h"
+#include "InstanceTransform.h"
+
+using namespace GamePrototype;
+
+#define CHECK(expr) \
+	do { if (!(expr)) { printf("FAILED: %s (%s:%d)\n", #expr, __FILE__, __LINE__); return false; } } while (0)
+
+namespace
+{
+	const int kNumTransforms = 10000;
+
+	// relative to the size of what is transformed, a few float ulps
+	const float kQuatTolerance = 1.0e-5f;
+
+	// ulps of the largest term between two roundings of the same sum of four products (fused or not)
+	const float kComposeUlps = 8.0f;
+
+	uint32_t g_seed = 12345;
+
+	float Random(float minValue, float maxValue)
+	{
+		g_seed = g_seed * 1664525u + 1013904223u;
+		return minValue + (maxValue - minValue) * static_cast<float>(g_seed >> 8) / 16777216.0f;
+	}
+
+	// column major rotation about a random axis, times scale (x, y, z), then translation
+	void RandomTransform(float scaleX, float scaleY, float scaleZ, float* pMat4)
+	{
+		double axis[3] = { Random(-1.0f, 1.0f), Random(-1.0f, 1.0f), Random(-1.0f, 1.0f) };
+		const double length = std::sqrt(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]) + 1.0e-9;
+		for (double& a : axis)
+		{
+			a /= length;
+		}
+
+		const double angle = Random(-3.14159265f, 3.14159265f);
+		const double c = std::cos(angle), s = std::sin(angle), t = 1.0 - c;
+		const double r[3][3] =
+		{
+			{ t*axis[0]*axis[0] + c, t*axis[0]*axis[1] - s*axis[2], t*axis[0]*axis[2] + s*axis[1] },
+			{ t*axis[0]*axis[1] + s*axis[2], t*axis[1]*axis[1] + c, t*axis[1]*axis[2] - s*axis[0] },
+			{ t*axis[0]*axis[2] - s*axis[1], t*axis[1]*axis[2] + s*axis[0], t*axis[2]*axis[2] + c }
+		};
+
+		const float scale[3] = { scaleX, scaleY, scaleZ };
+		for (int col = 0; col < 3; ++col)
+		{
+			for (int row = 0; row < 3; ++row)
+			{
+				pMat4[col*4 + row] = static_cast<float>(r[row][col] * scale[col]);
+			}
+			pMat4[col*4 + 3] = 0.0f;
+		}
+
+		pMat4[12] = Random(-10000.0f, 10000.0f);
+		pMat4[13] = Random(-10000.0f, 10000.0f);
+		pMat4[14] = Random(-10000.0f, 10000.0f);
+		pMat4[15] = 1.0f;
+	}
+
+	void Transform(const float* pMat4, const float* pPoint, float* pResult)
+	{
+		for (int row = 0; row < 3; ++row)
+		{
+			pResult[row] = pMat4[row] * pPoint[0] + pMat4[4 + row] * pPoint[1] + pMat4[8 + row] * pPoint[2] + pMat4[12 + row];
+		}
+	}
+
+	// largest distance between where the two matrices put a few points, over how far the points go
+	float RelativePointError(const float* pExpected, const float* pActual, float scale)
+	{
+		const float points[][3] = { { 0.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }, { 30.0f, -20.0f, 50.0f } };
+
+		float maxError = 0.0f;
+		for (const auto& point : points)
+		{
+			float expected[3], actual[3];
+			Transform(pExpected, point, expected);
+			Transform(pActual, point, actual);
+
+			const float reach = std::fabs(scale) * std::sqrt(point[0]*point[0] + point[1]*point[1] + point[2]*point[2]) +
+				std::sqrt(expected[0]*expected[0] + expected[1]*expected[1] + expected[2]*expected[2]) + 1.0f;
+			for (int i = 0; i < 3; ++i)
+			{
+				maxError = std::fmax(maxError, std::fabs(expected[i] - actual[i]) / reach);
+			}
+		}
+
+		return maxError;
+	}
+
+	// sum of the magnitudes of the products behind each element of parent * local, what its rounding scales with
+	void TermMagnitudes(const float* pParent, const float* pLocal, float* pMagnitudes)
+	{
+		for (int col = 0; col < 4; ++col)
+		{
+			for (int row = 0; row < 4; ++row)
+			{
+				float sum = 0.0f;
+				for (int k = 0; k < 4; ++k)
+				{
+					sum += std::fabs(pParent[k*4 + row] * pLocal[col*4 + k]);
+				}
+				pMagnitudes[col*4 + row] = sum;
+			}
+		}
+	}
+
+	bool NearlyEqual(float actual, float expected, float magnitude)
+	{
+		return std::fabs(actual - expected) <= kComposeUlps * FLT_EPSILON * magnitude;
+	}
+
+	float RoundTrip(InstanceTransform::Format format, const float* pMat4, float* pDecoded)
+	{
+		float encoded[16];
+		InstanceTransform::Encode(format, pMat4, encoded);
+		InstanceTransform::Decode(format, encoded, pDecoded);
+		return InstanceTransform::RoundTripError(format, pMat4);
+	}
+
+	bool TestStrides()
+	{
+		CHECK(InstanceTransform::GetStride(InstanceTransform::kMat4) == 64);
+		CHECK(InstanceTransform::GetStride(InstanceTransform::kAffine3x4) == 48);
+		CHECK(InstanceTransform::GetStride(InstanceTransform::kQuatPosScale) == 32);
+		return true;
+	}
+
+	// any affine matrix, shear and non uniform scale included, comes back bit for bit
+	bool TestAffineExact()
+	{
+		for (int i = 0; i < kNumTransforms; ++i)
+		{
+			float mat[16], decoded[16];
+			RandomTransform(Random(0.01f, 100.0f), Random(0.01f, 100.0f), Random(-100.0f, -0.01f), mat);
+			mat[4] += Random(-1.0f, 1.0f);	// shear
+
+			CHECK(RoundTrip(InstanceTransform::kAffine3x4, mat, decoded) == 0.0f);
+			CHECK(RoundTrip(InstanceTransform::kMat4, mat, decoded) == 0.0f);
+		}
+
+		return true;
+	}
+
+	// rotation and uniform scale, mirrored ones included
+	bool TestQuatPrecision()
+	{
+		float worstError = 0.0f;
+		for (int i = 0; i < kNumTransforms; ++i)
+		{
+			const float scale = Random(0.01f, 100.0f) * ((i % 4 == 0) ? -1.0f : 1.0f);
+
+			float mat[16], decoded[16];
+			RandomTransform(scale, scale, scale, mat);
+
+			const float matrixError = RoundTrip(InstanceTransform::kQuatPosScale, mat, decoded);
+			CHECK(matrixError <= kQuatTolerance * std::fabs(scale));
+
+			const float pointError = RelativePointError(mat, decoded, scale);
+			CHECK(pointError <= kQuatTolerance);
+			worstError = std::fmax(worstError, pointError);
+		}
+
+		printf("kQuatPosScale: worst relative point error %g\n", worstError);
+		return true;
+	}
+
+	// what kQuatPosScale cannot hold is reported, not hidden
+	bool TestQuatReportsLoss()
+	{
+		for (int i = 0; i < kNumTransforms; ++i)
+		{
+			float mat[16], decoded[16];
+			RandomTransform(1.0f, 2.0f, 0.5f, mat);
+			CHECK(RoundTrip(InstanceTransform::kQuatPosScale, mat, decoded) > 0.1f);
+		}
+
+		return true;
+	}
+
+	// ComposeBatch() in a compact format decodes to what it writes in kMat4, parent * local
+	bool TestComposeBatchAgainstMat4()
+	{
+		const size_t numParents = 7;
+		std::vector<float> parents(numParents * 16);
+		std::vector<float> locals(kNumTransforms * 16);
+		std::vector<uint32_t> parentIndices(kNumTransforms);
+
+		for (size_t i = 0; i < numParents; ++i)
+		{
+			const float scale = Random(0.5f, 2.0f);
+			RandomTransform(scale, scale, scale, &parents[i * 16]);
+		}
+
+		for (int i = 0; i < kNumTransforms; ++i)
+		{
+			const float scale = Random(0.1f, 10.0f);
+			RandomTransform(scale, scale, scale, &locals[i * 16]);
+			parentIndices[i] = static_cast<uint32_t>(i % numParents);
+		}
+
+		std::vector<float> worlds(kNumTransforms * 16);
+		InstanceTransform::ComposeBatch(InstanceTransform::kMat4, parents.data(), parentIndices.data(), locals.data(),
+			kNumTransforms, worlds.data());
+
+		for (int i = 0; i < kNumTransforms; ++i)
+		{
+			float expected[16], magnitudes[16];
+			FrustumCuller::Multiply(&parents[parentIndices[i] * 16], &locals[i * 16], expected);
+			TermMagnitudes(&parents[parentIndices[i] * 16], &locals[i * 16], magnitudes);
+			for (int k = 0; k < 16; ++k)
+			{
+				CHECK(NearlyEqual(worlds[i * 16 + k], expected[k], magnitudes[k]));
+			}
+		}
+
+		const InstanceTransform::Format compactFormats[] = { InstanceTransform::kAffine3x4, InstanceTransform::kQuatPosScale };
+		for (InstanceTransform::Format format : compactFormats)
+		{
+			const size_t stride = InstanceTransform::GetStride(format);
+			std::vector<char> encoded(kNumTransforms * stride);
+			InstanceTransform::ComposeBatch(format, parents.data(), parentIndices.data(), locals.data(), kNumTransforms, encoded.data());
+
+			for (int i = 0; i < kNumTransforms; ++i)
+			{
+				const float* pWorld = &worlds[i * 16];
+
+				float decoded[16];
+				InstanceTransform::Decode(format, &encoded[i * stride], decoded);
+
+				if (format == InstanceTransform::kAffine3x4)
+				{
+					for (int k = 0; k < 16; ++k)
+					{
+						CHECK(decoded[k] == pWorld[k]);
+					}
+				}
+				else
+				{
+					const float scale = std::sqrt(pWorld[0]*pWorld[0] + pWorld[1]*pWorld[1] + pWorld[2]*pWorld[2]);
+					CHECK(RelativePointError(pWorld, decoded, scale) <= kQuatTolerance);
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// the vectorized kernel against the scalar fallback, every format, with and without parent indices
+	bool TestComposeBatchMatchesScalar()
+	{
+#if defined(__AVX__)
+		printf("ComposeBatch(): AVX\n");
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		printf("ComposeBatch(): SSE2\n");
+#else
+		printf("ComposeBatch(): scalar, nothing to compare\n");
+#endif
+
+		const size_t count = 1001;
+		const size_t numParents = 5;
+		std::vector<float> parents(numParents * 16);
+		std::vector<float> locals(count * 16);
+		std::vector<uint32_t> parentIndices(count);
+
+		for (size_t i = 0; i < numParents; ++i)
+		{
+			RandomTransform(Random(0.5f, 2.0f), Random(0.5f, 2.0f), Random(0.5f, 2.0f), &parents[i * 16]);
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			RandomTransform(Random(0.1f, 10.0f), Random(0.1f, 10.0f), Random(0.1f, 10.0f), &locals[i * 16]);
+			parentIndices[i] = static_cast<uint32_t>((i * 3) % numParents);
+		}
+
+		// null indices pair instance i with parent i
+		std::vector<float> ownParents(count * 16);
+		for (size_t i = 0; i < count; ++i)
+		{
+			const float scale = Random(0.5f, 2.0f);
+			RandomTransform(scale, scale, scale, &ownParents[i * 16]);
+		}
+
+		const InstanceTransform::Format formats[] = { InstanceTransform::kMat4, InstanceTransform::kAffine3x4, InstanceTransform::kQuatPosScale };
+		for (InstanceTransform::Format format : formats)
+		{
+			const size_t numFloats = InstanceTransform::GetStride(format) / sizeof(float);
+
+			for (int pass = 0; pass < 2; ++pass)
+			{
+				const float* pParents = (pass == 0) ? parents.data() : ownParents.data();
+				const uint32_t* pIndices = (pass == 0) ? parentIndices.data() : nullptr;
+
+				std::vector<float> batch(count * numFloats);
+				InstanceTransform::ComposeBatch(format, pParents, pIndices, locals.data(), count, batch.data());
+
+				for (size_t i = 0; i < count; ++i)
+				{
+					const float* pParent = pParents + (pIndices ? pIndices[i] : i) * 16;
+					const float* pBatch = &batch[i * numFloats];
+
+					float world[16], magnitudes[16];
+					FrustumCuller::Multiply(pParent, &locals[i * 16], world);
+					TermMagnitudes(pParent, &locals[i * 16], magnitudes);
+
+					if (format == InstanceTransform::kMat4)
+					{
+						for (int k = 0; k < 16; ++k)
+						{
+							CHECK(NearlyEqual(pBatch[k], world[k], magnitudes[k]));
+						}
+					}
+					else if (format == InstanceTransform::kAffine3x4)
+					{
+						for (int row = 0; row < 3; ++row)
+						{
+							for (int col = 0; col < 4; ++col)
+							{
+								CHECK(NearlyEqual(pBatch[row*4 + col], world[col*4 + row], magnitudes[col*4 + row]));
+							}
+						}
+					}
+					else
+					{
+						// q and -q are the same rotation, and rounding may pick either: compare what they decode to
+						float encoded[16], expected[16], actual[16];
+						InstanceTransform::Encode(format, world, encoded);
+						InstanceTransform::Decode(format, encoded, expected);
+						InstanceTransform::Decode(format, pBatch, actual);
+
+						const float scale = std::sqrt(world[0]*world[0] + world[1]*world[1] + world[2]*world[2]);
+						CHECK(RelativePointError(expected, actual, scale) <= kQuatTolerance);
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+}
+
+int main()
+{
+	bool bPassed = true;
+	bPassed = TestStrides() && bPassed;
+	bPassed = TestAffineExact() && bPassed;
+	bPassed = TestQuatPrecision() && bPassed;
+	bPassed = TestQuatReportsLoss() && bPassed;
+	bPassed = TestComposeBatchAgainstMat4() && bPassed;
+	bPassed = TestComposeBatchMatchesScalar() && bPassed;
+
+	printf(bPassed ? "PASSED\n" : "FAILED\n");
+	return bPassed ? 0 : 1;
+}
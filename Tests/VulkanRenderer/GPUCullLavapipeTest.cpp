@@ -0,0 +1,772 @@
+// GPUCullLavapipeTest.cpp
+// Runs BatchDrawCull_CS on a CPU Vulkan device (lavapipe) under the Khronos validation layer and checks
+// its output against FrustumCuller, the CPU culling path. Two groups are culled in one go, once compacted
+// (the drawIndirectCount path) and once in place (culled commands drawn with no instances).
+// Fails on any mismatch or validation message of error severity. Exits 77 (skipped) without a CPU device.
+//
+//   glslc VulkanRenderer/Shaders/BatchDrawCull_CS.comp -o BatchDrawCull_CS.spv
+//   g++ -std=c++17 -O2 -I<engine include dir> -IRenderer -o GPUCullLavapipeTest
+//       Tests/VulkanRenderer/GPUCullLavapipeTest.cpp Renderer/FrustumCuller.cpp -lvulkan
+//   VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./GPUCullLavapipeTest BatchDrawCull_CS.spv
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "FrustumCuller.h"
+
+using namespace GamePrototype;
+
+#define CHECK(expr) \
+	do { if (!(expr)) { printf("FAILED: %s (%s:%d)\n", #expr, __FILE__, __LINE__); return false; } } while (0)
+
+#define VK_CHECK(expr) CHECK((expr) == VK_SUCCESS)
+
+namespace
+{
+	const int kSkipped = 77;
+
+	const uint32_t kLocalSize = 64;
+	const uint32_t kNumInstances = 1000;
+	const uint32_t kNumGroups = 2;
+	const uint32_t kGroupFirst[kNumGroups] = { 0, 600 };
+	const uint32_t kGroupCount[kNumGroups] = { 600, kNumInstances - 600 };
+
+	// spheres this close to a plane may land on either side, depending on rounding
+	const float kPlaneTolerance = 1.0e-3f;
+
+	int g_numValidationErrors = 0;
+
+	// BatchDrawCull_CS layouts
+	struct DrawCommand
+	{
+		uint32_t	vertexCount;
+		uint32_t	instanceCount;
+		uint32_t	firstVertex;
+		uint32_t	firstInstance;
+	};
+
+	struct Instance
+	{
+		float		bounds[4];
+		DrawCommand	command;
+	};
+
+	struct CameraData
+	{
+		float		viewCam[16];
+		float		projCam[16];
+	};
+
+	struct CullGroup
+	{
+		float		occlusionViewProj[16];
+		float		pyramidSize[2];
+		uint32_t	first;
+		uint32_t	count;
+		uint32_t	countIndex;
+		uint32_t	commandOffset;
+		uint32_t	compact;
+		uint32_t	phase;
+		uint32_t	occlusion;
+	};
+
+	struct Buffer
+	{
+		VkBuffer		buffer = VK_NULL_HANDLE;
+		VkDeviceMemory	memory = VK_NULL_HANDLE;
+		VkDeviceSize	size = 0;
+		void*			pMapped = nullptr;
+	};
+
+	struct Context
+	{
+		VkInstance					instance = VK_NULL_HANDLE;
+		VkDebugUtilsMessengerEXT	messenger = VK_NULL_HANDLE;
+		VkPhysicalDevice			physicalDevice = VK_NULL_HANDLE;
+		VkDevice					device = VK_NULL_HANDLE;
+		uint32_t					queueFamily = 0;
+		VkQueue						queue = VK_NULL_HANDLE;
+		VkCommandPool				commandPool = VK_NULL_HANDLE;
+
+		Buffer						cameraBuffer;
+		Buffer						instanceBuffer;
+		Buffer						commandBuffer;
+		Buffer						countBuffer;
+		Buffer						flagBuffer;
+
+		VkImage						pyramidImage = VK_NULL_HANDLE;
+		VkDeviceMemory				pyramidMemory = VK_NULL_HANDLE;
+		VkImageView					pyramidView = VK_NULL_HANDLE;
+		VkSampler					sampler = VK_NULL_HANDLE;
+
+		VkShaderModule				shaderModule = VK_NULL_HANDLE;
+		VkDescriptorSetLayout		descriptorSetLayout = VK_NULL_HANDLE;
+		VkDescriptorPool			descriptorPool = VK_NULL_HANDLE;
+		VkDescriptorSet				descriptorSet = VK_NULL_HANDLE;
+		VkPipelineLayout			pipelineLayout = VK_NULL_HANDLE;
+		VkPipeline					pipeline = VK_NULL_HANDLE;
+	};
+
+	VKAPI_ATTR VkBool32 VKAPI_CALL DebugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+		VkDebugUtilsMessageTypeFlagsEXT, const VkDebugUtilsMessengerCallbackDataEXT* pData, void*)
+	{
+		if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
+		{
+			printf("validation: %s\n", pData->pMessage);
+			++g_numValidationErrors;
+		}
+
+		return VK_FALSE;
+	}
+
+	bool CreateInstance(Context& ctx)
+	{
+		const char* pLayer = "VK_LAYER_KHRONOS_validation";
+		const char* pExtension = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
+
+		VkApplicationInfo appInfo = {};
+		appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+		appInfo.pApplicationName = "GPUCullLavapipeTest";
+		appInfo.apiVersion = VK_API_VERSION_1_1;
+
+		VkDebugUtilsMessengerCreateInfoEXT messengerInfo = {};
+		messengerInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+		messengerInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+		messengerInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT;
+		messengerInfo.pfnUserCallback = DebugCallback;
+
+		VkInstanceCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+		createInfo.pNext = &messengerInfo;
+		createInfo.pApplicationInfo = &appInfo;
+		createInfo.enabledLayerCount = 1;
+		createInfo.ppEnabledLayerNames = &pLayer;
+		createInfo.enabledExtensionCount = 1;
+		createInfo.ppEnabledExtensionNames = &pExtension;
+
+		// NOTE: without the layer there is nothing to validate against, which is a failure, not a skip
+		VK_CHECK(vkCreateInstance(&createInfo, nullptr, &ctx.instance));
+
+		auto pfnCreateMessenger = reinterpret_cast<PFN_vkCreateDebugUtilsMessengerEXT>(
+			vkGetInstanceProcAddr(ctx.instance, "vkCreateDebugUtilsMessengerEXT"));
+		CHECK(pfnCreateMessenger);
+		VK_CHECK(pfnCreateMessenger(ctx.instance, &messengerInfo, nullptr, &ctx.messenger));
+		return true;
+	}
+
+	// lavapipe reports itself as a CPU device
+	bool PickCPUDevice(Context& ctx)
+	{
+		uint32_t count = 0;
+		vkEnumeratePhysicalDevices(ctx.instance, &count, nullptr);
+		std::vector<VkPhysicalDevice> devices(count);
+		vkEnumeratePhysicalDevices(ctx.instance, &count, devices.data());
+
+		for (VkPhysicalDevice physicalDevice : devices)
+		{
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+			if (properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU)
+			{
+				printf("device: %s\n", properties.deviceName);
+				ctx.physicalDevice = physicalDevice;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool CreateDevice(Context& ctx)
+	{
+		uint32_t count = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(ctx.physicalDevice, &count, nullptr);
+		std::vector<VkQueueFamilyProperties> families(count);
+		vkGetPhysicalDeviceQueueFamilyProperties(ctx.physicalDevice, &count, families.data());
+
+		auto familyIter = std::find_if(families.begin(), families.end(),
+			[](const VkQueueFamilyProperties& family) { return (family.queueFlags & VK_QUEUE_COMPUTE_BIT) != 0; });
+		CHECK(familyIter != families.end());
+		ctx.queueFamily = static_cast<uint32_t>(familyIter - families.begin());
+
+		const float priority = 1.0f;
+		VkDeviceQueueCreateInfo queueInfo = {};
+		queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queueInfo.queueFamilyIndex = ctx.queueFamily;
+		queueInfo.queueCount = 1;
+		queueInfo.pQueuePriorities = &priority;
+
+		VkDeviceCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		createInfo.queueCreateInfoCount = 1;
+		createInfo.pQueueCreateInfos = &queueInfo;
+		VK_CHECK(vkCreateDevice(ctx.physicalDevice, &createInfo, nullptr, &ctx.device));
+		vkGetDeviceQueue(ctx.device, ctx.queueFamily, 0, &ctx.queue);
+
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = ctx.queueFamily;
+		VK_CHECK(vkCreateCommandPool(ctx.device, &poolInfo, nullptr, &ctx.commandPool));
+		return true;
+	}
+
+	bool FindMemoryType(const Context& ctx, uint32_t typeBits, VkMemoryPropertyFlags properties, uint32_t& memoryType)
+	{
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		vkGetPhysicalDeviceMemoryProperties(ctx.physicalDevice, &memoryProperties);
+
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
+		{
+			if ((typeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+			{
+				memoryType = i;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// host visible and coherent, so results are read back without staging
+	bool CreateBuffer(const Context& ctx, VkDeviceSize size, VkBufferUsageFlags usage, Buffer& buffer)
+	{
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size;
+		bufferInfo.usage = usage;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		VK_CHECK(vkCreateBuffer(ctx.device, &bufferInfo, nullptr, &buffer.buffer));
+
+		VkMemoryRequirements requirements;
+		vkGetBufferMemoryRequirements(ctx.device, buffer.buffer, &requirements);
+
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = requirements.size;
+		CHECK(FindMemoryType(ctx, requirements.memoryTypeBits,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, allocInfo.memoryTypeIndex));
+		VK_CHECK(vkAllocateMemory(ctx.device, &allocInfo, nullptr, &buffer.memory));
+		VK_CHECK(vkBindBufferMemory(ctx.device, buffer.buffer, buffer.memory, 0));
+		VK_CHECK(vkMapMemory(ctx.device, buffer.memory, 0, size, 0, &buffer.pMapped));
+
+		buffer.size = size;
+		memset(buffer.pMapped, 0, static_cast<size_t>(size));
+		return true;
+	}
+
+	void DestroyBuffer(const Context& ctx, Buffer& buffer)
+	{
+		if (buffer.buffer != VK_NULL_HANDLE)
+		{
+			vkDestroyBuffer(ctx.device, buffer.buffer, nullptr);
+		}
+
+		if (buffer.memory != VK_NULL_HANDLE)
+		{
+			vkFreeMemory(ctx.device, buffer.memory, nullptr);
+		}
+
+		buffer = Buffer();
+	}
+
+	// 1x1 depth pyramid. Occlusion is off, but the binding has to be valid
+	bool CreatePyramid(Context& ctx)
+	{
+		VkImageCreateInfo imageInfo = {};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = VK_FORMAT_R32_SFLOAT;
+		imageInfo.extent = { 1, 1, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VK_CHECK(vkCreateImage(ctx.device, &imageInfo, nullptr, &ctx.pyramidImage));
+
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(ctx.device, ctx.pyramidImage, &requirements);
+
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = requirements.size;
+		CHECK(FindMemoryType(ctx, requirements.memoryTypeBits, 0, allocInfo.memoryTypeIndex));
+		VK_CHECK(vkAllocateMemory(ctx.device, &allocInfo, nullptr, &ctx.pyramidMemory));
+		VK_CHECK(vkBindImageMemory(ctx.device, ctx.pyramidImage, ctx.pyramidMemory, 0));
+
+		VkImageViewCreateInfo viewInfo = {};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = ctx.pyramidImage;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = VK_FORMAT_R32_SFLOAT;
+		viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		VK_CHECK(vkCreateImageView(ctx.device, &viewInfo, nullptr, &ctx.pyramidView));
+
+		VkSamplerCreateInfo samplerInfo = {};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_NEAREST;
+		samplerInfo.minFilter = VK_FILTER_NEAREST;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		VK_CHECK(vkCreateSampler(ctx.device, &samplerInfo, nullptr, &ctx.sampler));
+		return true;
+	}
+
+	// same bindings as VKNGPUCuller::CreatePipeline()
+	bool CreatePipeline(Context& ctx, const char* pShaderPath)
+	{
+		std::ifstream file(pShaderPath, std::ios::binary | std::ios::ate);
+		CHECK(file);
+		std::vector<char> code(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(code.data(), static_cast<std::streamsize>(code.size()));
+		CHECK(file && code.size() % 4 == 0);
+
+		VkShaderModuleCreateInfo moduleInfo = {};
+		moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		moduleInfo.codeSize = code.size();
+		moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+		VK_CHECK(vkCreateShaderModule(ctx.device, &moduleInfo, nullptr, &ctx.shaderModule));
+
+		const VkDescriptorType types[] =
+		{
+			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+		};
+		const uint32_t numBindings = sizeof(types) / sizeof(types[0]);
+
+		VkDescriptorSetLayoutBinding bindings[numBindings] = {};
+		VkDescriptorPoolSize poolSizes[numBindings] = {};
+		for (uint32_t i = 0; i < numBindings; ++i)
+		{
+			bindings[i].binding = i;
+			bindings[i].descriptorType = types[i];
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+			poolSizes[i].type = types[i];
+			poolSizes[i].descriptorCount = 1;
+		}
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = numBindings;
+		layoutInfo.pBindings = bindings;
+		VK_CHECK(vkCreateDescriptorSetLayout(ctx.device, &layoutInfo, nullptr, &ctx.descriptorSetLayout));
+
+		VkDescriptorPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = 1;
+		poolInfo.poolSizeCount = numBindings;
+		poolInfo.pPoolSizes = poolSizes;
+		VK_CHECK(vkCreateDescriptorPool(ctx.device, &poolInfo, nullptr, &ctx.descriptorPool));
+
+		VkDescriptorSetAllocateInfo setInfo = {};
+		setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		setInfo.descriptorPool = ctx.descriptorPool;
+		setInfo.descriptorSetCount = 1;
+		setInfo.pSetLayouts = &ctx.descriptorSetLayout;
+		VK_CHECK(vkAllocateDescriptorSets(ctx.device, &setInfo, &ctx.descriptorSet));
+
+		const Buffer* pBuffers[] = { &ctx.cameraBuffer, &ctx.instanceBuffer, &ctx.commandBuffer, &ctx.countBuffer, &ctx.flagBuffer };
+		VkDescriptorBufferInfo bufferInfos[numBindings - 1] = {};
+		VkDescriptorImageInfo imageInfo = { ctx.sampler, ctx.pyramidView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		VkWriteDescriptorSet writes[numBindings] = {};
+		for (uint32_t i = 0; i < numBindings; ++i)
+		{
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = ctx.descriptorSet;
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = types[i];
+
+			if (i < numBindings - 1)
+			{
+				bufferInfos[i] = { pBuffers[i]->buffer, 0, VK_WHOLE_SIZE };
+				writes[i].pBufferInfo = &bufferInfos[i];
+			}
+			else
+			{
+				writes[i].pImageInfo = &imageInfo;
+			}
+		}
+		vkUpdateDescriptorSets(ctx.device, numBindings, writes, 0, nullptr);
+
+		VkPushConstantRange pushConstantRange = {};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.size = sizeof(CullGroup);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &ctx.descriptorSetLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+		VK_CHECK(vkCreatePipelineLayout(ctx.device, &pipelineLayoutInfo, nullptr, &ctx.pipelineLayout));
+
+		VkComputePipelineCreateInfo pipelineInfo = {};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = ctx.shaderModule;
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = ctx.pipelineLayout;
+		VK_CHECK(vkCreateComputePipelines(ctx.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &ctx.pipeline));
+		return true;
+	}
+
+	// one submit: pyramid into shader read layout, counts cleared, every group culled
+	bool RunCull(Context& ctx, bool bCompact)
+	{
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = ctx.commandPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer cmd = VK_NULL_HANDLE;
+		VK_CHECK(vkAllocateCommandBuffers(ctx.device, &allocInfo, &cmd));
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo));
+
+		VkImageMemoryBarrier imageBarrier = {};
+		imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.image = ctx.pyramidImage;
+		imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+		VkClearColorValue farDepth = {};
+		farDepth.float32[0] = 1.0f;
+		vkCmdClearColorImage(cmd, ctx.pyramidImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &farDepth, 1, &imageBarrier.subresourceRange);
+		vkCmdFillBuffer(cmd, ctx.countBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+
+		imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		imageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkMemoryBarrier fillBarrier = {};
+		fillBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		fillBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		fillBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &fillBarrier, 0, nullptr, 1, &imageBarrier);
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, ctx.pipeline);
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, ctx.pipelineLayout, 0, 1, &ctx.descriptorSet, 0, nullptr);
+
+		for (uint32_t group = 0; group < kNumGroups; ++group)
+		{
+			CullGroup cullGroup = {};
+			cullGroup.pyramidSize[0] = 1.0f;
+			cullGroup.pyramidSize[1] = 1.0f;
+			cullGroup.first = kGroupFirst[group];
+			cullGroup.count = kGroupCount[group];
+			cullGroup.countIndex = group;
+			cullGroup.compact = bCompact ? 1 : 0;
+
+			vkCmdPushConstants(cmd, ctx.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullGroup), &cullGroup);
+			vkCmdDispatch(cmd, (cullGroup.count + kLocalSize - 1) / kLocalSize, 1, 1);
+		}
+
+		VkMemoryBarrier readBackBarrier = {};
+		readBackBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		readBackBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		readBackBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &readBackBarrier, 0, nullptr, 0, nullptr);
+
+		VK_CHECK(vkEndCommandBuffer(cmd));
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &cmd;
+		VK_CHECK(vkQueueSubmit(ctx.queue, 1, &submitInfo, VK_NULL_HANDLE));
+		VK_CHECK(vkQueueWaitIdle(ctx.queue));
+
+		vkFreeCommandBuffers(ctx.device, ctx.commandPool, 1, &cmd);
+		return true;
+	}
+
+	void Destroy(Context& ctx)
+	{
+		if (ctx.device != VK_NULL_HANDLE)
+		{
+			vkDeviceWaitIdle(ctx.device);
+			vkDestroyPipeline(ctx.device, ctx.pipeline, nullptr);
+			vkDestroyPipelineLayout(ctx.device, ctx.pipelineLayout, nullptr);
+			vkDestroyDescriptorPool(ctx.device, ctx.descriptorPool, nullptr);
+			vkDestroyDescriptorSetLayout(ctx.device, ctx.descriptorSetLayout, nullptr);
+			vkDestroyShaderModule(ctx.device, ctx.shaderModule, nullptr);
+			vkDestroySampler(ctx.device, ctx.sampler, nullptr);
+			vkDestroyImageView(ctx.device, ctx.pyramidView, nullptr);
+			vkDestroyImage(ctx.device, ctx.pyramidImage, nullptr);
+			vkFreeMemory(ctx.device, ctx.pyramidMemory, nullptr);
+			DestroyBuffer(ctx, ctx.cameraBuffer);
+			DestroyBuffer(ctx, ctx.instanceBuffer);
+			DestroyBuffer(ctx, ctx.commandBuffer);
+			DestroyBuffer(ctx, ctx.countBuffer);
+			DestroyBuffer(ctx, ctx.flagBuffer);
+			vkDestroyCommandPool(ctx.device, ctx.commandPool, nullptr);
+			vkDestroyDevice(ctx.device, nullptr);
+		}
+
+		if (ctx.messenger != VK_NULL_HANDLE)
+		{
+			auto pfnDestroyMessenger = reinterpret_cast<PFN_vkDestroyDebugUtilsMessengerEXT>(
+				vkGetInstanceProcAddr(ctx.instance, "vkDestroyDebugUtilsMessengerEXT"));
+			if (pfnDestroyMessenger)
+			{
+				pfnDestroyMessenger(ctx.instance, ctx.messenger, nullptr);
+			}
+		}
+
+		if (ctx.instance != VK_NULL_HANDLE)
+		{
+			vkDestroyInstance(ctx.instance, nullptr);
+		}
+
+		ctx = Context();
+	}
+
+	// column major, camera at (0, 0, 10) looking down -z, 0..w depth like the effect's projections
+	void BuildCamera(CameraData& camera)
+	{
+		memset(&camera, 0, sizeof(camera));
+		camera.viewCam[0] = camera.viewCam[5] = camera.viewCam[10] = camera.viewCam[15] = 1.0f;
+		camera.viewCam[14] = -10.0f;
+
+		const float zNear = 0.5f;
+		const float zFar = 60.0f;
+		const float focal = 1.0f / std::tan(0.5f * 1.0471976f);	// 60 degree fov
+		const float aspect = 16.0f / 9.0f;
+		camera.projCam[0] = focal / aspect;
+		camera.projCam[5] = focal;
+		camera.projCam[10] = zFar / (zNear - zFar);
+		camera.projCam[11] = -1.0f;
+		camera.projCam[14] = zNear * zFar / (zNear - zFar);
+	}
+
+	// spheres all around the camera, some without bounds
+	void BuildInstances(std::vector<Instance>& instances)
+	{
+		uint32_t seed = 12345;
+		auto random = [&seed](float minValue, float maxValue)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			return minValue + (maxValue - minValue) * static_cast<float>(seed >> 8) / 16777216.0f;
+		};
+
+		instances.resize(kNumInstances);
+		for (uint32_t i = 0; i < kNumInstances; ++i)
+		{
+			Instance& instance = instances[i];
+			instance.bounds[0] = random(-40.0f, 40.0f);
+			instance.bounds[1] = random(-40.0f, 40.0f);
+			instance.bounds[2] = random(-40.0f, 40.0f);
+			instance.bounds[3] = (i % 97 == 0) ? FLT_MAX : random(0.1f, 4.0f);
+			instance.command = { 3, 1, 3*i, i };
+		}
+	}
+
+	// FrustumCuller's verdict, and whether each sphere is too close to a plane to compare
+	void CullOnCPU(const CameraData& camera, const std::vector<Instance>& instances, std::vector<bool>& visible, std::vector<bool>& ambiguous)
+	{
+		float viewProj[16];
+		FrustumCuller::Multiply(camera.projCam, camera.viewCam, viewProj);
+
+		Frustum frustum;
+		frustum.Extract(viewProj);
+
+		std::vector<float> centerX, centerY, centerZ, radius;
+		for (const Instance& instance : instances)
+		{
+			centerX.push_back(instance.bounds[0]);
+			centerY.push_back(instance.bounds[1]);
+			centerZ.push_back(instance.bounds[2]);
+			radius.push_back(instance.bounds[3]);
+		}
+
+		std::vector<uint32_t> indices(instances.size());
+		const size_t numVisible = FrustumCuller::Cull(frustum, centerX.data(), centerY.data(), centerZ.data(), radius.data(),
+			instances.size(), indices.data());
+
+		visible.assign(instances.size(), false);
+		for (size_t i = 0; i < numVisible; ++i)
+		{
+			visible[indices[i]] = true;
+		}
+
+		ambiguous.assign(instances.size(), false);
+		for (size_t i = 0; i < instances.size(); ++i)
+		{
+			for (int p = 0; p < Frustum::kMaxPlanes && radius[i] != FLT_MAX; ++p)
+			{
+				const float* pPlane = frustum.GetPlane(p);
+				const float distance = pPlane[0]*centerX[i] + pPlane[1]*centerY[i] + pPlane[2]*centerZ[i] + pPlane[3];
+				if (std::fabs(distance + radius[i]) < kPlaneTolerance)
+				{
+					ambiguous[i] = true;
+				}
+			}
+		}
+	}
+
+	bool IsSameCommand(const DrawCommand& a, const DrawCommand& b)
+	{
+		return memcmp(&a, &b, sizeof(DrawCommand)) == 0;
+	}
+
+	bool CheckInPlace(const Context& ctx, const std::vector<Instance>& instances, const std::vector<bool>& visible, const std::vector<bool>& ambiguous)
+	{
+		const DrawCommand* pCommands = static_cast<const DrawCommand*>(ctx.commandBuffer.pMapped);
+		const uint32_t* pFlags = static_cast<const uint32_t*>(ctx.flagBuffer.pMapped);
+
+		for (uint32_t i = 0; i < kNumInstances; ++i)
+		{
+			DrawCommand expected = instances[i].command;
+			expected.instanceCount = visible[i] ? 1 : 0;
+
+			CHECK(pFlags[i] == 1);
+			if (ambiguous[i])
+			{
+				expected.instanceCount = pCommands[i].instanceCount;
+			}
+			CHECK(IsSameCommand(pCommands[i], expected));
+		}
+
+		return true;
+	}
+
+	bool CheckCompact(const Context& ctx, const std::vector<Instance>& instances, const std::vector<bool>& visible, const std::vector<bool>& ambiguous)
+	{
+		const DrawCommand* pCommands = static_cast<const DrawCommand*>(ctx.commandBuffer.pMapped);
+		const uint32_t* pCounts = static_cast<const uint32_t*>(ctx.countBuffer.pMapped);
+
+		for (uint32_t group = 0; group < kNumGroups; ++group)
+		{
+			const uint32_t first = kGroupFirst[group];
+			const uint32_t count = pCounts[group];
+			CHECK(count <= kGroupCount[group]);
+
+			// survivors come out in any order, each command exactly once
+			std::vector<bool> drawn(kGroupCount[group], false);
+			for (uint32_t slot = 0; slot < count; ++slot)
+			{
+				const DrawCommand& command = pCommands[first + slot];
+				CHECK(command.firstInstance >= first && command.firstInstance < first + kGroupCount[group]);
+				CHECK(IsSameCommand(command, instances[command.firstInstance].command));
+				CHECK(!drawn[command.firstInstance - first]);
+				drawn[command.firstInstance - first] = true;
+			}
+
+			for (uint32_t i = 0; i < kGroupCount[group]; ++i)
+			{
+				CHECK(ambiguous[first + i] || drawn[i] == visible[first + i]);
+			}
+		}
+
+		return true;
+	}
+
+	bool Run(Context& ctx, const char* pShaderPath, bool& bSkipped)
+	{
+		bSkipped = false;
+		if (!CreateInstance(ctx))
+		{
+			return false;
+		}
+
+		if (!PickCPUDevice(ctx))
+		{
+			bSkipped = true;
+			return true;
+		}
+
+		CHECK(CreateDevice(ctx));
+
+		const VkBufferUsageFlags storage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		CHECK(CreateBuffer(ctx, sizeof(CameraData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, ctx.cameraBuffer));
+		CHECK(CreateBuffer(ctx, kNumInstances*sizeof(Instance), storage, ctx.instanceBuffer));
+		CHECK(CreateBuffer(ctx, kNumInstances*sizeof(DrawCommand), storage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, ctx.commandBuffer));
+		CHECK(CreateBuffer(ctx, kNumGroups*sizeof(uint32_t), storage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, ctx.countBuffer));
+		CHECK(CreateBuffer(ctx, kNumInstances*sizeof(uint32_t), storage, ctx.flagBuffer));
+		CHECK(CreatePyramid(ctx));
+		CHECK(CreatePipeline(ctx, pShaderPath));
+
+		CameraData camera;
+		BuildCamera(camera);
+		memcpy(ctx.cameraBuffer.pMapped, &camera, sizeof(camera));
+
+		std::vector<Instance> instances;
+		BuildInstances(instances);
+		memcpy(ctx.instanceBuffer.pMapped, instances.data(), instances.size()*sizeof(Instance));
+
+		std::vector<bool> visible, ambiguous;
+		CullOnCPU(camera, instances, visible, ambiguous);
+
+		const size_t numVisible = std::count(visible.begin(), visible.end(), true);
+		printf("%zu of %u visible on the CPU, %zu near a plane\n", numVisible, kNumInstances,
+			static_cast<size_t>(std::count(ambiguous.begin(), ambiguous.end(), true)));
+
+		// a scene that is all in or all out tests nothing
+		CHECK(numVisible > kNumInstances / 20 && numVisible < kNumInstances - kNumInstances / 20);
+
+		CHECK(RunCull(ctx, false));
+		CHECK(CheckInPlace(ctx, instances, visible, ambiguous));
+
+		memset(ctx.commandBuffer.pMapped, 0xff, static_cast<size_t>(ctx.commandBuffer.size));
+		CHECK(RunCull(ctx, true));
+		CHECK(CheckCompact(ctx, instances, visible, ambiguous));
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printf("usage: %s <BatchDrawCull_CS.spv>\n", argv[0]);
+		return 1;
+	}
+
+	Context ctx;
+	bool bSkipped = false;
+	const bool bPassed = Run(ctx, argv[1], bSkipped);
+	Destroy(ctx);
+
+	if (bSkipped)
+	{
+		printf("SKIPPED: no CPU Vulkan device (lavapipe)\n");
+		return kSkipped;
+	}
+
+	if (g_numValidationErrors != 0)
+	{
+		printf("FAILED: %d validation errors\n", g_numValidationErrors);
+		return 1;
+	}
+
+	printf(bPassed ? "PASSED\n" : "FAILED\n");
+	return bPassed ? 0 : 1;
+}
@@ -0,0 +1,46 @@
+// BufferMemberHandle.h
+// Compile time handle to one member of a buffer layout struct (UniformData and friends). Writes go
+// straight into mapped buffer memory at the member's offset, with no name lookup, so they belong in the
+// per draw paths. BufferMemoryHelper's string registration stays for debugging and reflection only
+#pragma once
+#ifndef BUFFER_MEMBER_HANDLE_H
+#define BUFFER_MEMBER_HANDLE_H
+
+#include <cstring>
+#include <type_traits>
+
+namespace GamePrototype
+{
+    // T: the layout struct, M: the member's type, Member: which one, e.g.
+    //     typedef BufferMemberHandle<UniformData, float[16], &UniformData::viewCam> ViewCamHandle;
+    template <typename T, typename M, M T::*Member>
+    struct BufferMemberHandle
+    {
+        static_assert(std::is_standard_layout<T>::value, "BufferMemberHandle: layout struct must be standard layout");
+        static_assert(std::is_trivially_copyable<M>::value, "BufferMemberHandle: member must be trivially copyable");
+
+        typedef M                                           ValueType;
+        typedef typename std::remove_all_extents<M>::type   ElementType;
+
+        static const size_t s_kSize = sizeof(M);
+
+        // the member inside a mapped T
+        static M& Get(void* pMapped)
+        {
+            return static_cast<T*>(pMapped)->*Member;
+        }
+
+        static void Write(void* pMapped, const M& value)
+        {
+            memcpy(&Get(pMapped), &value, s_kSize);
+        }
+
+        // arrays from a pointer to their first element (Math::mat4::Get() and such)
+        static void Write(void* pMapped, const ElementType* pValue)
+        {
+            memcpy(&Get(pMapped), pValue, s_kSize);
+        }
+    };
+}
+
+#endif // BUFFER_MEMBER_HANDLE_H
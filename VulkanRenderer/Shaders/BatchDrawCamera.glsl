@@ -0,0 +1,34 @@
+// BatchDrawCamera.glsl
+// Included by the batch draw vertex shaders for their camera (#extension GL_GOOGLE_include_directive).
+// Same layout as VKNBatchDrawEffect::UniformData either way. With BATCH_DRAW_PUSH_CAMERA defined it
+// comes in as push constants, matching VKNBatchDrawEffect::SetPushConstantCamera(true), and binding 0 is
+// left unused. Otherwise it is the dynamic uniform buffer at binding 0
+
+#ifdef BATCH_DRAW_PUSH_CAMERA
+layout(push_constant) uniform Camera
+{
+	mat4 viewCam;
+	mat4 projCam;
+} camera;
+#else
+layout(std140, binding = 0) uniform Camera
+{
+	mat4 viewCam;
+	mat4 projCam;
+} camera;
+#endif
+
+mat4 CameraView()
+{
+	return camera.viewCam;
+}
+
+mat4 CameraProjection()
+{
+	return camera.projCam;
+}
+
+vec4 CameraTransform(vec4 worldPosition)
+{
+	return camera.projCam * (camera.viewCam * worldPosition);
+}
@@ -0,0 +1,84 @@
+// BatchDrawInstances.glsl
+// Included by the static batch draw vertex shaders for their world matrices
+// (#extension GL_GOOGLE_include_directive). Define BATCH_DRAW_INSTANCE_BINDING first: 1 in the static
+// shadow shader, 2 in the static and static alpha blend shaders. The matrices come from
+// VKNMultiDrawInstancedObject's instance buffer as a storage buffer, so a draw can have as many instances
+// as the buffer holds. A mat4 array has the same layout under std430 as it had under std140.
+// BATCH_DRAW_INSTANCE_FORMAT picks the encoding, InstanceTransform::Format on the CPU side (default 0)
+
+#ifndef BATCH_DRAW_INSTANCE_BINDING
+#error BATCH_DRAW_INSTANCE_BINDING must be defined before including BatchDrawInstances.glsl
+#endif
+
+#ifndef BATCH_DRAW_INSTANCE_FORMAT
+#define BATCH_DRAW_INSTANCE_FORMAT 0
+#endif
+
+#if BATCH_DRAW_INSTANCE_FORMAT == 0
+
+// kMat4: column major 4x4
+layout(std430, binding = BATCH_DRAW_INSTANCE_BINDING) readonly buffer Instances
+{
+	mat4 worldMats[];
+} instances;
+
+#elif BATCH_DRAW_INSTANCE_FORMAT == 1
+
+// kAffine3x4: the top three rows
+struct InstanceAffine
+{
+	vec4 rows[3];
+};
+
+layout(std430, binding = BATCH_DRAW_INSTANCE_BINDING) readonly buffer Instances
+{
+	InstanceAffine worldMats[];
+} instances;
+
+#elif BATCH_DRAW_INSTANCE_FORMAT == 2
+
+// kQuatPosScale: rotation x y z w, then translation and uniform scale
+struct InstanceQuatPosScale
+{
+	vec4 rotation;
+	vec4 positionScale;
+};
+
+layout(std430, binding = BATCH_DRAW_INSTANCE_BINDING) readonly buffer Instances
+{
+	InstanceQuatPosScale worldMats[];
+} instances;
+
+#else
+#error unknown BATCH_DRAW_INSTANCE_FORMAT
+#endif
+
+// gl_InstanceIndex includes the draw's firstInstance, which is where its matrices start
+mat4 InstanceWorldMatrix()
+{
+#if BATCH_DRAW_INSTANCE_FORMAT == 0
+	return instances.worldMats[gl_InstanceIndex];
+#elif BATCH_DRAW_INSTANCE_FORMAT == 1
+	vec4 r0 = instances.worldMats[gl_InstanceIndex].rows[0];
+	vec4 r1 = instances.worldMats[gl_InstanceIndex].rows[1];
+	vec4 r2 = instances.worldMats[gl_InstanceIndex].rows[2];
+	return mat4(
+		vec4(r0.x, r1.x, r2.x, 0.0),
+		vec4(r0.y, r1.y, r2.y, 0.0),
+		vec4(r0.z, r1.z, r2.z, 0.0),
+		vec4(r0.w, r1.w, r2.w, 1.0));
+#else
+	vec4 q = instances.worldMats[gl_InstanceIndex].rotation;
+	vec4 ps = instances.worldMats[gl_InstanceIndex].positionScale;
+
+	// same as InstanceTransform::Decode()
+	vec3 c0 = vec3(1.0 - 2.0 * (q.y * q.y + q.z * q.z), 2.0 * (q.x * q.y + q.w * q.z), 2.0 * (q.x * q.z - q.w * q.y));
+	vec3 c1 = vec3(2.0 * (q.x * q.y - q.w * q.z), 1.0 - 2.0 * (q.x * q.x + q.z * q.z), 2.0 * (q.y * q.z + q.w * q.x));
+	vec3 c2 = vec3(2.0 * (q.x * q.z + q.w * q.y), 2.0 * (q.y * q.z - q.w * q.x), 1.0 - 2.0 * (q.x * q.x + q.y * q.y));
+	return mat4(
+		vec4(c0 * ps.w, 0.0),
+		vec4(c1 * ps.w, 0.0),
+		vec4(c2 * ps.w, 0.0),
+		vec4(ps.xyz, 1.0));
+#endif
+}
@@ -0,0 +1,19 @@
+// BatchDrawOIT.glsl
+// Included by the alpha blend materials' fragment shaders when VKNBatchDrawEffect runs in OIT mode
+// (#extension GL_GOOGLE_include_directive). Replaces the single color output: the color goes to the
+// accumulation target weighted by coverage and depth, its coverage to the revealage target. See VKNOITTargets
+
+layout(location = 0) out vec4 oitAccum;
+layout(location = 1) out float oitRevealage;
+
+// color: straight (not premultiplied) color and coverage of the surface
+void WriteOIT(vec4 color)
+{
+	// nearer surfaces count for more. Equation 10 of McGuire and Bavoil 2013 on 0..1 window depth,
+	// clamped so the RGBA16F sum neither underflows nor overflows
+	float z = gl_FragCoord.z;
+	float weight = clamp(color.a * max(1.0e-2, 3.0e3 * pow(1.0 - z, 3.0)), 1.0e-2, 3.0e3);
+
+	oitAccum = vec4(color.rgb * color.a, color.a) * weight;
+	oitRevealage = color.a;
+}
@@ -0,0 +1,31 @@
+// BatchDrawOITComposite_FS.frag
+// Resolves VKNOITTargets' accumulation and revealage into the weighted average translucent color. The
+// pipeline blends it as color * (1 - revealage) + dst * revealage
+#version 450
+
+layout(binding = 0) uniform sampler2D accumTexture;
+layout(binding = 1) uniform sampler2D revealageTexture;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+	ivec2 texel = ivec2(gl_FragCoord.xy);
+	float revealage = texelFetch(revealageTexture, texel, 0).r;
+
+	// nothing translucent covered this pixel
+	if (revealage >= 1.0)
+	{
+		discard;
+	}
+
+	vec4 accum = texelFetch(accumTexture, texel, 0);
+
+	// a sum of many bright surfaces can overflow half floats
+	if (any(isinf(accum)))
+	{
+		accum = vec4(accum.a);
+	}
+
+	outColor = vec4(accum.rgb / clamp(accum.a, 1.0e-4, 5.0e4), revealage);
+}
@@ -0,0 +1,9 @@
+// BatchDrawOITComposite_VS.vert
+// Full screen triangle for VKNOITTargets' composite, drawn with 3 vertices and no vertex buffer
+#version 450
+
+void main()
+{
+	vec2 uv = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+	gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+}
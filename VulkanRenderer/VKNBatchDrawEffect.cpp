@@ -1,1698 +1,2505 @@
-// VKNBatchDrawEffect.cpp
-#include "stdafx.h"
-#include "VKNBatchDrawEffect.h"
-#include "VKNShader.h"
-#include "VKNTexturePack.h"
-#include "VKNMultiDrawObject.h"
-#include "VKNMultiDrawInstancedObject.h"
-#include "VulkanRenderContext.h"
-#include "VulkanSwapChain.h"
-#include "VKNVertexInfo.h"
-#include "VulkanHelper.h"
-#include "VKNCommonUniformBuffers.h"
-#include "VKNCommandBuffer.h"
-#include "IVKNMultiDraw.h"
-
-#include "../Renderer/Renderer.h"
-#include "../Renderer/EffectInitInfo.h"
-#include "../Renderer/IEffectMgr.h"
-
-//#define KIRBY_SANITY
-
-namespace
-{
-	std::vector<VkDynamicState> s_dynamicStateEnables =
-	{
-		VK_DYNAMIC_STATE_VIEWPORT,
-		VK_DYNAMIC_STATE_SCISSOR,
-		VK_DYNAMIC_STATE_DEPTH_BIAS
-	};
-
-	// statically #define'd in shader (DeferredRenderLightPass_NM_Effect_FS)
-	static const int MAX_LIGHTS = 9;
-
-	// struct ShadowMatBuf
-	// converts a vector from the coordinate space of the viewer to the surface
-	// to the coordinate space between the light and the surface so a comparison
-	// can be made to determine if the surface is shadowed
-
-	const size_t shadowMatSize = Math::mat4::MAT4_SIZE * MAX_LIGHTS;
-	struct ShadowMatBuf // shadowmap specific uniform (StaticShadowMapShader_VS)
-	{
-		float shadowMatrix[shadowMatSize];
-
-		ShadowMatBuf()
-		:
-		shadowMatrix{}
-		{
-		}
-	};
-}
-
-namespace GamePrototype
-{
-	// we have now defined this in multiple places.
-	// Perhaps it needs either one common shared location
-	// or a rename?
-	VkPipelineDynamicStateCreateInfo s1_dynamicState =
-		VulkanHelper::InitPipelineDynamicStateCreateInfo(
-		s_dynamicStateEnables.data(),
-		static_cast<uint32_t>(s_dynamicStateEnables.size()),
-		0);
-
-	const VkVertexInputBindingDescription s_vertInputBindingDesc = VKNVertexInfo::GetVertexBinding();
-
-	const VKNVertexInfo::VertexAttributes s_vertAttrs = VKNVertexInfo::GetVertexAttributes();
-
-	const VkPipelineVertexInputStateCreateInfo s_vertexInputState =
-	{
-		VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,	// VkStructureType
-		0,	// pNext
-		0,	// flags
-		1,	// bindingDescriptionCount
-		&s_vertInputBindingDesc,	// pVertexBindingDescriptions
-		static_cast<uint32_t>(s_vertAttrs.size()),	// vertexAttributeDecriptionCount
-		s_vertAttrs.data()	// pVertexAttributeDescriptions
-	};
-
-	VKNBatchDrawEffect::VKNBatchDrawEffect(const EffectInitInfo& info)
-	:
-	BatchDrawEffect(info),
-	m_id(0),
-	m_currentPass(-1),
-	m_effectType(info.m_effectType),
-	m_bIsFirstDynamic(true),
-	m_bIsFirstStatic(true),
-	m_bIsFirstAlphaDynamic(true),
-	m_bIsFirstAlphaStatic(true),
-	m_bIsInitialized(false),
-	m_bSetStaticPackages(false),
-	m_bSetDynamicPackages(false),
-	m_pipelineBuilder(static_cast<VulkanRenderContext&>(*info.m_renderer.GetRenderContext()))
-	{
-	}
-
-	VKNBatchDrawEffect::~VKNBatchDrawEffect()
-	{
-	}
-
-	bool VKNBatchDrawEffect::Init()
-	{
-		if (!m_bIsInitialized)
-		{
-			if (!m_materialList.empty())
-			{
-				m_cachedShaderPtrs.resize(m_materialList.size());
-			}
-
-			RenderContextPtr contextPtr = m_renderer.GetRenderContext();
-			assert(contextPtr);
-			if(contextPtr)
-			{
-				VulkanRenderContext& vknContext = static_cast<VulkanRenderContext&>(*contextPtr);
-
-				int texWidth = TexturePack::s_kDefaultTextureWidth;
-				int texHeight = TexturePack::s_kDefaultTextureHeight;
-				int texMipMapLevels = TexturePack::s_kTextureMipMapLevels;
-				auto& queryRenderPtr = vknContext.GetQueryRenderer();
-				if(queryRenderPtr)
-				{
-					QueryRenderer::TextureInfo forcedTextureInfo = queryRenderPtr->GetTextureInfo();
-					if(forcedTextureInfo.bForcedSize)
-					{
-						texWidth = forcedTextureInfo.maxWidthHeight;
-						texHeight = forcedTextureInfo.maxWidthHeight;
-						texMipMapLevels = forcedTextureInfo.numMipMaps;
-					}
-				}
-
-				// NOTE: unlike the current OpenGL implementation,
-				// Vulkan IMultiDraw types share the same texture RGBA format 
-				// regardless of whether mesh objects use the alpha channel
-				m_texPackPtr = std::make_shared<VKNTexturePack>(vknContext,
-					texWidth,
-					texHeight,
-					texMipMapLevels,
-					TexturePack::s_kMaxTextures,
-					VK_FORMAT_B8G8R8A8_UNORM);	// NOTE: this should NOT perform alpha blending (BGR8 format unsupported)
-
-				RenderCheckOK(m_texPackPtr != TexturePackPtr());
-				RenderCheckOK(m_texPackPtr->Init());
-
-				m_dynamicMultiDrawObjectPtr = std::make_shared<VKNMultiDrawObject>(vknContext);
-				RenderCheckOK(m_dynamicMultiDrawObjectPtr != MultiDrawPtr());
-				m_dynamicMultiDrawObjectPtr->SetTexturePack(m_texPackPtr);
-				RenderCheckOK(m_dynamicMultiDrawObjectPtr->Initialize());
-
-				m_alphaDynamicMultiDrawObjectPtr = std::make_shared<VKNMultiDrawObject>(vknContext);
-				RenderCheckOK(m_alphaDynamicMultiDrawObjectPtr != MultiDrawPtr());
-				m_alphaDynamicMultiDrawObjectPtr->SetTexturePack(m_texPackPtr);
-				RenderCheckOK(m_alphaDynamicMultiDrawObjectPtr->Initialize());
-				m_alphaDynamicMultiDrawObjectPtr->SetAlphaBlending(true);
-
-				//m_staticMultiDrawObjectPtr = std::make_shared<VKNMultiDrawObject>(vknContext);
-				m_staticMultiDrawObjectPtr = std::make_shared<VKNMultiDrawInstancedObject>(vknContext);
-				RenderCheckOK(m_staticMultiDrawObjectPtr != MultiDrawPtr());
-				m_staticMultiDrawObjectPtr->SetTexturePack(m_texPackPtr);
-				RenderCheckOK(m_staticMultiDrawObjectPtr->Initialize());
-
-				m_alphaStaticMultiDrawObjectPtr = std::make_shared<VKNMultiDrawInstancedObject>(vknContext);
-				RenderCheckOK(m_alphaStaticMultiDrawObjectPtr != MultiDrawPtr());
-				m_alphaStaticMultiDrawObjectPtr->SetTexturePack(m_texPackPtr);
-				RenderCheckOK(m_alphaStaticMultiDrawObjectPtr->Initialize());
-				m_alphaStaticMultiDrawObjectPtr->SetAlphaBlending(true);
-
-				RenderCheckOK(CreateMemBufferHelpers());
-
-				m_bIsInitialized = true;
-			}
-		}
-
-		return m_bIsInitialized;
-	}
-
-	int VKNBatchDrawEffect::NumPasses() const
-	{
-#if defined KIRBY_SANITY
-		return FakeNumPasses();
-#endif
-		/*
-		for each type of draw pass, whether it be shadows, opaque geometry,
-		or translucent geometry, we have static and dynamic data.
-		So let's go with 2 for now
-		*/
-
-		return kMaxPasses; /* one static pass, one dynamic pass*/
-	}
-
-	bool VKNBatchDrawEffect::PrePass(int pass, const EffectStatePtr& esPtr)
-	{
-		if (!m_bIsDrawActive)
-		{
-			return true;
-		}
-
-#if defined KIRBY_SANITY
-		RenderCheckOK(FakePrePass(pass, esPtr));
-		return true;
-#endif
-
-		// TODO: RenderStateInfo should be passed here too? PrePass->Draw->PostPass remember?
-
-		m_currentPass = pass;
-		//assert(m_currentPass < m_materialList.size());
-		if (!m_cachedShaderPtrs[0])
-		{
-			m_cachedShaderPtrs[kStaticShaderIndex] = m_renderer.GetShaderProgram(m_materialList[kStaticShaderIndex]);
-			assert(m_cachedShaderPtrs[kStaticShaderIndex]);
-			m_cachedShaderPtrs[kStaticShadowShaderIndex] = m_renderer.GetShaderProgram(m_materialList[kStaticShadowShaderIndex]);
-			assert(m_cachedShaderPtrs[kStaticShadowShaderIndex]);
-			m_cachedShaderPtrs[kDynamicShaderIndex] = m_renderer.GetShaderProgram(m_materialList[kDynamicShaderIndex]);
-			assert(m_cachedShaderPtrs[kDynamicShaderIndex]);
-			m_cachedShaderPtrs[kDynamicShadowShaderIndex] = m_renderer.GetShaderProgram(m_materialList[kDynamicShadowShaderIndex]);
-			assert(m_cachedShaderPtrs[kDynamicShadowShaderIndex]);
-			m_cachedShaderPtrs[kStaticAlphaBlendShaderIndex] = m_renderer.GetShaderProgram(m_materialList[kStaticAlphaBlendShaderIndex]);
-			assert(m_cachedShaderPtrs[kStaticAlphaBlendShaderIndex]);
-			m_cachedShaderPtrs[kDynamicAlphaBlendShaderIndex] = m_renderer.GetShaderProgram(m_materialList[kDynamicAlphaBlendShaderIndex]);
-			assert(m_cachedShaderPtrs[kDynamicAlphaBlendShaderIndex]);
-
-			VulkanRenderContext& context = static_cast<VulkanRenderContext&>(*m_renderer.GetRenderContext());
-			uint32_t swapChainCount = context.GetSwapChainImageCount();
-			assert(swapChainCount > 0);
-
-			if(m_uniformMemHelperPtr)
-			{
-				for(auto& cachedShaderPtr : m_cachedShaderPtrs)
-				{
-					if(cachedShaderPtr)
-					{
-						VKNShaderPtr shaderPtr = std::dynamic_pointer_cast<VKNShader, Shader>(cachedShaderPtr);
-						if(shaderPtr)
-						{
-							RenderCheckOK(shaderPtr->Init(swapChainCount));
-							shaderPtr->SetBufferMemoryHelper(m_uniformMemHelperPtr);
-						}
-					}
-				}
-			}
-
-			const VKNEffectState& effectState = (esPtr->GetType() == EffectState::kDerived) ?
-				static_cast<const VKNEffectState&>(*esPtr) :
-				VKNEffectState(nullptr);
-
-			VKNShaderPtr shaderPtr = std::dynamic_pointer_cast<VKNShader, Shader>(m_cachedShaderPtrs[kDynamicShaderIndex]);
-			if(shaderPtr)
-			{
-				RenderCheckOK(SetupDynamicShader(shaderPtr, effectState));
-			}
-
-			shaderPtr = std::dynamic_pointer_cast<VKNShader, Shader>(m_cachedShaderPtrs[kStaticShaderIndex]);
-			if (shaderPtr)
-			{
-				RenderCheckOK(SetupStaticShader(shaderPtr, effectState));
-			}
-
-			shaderPtr = std::dynamic_pointer_cast<VKNShader, Shader>(m_cachedShaderPtrs[kStaticShadowShaderIndex]);
-			if (shaderPtr)
-			{
-				RenderCheckOK(SetupStaticShadowShader(shaderPtr, effectState));
-			}
-
-			shaderPtr = std::dynamic_pointer_cast<VKNShader, Shader>(m_cachedShaderPtrs[kDynamicShadowShaderIndex]);
-			if(shaderPtr)
-			{
-				RenderCheckOK(SetupDynamicShadowShader(shaderPtr, effectState));
-			}
-
-			shaderPtr = std::dynamic_pointer_cast<VKNShader, Shader>(m_cachedShaderPtrs[kStaticAlphaBlendShaderIndex]);
-			if (shaderPtr)
-			{
-				RenderCheckOK(SetupStaticAlphaBlendShader(shaderPtr, effectState));
-			}
-
-			shaderPtr = std::dynamic_pointer_cast<VKNShader, Shader>(m_cachedShaderPtrs[kDynamicAlphaBlendShaderIndex]);
-			if (shaderPtr)
-			{
-				RenderCheckOK(SetupDynamicAlphaBlendShader(shaderPtr, effectState));
-			}
-		}
-
-		return true;
-	}
-
-	bool VKNBatchDrawEffect::Collect(const Graphics::RenderObjectPtr& objPtr)
-	{
-		if (objPtr)
-		{
-			RenderCheckOK(m_dynamicMultiDrawObjectPtr != MultiDrawPtr());
-			RenderCheckOK(m_staticMultiDrawObjectPtr != MultiDrawPtr());
-
-			DrawPackagePtr dpPtr = objPtr->GetDrawPackage();
-			if (!dpPtr)
-			{
-				// NOTE: place the alpha blending type earlier than 
-				// default on list
-				std::vector<MultiDrawPtr> dynamicDrawList
-				{
-					m_alphaDynamicMultiDrawObjectPtr,
-					m_dynamicMultiDrawObjectPtr
-				};
-
-				DynamicDrawPackageBuilder dynamicBuilder(m_renderer.GetRenderContext(), dynamicDrawList, objPtr);
-				dpPtr = dynamicBuilder.Create();
-
-				// NOTE: place the alpha blending type earlier than 
-				// default on list
-				std::vector<MultiDrawPtr> staticDrawList
-				{
-					m_alphaStaticMultiDrawObjectPtr,
-					m_staticMultiDrawObjectPtr
-				};
-
-				StaticDrawPackageBuilder staticBuilder(m_renderer.GetRenderContext(), staticDrawList, objPtr, dpPtr);
-				dpPtr = staticBuilder.Create();
-
-				objPtr->SetDrawPackage(dpPtr);
-			}
-
-			if (dpPtr)
-			{
-				for (size_t i = 0; i<dpPtr->GetNumDataEntries(); ++i)
-				{
-					DrawPackageDataPtr dataPtr;
-					if (dpPtr->GetData(i, dataPtr))
-					{
-						if (dataPtr->IsDynamic())
-						{
-							m_dynamicPackages.push_back(dataPtr);
-						}
-						else
-						{
-							m_staticPackages.push_back(dataPtr);
-						}
-					}
-				}
-
-				m_renderer.AddEffect(this);
-			}
-
-			return true;
-		}
-
-		return false;
-	}
-
-	bool VKNBatchDrawEffect::Collect(const std::vector<Graphics::RenderObjectPtr>& list)
-	{
-		for (const auto& node : list)
-		{
-			if (!Collect(node))
-			{
-				return false;
-			}
-		}
-
-		return true;
-	}
-
-	bool VKNBatchDrawEffect::Collect(const Graphics::SceneNodePtr&)
-	{
-		// NOTE: LightCollection now stores all lights. Since this is just a typical
-		// geometry pass of a deferred render, lighting info is irrelevant right now.
-		return false;
-	}
-
-	bool VKNBatchDrawEffect::Draw(const Graphics::CameraDrawInfo& cdi, const Graphics::RenderStateInfo& rsi, const EffectStatePtr&)
-	{
-		if (!m_bIsDrawActive)
-		{
-			return true;
-		}
-
-#if defined KIRBY_SANITY
-		RenderCheckOK(FakeDraw(cdi, rsi));
-		return true;
-#endif
-
-		Graphics::RenderStateInfo mod_rsi(rsi);
-
-		// NOTE: this effect is not designed to handle postprocessing (yet).
-		if(rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kPostProcess)
-		{
-			return true;
-		}
-
-		if (m_currentPass == kFirstPass)
-		{
-			if (rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kShadows)
-			{
-				mod_rsi.SetShaderOverride(m_cachedShaderPtrs[MyShaderPassIndex::kStaticShadowShaderIndex]);
-			}
-			else if (rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kTranslucent)
-			{
-				mod_rsi.SetShaderOverride(m_cachedShaderPtrs[MyShaderPassIndex::kStaticAlphaBlendShaderIndex]);
-			}
-			else
-			{
-				mod_rsi.SetShaderOverride(m_cachedShaderPtrs[MyShaderPassIndex::kStaticShaderIndex]);
-			}
-
-			RenderCheckOK(DrawStaticPass(cdi, mod_rsi));
-		}
-		else if (m_currentPass == kSecondPass)
-		{
-			if (rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kShadows)
-			{
-				mod_rsi.SetShaderOverride(m_cachedShaderPtrs[MyShaderPassIndex::kDynamicShadowShaderIndex]);
-			}
-			else if (rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kTranslucent)
-			{
-				mod_rsi.SetShaderOverride(m_cachedShaderPtrs[MyShaderPassIndex::kDynamicAlphaBlendShaderIndex]);
-			}
-			else
-			{
-				mod_rsi.SetShaderOverride(m_cachedShaderPtrs[MyShaderPassIndex::kDynamicShaderIndex]);
-			}
-
-			RenderCheckOK(DrawDynamicPass(cdi, mod_rsi));
-		}
-
-		return true;
-	}
-
-	bool VKNBatchDrawEffect::PostPass(const EffectStatePtr&)
-	{
-		if (!m_bIsDrawActive)
-		{
-			return true;
-		}
-
-#if defined KIRBY_SANITY
-		RenderCheckOK(FakePostPass());
-		return true;
-#endif
-
-		if (m_currentPass > -1)
-		{
-			return true;
-		}
-
-		return false;
-	}
-
-	void VKNBatchDrawEffect::ClearForNextFrame()
-	{
-		m_bIsFirstStatic = true;
-		m_bIsFirstDynamic = true;
-		m_bIsFirstAlphaDynamic = true;
-		m_bIsFirstAlphaStatic = true;
-
-		m_staticPackages.clear();
-		m_dynamicPackages.clear();
-		m_bSetStaticPackages = false;
-		m_bSetDynamicPackages = false;
-	}
-
-	int VKNBatchDrawEffect::GetID() const
-	{
-		return m_id;
-	}
-
-	void VKNBatchDrawEffect::Free()
-	{
-		VulkanRenderContext& ctx = static_cast<VulkanRenderContext&>(*m_renderer.GetRenderContext());
-
-		// NOTE: we do this in multiple different places now. Perhaps it is time to merge into common?
-		vkQueueWaitIdle(ctx.GetGraphicsQueue());
-		vkDeviceWaitIdle(ctx.GetDevice());
-		// recorded command buffers need to be released at this point so we can release Vulkan objects
-		// previously recorded within it
-		VKNCommandBufferPtrList* pCmdList = ctx.GetCommandBuffers();
-		for (auto& cmdBufferPtr : *pCmdList)
-		{
-			cmdBufferPtr->ResetCommandBuffer();
-		}
-
-		if(m_dynamicMultiDrawObjectPtr)
-		{
-			m_dynamicMultiDrawObjectPtr->Shutdown();
-			m_dynamicMultiDrawObjectPtr = nullptr;
-		}
-
-		if(m_staticMultiDrawObjectPtr)
-		{
-			m_staticMultiDrawObjectPtr->Shutdown();
-			m_staticMultiDrawObjectPtr = nullptr;
-		}
-
-		if(m_alphaDynamicMultiDrawObjectPtr)
-		{
-			m_alphaDynamicMultiDrawObjectPtr->Shutdown();
-			m_alphaDynamicMultiDrawObjectPtr = nullptr;
-		}
-
-		if(m_alphaStaticMultiDrawObjectPtr)
-		{
-			m_alphaStaticMultiDrawObjectPtr->Shutdown();
-			m_alphaStaticMultiDrawObjectPtr = nullptr;
-		}
-
-		m_cachedShaderPtrs.clear();
-
-		m_texPackPtr = nullptr;
-		m_staticPackages.clear();
-		m_dynamicPackages.clear();
-
-		m_pipelineBuilder.Reset();
-
-		m_uniformMemHelperPtr = nullptr;
-	}
-
-	int VKNBatchDrawEffect::GetEffectType() const
-	{
-		return m_effectType;
-	}
-
-	bool VKNBatchDrawEffect::PostSceneGraph()
-	{
-		return CheckBuffers();
-	}
-
-	bool VKNBatchDrawEffect::DrawStaticPass(const Graphics::CameraDrawInfo& cdi, const Graphics::RenderStateInfo& rsi)
-	{
-		int shaderIndex = MyShaderPassIndex::kStaticShaderIndex;
-		MultiDrawPtr drawPtr;
-
-		if (rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kTranslucent)
-		{
-			drawPtr = m_alphaStaticMultiDrawObjectPtr;
-			shaderIndex = MyShaderPassIndex::kStaticAlphaBlendShaderIndex;
-		}
-		else if (rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kShadows)
-		{
-			drawPtr = m_staticMultiDrawObjectPtr;
-			shaderIndex = MyShaderPassIndex::kStaticShadowShaderIndex;
-		}
-		else
-		{
-			drawPtr = m_staticMultiDrawObjectPtr;
-			shaderIndex = MyShaderPassIndex::kStaticShaderIndex;
-		}
-
-		if (drawPtr)
-		{
-			VKNShaderPtr currentShader = std::dynamic_pointer_cast<VKNShader, Shader>(rsi.GetShaderOverride());
-			if (!currentShader)
-			{
-				currentShader = std::dynamic_pointer_cast<VKNShader, Shader>(m_cachedShaderPtrs[shaderIndex]);
-			}
-
-			if (currentShader)
-			{
-				m_renderer.SetActiveShaderProgram(currentShader);
-				// we set the shader here as well because static multidraw type needs
-				// to access uniform 'worldMat' to set it per object reference
-				drawPtr->SetShader(currentShader);
-
-				UpdateUniforms(cdi, rsi);
-
-				// the array buffer and texture array linking to shader state is done
-				// within this call
-				RenderCheckOK(drawPtr->Render());
-			}
-		}
-
-		return true;
-	}
-
-	bool VKNBatchDrawEffect::DrawDynamicPass(const Graphics::CameraDrawInfo& cdi, const Graphics::RenderStateInfo& rsi)
-	{
-		int shaderIndex = MyShaderPassIndex::kDynamicShaderIndex;
-		MultiDrawPtr drawPtr;
-
-		if (rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kTranslucent)
-		{
-			drawPtr = m_alphaDynamicMultiDrawObjectPtr;
-			shaderIndex = MyShaderPassIndex::kDynamicAlphaBlendShaderIndex;
-		}
-		else if (rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kShadows)
-		{
-			drawPtr = m_dynamicMultiDrawObjectPtr;
-			shaderIndex = MyShaderPassIndex::kDynamicShadowShaderIndex;
-		}
-		else
-		{
-			drawPtr = m_dynamicMultiDrawObjectPtr;
-			shaderIndex = MyShaderPassIndex::kDynamicShaderIndex;
-		}
-
-		if (drawPtr)
-		{
-			// we need to link the array buffer and texture array to shader state,
-			// as well as cdi & rdi before rendering (we ignore rdi for testing 1/9/2015)
-			VKNShaderPtr currentShader = std::dynamic_pointer_cast<VKNShader, Shader>(rsi.GetShaderOverride());
-			if (!currentShader)
-			{
-				currentShader = std::dynamic_pointer_cast<VKNShader, Shader>(m_cachedShaderPtrs[shaderIndex]);
-			}
-
-			if (currentShader)
-			{
-				UpdateUniforms(cdi, rsi);
-
-				// start recording
-
-				m_renderer.SetActiveShaderProgram(currentShader);
-
-				// we set the shader here as well because static multidraw type needs
-				// to access uniform 'worldMat' to set it per object reference
-				drawPtr->SetShader(currentShader);
-				// the array buffer and texture array linking to shader state is done
-				// within this call
-				RenderCheckOK(drawPtr->Render());
-			}
-		}
-
-		return true;
-	}
-
-	bool VKNBatchDrawEffect::CheckBuffers()
-	{
-		if (!m_bSetStaticPackages)
-		{
-			m_bSetStaticPackages = true;
-
-			for (auto& dataPtr : m_staticPackages)
-			{
-				if (!dataPtr->HasAlpha())
-				{
-					if (m_bIsFirstStatic)
-					{
-						m_staticMultiDrawObjectPtr->Add(dataPtr, IMultiDraw::FirstToken());
-						m_bIsFirstStatic = false;
-					}
-					else
-					{
-						m_staticMultiDrawObjectPtr->Add(dataPtr);
-					}
-				}
-			}
-
-			RenderCheckOK(m_staticMultiDrawObjectPtr->Update());
-
-			// alpha blended static meshes
-			for (auto& dataPtr : m_staticPackages)
-			{
-				if (dataPtr->HasAlpha())
-				{
-					if (m_bIsFirstAlphaStatic)
-					{
-						m_alphaStaticMultiDrawObjectPtr->Add(dataPtr, IMultiDraw::FirstToken());
-						m_bIsFirstAlphaStatic = false;
-					}
-					else
-					{
-						m_alphaStaticMultiDrawObjectPtr->Add(dataPtr);
-					}
-				}
-			}
-
-			RenderCheckOK(m_alphaStaticMultiDrawObjectPtr->Update());
-		}
-
-		if (!m_bSetDynamicPackages)
-		{
-			m_bSetDynamicPackages = true;
-
-			for (auto& dataPtr : m_dynamicPackages)
-			{
-				if (!dataPtr->HasAlpha())
-				{
-					if (m_bIsFirstDynamic)
-					{
-						m_dynamicMultiDrawObjectPtr->Add(dataPtr, IMultiDraw::FirstToken());
-						m_bIsFirstDynamic = false;
-					}
-					else
-					{
-						m_dynamicMultiDrawObjectPtr->Add(dataPtr);
-					}
-				}
-			}
-
-			RenderCheckOK(m_dynamicMultiDrawObjectPtr->Update());
-
-			// alpha blended dynamic meshes
-			for (auto& dataPtr : m_dynamicPackages)
-			{
-				if (dataPtr->HasAlpha())
-				{
-					if (m_bIsFirstAlphaDynamic)
-					{
-						m_alphaDynamicMultiDrawObjectPtr->Add(dataPtr, IMultiDraw::FirstToken());
-						m_bIsFirstAlphaDynamic = false;
-					}
-					else
-					{
-						m_alphaDynamicMultiDrawObjectPtr->Add(dataPtr);
-					}
-				}
-			}
-
-			RenderCheckOK(m_alphaDynamicMultiDrawObjectPtr->Update());
-		}
-
-		return true;
-	}
-
-	bool VKNBatchDrawEffect::CreateMemBufferHelpers()
-	{
-		VulkanRenderContext& context = static_cast<VulkanRenderContext&>(*m_renderer.GetRenderContext());
-
-		if (!m_uniformMemHelperPtr)
-		{
-			m_uniformMemHelperPtr = std::make_shared<BufferMemoryHelper<UniformData>>(context);
-			RenderCheckOK(m_uniformMemHelperPtr && m_uniformMemHelperPtr->Init(IBufferMemoryHelper::kBufferType_Uniform));
-
-			// register our desired types
-			RenderCheckOK(UniformData::Register(dynamic_cast<BufferMemoryHelper<UniformData>&>(*m_uniformMemHelperPtr)));
-		}
-
-		return true;
-	}
-
-	bool VKNBatchDrawEffect::UpdateUniforms(const Graphics::CameraDrawInfo& cdi, const Graphics::RenderStateInfo&)
-	{
-		if (m_uniformMemHelperPtr)
-		{
-			RenderCheckOK(m_uniformMemHelperPtr->SetValue("viewCam", cdi.viewMat.Get()));
-			RenderCheckOK(m_uniformMemHelperPtr->SetValue("projCam", cdi.projMat.Get()));
-			RenderCheckOK(m_uniformMemHelperPtr->CopyToDevice());
-		}
-
-		return true;
-	}
-
-	bool VKNBatchDrawEffect::SetupStaticShadowShader(const VKNShaderPtr& shaderPtr, const VKNEffectState& es)
-	{
-		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState =
-			VulkanHelper::InitPipelineInputAssemblyStateCreateInfo(
-			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-			0,
-			VK_FALSE);
-
-		VkPipelineRasterizationStateCreateInfo rasterizationState =
-			VulkanHelper::InitPipelineRasterizationStateCreateInfo(
-			VK_POLYGON_MODE_FILL,
-			VK_CULL_MODE_BACK_BIT,
-			VK_FRONT_FACE_COUNTER_CLOCKWISE,
-			0,
-			VK_FALSE);
-
-		// we are now using dynamic depth bias (vkCmdSetDepthBias) for shadows, this must be set as well
-		rasterizationState.depthBiasEnable = VK_TRUE;
-
-		// No color attachment in a depth buffer only pipeline
-		VkPipelineColorBlendStateCreateInfo colorBlendState = 
-			VulkanHelper::InitPipelineColorBlendStateCreateInfo(0, nullptr);
-
-		VkPipelineDepthStencilStateCreateInfo depthStencilState =
-			VulkanHelper::InitPipelineDepthStencilStateCreateInfo(
-			VK_TRUE,
-			VK_TRUE,
-			VK_COMPARE_OP_LESS_OR_EQUAL);
-
-		VkPipelineViewportStateCreateInfo viewportState =
-			VulkanHelper::InitPipelineViewportStateCreateInfo(1, 1, 0);
-
-		VkPipelineMultisampleStateCreateInfo multisampleState =
-			VulkanHelper::InitPipelineMultisampleStateCreateInfo(
-			VK_SAMPLE_COUNT_1_BIT,
-			0);
-
-		if (shaderPtr)
-		{
-			assert(m_uniformMemHelperPtr);
-			shaderPtr->SetBufferMemoryHelper(m_uniformMemHelperPtr);
-
-			VKNDescriptorSetBuilder& dsBuilder = shaderPtr->GetDescriptorSetBuilder();
-
-			//layout(std140, binding = 0) uniform ViewProjLight
-			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-				VK_SHADER_STAGE_VERTEX_BIT,
-				0);
-
-			//layout(std140, binding = 1) uniform Instances
-			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-				VK_SHADER_STAGE_VERTEX_BIT,
-				1);
-
-			dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-				0,
-				0,
-				m_uniformMemHelperPtr->GetBufferObject());
-
-			// remember that world matrix instances were collected as part of VKNMultiDrawInstancedObject.
-			// You want those matrices for shadow rendering too
-			assert(m_staticMultiDrawObjectPtr);
-			if (m_staticMultiDrawObjectPtr)
-			{
-				VKNMultiDrawInstancedObject* pDrawInstancedObject = dynamic_cast<VKNMultiDrawInstancedObject*>(m_staticMultiDrawObjectPtr.get());
-				if (pDrawInstancedObject)
-				{
-					auto& instBuffer = pDrawInstancedObject->GetInstanceBuffer();
-					dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-						1,
-						0,
-						instBuffer);
-				}
-			}
-
-			auto& depthOnlyFBOs = es.GetDepthOnlyFrameBufferObjects();
-			assert(!depthOnlyFBOs.empty());
-			if(depthOnlyFBOs.empty())
-			{
-				return false;
-			}
-
-			assert(depthOnlyFBOs[0]->renderPass != VK_NULL_HANDLE);
-
-			// although when constructing VkCommandBuffers we use the actual VkRenderPass
-			// from one of the light shadowmap framebuffers, we use this 'fake' FrameBufferObject
-			// to set up the pipeline. The VkRenderPass should possess the same properties for all
-			// shadowmaps.
-
-			VKNPipelineBuilder& pipelineBuilder = shaderPtr->GetPipelineBuilder();
-			pipelineBuilder.Add(inputAssemblyState).
-				Add(s_vertexInputState).
-				Add(rasterizationState).
-				Add(colorBlendState).
-				Add(depthStencilState).
-				Add(viewportState).
-				Add(multisampleState).
-				Add(s1_dynamicState).
-				Add(depthOnlyFBOs[0]->renderPass);
-
-			return true;
-		}
-
-		return false;
-	}
-
-	bool VKNBatchDrawEffect::SetupStaticShader(const VKNShaderPtr& shaderPtr, const VKNEffectState& es)
-	{
-		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState =
-			VulkanHelper::InitPipelineInputAssemblyStateCreateInfo(
-			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-			0,
-			VK_FALSE);
-
-		VkPipelineRasterizationStateCreateInfo rasterizationState =
-			VulkanHelper::InitPipelineRasterizationStateCreateInfo(
-			VK_POLYGON_MODE_FILL,
-			VK_CULL_MODE_BACK_BIT, /*VK_CULL_MODE_NONE?*/
-			VK_FRONT_FACE_COUNTER_CLOCKWISE,
-			0,
-			VK_FALSE);
-
-		VkPipelineColorBlendAttachmentState blendAttachmentState =
-			VulkanHelper::InitPipelineColorBlendAttachmentState(
-			0xf,
-			VK_FALSE);
-
-		VkPipelineColorBlendStateCreateInfo colorBlendState =
-			VulkanHelper::InitPipelineColorBlendStateCreateInfo(0, nullptr);
-
-		// tricky... BatchDrawEffect was designed for OpenGL to not have to worry about
-		// which framebuffer output is rendered to because the state machine handled that.
-		// In Vulkan, we don't have that luxury. So, we check to see if a GBuffer FBO is present.
-		// If not, we fall back to the default FBO if present.
-		const FrameBufferObject* pFBO = nullptr;
-
-		auto& gBufferFBOs = es.GetGBufferFrameBufferObjects();
-		if(!gBufferFBOs.empty())
-		{
-			pFBO = gBufferFBOs[0];
-		}
-
-		if(!pFBO)
-		{
-			auto& defaultFBOs = es.GetDefaultFrameBufferObjects();
-			assert(!defaultFBOs.empty());
-			if(!defaultFBOs.empty())
-			{
-				pFBO = defaultFBOs[0];
-			}
-		}
-
-		assert(pFBO);
-		if(!pFBO)
-		{
-			return false;
-		}
-
-		std::vector<VkPipelineColorBlendAttachmentState> colorBlendStates;
-
-		if(pFBO)
-		{
-			for(auto& entry : pFBO->textureObjectInfos)
-			{
-				colorBlendStates.push_back(entry.colorBlendState);
-			}
-
-			colorBlendState =
-				VulkanHelper::InitPipelineColorBlendStateCreateInfo(
-				static_cast<uint32_t>(colorBlendStates.size()),
-				colorBlendStates.data());
-		}
-
-		VkPipelineDepthStencilStateCreateInfo depthStencilState =
-			VulkanHelper::InitPipelineDepthStencilStateCreateInfo(
-			VK_TRUE,
-			VK_TRUE,
-			VK_COMPARE_OP_LESS_OR_EQUAL);
-
-		VkPipelineViewportStateCreateInfo viewportState =
-			VulkanHelper::InitPipelineViewportStateCreateInfo(1, 1, 0);
-
-		VkPipelineMultisampleStateCreateInfo multisampleState =
-			VulkanHelper::InitPipelineMultisampleStateCreateInfo(
-			VK_SAMPLE_COUNT_1_BIT,
-			0);
-
-		if (shaderPtr)
-		{
-			VKNDescriptorSetBuilder& dsBuilder = shaderPtr->GetDescriptorSetBuilder();
-
-			//layout(std140, binding = 0) uniform ProjViewBuf
-			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-				VK_SHADER_STAGE_VERTEX_BIT,
-				0);
-
-			//layout(std140, binding = 2) uniform Instances
-			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-				VK_SHADER_STAGE_VERTEX_BIT,
-				2);
-
-			//layout(binding = 1) uniform sampler2DArray textureMaps;
-			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-				VK_SHADER_STAGE_FRAGMENT_BIT,
-				1);
-
-			if (m_uniformMemHelperPtr)
-			{
-				dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-					0,
-					0,
-					m_uniformMemHelperPtr->GetBufferObject());
-			}
-
-			assert(m_staticMultiDrawObjectPtr);
-			if (m_staticMultiDrawObjectPtr)
-			{
-				VKNMultiDrawInstancedObject* pDrawInstancedObject = dynamic_cast<VKNMultiDrawInstancedObject*>(m_staticMultiDrawObjectPtr.get());
-				if(pDrawInstancedObject)
-				{
-					auto& instBuffer = pDrawInstancedObject->GetInstanceBuffer();
-					dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-						2,
-						0,
-						instBuffer);
-				}			
-			}
-
-			if (m_texPackPtr)
-			{
-				VKNTexturePackPtr vknTexPackPtr = std::dynamic_pointer_cast<VKNTexturePack, TexturePack>(m_texPackPtr);
-				if (vknTexPackPtr)
-				{
-					TextureObject* pTexObj = vknTexPackPtr->GetTextureHandle();
-					assert(pTexObj);
-					if(pTexObj)
-					{
-						dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-							1,
-							0,
-							*pTexObj);
-					}
-				}
-			}
-
-			assert(pFBO->renderPass);
-			VKNPipelineBuilder& pipelineBuilder = shaderPtr->GetPipelineBuilder();
-			pipelineBuilder.Add(inputAssemblyState).
-				Add(s_vertexInputState).
-				Add(rasterizationState).
-				Add(colorBlendState).
-				Add(depthStencilState).
-				Add(viewportState).
-				Add(multisampleState).
-				Add(s1_dynamicState).
-				Add(pFBO->renderPass);
-
-			return true;
-		}
-
-		return false;
-	}
-
-	bool VKNBatchDrawEffect::SetupDynamicShadowShader(const VKNShaderPtr& shaderPtr, const VKNEffectState& es)
-	{
-		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState =
-			VulkanHelper::InitPipelineInputAssemblyStateCreateInfo(
-			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-			0,
-			VK_FALSE);
-
-		VkPipelineRasterizationStateCreateInfo rasterizationState =
-			VulkanHelper::InitPipelineRasterizationStateCreateInfo(
-			VK_POLYGON_MODE_FILL,
-			VK_CULL_MODE_BACK_BIT,
-			VK_FRONT_FACE_COUNTER_CLOCKWISE,
-			0,
-			VK_FALSE);
-
-		// no color state in a depth only pipeline
-		VkPipelineColorBlendStateCreateInfo colorBlendState = 
-			VulkanHelper::InitPipelineColorBlendStateCreateInfo(0, nullptr);
-
-		VkPipelineDepthStencilStateCreateInfo depthStencilState =
-			VulkanHelper::InitPipelineDepthStencilStateCreateInfo(
-			VK_TRUE,
-			VK_TRUE,
-			VK_COMPARE_OP_LESS_OR_EQUAL);
-
-		VkPipelineViewportStateCreateInfo viewportState =
-			VulkanHelper::InitPipelineViewportStateCreateInfo(1, 1, 0);
-
-		VkPipelineMultisampleStateCreateInfo multisampleState =
-			VulkanHelper::InitPipelineMultisampleStateCreateInfo(
-			VK_SAMPLE_COUNT_1_BIT,
-			0);
-
-		if (shaderPtr)
-		{
-			assert(m_uniformMemHelperPtr);
-			shaderPtr->SetBufferMemoryHelper(m_uniformMemHelperPtr);
-
-			VKNDescriptorSetBuilder& dsBuilder = shaderPtr->GetDescriptorSetBuilder();
-
-			//layout(std140, binding = 0) uniform ViewProjCam
-			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-				VK_SHADER_STAGE_VERTEX_BIT,
-				0);
-
-			dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-				0,
-				0,
-				m_uniformMemHelperPtr->GetBufferObject());
-
-			auto& depthFBOs = es.GetDepthOnlyFrameBufferObjects();
-			assert(!depthFBOs.empty());
-			if(depthFBOs.empty())
-			{
-				return false;
-			}
-
-			assert(depthFBOs[0]->renderPass);
-
-			VKNPipelineBuilder& pipelineBuilder = shaderPtr->GetPipelineBuilder();
-			pipelineBuilder.Add(inputAssemblyState).
-				Add(s_vertexInputState).
-				Add(rasterizationState).
-				Add(colorBlendState).
-				Add(depthStencilState).
-				Add(viewportState).
-				Add(multisampleState).
-				Add(s1_dynamicState).
-				Add(depthFBOs[0]->renderPass);
-
-			return true;
-		}
-
-		return false;
-	}
-
-	bool VKNBatchDrawEffect::SetupDynamicShader(const VKNShaderPtr& shaderPtr, const VKNEffectState& es)
-	{
-		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState =
-			VulkanHelper::InitPipelineInputAssemblyStateCreateInfo(
-			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-			0,
-			VK_FALSE);
-
-		VkPipelineRasterizationStateCreateInfo rasterizationState =
-			VulkanHelper::InitPipelineRasterizationStateCreateInfo(
-			VK_POLYGON_MODE_FILL,
-			VK_CULL_MODE_BACK_BIT,
-			VK_FRONT_FACE_COUNTER_CLOCKWISE,
-			0,
-			VK_FALSE);
-
-		VkPipelineColorBlendAttachmentState blendAttachmentState =
-			VulkanHelper::InitPipelineColorBlendAttachmentState(
-			0xf,
-			VK_FALSE);
-
-		VkPipelineColorBlendStateCreateInfo colorBlendState{};
-
-		// tricky... BatchDrawEffect was designed for OpenGL to not have to worry about
-		// which framebuffer output is rendered to because the state machine handled that.
-		// In Vulkan, we don't have that luxury. So, we check to see if a GBuffer FBO is present.
-		// If not, we fall back to the default FBO if present.
-		const FrameBufferObject* pFBO = nullptr;
-
-		auto& gBufferFBOs = es.GetGBufferFrameBufferObjects();
-		if (!gBufferFBOs.empty())
-		{
-			pFBO = gBufferFBOs[0];
-		}
-
-		if (!pFBO)
-		{
-			auto& defaultFBOs = es.GetDefaultFrameBufferObjects();
-			assert(!defaultFBOs.empty());
-			if (!defaultFBOs.empty())
-			{
-				pFBO = defaultFBOs[0];
-			}
-		}
-
-		assert(pFBO);
-		if (!pFBO)
-		{
-			return false;
-		}
-
-		std::vector<VkPipelineColorBlendAttachmentState> colorBlendStates;
-
-		if(pFBO)
-		{
-			for(auto& entry : pFBO->textureObjectInfos)
-			{
-				colorBlendStates.push_back(entry.colorBlendState);
-			}
-
-			colorBlendState =
-				VulkanHelper::InitPipelineColorBlendStateCreateInfo(
-				static_cast<uint32_t>(colorBlendStates.size()),
-				colorBlendStates.data());
-		}
-		else
-		{
-			VkPipelineColorBlendStateCreateInfo colorBlendState =
-				VulkanHelper::InitPipelineColorBlendStateCreateInfo(
-				1,
-				&blendAttachmentState);
-		}
-
-		VkPipelineDepthStencilStateCreateInfo depthStencilState =
-			VulkanHelper::InitPipelineDepthStencilStateCreateInfo(
-			VK_TRUE,
-			VK_TRUE,
-			VK_COMPARE_OP_LESS_OR_EQUAL);
-
-		VkPipelineViewportStateCreateInfo viewportState =
-			VulkanHelper::InitPipelineViewportStateCreateInfo(1, 1, 0);
-
-		VkPipelineMultisampleStateCreateInfo multisampleState =
-			VulkanHelper::InitPipelineMultisampleStateCreateInfo(
-			VK_SAMPLE_COUNT_1_BIT,
-			0);
-
-		if (shaderPtr)
-		{
-			VKNDescriptorSetBuilder& dsBuilder = shaderPtr->GetDescriptorSetBuilder();
-
-			//layout(std140, binding = 0) uniform ProjViewBuf
-			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-				VK_SHADER_STAGE_VERTEX_BIT,
-				0);
-
-			//layout(binding = 1) uniform sampler2DArray textureMaps;
-			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-				VK_SHADER_STAGE_FRAGMENT_BIT,
-				1);
-
-			if(m_uniformMemHelperPtr)
-			{
-				dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-					0,
-					0,
-					m_uniformMemHelperPtr->GetBufferObject());
-			}
-
-			if(m_texPackPtr)
-			{
-				VKNTexturePackPtr vknTexPackPtr = std::dynamic_pointer_cast<VKNTexturePack, TexturePack>(m_texPackPtr);
-				if(vknTexPackPtr)
-				{
-					TextureObject* pTexObj = vknTexPackPtr->GetTextureHandle();
-					assert(pTexObj);
-					if(pTexObj)
-					{
-						dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-							1,
-							0,
-							*pTexObj);
-					}
-				}
-			}
-
-			assert(pFBO->renderPass);
-			VKNPipelineBuilder& pipelineBuilder = shaderPtr->GetPipelineBuilder();
-			pipelineBuilder.Add(inputAssemblyState).
-				Add(s_vertexInputState).
-				Add(rasterizationState).
-				Add(colorBlendState).
-				Add(depthStencilState).
-				Add(viewportState).
-				Add(multisampleState).
-				Add(s1_dynamicState).
-				Add(pFBO->renderPass);
-
-			return true;
-		}
-
-		return false;
-	}
-
-	bool VKNBatchDrawEffect::SetupStaticAlphaBlendShader(const VKNShaderPtr& shaderPtr, const VKNEffectState& es)
-	{
-		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState =
-			VulkanHelper::InitPipelineInputAssemblyStateCreateInfo(
-			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-			0,
-			VK_FALSE);
-
-		VkPipelineRasterizationStateCreateInfo rasterizationState =
-			VulkanHelper::InitPipelineRasterizationStateCreateInfo(
-			VK_POLYGON_MODE_FILL,
-			VK_CULL_MODE_BACK_BIT,
-			VK_FRONT_FACE_COUNTER_CLOCKWISE,
-			0);
-
-		VkPipelineColorBlendAttachmentState alphaBlendAttachmentState
-		{
-			VK_TRUE,							// blendEnable
-			VK_BLEND_FACTOR_SRC_COLOR,			// srcColorBlendFactor
-			VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,// dstColorBlendFactor
-			VK_BLEND_OP_ADD,					// colorBlendOp
-			VK_BLEND_FACTOR_SRC_ALPHA,			// srcAlphaBlendFactor
-			VK_BLEND_FACTOR_ONE,				// dstAlphaBlendFactor
-			VK_BLEND_OP_ADD,					// alphaBlendOp
-			VK_COLOR_COMPONENT_R_BIT |
-			VK_COLOR_COMPONENT_G_BIT |
-			VK_COLOR_COMPONENT_B_BIT |
-			VK_COLOR_COMPONENT_A_BIT			// colorWriteMask
-		};
-
-		std::vector<VkPipelineColorBlendAttachmentState> alphaBlendColorBlendStates;
-		alphaBlendColorBlendStates.push_back(alphaBlendAttachmentState);
-
-		VkPipelineColorBlendStateCreateInfo alphaBlendColorBlendState
-		{
-			VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-			0,									// pNext
-			0,									// flags
-			VK_FALSE,							// logicOpEnable
-			VK_LOGIC_OP_CLEAR,					// logicOp
-			static_cast<uint32_t>(alphaBlendColorBlendStates.size()),	// attachmentCount
-			alphaBlendColorBlendStates.data(),	// pAttachments
-			{ 1.f, 1.f, 1.f, 1.f }				// blend constants
-		};
-
-		FrameBufferObjectPtr fboAlphaBlendPtr = es.GetFinalFrameBufferObject();
-		assert(fboAlphaBlendPtr);
-		if (!fboAlphaBlendPtr)
-		{
-			return false;
-		}
-
-		VkPipelineDepthStencilStateCreateInfo depthStencilState =
-			VulkanHelper::InitPipelineDepthStencilStateCreateInfo(
-			VK_FALSE,
-			VK_FALSE,
-			VK_COMPARE_OP_LESS_OR_EQUAL);
-
-		VkPipelineViewportStateCreateInfo viewportState =
-			VulkanHelper::InitPipelineViewportStateCreateInfo(1, 1, 0);
-
-		VkPipelineMultisampleStateCreateInfo multisampleState =
-			VulkanHelper::InitPipelineMultisampleStateCreateInfo(
-			VK_SAMPLE_COUNT_1_BIT,
-			0);
-
-		if (shaderPtr)
-		{
-			VKNDescriptorSetBuilder& dsBuilder = shaderPtr->GetDescriptorSetBuilder();
-
-			//layout(std140, binding = 0) uniform ProjViewBuf
-			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-				VK_SHADER_STAGE_VERTEX_BIT,
-				0);
-
-			//layout(binding = 1) uniform sampler2DArray textureMaps;
-			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-				VK_SHADER_STAGE_FRAGMENT_BIT,
-				1);
-
-			//layout(std140, binding = 2) uniform Instances
-			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-				VK_SHADER_STAGE_VERTEX_BIT,
-				2);
-
-			if (m_uniformMemHelperPtr)
-			{
-				dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-					0,
-					0,
-					m_uniformMemHelperPtr->GetBufferObject());
-			}
-
-			if (m_texPackPtr)
-			{
-				VKNTexturePackPtr vknTexPackPtr = std::dynamic_pointer_cast<VKNTexturePack, TexturePack>(m_texPackPtr);
-				if (vknTexPackPtr)
-				{
-					TextureObject* pTexObj = vknTexPackPtr->GetTextureHandle();
-					assert(pTexObj);
-					if (pTexObj)
-					{
-						dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-							1,
-							0,
-							*pTexObj);
-					}
-				}
-			}
-
-			// remember that world matrix instances were collected as part of VKNMultiDrawInstancedObject.
-			// You want those matrices for shadow rendering too
-			assert(m_alphaStaticMultiDrawObjectPtr);
-			if (m_alphaStaticMultiDrawObjectPtr)
-			{
-				VKNMultiDrawInstancedObject* pDrawInstancedObject = dynamic_cast<VKNMultiDrawInstancedObject*>(m_alphaStaticMultiDrawObjectPtr.get());
-				if (pDrawInstancedObject)
-				{
-					auto& instBuffer = pDrawInstancedObject->GetInstanceBuffer();
-					dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-						2,
-						0,
-						instBuffer);
-				}
-			}
-
-			// NOTE: the renderpass you use here needs to preserve existing color attachments,
-			// not clear or ignore them.
-
-			assert(fboAlphaBlendPtr->renderPass);
-			VKNPipelineBuilder& pipelineBuilder = shaderPtr->GetPipelineBuilder();
-			pipelineBuilder.Add(inputAssemblyState).
-				Add(s_vertexInputState).
-				Add(rasterizationState).
-				Add(alphaBlendColorBlendState).
-				Add(depthStencilState).
-				Add(viewportState).
-				Add(multisampleState).
-				Add(s1_dynamicState).
-				Add(fboAlphaBlendPtr->renderPass);
-
-			return true;
-		}
-
-		return false;
-	}
-
-	bool VKNBatchDrawEffect::SetupDynamicAlphaBlendShader(const VKNShaderPtr& shaderPtr, const VKNEffectState& es)
-	{
-		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState =
-			VulkanHelper::InitPipelineInputAssemblyStateCreateInfo(
-			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-			0,
-			VK_FALSE);
-
-		VkPipelineRasterizationStateCreateInfo rasterizationState =
-			VulkanHelper::InitPipelineRasterizationStateCreateInfo(
-			VK_POLYGON_MODE_FILL,
-			VK_CULL_MODE_BACK_BIT,
-			VK_FRONT_FACE_COUNTER_CLOCKWISE,
-			0);
-
-		VkPipelineColorBlendAttachmentState alphaBlendAttachmentState
-		{
-			VK_TRUE,							// blendEnable
-			VK_BLEND_FACTOR_ONE,				// srcColorBlendFactor
-			VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA/*VK_BLEND_FACTOR_ZERO*/,// dstColorBlendFactor
-			VK_BLEND_OP_ADD,					// colorBlendOp
-			VK_BLEND_FACTOR_ONE,				// srcAlphaBlendFactor
-			VK_BLEND_FACTOR_ZERO,				// dstAlphaBlendFactor
-			VK_BLEND_OP_ADD,					// alphaBlendOp
-			VK_COLOR_COMPONENT_R_BIT |
-			VK_COLOR_COMPONENT_G_BIT |
-			VK_COLOR_COMPONENT_B_BIT |
-			VK_COLOR_COMPONENT_A_BIT			// colorWriteMask
-		};
-
-		std::vector<VkPipelineColorBlendAttachmentState> alphaBlendColorBlendStates;
-		alphaBlendColorBlendStates.push_back(alphaBlendAttachmentState);
-
-		VkPipelineColorBlendStateCreateInfo alphaBlendColorBlendState
-		{
-			VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-			0,									// pNext
-			0,									// flags
-			VK_FALSE,							// logicOpEnable
-			VK_LOGIC_OP_CLEAR,					// logicOp
-			static_cast<uint32_t>(alphaBlendColorBlendStates.size()),	// attachmentCount
-			alphaBlendColorBlendStates.data(),	// pAttachments
-			{ 1.f, 1.f, 1.f, 1.f }				// blend constants
-		};
-
-		FrameBufferObjectPtr fboAlphaBlendPtr = es.GetFinalFrameBufferObject();		
-		assert(fboAlphaBlendPtr);
-
-		if (!fboAlphaBlendPtr)
-		{
-			return false;
-		}
-
-		std::vector<VkPipelineColorBlendAttachmentState> colorBlendStates;
-
-		VkPipelineDepthStencilStateCreateInfo depthStencilState =
-			VulkanHelper::InitPipelineDepthStencilStateCreateInfo(
-			VK_TRUE,
-			VK_FALSE,
-			VK_COMPARE_OP_LESS_OR_EQUAL);
-
-		VkPipelineViewportStateCreateInfo viewportState =
-			VulkanHelper::InitPipelineViewportStateCreateInfo(1, 1, 0);
-
-		VkPipelineMultisampleStateCreateInfo multisampleState =
-			VulkanHelper::InitPipelineMultisampleStateCreateInfo(
-			VK_SAMPLE_COUNT_1_BIT,
-			0);
-
-		if (shaderPtr)
-		{
-			// NOTE: the layout and binding info is taken from the desired shaders and 
-			// uniform blocks to determine how descriptor sets are formatted
-			VKNDescriptorSetBuilder& dsBuilder = shaderPtr->GetDescriptorSetBuilder();
-
-			//layout(std140, binding = 0) uniform ProjViewBuf
-			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-				VK_SHADER_STAGE_VERTEX_BIT,
-				0);
-
-			//layout(binding = 1) uniform sampler2DArray textureMaps;
-			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-				VK_SHADER_STAGE_FRAGMENT_BIT,
-				1);
-
-			if (m_uniformMemHelperPtr)
-			{
-				dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-					0,
-					0,
-					m_uniformMemHelperPtr->GetBufferObject());
-			}
-
-			if (m_texPackPtr)
-			{
-				VKNTexturePackPtr vknTexPackPtr = std::dynamic_pointer_cast<VKNTexturePack, TexturePack>(m_texPackPtr);
-				if (vknTexPackPtr)
-				{
-					TextureObject* pTexObj = vknTexPackPtr->GetTextureHandle();
-					assert(pTexObj);
-					if (pTexObj)
-					{
-						dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-							1,
-							0,
-							*pTexObj);
-					}
-				}
-			}
-
-			// NOTE: the renderpass you use here needs to preserve existing color attachments,
-			// not clear or ignore them.
-			assert(fboAlphaBlendPtr->renderPass);
-			VKNPipelineBuilder& pipelineBuilder = shaderPtr->GetPipelineBuilder();
-			pipelineBuilder.Add(inputAssemblyState).
-				Add(s_vertexInputState).
-				Add(rasterizationState).
-				Add(alphaBlendColorBlendState).
-				Add(depthStencilState).
-				Add(viewportState).
-				Add(multisampleState).
-				Add(s1_dynamicState).
-				Add(fboAlphaBlendPtr->renderPass);
-
-			return true;
-		}
-
-		return false;
-	}
-
-	bool VKNBatchDrawEffect::FakePrePass(int pass, const EffectStatePtr& esPtr)
-	{
-		m_currentPass = pass;
-		if (!m_cachedShaderPtrs[0])
-		{
-			m_cachedShaderPtrs[0] = m_renderer.GetShaderProgram(m_materialList[0]);
-
-			VulkanRenderContext& context = static_cast<VulkanRenderContext&>(*m_renderer.GetRenderContext());
-			uint32_t swapChainCount = context.GetSwapChainImageCount();
-			assert(swapChainCount > 0);
-
-			assert(esPtr);
-			if(!esPtr)
-			{
-				Log::PrintError("VKNBatchDrawEffect::FakePrePass() EffectStatePtr is NULL! Cannot continue!");
-				return false;
-			}
-
-			const VKNEffectState& effectState = (esPtr->GetType() == EffectState::kDerived) ?
-				static_cast<const VKNEffectState&>(*esPtr) :
-				VKNEffectState(nullptr);
-
-			VKNShaderPtr shaderPtr = std::dynamic_pointer_cast<VKNShader, Shader>(m_cachedShaderPtrs[0]);
-			if (shaderPtr)
-			{
-				RenderCheckOK(FakeSetupShader(shaderPtr, effectState));
-			}
-		}
-
-		// if we have open bindings, close them
-		RenderCheckOK(CheckBuffers());
-
-		return true;
-	}
-
-	bool VKNBatchDrawEffect::FakeDraw(const Graphics::CameraDrawInfo& cdi, const Graphics::RenderStateInfo& rsi)
-	{
-		int shaderIndex = 0;
-		assert(m_dynamicMultiDrawObjectPtr);
-		MultiDrawPtr drawPtr = m_dynamicMultiDrawObjectPtr;
-		if (drawPtr)
-		{
-			VKNShaderPtr currentShader = std::dynamic_pointer_cast<VKNShader, Shader>(m_cachedShaderPtrs[shaderIndex]);
-			assert(currentShader);
-			if (currentShader)
-			{
-				UpdateUniforms(cdi, rsi);
-
-				// start recording
-
-				m_renderer.SetActiveShaderProgram(currentShader);
-
-				// we set the shader here as well because static multidraw type needs
-				// to access uniform 'worldMat' to set it per object reference
-				drawPtr->SetShader(currentShader);
-				// the array buffer and texture array linking to shader state is done
-				// within this call
-				RenderCheckOK(drawPtr->Render());
-
-				return true;
-			}
-		}
-
-		return false;
-	}
-
-	bool VKNBatchDrawEffect::FakePostPass()
-	{
-		if (m_currentPass > -1)
-		{
-			return true;
-		}
-
-		return false;
-	}
-
-	bool VKNBatchDrawEffect::FakeSetupShader(const VKNShaderPtr& shaderPtr, const VKNEffectState& effectState)
-	{
-		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState =
-			VulkanHelper::InitPipelineInputAssemblyStateCreateInfo(
-			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-			0,
-			VK_FALSE);
-
-		VkPipelineRasterizationStateCreateInfo rasterizationState =
-			VulkanHelper::InitPipelineRasterizationStateCreateInfo(
-			VK_POLYGON_MODE_FILL,
-			VK_CULL_MODE_BACK_BIT,
-			VK_FRONT_FACE_COUNTER_CLOCKWISE,
-			0);
-
-		VkPipelineColorBlendAttachmentState blendAttachmentState =
-			VulkanHelper::InitPipelineColorBlendAttachmentState(
-			0xf,
-			VK_FALSE);
-
-		VkPipelineColorBlendStateCreateInfo colorBlendState{};
-
-		auto& defaultFBOs = effectState.GetDefaultFrameBufferObjects();
-		assert(!defaultFBOs.empty());
-
-		if(defaultFBOs.empty())
-		{
-			return false;
-		}
-
-		std::vector<VkPipelineColorBlendAttachmentState> colorBlendStates;
-
-		const FrameBufferObject* pFBO = defaultFBOs[0];
-		if (pFBO)
-		{
-			for(auto& entry : pFBO->textureObjectInfos)
-			{
-				colorBlendStates.push_back(entry.colorBlendState);
-			}
-
-			colorBlendState =
-				VulkanHelper::InitPipelineColorBlendStateCreateInfo(
-				static_cast<uint32_t>(colorBlendStates.size()),
-				colorBlendStates.data());
-		}
-		else
-		{
-			VkPipelineColorBlendStateCreateInfo colorBlendState =
-				VulkanHelper::InitPipelineColorBlendStateCreateInfo(
-				1,
-				&blendAttachmentState);
-		}
-
-		VkPipelineDepthStencilStateCreateInfo depthStencilState =
-			VulkanHelper::InitPipelineDepthStencilStateCreateInfo(
-			VK_TRUE,
-			VK_TRUE,
-			VK_COMPARE_OP_LESS_OR_EQUAL);
-
-		VkPipelineViewportStateCreateInfo viewportState =
-			VulkanHelper::InitPipelineViewportStateCreateInfo(1, 1, 0);
-
-		VkPipelineMultisampleStateCreateInfo multisampleState =
-			VulkanHelper::InitPipelineMultisampleStateCreateInfo(
-			VK_SAMPLE_COUNT_1_BIT,
-			0);
-
-		if (shaderPtr)
-		{
-			// TODO: look at the desired shaders and uniform blocks to determine
-			// how descriptor sets are formatted
-			VKNDescriptorSetBuilder& dsBuilder = shaderPtr->GetDescriptorSetBuilder();
-
-			//layout(std140, binding = 0) uniform ProjViewBuf
-			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-				VK_SHADER_STAGE_VERTEX_BIT,
-				0);
-
-			//layout(binding = 1) uniform sampler2DArray textureMaps;
-			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-				VK_SHADER_STAGE_FRAGMENT_BIT,
-				1);
-
-			if (m_uniformMemHelperPtr)
-			{
-				dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-					0,
-					0,
-					m_uniformMemHelperPtr->GetBufferObject());
-			}
-
-			if (m_texPackPtr)
-			{
-				VKNTexturePackPtr vknTexPackPtr = std::dynamic_pointer_cast<VKNTexturePack, TexturePack>(m_texPackPtr);
-				if (vknTexPackPtr)
-				{
-					TextureObject* pTexObj = vknTexPackPtr->GetTextureHandle();
-					assert(pTexObj);
-					if (pTexObj)
-					{
-						dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-							1,
-							0,
-							*pTexObj);
-					}
-				}
-			}
-
-			assert(defaultFBOs[0]->renderPass);
-			VKNPipelineBuilder& pipelineBuilder = shaderPtr->GetPipelineBuilder();
-			pipelineBuilder.Add(inputAssemblyState).
-				Add(s_vertexInputState).
-				Add(rasterizationState).
-				Add(colorBlendState).
-				Add(depthStencilState).
-				Add(viewportState).
-				Add(multisampleState).
-				Add(s1_dynamicState).
-				Add(defaultFBOs[0]->renderPass);
-
-			return true;
-		}
-
-		return false;
-	}
-}
+// VKNBatchDrawEffect.cpp
+#include "stdafx.h"
+#include "VKNBatchDrawEffect.h"
+#include "VKNShader.h"
+#include "VKNTexturePack.h"
+#include "VKNMultiDrawObject.h"
+#include "VKNMultiDrawInstancedObject.h"
+#include "VulkanRenderContext.h"
+#include "VulkanSwapChain.h"
+#include "VKNVertexInfo.h"
+#include "VulkanHelper.h"
+#include "VKNCommonUniformBuffers.h"
+#include "VKNCommandBuffer.h"
+#include "IVKNMultiDraw.h"
+#include "VKNComputeSkinner.h"
+#include "VKNComputeUtils.h"
+#include "VKNGPUCuller.h"
+#include "VKNOITTargets.h"
+#include "VKNPipelineCache.h"
+
+#include "../Renderer/Renderer.h"
+#include "../Renderer/EffectInitInfo.h"
+#include "../Renderer/IEffectMgr.h"
+
+#include <cassert>
+
+//#define KIRBY_SANITY
+
+namespace
+{
+	std::vector<VkDynamicState> s_dynamicStateEnables =
+	{
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR,
+		VK_DYNAMIC_STATE_DEPTH_BIAS
+	};
+
+	// next to the executable unless SetPipelineCacheFile() says otherwise
+	const char* s_kDefaultPipelineCacheFile = "VKNBatchDrawEffect.pipelinecache";
+
+	// statically #define'd in shader (DeferredRenderLightPass_NM_Effect_FS)
+	static const int MAX_LIGHTS = 9;
+
+	// struct ShadowMatBuf
+	// converts a vector from the coordinate space of the viewer to the surface
+	// to the coordinate space between the light and the surface so a comparison
+	// can be made to determine if the surface is shadowed
+
+	const size_t shadowMatSize = Math::mat4::MAT4_SIZE * MAX_LIGHTS;
+	struct ShadowMatBuf // shadowmap specific uniform (StaticShadowMapShader_VS)
+	{
+		float shadowMatrix[shadowMatSize];
+
+		ShadowMatBuf()
+		:
+		shadowMatrix{}
+		{
+		}
+	};
+}
+
+namespace GamePrototype
+{
+	// we have now defined this in multiple places.
+	// Perhaps it needs either one common shared location
+	// or a rename?
+	VkPipelineDynamicStateCreateInfo s1_dynamicState =
+		VulkanHelper::InitPipelineDynamicStateCreateInfo(
+		s_dynamicStateEnables.data(),
+		static_cast<uint32_t>(s_dynamicStateEnables.size()),
+		0);
+
+	const VkVertexInputBindingDescription s_vertInputBindingDesc = VKNVertexInfo::GetVertexBinding();
+
+	const VKNVertexInfo::VertexAttributes s_vertAttrs = VKNVertexInfo::GetVertexAttributes();
+
+	const VkPipelineVertexInputStateCreateInfo s_vertexInputState =
+	{
+		VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,	// VkStructureType
+		0,	// pNext
+		0,	// flags
+		1,	// bindingDescriptionCount
+		&s_vertInputBindingDesc,	// pVertexBindingDescriptions
+		static_cast<uint32_t>(s_vertAttrs.size()),	// vertexAttributeDecriptionCount
+		s_vertAttrs.data()	// pVertexAttributeDescriptions
+	};
+
+	VKNBatchDrawEffect::VKNBatchDrawEffect(const EffectInitInfo& info)
+	:
+	BatchDrawEffect(info),
+	m_id(0),
+	m_currentPass(-1),
+	m_effectType(info.m_effectType),
+	m_bIsFirstDynamic(true),
+	m_bIsFirstStatic(true),
+	m_bIsFirstAlphaDynamic(true),
+	m_bIsFirstAlphaStatic(true),
+	m_bIsInitialized(false),
+	m_bSetStaticPackages(false),
+	m_bSetDynamicPackages(false),
+	m_gpuCullView{},
+	m_gpuCullProj{},
+	m_bGPUCullRecorded(false),
+	m_gpuDrawPhase(VKNGPUCuller::kFirstPhase),
+	m_bMultiDrawIndirect(false),
+	m_pipelineCacheFile(s_kDefaultPipelineCacheFile),
+	m_pipelineCacheSizeBefore(0),
+	m_bCountPipelineCache(false),
+	m_numWarmUpJobs(0),
+	m_bWarmUpFailed(false),
+	m_bOITMode(false),
+	m_bPushConstantCamera(false),
+	m_instanceFormat(InstanceTransform::kMat4),
+	m_pipelineBuilder(static_cast<VulkanRenderContext&>(*info.m_renderer.GetRenderContext()))
+	{
+	}
+
+	VKNBatchDrawEffect::~VKNBatchDrawEffect()
+	{
+		// package preparations in flight reference this effect, warm-up jobs call into the Setup functions
+		WaitForPackageBuilds();
+		WaitForWarmUp();
+	}
+
+	bool VKNBatchDrawEffect::Init()
+	{
+		if (!m_bIsInitialized)
+		{
+			if (!m_materialList.empty())
+			{
+				m_cachedShaderPtrs.resize(m_materialList.size());
+			}
+
+			RenderContextPtr contextPtr = m_renderer.GetRenderContext();
+			assert(contextPtr);
+			if(contextPtr)
+			{
+				VulkanRenderContext& vknContext = static_cast<VulkanRenderContext&>(*contextPtr);
+
+				int texWidth = TexturePack::s_kDefaultTextureWidth;
+				int texHeight = TexturePack::s_kDefaultTextureHeight;
+				int texMipMapLevels = TexturePack::s_kTextureMipMapLevels;
+				auto& queryRenderPtr = vknContext.GetQueryRenderer();
+				if(queryRenderPtr)
+				{
+					QueryRenderer::TextureInfo forcedTextureInfo = queryRenderPtr->GetTextureInfo();
+					if(forcedTextureInfo.bForcedSize)
+					{
+						texWidth = forcedTextureInfo.maxWidthHeight;
+						texHeight = forcedTextureInfo.maxWidthHeight;
+						texMipMapLevels = forcedTextureInfo.numMipMaps;
+					}
+				}
+
+				// NOTE: unlike the current OpenGL implementation,
+				// Vulkan IMultiDraw types share the same texture RGBA format 
+				// regardless of whether mesh objects use the alpha channel
+				m_texPackPtr = std::make_shared<VKNTexturePack>(vknContext,
+					texWidth,
+					texHeight,
+					texMipMapLevels,
+					TexturePack::s_kMaxTextures,
+					VK_FORMAT_B8G8R8A8_UNORM);	// NOTE: this should NOT perform alpha blending (BGR8 format unsupported)
+
+				RenderCheckOK(m_texPackPtr != TexturePackPtr());
+				RenderCheckOK(m_texPackPtr->Init());
+
+				m_dynamicMultiDrawObjectPtr = std::make_shared<VKNMultiDrawObject>(vknContext);
+				RenderCheckOK(m_dynamicMultiDrawObjectPtr != MultiDrawPtr());
+				m_dynamicMultiDrawObjectPtr->SetTexturePack(m_texPackPtr);
+				RenderCheckOK(m_dynamicMultiDrawObjectPtr->Initialize());
+
+				m_alphaDynamicMultiDrawObjectPtr = std::make_shared<VKNMultiDrawObject>(vknContext);
+				RenderCheckOK(m_alphaDynamicMultiDrawObjectPtr != MultiDrawPtr());
+				m_alphaDynamicMultiDrawObjectPtr->SetTexturePack(m_texPackPtr);
+				RenderCheckOK(m_alphaDynamicMultiDrawObjectPtr->Initialize());
+				m_alphaDynamicMultiDrawObjectPtr->SetAlphaBlending(true);
+
+				//m_staticMultiDrawObjectPtr = std::make_shared<VKNMultiDrawObject>(vknContext);
+				// the shaders read world matrices from a storage buffer, so instances per draw are not capped by
+				// the uniform buffer range
+				auto staticInstancedPtr = std::make_shared<VKNMultiDrawInstancedObject>(vknContext);
+				RenderCheckOK(staticInstancedPtr != nullptr);
+				staticInstancedPtr->SetInstanceBufferUsage(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+				staticInstancedPtr->SetInstanceTransformFormat(m_instanceFormat);
+				m_staticMultiDrawObjectPtr = staticInstancedPtr;
+				m_staticMultiDrawObjectPtr->SetTexturePack(m_texPackPtr);
+				RenderCheckOK(m_staticMultiDrawObjectPtr->Initialize());
+
+				auto alphaStaticInstancedPtr = std::make_shared<VKNMultiDrawInstancedObject>(vknContext);
+				RenderCheckOK(alphaStaticInstancedPtr != nullptr);
+				alphaStaticInstancedPtr->SetInstanceBufferUsage(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+				alphaStaticInstancedPtr->SetInstanceTransformFormat(m_instanceFormat);
+				m_alphaStaticMultiDrawObjectPtr = alphaStaticInstancedPtr;
+				m_alphaStaticMultiDrawObjectPtr->SetTexturePack(m_texPackPtr);
+				RenderCheckOK(m_alphaStaticMultiDrawObjectPtr->Initialize());
+				m_alphaStaticMultiDrawObjectPtr->SetAlphaBlending(true);
+
+				// NOTE: place the alpha blending type earlier than 
+				// default on list
+				m_dynamicDrawList = { m_alphaDynamicMultiDrawObjectPtr, m_dynamicMultiDrawObjectPtr };
+				m_staticDrawList = { m_alphaStaticMultiDrawObjectPtr, m_staticMultiDrawObjectPtr };
+
+				RenderCheckOK(CreateMemBufferHelpers());
+
+				m_pipelineCachePtr = std::make_shared<VKNPipelineCache>(vknContext);
+				RenderCheckOK(m_pipelineCachePtr->Init(m_pipelineCacheFile));
+
+				m_bIsInitialized = true;
+			}
+		}
+
+		return m_bIsInitialized;
+	}
+
+	int VKNBatchDrawEffect::NumPasses() const
+	{
+#if defined KIRBY_SANITY
+		return FakeNumPasses();
+#endif
+		/*
+		for each type of draw pass, whether it be shadows, opaque geometry,
+		or translucent geometry, we have static and dynamic data.
+		So let's go with 2 for now
+		*/
+
+		return kMaxPasses; /* one static pass, one dynamic pass*/
+	}
+
+	bool VKNBatchDrawEffect::PrePass(int pass, const EffectStatePtr& esPtr)
+	{
+		if (!m_bIsDrawActive)
+		{
+			return true;
+		}
+
+#if defined KIRBY_SANITY
+		RenderCheckOK(FakePrePass(pass, esPtr));
+		return true;
+#endif
+
+		// TODO: RenderStateInfo should be passed here too? PrePass->Draw->PostPass remember?
+
+		m_currentPass = pass;
+
+		// a warm-up still running when the first frame comes in is finished here. One that failed leaves
+		// the setup to the lazy path below
+		if (!WaitForWarmUp())
+		{
+			for (ShaderPtr& shaderPtr : m_cachedShaderPtrs)
+			{
+				shaderPtr = ShaderPtr();
+			}
+		}
+
+		//assert(m_currentPass < m_materialList.size());
+		if (!m_cachedShaderPtrs[0])
+		{
+			const VKNEffectState& effectState = (esPtr->GetType() == EffectState::kDerived) ?
+				static_cast<const VKNEffectState&>(*esPtr) :
+				VKNEffectState(nullptr);
+
+			RenderCheckOK(PrepareShaders(effectState));
+
+			for (int shaderIndex = 0; shaderIndex < kMaxShaderIndex; ++shaderIndex)
+			{
+				VKNShaderPtr shaderPtr = std::dynamic_pointer_cast<VKNShader, Shader>(m_cachedShaderPtrs[shaderIndex]);
+				if (shaderPtr)
+				{
+					RenderCheckOK(SetupShader(shaderIndex, shaderPtr, effectState));
+				}
+			}
+		}
+
+		return true;
+	}
+
+	bool VKNBatchDrawEffect::WarmUpPipelines(const EffectStatePtr& esPtr, const WarmUpDoneFunc& doneFunc, const WorkerPoolPtr& poolPtr)
+	{
+		RenderCheckOK(m_bIsInitialized);
+		RenderCheckOK(esPtr);
+		RenderCheckOK(IsWarmUpDone());
+
+		if (m_cachedShaderPtrs[0])
+		{
+			// PrePass() got there first
+			if (doneFunc)
+			{
+				doneFunc(true);
+			}
+			return true;
+		}
+
+		// the jobs outlive this call, so they keep the effect state alive
+		std::shared_ptr<const VKNEffectState> effectStatePtr = (esPtr->GetType() == EffectState::kDerived) ?
+			std::static_pointer_cast<const VKNEffectState>(esPtr) :
+			std::make_shared<const VKNEffectState>(nullptr);
+
+		// resolving the shaders and allocating their descriptor sets stays on this thread
+		RenderCheckOK(PrepareShaders(*effectStatePtr));
+
+		std::vector<std::pair<int, VKNShaderPtr>> jobs;
+		for (int shaderIndex = 0; shaderIndex < kMaxShaderIndex; ++shaderIndex)
+		{
+			VKNShaderPtr shaderPtr = std::dynamic_pointer_cast<VKNShader, Shader>(m_cachedShaderPtrs[shaderIndex]);
+			if (shaderPtr)
+			{
+				jobs.emplace_back(shaderIndex, shaderPtr);
+			}
+		}
+
+		if (jobs.empty())
+		{
+			if (doneFunc)
+			{
+				doneFunc(true);
+			}
+			return true;
+		}
+
+		WorkerPoolPtr workerPoolPtr = poolPtr ? poolPtr : GetWorkerPool();
+		assert(workerPoolPtr);
+
+		{
+			std::lock_guard<std::mutex> lock(m_warmUpMutex);
+			m_bWarmUpFailed = false;
+			m_numWarmUpJobs = jobs.size();
+		}
+
+		// every shader has its own builders, and pipeline caches are internally synchronized, so the
+		// pipelines are set up and compiled side by side
+		for (auto& job : jobs)
+		{
+			const int shaderIndex = job.first;
+			VKNShaderPtr shaderPtr = job.second;
+			workerPoolPtr->Submit([this, shaderIndex, shaderPtr, effectStatePtr, doneFunc]()
+			{
+				const bool bBuilt = SetupShader(shaderIndex, shaderPtr, *effectStatePtr) && shaderPtr->BuildPipeline();
+				if (!bBuilt)
+				{
+					Log::PrintError("VKNBatchDrawEffect::WarmUpPipelines() failed to build a pipeline!");
+				}
+
+				// NOTE: the effect may be destroyed as soon as the count hits zero, nothing of it is read after
+				bool bSucceeded = false;
+				bool bLast = false;
+				{
+					std::lock_guard<std::mutex> lock(m_warmUpMutex);
+					m_bWarmUpFailed = m_bWarmUpFailed || !bBuilt;
+					bSucceeded = !m_bWarmUpFailed;
+					bLast = (--m_numWarmUpJobs == 0);
+					if (bLast)
+					{
+						m_warmUpDoneCondition.notify_all();
+					}
+				}
+
+				// the last job out reports
+				if (bLast && doneFunc)
+				{
+					doneFunc(bSucceeded);
+				}
+			});
+		}
+
+		return true;
+	}
+
+	bool VKNBatchDrawEffect::IsWarmUpDone() const
+	{
+		std::lock_guard<std::mutex> lock(m_warmUpMutex);
+		return m_numWarmUpJobs == 0;
+	}
+
+	bool VKNBatchDrawEffect::WaitForWarmUp()
+	{
+		std::unique_lock<std::mutex> lock(m_warmUpMutex);
+		m_warmUpDoneCondition.wait(lock, [this]() { return m_numWarmUpJobs == 0; });
+
+		const bool bSucceeded = !m_bWarmUpFailed;
+		m_bWarmUpFailed = false;
+		return bSucceeded;
+	}
+
+	bool VKNBatchDrawEffect::PrepareShaders(const VKNEffectState& effectState)
+	{
+		m_cachedShaderPtrs[kStaticShaderIndex] = m_renderer.GetShaderProgram(m_materialList[kStaticShaderIndex]);
+		assert(m_cachedShaderPtrs[kStaticShaderIndex]);
+		m_cachedShaderPtrs[kStaticShadowShaderIndex] = m_renderer.GetShaderProgram(m_materialList[kStaticShadowShaderIndex]);
+		assert(m_cachedShaderPtrs[kStaticShadowShaderIndex]);
+		m_cachedShaderPtrs[kDynamicShaderIndex] = m_renderer.GetShaderProgram(m_materialList[kDynamicShaderIndex]);
+		assert(m_cachedShaderPtrs[kDynamicShaderIndex]);
+		m_cachedShaderPtrs[kDynamicShadowShaderIndex] = m_renderer.GetShaderProgram(m_materialList[kDynamicShadowShaderIndex]);
+		assert(m_cachedShaderPtrs[kDynamicShadowShaderIndex]);
+		m_cachedShaderPtrs[kStaticAlphaBlendShaderIndex] = m_renderer.GetShaderProgram(m_materialList[kStaticAlphaBlendShaderIndex]);
+		assert(m_cachedShaderPtrs[kStaticAlphaBlendShaderIndex]);
+		m_cachedShaderPtrs[kDynamicAlphaBlendShaderIndex] = m_renderer.GetShaderProgram(m_materialList[kDynamicAlphaBlendShaderIndex]);
+		assert(m_cachedShaderPtrs[kDynamicAlphaBlendShaderIndex]);
+
+		VulkanRenderContext& context = static_cast<VulkanRenderContext&>(*m_renderer.GetRenderContext());
+		uint32_t swapChainCount = context.GetSwapChainImageCount();
+		assert(swapChainCount > 0);
+
+		if(m_uniformMemHelperPtr)
+		{
+			for(auto& cachedShaderPtr : m_cachedShaderPtrs)
+			{
+				if(cachedShaderPtr)
+				{
+					VKNShaderPtr shaderPtr = std::dynamic_pointer_cast<VKNShader, Shader>(cachedShaderPtr);
+					if(shaderPtr)
+					{
+						RenderCheckOK(shaderPtr->Init(swapChainCount));
+						shaderPtr->SetBufferMemoryHelper(m_uniformMemHelperPtr);
+					}
+				}
+			}
+		}
+
+		// the alpha pipelines are built against the OIT targets' render pass
+		if (m_bOITMode && !m_oitTargetsPtr)
+		{
+			FrameBufferObjectPtr fboFinalPtr = effectState.GetFinalFrameBufferObject();
+			RenderCheckOK(fboFinalPtr);
+
+			VKNOITTargetsPtr oitTargetsPtr = std::make_shared<VKNOITTargets>(context);
+			if (!oitTargetsPtr->Init(m_oitInfo.depthFormat, fboFinalPtr->renderPass,
+				m_oitInfo.compositeVertexShaderPath, m_oitInfo.compositeFragmentShaderPath))
+			{
+				Log::PrintError("VKNBatchDrawEffect::PrepareShaders() failed to initialize OIT targets!");
+				return false;
+			}
+
+			m_oitTargetsPtr = oitTargetsPtr;
+		}
+
+		// the pipelines are compiled through the cache, whether it held them all is known at the end of
+		// the first frame
+		if (m_pipelineCachePtr)
+		{
+			for (auto& cachedShaderPtr : m_cachedShaderPtrs)
+			{
+				VKNShaderPtr shaderPtr = std::dynamic_pointer_cast<VKNShader, Shader>(cachedShaderPtr);
+				if (shaderPtr)
+				{
+					shaderPtr->GetPipelineBuilder().SetPipelineCache(m_pipelineCachePtr->GetHandle());
+				}
+			}
+
+			m_pipelineCacheSizeBefore = m_pipelineCachePtr->GetDataSize();
+			m_bCountPipelineCache = true;
+		}
+
+		return true;
+	}
+
+	bool VKNBatchDrawEffect::SetupShader(int shaderIndex, const VKNShaderPtr& shaderPtr, const VKNEffectState& effectState)
+	{
+		switch (shaderIndex)
+		{
+		case kStaticShadowShaderIndex:
+			return SetupStaticShadowShader(shaderPtr, effectState);
+		case kStaticShaderIndex:
+			return SetupStaticShader(shaderPtr, effectState);
+		case kDynamicShadowShaderIndex:
+			return SetupDynamicShadowShader(shaderPtr, effectState);
+		case kDynamicShaderIndex:
+			return SetupDynamicShader(shaderPtr, effectState);
+		case kStaticAlphaBlendShaderIndex:
+			return SetupStaticAlphaBlendShader(shaderPtr, effectState);
+		case kDynamicAlphaBlendShaderIndex:
+			return SetupDynamicAlphaBlendShader(shaderPtr, effectState);
+		default:
+			break;
+		}
+
+		return false;
+	}
+
+	bool VKNBatchDrawEffect::Collect(const Graphics::RenderObjectPtr& objPtr)
+	{
+		if (objPtr)
+		{
+			RenderCheckOK(m_dynamicMultiDrawObjectPtr != MultiDrawPtr());
+			RenderCheckOK(m_staticMultiDrawObjectPtr != MultiDrawPtr());
+
+			// NOTE: with async package builds on, an object without a package is
+			// skipped until its package is published back to us
+			DrawPackagePtr dpPtr = AcquireDrawPackage(objPtr);
+			if (dpPtr)
+			{
+				GatherPackageData(*objPtr, dpPtr, m_packageBins);
+				m_renderer.AddEffect(this);
+			}
+
+			return true;
+		}
+
+		return false;
+	}
+
+	bool VKNBatchDrawEffect::Collect(const std::vector<Graphics::RenderObjectPtr>& list)
+	{
+		// the parallel path does not go through Collect(RenderObjectPtr)
+		RenderCheckOK(m_dynamicMultiDrawObjectPtr != MultiDrawPtr());
+		RenderCheckOK(m_staticMultiDrawObjectPtr != MultiDrawPtr());
+
+		return CollectList(list);
+	}
+
+	bool VKNBatchDrawEffect::Collect(const Graphics::SceneNodePtr&)
+	{
+		// NOTE: LightCollection now stores all lights. Since this is just a typical
+		// geometry pass of a deferred render, lighting info is irrelevant right now.
+		return false;
+	}
+
+	bool VKNBatchDrawEffect::Draw(const Graphics::CameraDrawInfo& cdi, const Graphics::RenderStateInfo& rsi, const EffectStatePtr&)
+	{
+		if (!m_bIsDrawActive)
+		{
+			return true;
+		}
+
+#if defined KIRBY_SANITY
+		RenderCheckOK(FakeDraw(cdi, rsi));
+		return true;
+#endif
+
+		Graphics::RenderStateInfo mod_rsi(rsi);
+
+		// NOTE: this effect is not designed to handle postprocessing (yet).
+		if(rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kPostProcess)
+		{
+			return true;
+		}
+
+		// next frame's depth order follows the view camera, not the lights'
+		if (rsi.GetHint() != Graphics::RenderStateInfo::RenderPassHint::kShadows)
+		{
+			SetSortView(cdi);
+		}
+
+		if (m_currentPass == kFirstPass)
+		{
+			if (rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kShadows)
+			{
+				mod_rsi.SetShaderOverride(m_cachedShaderPtrs[MyShaderPassIndex::kStaticShadowShaderIndex]);
+			}
+			else if (rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kTranslucent)
+			{
+				mod_rsi.SetShaderOverride(m_cachedShaderPtrs[MyShaderPassIndex::kStaticAlphaBlendShaderIndex]);
+			}
+			else
+			{
+				mod_rsi.SetShaderOverride(m_cachedShaderPtrs[MyShaderPassIndex::kStaticShaderIndex]);
+			}
+
+			RenderCheckOK(DrawStaticPass(cdi, mod_rsi));
+		}
+		else if (m_currentPass == kSecondPass)
+		{
+			if (rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kShadows)
+			{
+				mod_rsi.SetShaderOverride(m_cachedShaderPtrs[MyShaderPassIndex::kDynamicShadowShaderIndex]);
+			}
+			else if (rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kTranslucent)
+			{
+				mod_rsi.SetShaderOverride(m_cachedShaderPtrs[MyShaderPassIndex::kDynamicAlphaBlendShaderIndex]);
+			}
+			else
+			{
+				mod_rsi.SetShaderOverride(m_cachedShaderPtrs[MyShaderPassIndex::kDynamicShaderIndex]);
+			}
+
+			RenderCheckOK(DrawDynamicPass(cdi, mod_rsi));
+		}
+
+		return true;
+	}
+
+	bool VKNBatchDrawEffect::PostPass(const EffectStatePtr&)
+	{
+		if (!m_bIsDrawActive)
+		{
+			return true;
+		}
+
+#if defined KIRBY_SANITY
+		RenderCheckOK(FakePostPass());
+		return true;
+#endif
+
+		if (m_currentPass > -1)
+		{
+			return true;
+		}
+
+		return false;
+	}
+
+	void VKNBatchDrawEffect::ClearForNextFrame()
+	{
+		// NOTE: m_bIsFirstStatic & m_bIsFirstAlphaStatic are reset by UpdateStaticBuffers(),
+		// the static IMultiDraw objects keep their contents between frames
+		m_bIsFirstDynamic = true;
+		m_bIsFirstAlphaDynamic = true;
+
+		// per frame containers live in the frame arena
+		ResetFrameAllocations();
+
+		// objects prepared on the worker threads get their packages built here, for next frame's Collect()
+		PublishBuiltPackages();
+		m_bSetStaticPackages = false;
+		m_bSetDynamicPackages = false;
+
+		if (m_bCountPipelineCache)
+		{
+			m_pipelineCachePtr->CountCreation(m_pipelineCacheSizeBefore);
+			m_bCountPipelineCache = false;
+		}
+
+		// next frame's culling is recorded with its own camera
+		m_bGPUCullRecorded = false;
+		m_gpuDrawPhase = VKNGPUCuller::kFirstPhase;
+
+		// next frame writes the slices of the frame in flight after this one
+		m_cameraSlices.clear();
+		if (m_uniformRingPtr)
+		{
+			m_uniformRingPtr->BeginFrame();
+		}
+
+		// the visible sets' command regions too, ResetFrameAllocations() had them all rewritten
+		if (m_drawCommandRingPtr)
+		{
+			m_drawCommandRingPtr->BeginFrame();
+		}
+	}
+
+	int VKNBatchDrawEffect::GetID() const
+	{
+		return m_id;
+	}
+
+	void VKNBatchDrawEffect::Free()
+	{
+		VulkanRenderContext& ctx = static_cast<VulkanRenderContext&>(*m_renderer.GetRenderContext());
+
+		// the IMultiDraw objects go below, so whatever the workers prepared is dropped unbuilt. Warm-up jobs
+		// still reference the shaders
+		DiscardPackageBuilds();
+		WaitForWarmUp();
+
+		// NOTE: we do this in multiple different places now. Perhaps it is time to merge into common?
+		vkQueueWaitIdle(ctx.GetGraphicsQueue());
+		vkDeviceWaitIdle(ctx.GetDevice());
+		// recorded command buffers need to be released at this point so we can release Vulkan objects
+		// previously recorded within it
+		VKNCommandBufferPtrList* pCmdList = ctx.GetCommandBuffers();
+		for (auto& cmdBufferPtr : *pCmdList)
+		{
+			cmdBufferPtr->ResetCommandBuffer();
+		}
+
+		// the builder draw lists hold references to the IMultiDraw objects below
+		m_dynamicDrawList.clear();
+		m_staticDrawList.clear();
+
+		if(m_dynamicMultiDrawObjectPtr)
+		{
+			m_dynamicMultiDrawObjectPtr->Shutdown();
+			m_dynamicMultiDrawObjectPtr = nullptr;
+		}
+
+		if(m_staticMultiDrawObjectPtr)
+		{
+			m_staticMultiDrawObjectPtr->Shutdown();
+			m_staticMultiDrawObjectPtr = nullptr;
+		}
+
+		if(m_alphaDynamicMultiDrawObjectPtr)
+		{
+			m_alphaDynamicMultiDrawObjectPtr->Shutdown();
+			m_alphaDynamicMultiDrawObjectPtr = nullptr;
+		}
+
+		if(m_alphaStaticMultiDrawObjectPtr)
+		{
+			m_alphaStaticMultiDrawObjectPtr->Shutdown();
+			m_alphaStaticMultiDrawObjectPtr = nullptr;
+		}
+
+		m_cachedShaderPtrs.clear();
+
+		m_texPackPtr = nullptr;
+		ResetFrameAllocations();
+		m_staticRegistry.Clear();
+		m_alphaStaticRegistry.Clear();
+
+		m_pipelineBuilder.Reset();
+
+		m_uniformMemHelperPtr = nullptr;
+		m_cameraSlices.clear();
+		if (m_uniformRingPtr)
+		{
+			m_uniformRingPtr->Shutdown();
+			m_uniformRingPtr = nullptr;
+		}
+
+		if (m_drawCommandRingPtr)
+		{
+			m_drawCommandRingPtr->Shutdown();
+			m_drawCommandRingPtr = nullptr;
+		}
+
+		if (m_gpuCullerPtr)
+		{
+			m_gpuCullerPtr->Shutdown();
+			m_gpuCullerPtr = nullptr;
+		}
+
+		if (m_computeSkinnerPtr)
+		{
+			m_computeSkinnerPtr->Shutdown();
+			m_computeSkinnerPtr = nullptr;
+		}
+		m_skinInstanceFunc = SkinInstanceFunc();
+
+		if (m_oitTargetsPtr)
+		{
+			m_oitTargetsPtr->Shutdown();
+			m_oitTargetsPtr = nullptr;
+		}
+
+		// writes what this run compiled for the next one
+		if (m_pipelineCachePtr)
+		{
+			m_pipelineCachePtr->Shutdown();
+			m_pipelineCachePtr = nullptr;
+		}
+		m_bCountPipelineCache = false;
+	}
+
+	int VKNBatchDrawEffect::GetEffectType() const
+	{
+		return m_effectType;
+	}
+
+	bool VKNBatchDrawEffect::PostSceneGraph()
+	{
+		return CheckBuffers();
+	}
+
+	DrawPackagePtr VKNBatchDrawEffect::BuildDrawPackage(const Graphics::RenderObjectPtr& objPtr)
+	{
+		// draw lists are built once in Init(), nothing to allocate per object here
+		DynamicDrawPackageBuilder dynamicBuilder(m_renderer.GetRenderContext(), m_dynamicDrawList, objPtr);
+		DrawPackagePtr dpPtr = dynamicBuilder.Create();
+
+		StaticDrawPackageBuilder staticBuilder(m_renderer.GetRenderContext(), m_staticDrawList, objPtr, dpPtr);
+		return staticBuilder.Create();
+	}
+
+	bool VKNBatchDrawEffect::DrawStaticPass(const Graphics::CameraDrawInfo& cdi, const Graphics::RenderStateInfo& rsi)
+	{
+		int shaderIndex = MyShaderPassIndex::kStaticShaderIndex;
+		MultiDrawPtr drawPtr;
+
+		if (rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kTranslucent)
+		{
+			drawPtr = m_alphaStaticMultiDrawObjectPtr;
+			shaderIndex = MyShaderPassIndex::kStaticAlphaBlendShaderIndex;
+		}
+		else if (rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kShadows)
+		{
+			drawPtr = m_staticMultiDrawObjectPtr;
+			shaderIndex = MyShaderPassIndex::kStaticShadowShaderIndex;
+		}
+		else
+		{
+			drawPtr = m_staticMultiDrawObjectPtr;
+			shaderIndex = MyShaderPassIndex::kStaticShaderIndex;
+		}
+
+		if (drawPtr)
+		{
+			const bool bTranslucent = (rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kTranslucent);
+			const DrawPackageBins::BinIndex binIndex = bTranslucent ? DrawPackageBins::kStaticAlpha : DrawPackageBins::kStaticOpaque;
+			const VKNMultiDrawPtr& multiDrawPtr = bTranslucent ? m_alphaStaticMultiDrawObjectPtr : m_staticMultiDrawObjectPtr;
+			bool bChanged = false;
+
+			if (IsCullingInDraw())
+			{
+				// shadow passes take the casters of the light drawn with their camera. Without one, casters outside its
+				// view still cast into it, so nothing is culled
+				const bool bShadows = (rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kShadows);
+				const LodSelector lodSelector(cdi, GetLodSettings());
+				const LodSelector* pLods = IsLodSelection() ? &lodSelector : nullptr;
+				if (!bShadows || !HasShadowLights() || !SelectShadowCasters(cdi, binIndex, bChanged, pLods))
+				{
+					const Frustum frustum(cdi);
+					bChanged = CullStaticBin(binIndex, (bShadows || !IsFrustumCulling()) ? nullptr : &frustum, pLods);
+				}
+			}
+
+			VKNShaderPtr currentShader = std::dynamic_pointer_cast<VKNShader, Shader>(rsi.GetShaderOverride());
+			if (!currentShader)
+			{
+				currentShader = std::dynamic_pointer_cast<VKNShader, Shader>(m_cachedShaderPtrs[shaderIndex]);
+			}
+
+			if (currentShader)
+			{
+				m_renderer.SetActiveShaderProgram(currentShader);
+				// we set the shader here as well because static multidraw type needs
+				// to access uniform 'worldMat' to set it per object reference
+				drawPtr->SetShader(currentShader);
+
+				RenderCheckOK(UpdateUniforms(cdi, rsi, currentShader));
+
+				// the array buffer and texture array linking to shader state is done
+				// within this call
+				if (IsCullingInDraw())
+				{
+					RenderCheckOK(DrawVisible(multiDrawPtr, binIndex, bChanged));
+				}
+				else if (IsGPUCulledPass(cdi, rsi))
+				{
+					const VKNGPUCuller::Phase phase = m_gpuDrawPhase;
+					RenderCheckOK(multiDrawPtr->RenderWith([this, binIndex, phase](VkCommandBuffer cmd) { RecordGPUDraw(cmd, binIndex, phase); }));
+				}
+				else
+				{
+					RenderCheckOK(drawPtr->Render());
+				}
+			}
+		}
+
+		return true;
+	}
+
+	bool VKNBatchDrawEffect::DrawDynamicPass(const Graphics::CameraDrawInfo& cdi, const Graphics::RenderStateInfo& rsi)
+	{
+		int shaderIndex = MyShaderPassIndex::kDynamicShaderIndex;
+		MultiDrawPtr drawPtr;
+
+		if (rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kTranslucent)
+		{
+			drawPtr = m_alphaDynamicMultiDrawObjectPtr;
+			shaderIndex = MyShaderPassIndex::kDynamicAlphaBlendShaderIndex;
+		}
+		else if (rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kShadows)
+		{
+			drawPtr = m_dynamicMultiDrawObjectPtr;
+			shaderIndex = MyShaderPassIndex::kDynamicShadowShaderIndex;
+		}
+		else
+		{
+			drawPtr = m_dynamicMultiDrawObjectPtr;
+			shaderIndex = MyShaderPassIndex::kDynamicShaderIndex;
+		}
+
+		if (drawPtr)
+		{
+			const bool bTranslucent = (rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kTranslucent);
+			const DrawPackageBins::BinIndex binIndex = bTranslucent ? DrawPackageBins::kDynamicAlpha : DrawPackageBins::kDynamicOpaque;
+			const VKNMultiDrawPtr& multiDrawPtr = bTranslucent ? m_alphaDynamicMultiDrawObjectPtr : m_dynamicMultiDrawObjectPtr;
+			bool bChanged = false;
+
+			if (IsCullingInDraw())
+			{
+				// shadow passes take the casters of the light drawn with their camera. Without one, casters outside its
+				// view still cast into it, so nothing is culled
+				const bool bShadows = (rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kShadows);
+				const LodSelector lodSelector(cdi, GetLodSettings());
+				const LodSelector* pLods = IsLodSelection() ? &lodSelector : nullptr;
+				if (!bShadows || !HasShadowLights() || !SelectShadowCasters(cdi, binIndex, bChanged, pLods))
+				{
+					const Frustum frustum(cdi);
+					bChanged = CullDynamicBin(binIndex, (bShadows || !IsFrustumCulling()) ? nullptr : &frustum, pLods);
+				}
+			}
+
+			// we need to link the array buffer and texture array to shader state,
+			// as well as cdi & rdi before rendering (we ignore rdi for testing 1/9/2015)
+			VKNShaderPtr currentShader = std::dynamic_pointer_cast<VKNShader, Shader>(rsi.GetShaderOverride());
+			if (!currentShader)
+			{
+				currentShader = std::dynamic_pointer_cast<VKNShader, Shader>(m_cachedShaderPtrs[shaderIndex]);
+			}
+
+			if (currentShader)
+			{
+				RenderCheckOK(UpdateUniforms(cdi, rsi, currentShader));
+
+				// start recording
+
+				m_renderer.SetActiveShaderProgram(currentShader);
+
+				// we set the shader here as well because static multidraw type needs
+				// to access uniform 'worldMat' to set it per object reference
+				drawPtr->SetShader(currentShader);
+				// the array buffer and texture array linking to shader state is done
+				// within this call
+				if (IsCullingInDraw())
+				{
+					RenderCheckOK(DrawVisible(multiDrawPtr, binIndex, bChanged));
+				}
+				else if (IsGPUCulledPass(cdi, rsi))
+				{
+					const VKNGPUCuller::Phase phase = m_gpuDrawPhase;
+					RenderCheckOK(multiDrawPtr->RenderWith([this, binIndex, phase](VkCommandBuffer cmd) { RecordGPUDraw(cmd, binIndex, phase); }));
+				}
+				else
+				{
+					RenderCheckOK(drawPtr->Render());
+				}
+			}
+		}
+
+		return true;
+	}
+
+	bool VKNBatchDrawEffect::DrawVisible(const VKNMultiDrawPtr& multiDrawPtr, DrawPackageBins::BinIndex binIndex, bool bChanged)
+	{
+		CommandRegion& region = m_commandRegions[GetCommandSet(binIndex)][binIndex];
+
+		// an unchanged set draws the region an earlier pass of this frame wrote for it, which stays as it was
+		if (bChanged)
+		{
+			BuildVisibleCommands(binIndex, m_drawCommands);
+
+			region.offset = 0;
+			region.count = 0;
+			if (!m_drawCommands.empty())
+			{
+				const uint32_t count = static_cast<uint32_t>(m_drawCommands.size());
+				VkDrawIndirectCommand* pCommands = m_drawCommandRingPtr->Allocate(count, region.offset);
+				RenderCheckOK(pCommands);
+
+				memcpy(pCommands, m_drawCommands.data(), count*sizeof(VkDrawIndirectCommand));
+				region.count = count;
+			}
+		}
+
+		if (region.count == 0)
+		{
+			return true;
+		}
+
+		const VkBuffer buffer = m_drawCommandRingPtr->GetBuffer();
+		const VkDeviceSize offset = region.offset;
+		const uint32_t count = region.count;
+		const bool bMultiDrawIndirect = m_bMultiDrawIndirect;
+		return multiDrawPtr->RenderWith([buffer, offset, count, bMultiDrawIndirect](VkCommandBuffer cmd)
+		{
+			VKNComputeUtils::RecordDrawIndirect(cmd, buffer, offset, count, bMultiDrawIndirect);
+		});
+	}
+
+	bool VKNBatchDrawEffect::IsGPUCulledPass(const Graphics::CameraDrawInfo& cdi, const Graphics::RenderStateInfo& rsi) const
+	{
+		if (!m_gpuCullerPtr || !m_bGPUCullRecorded || rsi.GetHint() == Graphics::RenderStateInfo::RenderPassHint::kShadows)
+		{
+			return false;
+		}
+
+		// any other camera would draw what this one culled
+		return memcmp(cdi.viewMat.Get(), m_gpuCullView, sizeof(m_gpuCullView)) == 0 &&
+			memcmp(cdi.projMat.Get(), m_gpuCullProj, sizeof(m_gpuCullProj)) == 0;
+	}
+
+	bool VKNBatchDrawEffect::CheckBuffers()
+	{
+		if (!m_bSetStaticPackages)
+		{
+			m_bSetStaticPackages = true;
+
+			// once per frame, before anything is fed
+			SortPackages();
+
+			// static geometry rarely changes. Only rebuild when the collected set differs from what
+			// the static IMultiDraw objects already hold
+			RenderCheckOK(UpdateStaticBuffers());
+		}
+
+		// everything collected, every pass of the frame draws from the same contents (culling in Draw():
+		// through its own command region)
+		if (!m_bSetDynamicPackages)
+		{
+			m_bSetDynamicPackages = true;
+
+			AddToMultiDraw(m_dynamicMultiDrawObjectPtr, m_packageBins.Get(DrawPackageBins::kDynamicOpaque).packages, m_bIsFirstDynamic);
+			RenderCheckOK(m_dynamicMultiDrawObjectPtr->Update());
+
+			// alpha blended dynamic meshes
+			AddToMultiDraw(m_alphaDynamicMultiDrawObjectPtr, m_packageBins.Get(DrawPackageBins::kDynamicAlpha).packages, m_bIsFirstAlphaDynamic);
+			RenderCheckOK(m_alphaDynamicMultiDrawObjectPtr->Update());
+
+			// the GPU culler works from exactly what the IMultiDraw objects hold
+			if (IsGPUCulling())
+			{
+				UpdateGPUCullInstances();
+			}
+
+			// the skinning jobs too, with the vertex ranges the packages were just given
+			if (IsComputeSkinning())
+			{
+				UpdateSkinInstances();
+			}
+		}
+
+		return true;
+	}
+
+	bool VKNBatchDrawEffect::UpdateStaticBuffers()
+	{
+		if (m_staticRegistry.Update(m_packageBins.Get(DrawPackageBins::kStaticOpaque)))
+		{
+			m_bIsFirstStatic = true;
+			AddToMultiDraw(m_staticMultiDrawObjectPtr, m_staticRegistry, m_bIsFirstStatic);
+			RenderCheckOK(m_staticMultiDrawObjectPtr->Update());
+		}
+
+		// moved instances only, the registry reported no change
+		RenderCheckOK(UploadMovedInstances(m_staticMultiDrawObjectPtr, m_staticRegistry, m_instanceFormat));
+
+		// alpha blended static meshes
+		if (m_alphaStaticRegistry.Update(m_packageBins.Get(DrawPackageBins::kStaticAlpha)))
+		{
+			m_bIsFirstAlphaStatic = true;
+			AddToMultiDraw(m_alphaStaticMultiDrawObjectPtr, m_alphaStaticRegistry, m_bIsFirstAlphaStatic);
+			RenderCheckOK(m_alphaStaticMultiDrawObjectPtr->Update());
+		}
+
+		// moved instances only, the registry reported no change
+		RenderCheckOK(UploadMovedInstances(m_alphaStaticMultiDrawObjectPtr, m_alphaStaticRegistry, m_instanceFormat));
+
+		return true;
+	}
+
+	bool VKNBatchDrawEffect::SetGPUCulling(bool bEnable, const std::string& shaderPath, bool bDrawIndirectCount)
+	{
+		VulkanRenderContext& context = static_cast<VulkanRenderContext&>(*m_renderer.GetRenderContext());
+
+		if (m_gpuCullerPtr)
+		{
+			// recorded frames may still read the culler's buffers
+			vkDeviceWaitIdle(context.GetDevice());
+			m_gpuCullerPtr->Shutdown();
+			m_gpuCullerPtr = nullptr;
+		}
+
+		if (!bEnable)
+		{
+			return true;
+		}
+
+		if (!GetDrawCommandFunc())
+		{
+			Log::PrintError("VKNBatchDrawEffect::SetGPUCulling() needs a draw command function!");
+			return false;
+		}
+
+		// the compute pass decides what is drawn, nothing else may
+		if (IsCullingInDraw())
+		{
+			Log::PrintError("VKNBatchDrawEffect::SetGPUCulling() turn off frustum culling, LOD selection and depth sorting first!");
+			return false;
+		}
+
+		VKNGPUCullerPtr cullerPtr = std::make_shared<VKNGPUCuller>(context);
+		if (!cullerPtr->Init(shaderPath, bDrawIndirectCount, m_bMultiDrawIndirect))
+		{
+			Log::PrintError("VKNBatchDrawEffect::SetGPUCulling() failed to initialize GPU culler!");
+			return false;
+		}
+
+		m_gpuCullerPtr = cullerPtr;
+		m_bGPUCullRecorded = false;
+
+		return true;
+	}
+
+	bool VKNBatchDrawEffect::RecordGPUCulling(VkCommandBuffer cmd, const Graphics::CameraDrawInfo& cdi)
+	{
+		if (!m_gpuCullerPtr)
+		{
+			return true;
+		}
+
+		RenderCheckOK(m_gpuCullerPtr->RecordCull(cmd, cdi.viewMat.Get(), cdi.projMat.Get()));
+
+		// the passes drawn with this camera draw the output
+		memcpy(m_gpuCullView, cdi.viewMat.Get(), sizeof(m_gpuCullView));
+		memcpy(m_gpuCullProj, cdi.projMat.Get(), sizeof(m_gpuCullProj));
+		m_bGPUCullRecorded = true;
+		m_gpuDrawPhase = VKNGPUCuller::kFirstPhase;
+		return true;
+	}
+
+	bool VKNBatchDrawEffect::SetMultiDrawIndirect(bool bEnabled)
+	{
+		if (m_gpuCullerPtr && bEnabled != m_bMultiDrawIndirect)
+		{
+			Log::PrintError("VKNBatchDrawEffect::SetMultiDrawIndirect() set before SetGPUCulling()!");
+			return false;
+		}
+
+		if (bEnabled)
+		{
+			VulkanRenderContext& context = static_cast<VulkanRenderContext&>(*m_renderer.GetRenderContext());
+
+			VkPhysicalDeviceFeatures features = {};
+			vkGetPhysicalDeviceFeatures(context.GetPhysicalDevice(), &features);
+			if (!features.multiDrawIndirect)
+			{
+				Log::PrintError("VKNBatchDrawEffect::SetMultiDrawIndirect() not supported by the device!");
+				return false;
+			}
+		}
+
+		m_bMultiDrawIndirect = bEnabled;
+		return true;
+	}
+
+	bool VKNBatchDrawEffect::SetComputeSkinning(bool bEnable, const std::string& shaderPath, const VKNComputeSkinner::VertexLayout& layout,
+		uint32_t maxBindPoseVertices, const SkinInstanceFunc& skinInstanceFunc)
+	{
+		RenderCheckOK(m_bIsInitialized);
+
+		// jobs are gathered once per frame in CheckBuffers(), every pass must draw the same vertex ranges
+		if (bEnable && IsCullingInDraw())
+		{
+			Log::PrintError("VKNBatchDrawEffect::SetComputeSkinning() not supported with frustum culling, LOD selection or depth sorting!");
+			return false;
+		}
+
+		VulkanRenderContext& context = static_cast<VulkanRenderContext&>(*m_renderer.GetRenderContext());
+
+		if (m_computeSkinnerPtr)
+		{
+			// recorded frames may still read the skinner's buffers
+			vkDeviceWaitIdle(context.GetDevice());
+			m_computeSkinnerPtr->Shutdown();
+			m_computeSkinnerPtr = nullptr;
+		}
+
+		m_skinInstanceFunc = SkinInstanceFunc();
+
+		// the dynamic IMultiDraw objects' vertex buffers become storage buffers the compute pass writes into
+		m_dynamicMultiDrawObjectPtr->EnableComputeSkinning(bEnable);
+		m_alphaDynamicMultiDrawObjectPtr->EnableComputeSkinning(bEnable);
+
+		if (!bEnable)
+		{
+			return true;
+		}
+
+		RenderCheckOK(skinInstanceFunc != nullptr);
+
+		VKNComputeSkinnerPtr skinnerPtr = std::make_shared<VKNComputeSkinner>(context);
+		if (!skinnerPtr->Init(shaderPath, layout, maxBindPoseVertices))
+		{
+			Log::PrintError("VKNBatchDrawEffect::SetComputeSkinning() failed to initialize compute skinner!");
+			m_dynamicMultiDrawObjectPtr->EnableComputeSkinning(false);
+			m_alphaDynamicMultiDrawObjectPtr->EnableComputeSkinning(false);
+			return false;
+		}
+
+		m_computeSkinnerPtr = skinnerPtr;
+		m_skinInstanceFunc = skinInstanceFunc;
+
+		return true;
+	}
+
+	bool VKNBatchDrawEffect::AddSkinnedMesh(const std::vector<VKNComputeSkinner::SkinVertex>& vertices, uint32_t numBones, uint32_t& meshId)
+	{
+		if (!m_computeSkinnerPtr)
+		{
+			Log::PrintError("VKNBatchDrawEffect::AddSkinnedMesh() compute skinning is off!");
+			return false;
+		}
+
+		return m_computeSkinnerPtr->AddMesh(vertices, numBones, meshId);
+	}
+
+	bool VKNBatchDrawEffect::RecordComputeSkinning(VkCommandBuffer cmd)
+	{
+		if (!m_computeSkinnerPtr)
+		{
+			return true;
+		}
+
+		// SetComputeSkinning() and the culling setters refuse each other
+		assert(!IsCullingInDraw());
+
+		const BufferObject* pVertexBuffers[VKNComputeSkinner::s_kMaxGroups] =
+		{
+			&m_dynamicMultiDrawObjectPtr->GetVertexBuffer(),
+			&m_alphaDynamicMultiDrawObjectPtr->GetVertexBuffer()
+		};
+
+		return m_computeSkinnerPtr->RecordSkinning(cmd, pVertexBuffers);
+	}
+
+	bool VKNBatchDrawEffect::SetFrustumCulling(bool bEnable)
+	{
+		if (bEnable && IsGPUCulling())
+		{
+			Log::PrintError("VKNBatchDrawEffect::SetFrustumCulling() not supported with GPU culling!");
+			return false;
+		}
+
+		if (bEnable && IsComputeSkinning())
+		{
+			Log::PrintError("VKNBatchDrawEffect::SetFrustumCulling() not supported with compute skinning!");
+			return false;
+		}
+
+		return BatchDrawEffect::SetFrustumCulling(bEnable);
+	}
+
+	bool VKNBatchDrawEffect::SetLodSelection(bool bEnable)
+	{
+		if (bEnable && IsGPUCulling())
+		{
+			Log::PrintError("VKNBatchDrawEffect::SetLodSelection() not supported with GPU culling!");
+			return false;
+		}
+
+		if (bEnable && IsComputeSkinning())
+		{
+			Log::PrintError("VKNBatchDrawEffect::SetLodSelection() not supported with compute skinning!");
+			return false;
+		}
+
+		return BatchDrawEffect::SetLodSelection(bEnable);
+	}
+
+	bool VKNBatchDrawEffect::SetDepthSorting(bool bEnable)
+	{
+		if (bEnable && IsGPUCulling())
+		{
+			Log::PrintError("VKNBatchDrawEffect::SetDepthSorting() not supported with GPU culling!");
+			return false;
+		}
+
+		if (bEnable && IsComputeSkinning())
+		{
+			Log::PrintError("VKNBatchDrawEffect::SetDepthSorting() not supported with compute skinning!");
+			return false;
+		}
+
+		return BatchDrawEffect::SetDepthSorting(bEnable);
+	}
+
+	bool VKNBatchDrawEffect::SetOcclusionCulling(bool bEnable, const std::string& pyramidShaderPath)
+	{
+		if (!m_gpuCullerPtr)
+		{
+			// occlusion tests run in the GPU culling pass
+			RenderCheckOK(!bEnable);
+			return true;
+		}
+
+		return m_gpuCullerPtr->EnableOcclusion(bEnable, pyramidShaderPath);
+	}
+
+	bool VKNBatchDrawEffect::RecordGPUOcclusionRetest(VkCommandBuffer cmd, const VKNEffectState& effectState, uint32_t imageIndex)
+	{
+		if (!IsOcclusionCulling())
+		{
+			return true;
+		}
+
+		auto& gBufferFBOs = effectState.GetGBufferFrameBufferObjects();
+		if (gBufferFBOs.empty())
+		{
+			Log::PrintError("VKNBatchDrawEffect::RecordGPUOcclusionRetest() no GBuffer to take depth from!");
+			return false;
+		}
+
+		const FrameBufferObject* pFBO = gBufferFBOs[(imageIndex < gBufferFBOs.size()) ? imageIndex : 0];
+		assert(pFBO);
+
+		RenderCheckOK(m_gpuCullerPtr->RecordOcclusionRetest(cmd, pFBO->depthTexture, pFBO->width, pFBO->height));
+
+		// the second half of the geometry pass draws what was wrongly hidden
+		m_gpuDrawPhase = VKNGPUCuller::kSecondPhase;
+		return true;
+	}
+
+	VKNPipelineCache::Stats VKNBatchDrawEffect::GetPipelineCacheStats() const
+	{
+		return m_pipelineCachePtr ? m_pipelineCachePtr->GetStats() : VKNPipelineCache::Stats();
+	}
+
+	bool VKNBatchDrawEffect::SetOITMode(bool bEnable, const OITInfo& info)
+	{
+		if (!m_cachedShaderPtrs.empty() && m_cachedShaderPtrs[0])
+		{
+			Log::PrintError("VKNBatchDrawEffect::SetOITMode() the alpha pipelines are already built!");
+			return false;
+		}
+
+		RenderCheckOK(!bEnable || info.depthFormat != VK_FORMAT_UNDEFINED);
+
+		m_bOITMode = bEnable;
+		m_oitInfo = bEnable ? info : OITInfo();
+
+		// blending no longer depends on the order the alpha packages are drawn in
+		SetOrderIndependentAlpha(bEnable);
+
+		return true;
+	}
+
+	bool VKNBatchDrawEffect::SetPushConstantCamera(bool bEnable)
+	{
+		if (!m_cachedShaderPtrs.empty() && m_cachedShaderPtrs[0])
+		{
+			Log::PrintError("VKNBatchDrawEffect::SetPushConstantCamera() the pipelines are already built!");
+			return false;
+		}
+
+		m_bPushConstantCamera = bEnable;
+		return true;
+	}
+
+	bool VKNBatchDrawEffect::BeginOITPass(VkCommandBuffer cmd, const VKNEffectState& effectState, uint32_t imageIndex)
+	{
+		RenderCheckOK(m_oitTargetsPtr);
+
+		auto& gBufferFBOs = effectState.GetGBufferFrameBufferObjects();
+		if (gBufferFBOs.empty())
+		{
+			Log::PrintError("VKNBatchDrawEffect::BeginOITPass() no GBuffer to take depth from!");
+			return false;
+		}
+
+		const FrameBufferObject* pFBO = gBufferFBOs[(imageIndex < gBufferFBOs.size()) ? imageIndex : 0];
+		assert(pFBO);
+
+		return m_oitTargetsPtr->Begin(cmd, imageIndex, pFBO->depthTexture, pFBO->width, pFBO->height);
+	}
+
+	void VKNBatchDrawEffect::EndOITPass(VkCommandBuffer cmd)
+	{
+		if (m_oitTargetsPtr)
+		{
+			m_oitTargetsPtr->End(cmd);
+		}
+	}
+
+	bool VKNBatchDrawEffect::RecordOITComposite(VkCommandBuffer cmd, uint32_t imageIndex)
+	{
+		RenderCheckOK(m_oitTargetsPtr);
+
+		return m_oitTargetsPtr->RecordComposite(cmd, imageIndex);
+	}
+
+	void VKNBatchDrawEffect::RecordGPUDraw(VkCommandBuffer cmd, DrawPackageBins::BinIndex binIndex, VKNGPUCuller::Phase phase) const
+	{
+		if (m_gpuCullerPtr)
+		{
+			m_gpuCullerPtr->RecordDraw(cmd, binIndex, phase);
+		}
+	}
+
+	void VKNBatchDrawEffect::UpdateGPUCullInstances()
+	{
+		m_gpuCullerPtr->BeginFrame();
+
+		for (int bin = 0; bin < DrawPackageBins::kMaxBins; ++bin)
+		{
+			const DrawPackageBins::BinIndex binIndex = static_cast<DrawPackageBins::BinIndex>(bin);
+			m_gpuCullInstances.clear();
+
+			if (binIndex == DrawPackageBins::kStaticOpaque || binIndex == DrawPackageBins::kStaticAlpha)
+			{
+				// one command per object sharing a package, all with the package's (union) bounds
+				const StaticPackageRegistry& registry = (binIndex == DrawPackageBins::kStaticOpaque) ? m_staticRegistry : m_alphaStaticRegistry;
+				const auto& packages = registry.GetPackages();
+				const auto& instanceCounts = registry.GetInstanceCounts();
+				const auto& instanceOffsets = registry.GetInstanceOffsets();
+				const auto& bounds = registry.GetBounds();
+
+				for (size_t i = 0; i < packages.size(); ++i)
+				{
+					const BoundingSphere sphere = (i < bounds.size()) ? bounds[i] : BoundingSphere();
+					for (uint32_t instance = 0; instance < instanceCounts[i]; ++instance)
+					{
+						AddGPUCullInstance(*packages[i], instanceOffsets[i] + instance, sphere);
+					}
+				}
+			}
+			else
+			{
+				const DrawPackageBin& packageBin = m_packageBins.Get(binIndex);
+				for (size_t i = 0; i < packageBin.Size(); ++i)
+				{
+					const BoundingSphere sphere(packageBin.centerX[i], packageBin.centerY[i], packageBin.centerZ[i], packageBin.radius[i]);
+					AddGPUCullInstance(*packageBin.packages[i], 0, sphere);
+				}
+			}
+
+			m_gpuCullerPtr->SetInstances(bin, m_gpuCullInstances);
+		}
+	}
+
+	void VKNBatchDrawEffect::AddGPUCullInstance(const DrawPackageData& data, uint32_t instance, const BoundingSphere& sphere)
+	{
+		DrawCommand command;
+		if (!GetDrawCommandFunc()(data, instance, command))
+		{
+			// nothing to draw for this package
+			return;
+		}
+
+		VKNGPUCuller::Instance gpuInstance;
+		memcpy(&gpuInstance.command, &command, sizeof(gpuInstance.command));
+
+		gpuInstance.bounds[0] = sphere.center[0];
+		gpuInstance.bounds[1] = sphere.center[1];
+		gpuInstance.bounds[2] = sphere.center[2];
+		gpuInstance.bounds[3] = sphere.radius;
+		m_gpuCullInstances.push_back(gpuInstance);
+	}
+
+	void VKNBatchDrawEffect::UpdateSkinInstances()
+	{
+		m_computeSkinnerPtr->BeginFrame();
+
+		// skinner group 0: dynamic opaque, 1: dynamic alpha, matching RecordComputeSkinning()'s vertex buffers
+		const DrawPackageBins::BinIndex bins[VKNComputeSkinner::s_kMaxGroups] = { DrawPackageBins::kDynamicOpaque, DrawPackageBins::kDynamicAlpha };
+		for (uint32_t group = 0; group < VKNComputeSkinner::s_kMaxGroups; ++group)
+		{
+			const DrawPackageBin& packageBin = m_packageBins.Get(bins[group]);
+			for (size_t i = 0; i < packageBin.Size(); ++i)
+			{
+				SkinInstance skinInstance;
+				if (!m_skinInstanceFunc(*packageBin.packages[i], skinInstance))
+				{
+					// not skinned, drawn as uploaded
+					continue;
+				}
+
+				if (!m_computeSkinnerPtr->AddInstance(group, skinInstance.meshId, skinInstance.pBoneMatrices, skinInstance.firstVertex))
+				{
+					Log::PrintError("VKNBatchDrawEffect::UpdateSkinInstances() invalid skin instance!");
+				}
+			}
+		}
+	}
+
+	bool VKNBatchDrawEffect::CreateMemBufferHelpers()
+	{
+		VulkanRenderContext& context = static_cast<VulkanRenderContext&>(*m_renderer.GetRenderContext());
+
+		if (!m_uniformMemHelperPtr)
+		{
+			m_uniformMemHelperPtr = std::make_shared<BufferMemoryHelper<UniformData>>(context);
+			RenderCheckOK(m_uniformMemHelperPtr && m_uniformMemHelperPtr->Init(IBufferMemoryHelper::kBufferType_Uniform));
+
+			// register our desired types
+			RenderCheckOK(UniformData::Register(dynamic_cast<BufferMemoryHelper<UniformData>&>(*m_uniformMemHelperPtr)));
+		}
+
+		if (!m_uniformRingPtr)
+		{
+			// a frame in flight per swap chain image, each with its own slices
+			uint32_t swapChainCount = context.GetSwapChainImageCount();
+			assert(swapChainCount > 0);
+
+			m_uniformRingPtr = std::make_shared<VKNUniformRing>(context);
+			RenderCheckOK(m_uniformRingPtr->Init(sizeof(UniformData), swapChainCount, s_kMaxCamerasPerFrame));
+			m_cameraSlices.reserve(s_kMaxCamerasPerFrame);
+		}
+
+		if (!m_drawCommandRingPtr)
+		{
+			// same frames in flight as the uniform ring
+			m_drawCommandRingPtr = std::make_shared<VKNDrawCommandRing>(context);
+			RenderCheckOK(m_drawCommandRingPtr->Init(context.GetSwapChainImageCount(), s_kMaxDrawCommandsPerFrame));
+		}
+
+		return true;
+	}
+
+	bool VKNBatchDrawEffect::UpdateUniforms(const Graphics::CameraDrawInfo& cdi, const Graphics::RenderStateInfo&, const VKNShaderPtr& shaderPtr)
+	{
+		const float* pView = cdi.viewMat.Get();
+		const float* pProj = cdi.projMat.Get();
+
+		if (m_bPushConstantCamera)
+		{
+			// recorded with the draw, nothing to write
+			UniformData data;
+			UniformViewCam::Write(&data, pView);
+			UniformProjCam::Write(&data, pProj);
+			shaderPtr->SetPushConstants(VK_SHADER_STAGE_VERTEX_BIT, &data, sizeof(data));
+			return true;
+		}
+
+		if (!m_uniformRingPtr)
+		{
+			return true;
+		}
+
+		const size_t matSize = Math::mat4::MAT4_SIZE * sizeof(float);
+
+		// every pass drawn from the same camera shares its slice
+		const CameraSlice* pSlice = nullptr;
+		for (const CameraSlice& slice : m_cameraSlices)
+		{
+			if (memcmp(slice.viewCam, pView, matSize) == 0 && memcmp(slice.projCam, pProj, matSize) == 0)
+			{
+				pSlice = &slice;
+				break;
+			}
+		}
+
+		if (!pSlice)
+		{
+			CameraSlice slice;
+			void* pMapped = m_uniformRingPtr->Allocate(slice.dynamicOffset);
+			RenderCheckOK(pMapped != nullptr);
+
+			memcpy(slice.viewCam, pView, matSize);
+			memcpy(slice.projCam, pProj, matSize);
+			UniformViewCam::Write(pMapped, pView);
+			UniformProjCam::Write(pMapped, pProj);
+
+			m_cameraSlices.push_back(slice);
+			pSlice = &m_cameraSlices.back();
+		}
+
+		// applied to the dynamic uniform binding when the shader's descriptor set is bound
+		shaderPtr->SetDynamicOffset(pSlice->dynamicOffset);
+
+		return true;
+	}
+
+	void VKNBatchDrawEffect::AddCameraLayout(const VKNShaderPtr& shaderPtr)
+	{
+		if (m_bPushConstantCamera)
+		{
+			VkPushConstantRange range = {};
+			range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+			range.offset = 0;
+			range.size = sizeof(UniformData);
+			shaderPtr->GetPipelineBuilder().Add(range);
+			return;
+		}
+
+		shaderPtr->GetDescriptorSetBuilder().AddToLayout(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+			VK_SHADER_STAGE_VERTEX_BIT,
+			0);
+	}
+
+	void VKNBatchDrawEffect::AddCameraWrite(VKNDescriptorSetBuilder& dsBuilder)
+	{
+		if (!m_bPushConstantCamera && m_uniformRingPtr)
+		{
+			dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+				0,
+				0,
+				m_uniformRingPtr->GetBufferObject());
+		}
+	}
+
+	bool VKNBatchDrawEffect::SetupStaticShadowShader(const VKNShaderPtr& shaderPtr, const VKNEffectState& es)
+	{
+		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState =
+			VulkanHelper::InitPipelineInputAssemblyStateCreateInfo(
+			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+			0,
+			VK_FALSE);
+
+		VkPipelineRasterizationStateCreateInfo rasterizationState =
+			VulkanHelper::InitPipelineRasterizationStateCreateInfo(
+			VK_POLYGON_MODE_FILL,
+			VK_CULL_MODE_BACK_BIT,
+			VK_FRONT_FACE_COUNTER_CLOCKWISE,
+			0,
+			VK_FALSE);
+
+		// we are now using dynamic depth bias (vkCmdSetDepthBias) for shadows, this must be set as well
+		rasterizationState.depthBiasEnable = VK_TRUE;
+
+		// No color attachment in a depth buffer only pipeline
+		VkPipelineColorBlendStateCreateInfo colorBlendState = 
+			VulkanHelper::InitPipelineColorBlendStateCreateInfo(0, nullptr);
+
+		VkPipelineDepthStencilStateCreateInfo depthStencilState =
+			VulkanHelper::InitPipelineDepthStencilStateCreateInfo(
+			VK_TRUE,
+			VK_TRUE,
+			VK_COMPARE_OP_LESS_OR_EQUAL);
+
+		VkPipelineViewportStateCreateInfo viewportState =
+			VulkanHelper::InitPipelineViewportStateCreateInfo(1, 1, 0);
+
+		VkPipelineMultisampleStateCreateInfo multisampleState =
+			VulkanHelper::InitPipelineMultisampleStateCreateInfo(
+			VK_SAMPLE_COUNT_1_BIT,
+			0);
+
+		if (shaderPtr)
+		{
+			assert(m_uniformMemHelperPtr);
+			shaderPtr->SetBufferMemoryHelper(m_uniformMemHelperPtr);
+
+			VKNDescriptorSetBuilder& dsBuilder = shaderPtr->GetDescriptorSetBuilder();
+
+			//layout(std140, binding = 0) uniform ViewProjLight (or push_constant)
+			AddCameraLayout(shaderPtr);
+
+			//layout(std430, binding = 1) readonly buffer Instances
+			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_VERTEX_BIT,
+				1);
+
+			AddCameraWrite(dsBuilder);
+
+			// remember that world matrix instances were collected as part of VKNMultiDrawInstancedObject.
+			// You want those matrices for shadow rendering too
+			assert(m_staticMultiDrawObjectPtr);
+			if (m_staticMultiDrawObjectPtr)
+			{
+				VKNMultiDrawInstancedObject* pDrawInstancedObject = dynamic_cast<VKNMultiDrawInstancedObject*>(m_staticMultiDrawObjectPtr.get());
+				if (pDrawInstancedObject)
+				{
+					auto& instBuffer = pDrawInstancedObject->GetInstanceBuffer();
+					dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+						1,
+						0,
+						instBuffer);
+				}
+			}
+
+			auto& depthOnlyFBOs = es.GetDepthOnlyFrameBufferObjects();
+			assert(!depthOnlyFBOs.empty());
+			if(depthOnlyFBOs.empty())
+			{
+				return false;
+			}
+
+			assert(depthOnlyFBOs[0]->renderPass != VK_NULL_HANDLE);
+
+			// although when constructing VkCommandBuffers we use the actual VkRenderPass
+			// from one of the light shadowmap framebuffers, we use this 'fake' FrameBufferObject
+			// to set up the pipeline. The VkRenderPass should possess the same properties for all
+			// shadowmaps.
+
+			VKNPipelineBuilder& pipelineBuilder = shaderPtr->GetPipelineBuilder();
+			pipelineBuilder.Add(inputAssemblyState).
+				Add(s_vertexInputState).
+				Add(rasterizationState).
+				Add(colorBlendState).
+				Add(depthStencilState).
+				Add(viewportState).
+				Add(multisampleState).
+				Add(s1_dynamicState).
+				Add(depthOnlyFBOs[0]->renderPass);
+
+			return true;
+		}
+
+		return false;
+	}
+
+	bool VKNBatchDrawEffect::SetupStaticShader(const VKNShaderPtr& shaderPtr, const VKNEffectState& es)
+	{
+		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState =
+			VulkanHelper::InitPipelineInputAssemblyStateCreateInfo(
+			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+			0,
+			VK_FALSE);
+
+		VkPipelineRasterizationStateCreateInfo rasterizationState =
+			VulkanHelper::InitPipelineRasterizationStateCreateInfo(
+			VK_POLYGON_MODE_FILL,
+			VK_CULL_MODE_BACK_BIT, /*VK_CULL_MODE_NONE?*/
+			VK_FRONT_FACE_COUNTER_CLOCKWISE,
+			0,
+			VK_FALSE);
+
+		VkPipelineColorBlendAttachmentState blendAttachmentState =
+			VulkanHelper::InitPipelineColorBlendAttachmentState(
+			0xf,
+			VK_FALSE);
+
+		VkPipelineColorBlendStateCreateInfo colorBlendState =
+			VulkanHelper::InitPipelineColorBlendStateCreateInfo(0, nullptr);
+
+		// tricky... BatchDrawEffect was designed for OpenGL to not have to worry about
+		// which framebuffer output is rendered to because the state machine handled that.
+		// In Vulkan, we don't have that luxury. So, we check to see if a GBuffer FBO is present.
+		// If not, we fall back to the default FBO if present.
+		const FrameBufferObject* pFBO = nullptr;
+
+		auto& gBufferFBOs = es.GetGBufferFrameBufferObjects();
+		if(!gBufferFBOs.empty())
+		{
+			pFBO = gBufferFBOs[0];
+		}
+
+		if(!pFBO)
+		{
+			auto& defaultFBOs = es.GetDefaultFrameBufferObjects();
+			assert(!defaultFBOs.empty());
+			if(!defaultFBOs.empty())
+			{
+				pFBO = defaultFBOs[0];
+			}
+		}
+
+		assert(pFBO);
+		if(!pFBO)
+		{
+			return false;
+		}
+
+		std::vector<VkPipelineColorBlendAttachmentState> colorBlendStates;
+
+		if(pFBO)
+		{
+			for(auto& entry : pFBO->textureObjectInfos)
+			{
+				colorBlendStates.push_back(entry.colorBlendState);
+			}
+
+			colorBlendState =
+				VulkanHelper::InitPipelineColorBlendStateCreateInfo(
+				static_cast<uint32_t>(colorBlendStates.size()),
+				colorBlendStates.data());
+		}
+
+		VkPipelineDepthStencilStateCreateInfo depthStencilState =
+			VulkanHelper::InitPipelineDepthStencilStateCreateInfo(
+			VK_TRUE,
+			VK_TRUE,
+			VK_COMPARE_OP_LESS_OR_EQUAL);
+
+		VkPipelineViewportStateCreateInfo viewportState =
+			VulkanHelper::InitPipelineViewportStateCreateInfo(1, 1, 0);
+
+		VkPipelineMultisampleStateCreateInfo multisampleState =
+			VulkanHelper::InitPipelineMultisampleStateCreateInfo(
+			VK_SAMPLE_COUNT_1_BIT,
+			0);
+
+		if (shaderPtr)
+		{
+			VKNDescriptorSetBuilder& dsBuilder = shaderPtr->GetDescriptorSetBuilder();
+
+			//layout(std140, binding = 0) uniform ProjViewBuf (or push_constant)
+			AddCameraLayout(shaderPtr);
+
+			//layout(std430, binding = 2) readonly buffer Instances
+			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_VERTEX_BIT,
+				2);
+
+			//layout(binding = 1) uniform sampler2DArray textureMaps;
+			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				VK_SHADER_STAGE_FRAGMENT_BIT,
+				1);
+
+			AddCameraWrite(dsBuilder);
+
+			assert(m_staticMultiDrawObjectPtr);
+			if (m_staticMultiDrawObjectPtr)
+			{
+				VKNMultiDrawInstancedObject* pDrawInstancedObject = dynamic_cast<VKNMultiDrawInstancedObject*>(m_staticMultiDrawObjectPtr.get());
+				if(pDrawInstancedObject)
+				{
+					auto& instBuffer = pDrawInstancedObject->GetInstanceBuffer();
+					dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+						2,
+						0,
+						instBuffer);
+				}			
+			}
+
+			if (m_texPackPtr)
+			{
+				VKNTexturePackPtr vknTexPackPtr = std::dynamic_pointer_cast<VKNTexturePack, TexturePack>(m_texPackPtr);
+				if (vknTexPackPtr)
+				{
+					TextureObject* pTexObj = vknTexPackPtr->GetTextureHandle();
+					assert(pTexObj);
+					if(pTexObj)
+					{
+						dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+							1,
+							0,
+							*pTexObj);
+					}
+				}
+			}
+
+			assert(pFBO->renderPass);
+			VKNPipelineBuilder& pipelineBuilder = shaderPtr->GetPipelineBuilder();
+			pipelineBuilder.Add(inputAssemblyState).
+				Add(s_vertexInputState).
+				Add(rasterizationState).
+				Add(colorBlendState).
+				Add(depthStencilState).
+				Add(viewportState).
+				Add(multisampleState).
+				Add(s1_dynamicState).
+				Add(pFBO->renderPass);
+
+			return true;
+		}
+
+		return false;
+	}
+
+	bool VKNBatchDrawEffect::SetupDynamicShadowShader(const VKNShaderPtr& shaderPtr, const VKNEffectState& es)
+	{
+		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState =
+			VulkanHelper::InitPipelineInputAssemblyStateCreateInfo(
+			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+			0,
+			VK_FALSE);
+
+		VkPipelineRasterizationStateCreateInfo rasterizationState =
+			VulkanHelper::InitPipelineRasterizationStateCreateInfo(
+			VK_POLYGON_MODE_FILL,
+			VK_CULL_MODE_BACK_BIT,
+			VK_FRONT_FACE_COUNTER_CLOCKWISE,
+			0,
+			VK_FALSE);
+
+		// no color state in a depth only pipeline
+		VkPipelineColorBlendStateCreateInfo colorBlendState = 
+			VulkanHelper::InitPipelineColorBlendStateCreateInfo(0, nullptr);
+
+		VkPipelineDepthStencilStateCreateInfo depthStencilState =
+			VulkanHelper::InitPipelineDepthStencilStateCreateInfo(
+			VK_TRUE,
+			VK_TRUE,
+			VK_COMPARE_OP_LESS_OR_EQUAL);
+
+		VkPipelineViewportStateCreateInfo viewportState =
+			VulkanHelper::InitPipelineViewportStateCreateInfo(1, 1, 0);
+
+		VkPipelineMultisampleStateCreateInfo multisampleState =
+			VulkanHelper::InitPipelineMultisampleStateCreateInfo(
+			VK_SAMPLE_COUNT_1_BIT,
+			0);
+
+		if (shaderPtr)
+		{
+			assert(m_uniformMemHelperPtr);
+			shaderPtr->SetBufferMemoryHelper(m_uniformMemHelperPtr);
+
+			VKNDescriptorSetBuilder& dsBuilder = shaderPtr->GetDescriptorSetBuilder();
+
+			//layout(std140, binding = 0) uniform ViewProjCam (or push_constant)
+			AddCameraLayout(shaderPtr);
+
+			AddCameraWrite(dsBuilder);
+
+			auto& depthFBOs = es.GetDepthOnlyFrameBufferObjects();
+			assert(!depthFBOs.empty());
+			if(depthFBOs.empty())
+			{
+				return false;
+			}
+
+			assert(depthFBOs[0]->renderPass);
+
+			VKNPipelineBuilder& pipelineBuilder = shaderPtr->GetPipelineBuilder();
+			pipelineBuilder.Add(inputAssemblyState).
+				Add(s_vertexInputState).
+				Add(rasterizationState).
+				Add(colorBlendState).
+				Add(depthStencilState).
+				Add(viewportState).
+				Add(multisampleState).
+				Add(s1_dynamicState).
+				Add(depthFBOs[0]->renderPass);
+
+			return true;
+		}
+
+		return false;
+	}
+
+	bool VKNBatchDrawEffect::SetupDynamicShader(const VKNShaderPtr& shaderPtr, const VKNEffectState& es)
+	{
+		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState =
+			VulkanHelper::InitPipelineInputAssemblyStateCreateInfo(
+			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+			0,
+			VK_FALSE);
+
+		VkPipelineRasterizationStateCreateInfo rasterizationState =
+			VulkanHelper::InitPipelineRasterizationStateCreateInfo(
+			VK_POLYGON_MODE_FILL,
+			VK_CULL_MODE_BACK_BIT,
+			VK_FRONT_FACE_COUNTER_CLOCKWISE,
+			0,
+			VK_FALSE);
+
+		VkPipelineColorBlendAttachmentState blendAttachmentState =
+			VulkanHelper::InitPipelineColorBlendAttachmentState(
+			0xf,
+			VK_FALSE);
+
+		VkPipelineColorBlendStateCreateInfo colorBlendState{};
+
+		// tricky... BatchDrawEffect was designed for OpenGL to not have to worry about
+		// which framebuffer output is rendered to because the state machine handled that.
+		// In Vulkan, we don't have that luxury. So, we check to see if a GBuffer FBO is present.
+		// If not, we fall back to the default FBO if present.
+		const FrameBufferObject* pFBO = nullptr;
+
+		auto& gBufferFBOs = es.GetGBufferFrameBufferObjects();
+		if (!gBufferFBOs.empty())
+		{
+			pFBO = gBufferFBOs[0];
+		}
+
+		if (!pFBO)
+		{
+			auto& defaultFBOs = es.GetDefaultFrameBufferObjects();
+			assert(!defaultFBOs.empty());
+			if (!defaultFBOs.empty())
+			{
+				pFBO = defaultFBOs[0];
+			}
+		}
+
+		assert(pFBO);
+		if (!pFBO)
+		{
+			return false;
+		}
+
+		std::vector<VkPipelineColorBlendAttachmentState> colorBlendStates;
+
+		if(pFBO)
+		{
+			for(auto& entry : pFBO->textureObjectInfos)
+			{
+				colorBlendStates.push_back(entry.colorBlendState);
+			}
+
+			colorBlendState =
+				VulkanHelper::InitPipelineColorBlendStateCreateInfo(
+				static_cast<uint32_t>(colorBlendStates.size()),
+				colorBlendStates.data());
+		}
+		else
+		{
+			VkPipelineColorBlendStateCreateInfo colorBlendState =
+				VulkanHelper::InitPipelineColorBlendStateCreateInfo(
+				1,
+				&blendAttachmentState);
+		}
+
+		VkPipelineDepthStencilStateCreateInfo depthStencilState =
+			VulkanHelper::InitPipelineDepthStencilStateCreateInfo(
+			VK_TRUE,
+			VK_TRUE,
+			VK_COMPARE_OP_LESS_OR_EQUAL);
+
+		VkPipelineViewportStateCreateInfo viewportState =
+			VulkanHelper::InitPipelineViewportStateCreateInfo(1, 1, 0);
+
+		VkPipelineMultisampleStateCreateInfo multisampleState =
+			VulkanHelper::InitPipelineMultisampleStateCreateInfo(
+			VK_SAMPLE_COUNT_1_BIT,
+			0);
+
+		if (shaderPtr)
+		{
+			VKNDescriptorSetBuilder& dsBuilder = shaderPtr->GetDescriptorSetBuilder();
+
+			//layout(std140, binding = 0) uniform ProjViewBuf (or push_constant)
+			AddCameraLayout(shaderPtr);
+
+			//layout(binding = 1) uniform sampler2DArray textureMaps;
+			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				VK_SHADER_STAGE_FRAGMENT_BIT,
+				1);
+
+			AddCameraWrite(dsBuilder);
+
+			if(m_texPackPtr)
+			{
+				VKNTexturePackPtr vknTexPackPtr = std::dynamic_pointer_cast<VKNTexturePack, TexturePack>(m_texPackPtr);
+				if(vknTexPackPtr)
+				{
+					TextureObject* pTexObj = vknTexPackPtr->GetTextureHandle();
+					assert(pTexObj);
+					if(pTexObj)
+					{
+						dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+							1,
+							0,
+							*pTexObj);
+					}
+				}
+			}
+
+			assert(pFBO->renderPass);
+			VKNPipelineBuilder& pipelineBuilder = shaderPtr->GetPipelineBuilder();
+			pipelineBuilder.Add(inputAssemblyState).
+				Add(s_vertexInputState).
+				Add(rasterizationState).
+				Add(colorBlendState).
+				Add(depthStencilState).
+				Add(viewportState).
+				Add(multisampleState).
+				Add(s1_dynamicState).
+				Add(pFBO->renderPass);
+
+			return true;
+		}
+
+		return false;
+	}
+
+	bool VKNBatchDrawEffect::SetupStaticAlphaBlendShader(const VKNShaderPtr& shaderPtr, const VKNEffectState& es)
+	{
+		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState =
+			VulkanHelper::InitPipelineInputAssemblyStateCreateInfo(
+			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+			0,
+			VK_FALSE);
+
+		VkPipelineRasterizationStateCreateInfo rasterizationState =
+			VulkanHelper::InitPipelineRasterizationStateCreateInfo(
+			VK_POLYGON_MODE_FILL,
+			VK_CULL_MODE_BACK_BIT,
+			VK_FRONT_FACE_COUNTER_CLOCKWISE,
+			0);
+
+		VkPipelineColorBlendAttachmentState alphaBlendAttachmentState
+		{
+			VK_TRUE,							// blendEnable
+			VK_BLEND_FACTOR_SRC_COLOR,			// srcColorBlendFactor
+			VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,// dstColorBlendFactor
+			VK_BLEND_OP_ADD,					// colorBlendOp
+			VK_BLEND_FACTOR_SRC_ALPHA,			// srcAlphaBlendFactor
+			VK_BLEND_FACTOR_ONE,				// dstAlphaBlendFactor
+			VK_BLEND_OP_ADD,					// alphaBlendOp
+			VK_COLOR_COMPONENT_R_BIT |
+			VK_COLOR_COMPONENT_G_BIT |
+			VK_COLOR_COMPONENT_B_BIT |
+			VK_COLOR_COMPONENT_A_BIT			// colorWriteMask
+		};
+
+		std::vector<VkPipelineColorBlendAttachmentState> alphaBlendColorBlendStates;
+		if (m_oitTargetsPtr)
+		{
+			// accumulation and revealage instead of the final color
+			alphaBlendColorBlendStates.push_back(VKNOITTargets::GetAccumBlendState());
+			alphaBlendColorBlendStates.push_back(VKNOITTargets::GetRevealageBlendState());
+		}
+		else
+		{
+			alphaBlendColorBlendStates.push_back(alphaBlendAttachmentState);
+		}
+
+		VkPipelineColorBlendStateCreateInfo alphaBlendColorBlendState
+		{
+			VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+			0,									// pNext
+			0,									// flags
+			VK_FALSE,							// logicOpEnable
+			VK_LOGIC_OP_CLEAR,					// logicOp
+			static_cast<uint32_t>(alphaBlendColorBlendStates.size()),	// attachmentCount
+			alphaBlendColorBlendStates.data(),	// pAttachments
+			{ 1.f, 1.f, 1.f, 1.f }				// blend constants
+		};
+
+		FrameBufferObjectPtr fboAlphaBlendPtr = es.GetFinalFrameBufferObject();
+		assert(fboAlphaBlendPtr);
+		if (!fboAlphaBlendPtr)
+		{
+			return false;
+		}
+
+		// unsorted OIT surfaces must not show through the opaque ones, so they test against the GBuffer depth
+		VkPipelineDepthStencilStateCreateInfo depthStencilState =
+			VulkanHelper::InitPipelineDepthStencilStateCreateInfo(
+			m_oitTargetsPtr ? VK_TRUE : VK_FALSE,
+			VK_FALSE,
+			VK_COMPARE_OP_LESS_OR_EQUAL);
+
+		VkPipelineViewportStateCreateInfo viewportState =
+			VulkanHelper::InitPipelineViewportStateCreateInfo(1, 1, 0);
+
+		VkPipelineMultisampleStateCreateInfo multisampleState =
+			VulkanHelper::InitPipelineMultisampleStateCreateInfo(
+			VK_SAMPLE_COUNT_1_BIT,
+			0);
+
+		if (shaderPtr)
+		{
+			VKNDescriptorSetBuilder& dsBuilder = shaderPtr->GetDescriptorSetBuilder();
+
+			//layout(std140, binding = 0) uniform ProjViewBuf (or push_constant)
+			AddCameraLayout(shaderPtr);
+
+			//layout(binding = 1) uniform sampler2DArray textureMaps;
+			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				VK_SHADER_STAGE_FRAGMENT_BIT,
+				1);
+
+			//layout(std430, binding = 2) readonly buffer Instances
+			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_VERTEX_BIT,
+				2);
+
+			AddCameraWrite(dsBuilder);
+
+			if (m_texPackPtr)
+			{
+				VKNTexturePackPtr vknTexPackPtr = std::dynamic_pointer_cast<VKNTexturePack, TexturePack>(m_texPackPtr);
+				if (vknTexPackPtr)
+				{
+					TextureObject* pTexObj = vknTexPackPtr->GetTextureHandle();
+					assert(pTexObj);
+					if (pTexObj)
+					{
+						dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+							1,
+							0,
+							*pTexObj);
+					}
+				}
+			}
+
+			// remember that world matrix instances were collected as part of VKNMultiDrawInstancedObject.
+			// You want those matrices for shadow rendering too
+			assert(m_alphaStaticMultiDrawObjectPtr);
+			if (m_alphaStaticMultiDrawObjectPtr)
+			{
+				VKNMultiDrawInstancedObject* pDrawInstancedObject = dynamic_cast<VKNMultiDrawInstancedObject*>(m_alphaStaticMultiDrawObjectPtr.get());
+				if (pDrawInstancedObject)
+				{
+					auto& instBuffer = pDrawInstancedObject->GetInstanceBuffer();
+					dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+						2,
+						0,
+						instBuffer);
+				}
+			}
+
+			// NOTE: the renderpass you use here needs to preserve existing color attachments,
+			// not clear or ignore them. The OIT pass clears its own targets instead
+			VkRenderPass renderPass = m_oitTargetsPtr ? m_oitTargetsPtr->GetRenderPass() : fboAlphaBlendPtr->renderPass;
+			assert(renderPass);
+			VKNPipelineBuilder& pipelineBuilder = shaderPtr->GetPipelineBuilder();
+			pipelineBuilder.Add(inputAssemblyState).
+				Add(s_vertexInputState).
+				Add(rasterizationState).
+				Add(alphaBlendColorBlendState).
+				Add(depthStencilState).
+				Add(viewportState).
+				Add(multisampleState).
+				Add(s1_dynamicState).
+				Add(renderPass);
+
+			return true;
+		}
+
+		return false;
+	}
+
+	bool VKNBatchDrawEffect::SetupDynamicAlphaBlendShader(const VKNShaderPtr& shaderPtr, const VKNEffectState& es)
+	{
+		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState =
+			VulkanHelper::InitPipelineInputAssemblyStateCreateInfo(
+			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+			0,
+			VK_FALSE);
+
+		VkPipelineRasterizationStateCreateInfo rasterizationState =
+			VulkanHelper::InitPipelineRasterizationStateCreateInfo(
+			VK_POLYGON_MODE_FILL,
+			VK_CULL_MODE_BACK_BIT,
+			VK_FRONT_FACE_COUNTER_CLOCKWISE,
+			0);
+
+		VkPipelineColorBlendAttachmentState alphaBlendAttachmentState
+		{
+			VK_TRUE,							// blendEnable
+			VK_BLEND_FACTOR_ONE,				// srcColorBlendFactor
+			VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA/*VK_BLEND_FACTOR_ZERO*/,// dstColorBlendFactor
+			VK_BLEND_OP_ADD,					// colorBlendOp
+			VK_BLEND_FACTOR_ONE,				// srcAlphaBlendFactor
+			VK_BLEND_FACTOR_ZERO,				// dstAlphaBlendFactor
+			VK_BLEND_OP_ADD,					// alphaBlendOp
+			VK_COLOR_COMPONENT_R_BIT |
+			VK_COLOR_COMPONENT_G_BIT |
+			VK_COLOR_COMPONENT_B_BIT |
+			VK_COLOR_COMPONENT_A_BIT			// colorWriteMask
+		};
+
+		std::vector<VkPipelineColorBlendAttachmentState> alphaBlendColorBlendStates;
+		if (m_oitTargetsPtr)
+		{
+			// accumulation and revealage instead of the final color
+			alphaBlendColorBlendStates.push_back(VKNOITTargets::GetAccumBlendState());
+			alphaBlendColorBlendStates.push_back(VKNOITTargets::GetRevealageBlendState());
+		}
+		else
+		{
+			alphaBlendColorBlendStates.push_back(alphaBlendAttachmentState);
+		}
+
+		VkPipelineColorBlendStateCreateInfo alphaBlendColorBlendState
+		{
+			VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+			0,									// pNext
+			0,									// flags
+			VK_FALSE,							// logicOpEnable
+			VK_LOGIC_OP_CLEAR,					// logicOp
+			static_cast<uint32_t>(alphaBlendColorBlendStates.size()),	// attachmentCount
+			alphaBlendColorBlendStates.data(),	// pAttachments
+			{ 1.f, 1.f, 1.f, 1.f }				// blend constants
+		};
+
+		FrameBufferObjectPtr fboAlphaBlendPtr = es.GetFinalFrameBufferObject();		
+		assert(fboAlphaBlendPtr);
+
+		if (!fboAlphaBlendPtr)
+		{
+			return false;
+		}
+
+		std::vector<VkPipelineColorBlendAttachmentState> colorBlendStates;
+
+		VkPipelineDepthStencilStateCreateInfo depthStencilState =
+			VulkanHelper::InitPipelineDepthStencilStateCreateInfo(
+			VK_TRUE,
+			VK_FALSE,
+			VK_COMPARE_OP_LESS_OR_EQUAL);
+
+		VkPipelineViewportStateCreateInfo viewportState =
+			VulkanHelper::InitPipelineViewportStateCreateInfo(1, 1, 0);
+
+		VkPipelineMultisampleStateCreateInfo multisampleState =
+			VulkanHelper::InitPipelineMultisampleStateCreateInfo(
+			VK_SAMPLE_COUNT_1_BIT,
+			0);
+
+		if (shaderPtr)
+		{
+			// NOTE: the layout and binding info is taken from the desired shaders and 
+			// uniform blocks to determine how descriptor sets are formatted
+			VKNDescriptorSetBuilder& dsBuilder = shaderPtr->GetDescriptorSetBuilder();
+
+			//layout(std140, binding = 0) uniform ProjViewBuf (or push_constant)
+			AddCameraLayout(shaderPtr);
+
+			//layout(binding = 1) uniform sampler2DArray textureMaps;
+			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				VK_SHADER_STAGE_FRAGMENT_BIT,
+				1);
+
+			AddCameraWrite(dsBuilder);
+
+			if (m_texPackPtr)
+			{
+				VKNTexturePackPtr vknTexPackPtr = std::dynamic_pointer_cast<VKNTexturePack, TexturePack>(m_texPackPtr);
+				if (vknTexPackPtr)
+				{
+					TextureObject* pTexObj = vknTexPackPtr->GetTextureHandle();
+					assert(pTexObj);
+					if (pTexObj)
+					{
+						dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+							1,
+							0,
+							*pTexObj);
+					}
+				}
+			}
+
+			// NOTE: the renderpass you use here needs to preserve existing color attachments,
+			// not clear or ignore them. The OIT pass clears its own targets instead
+			VkRenderPass renderPass = m_oitTargetsPtr ? m_oitTargetsPtr->GetRenderPass() : fboAlphaBlendPtr->renderPass;
+			assert(renderPass);
+			VKNPipelineBuilder& pipelineBuilder = shaderPtr->GetPipelineBuilder();
+			pipelineBuilder.Add(inputAssemblyState).
+				Add(s_vertexInputState).
+				Add(rasterizationState).
+				Add(alphaBlendColorBlendState).
+				Add(depthStencilState).
+				Add(viewportState).
+				Add(multisampleState).
+				Add(s1_dynamicState).
+				Add(renderPass);
+
+			return true;
+		}
+
+		return false;
+	}
+
+	bool VKNBatchDrawEffect::FakePrePass(int pass, const EffectStatePtr& esPtr)
+	{
+		m_currentPass = pass;
+		if (!m_cachedShaderPtrs[0])
+		{
+			m_cachedShaderPtrs[0] = m_renderer.GetShaderProgram(m_materialList[0]);
+
+			VulkanRenderContext& context = static_cast<VulkanRenderContext&>(*m_renderer.GetRenderContext());
+			uint32_t swapChainCount = context.GetSwapChainImageCount();
+			assert(swapChainCount > 0);
+
+			assert(esPtr);
+			if(!esPtr)
+			{
+				Log::PrintError("VKNBatchDrawEffect::FakePrePass() EffectStatePtr is NULL! Cannot continue!");
+				return false;
+			}
+
+			const VKNEffectState& effectState = (esPtr->GetType() == EffectState::kDerived) ?
+				static_cast<const VKNEffectState&>(*esPtr) :
+				VKNEffectState(nullptr);
+
+			VKNShaderPtr shaderPtr = std::dynamic_pointer_cast<VKNShader, Shader>(m_cachedShaderPtrs[0]);
+			if (shaderPtr)
+			{
+				RenderCheckOK(FakeSetupShader(shaderPtr, effectState));
+			}
+		}
+
+		// if we have open bindings, close them
+		RenderCheckOK(CheckBuffers());
+
+		return true;
+	}
+
+	bool VKNBatchDrawEffect::FakeDraw(const Graphics::CameraDrawInfo& cdi, const Graphics::RenderStateInfo& rsi)
+	{
+		int shaderIndex = 0;
+		assert(m_dynamicMultiDrawObjectPtr);
+		MultiDrawPtr drawPtr = m_dynamicMultiDrawObjectPtr;
+		if (drawPtr)
+		{
+			VKNShaderPtr currentShader = std::dynamic_pointer_cast<VKNShader, Shader>(m_cachedShaderPtrs[shaderIndex]);
+			assert(currentShader);
+			if (currentShader)
+			{
+				RenderCheckOK(UpdateUniforms(cdi, rsi, currentShader));
+
+				// start recording
+
+				m_renderer.SetActiveShaderProgram(currentShader);
+
+				// we set the shader here as well because static multidraw type needs
+				// to access uniform 'worldMat' to set it per object reference
+				drawPtr->SetShader(currentShader);
+				// the array buffer and texture array linking to shader state is done
+				// within this call
+				RenderCheckOK(drawPtr->Render());
+
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool VKNBatchDrawEffect::FakePostPass()
+	{
+		if (m_currentPass > -1)
+		{
+			return true;
+		}
+
+		return false;
+	}
+
+	bool VKNBatchDrawEffect::FakeSetupShader(const VKNShaderPtr& shaderPtr, const VKNEffectState& effectState)
+	{
+		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState =
+			VulkanHelper::InitPipelineInputAssemblyStateCreateInfo(
+			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+			0,
+			VK_FALSE);
+
+		VkPipelineRasterizationStateCreateInfo rasterizationState =
+			VulkanHelper::InitPipelineRasterizationStateCreateInfo(
+			VK_POLYGON_MODE_FILL,
+			VK_CULL_MODE_BACK_BIT,
+			VK_FRONT_FACE_COUNTER_CLOCKWISE,
+			0);
+
+		VkPipelineColorBlendAttachmentState blendAttachmentState =
+			VulkanHelper::InitPipelineColorBlendAttachmentState(
+			0xf,
+			VK_FALSE);
+
+		VkPipelineColorBlendStateCreateInfo colorBlendState{};
+
+		auto& defaultFBOs = effectState.GetDefaultFrameBufferObjects();
+		assert(!defaultFBOs.empty());
+
+		if(defaultFBOs.empty())
+		{
+			return false;
+		}
+
+		std::vector<VkPipelineColorBlendAttachmentState> colorBlendStates;
+
+		const FrameBufferObject* pFBO = defaultFBOs[0];
+		if (pFBO)
+		{
+			for(auto& entry : pFBO->textureObjectInfos)
+			{
+				colorBlendStates.push_back(entry.colorBlendState);
+			}
+
+			colorBlendState =
+				VulkanHelper::InitPipelineColorBlendStateCreateInfo(
+				static_cast<uint32_t>(colorBlendStates.size()),
+				colorBlendStates.data());
+		}
+		else
+		{
+			VkPipelineColorBlendStateCreateInfo colorBlendState =
+				VulkanHelper::InitPipelineColorBlendStateCreateInfo(
+				1,
+				&blendAttachmentState);
+		}
+
+		VkPipelineDepthStencilStateCreateInfo depthStencilState =
+			VulkanHelper::InitPipelineDepthStencilStateCreateInfo(
+			VK_TRUE,
+			VK_TRUE,
+			VK_COMPARE_OP_LESS_OR_EQUAL);
+
+		VkPipelineViewportStateCreateInfo viewportState =
+			VulkanHelper::InitPipelineViewportStateCreateInfo(1, 1, 0);
+
+		VkPipelineMultisampleStateCreateInfo multisampleState =
+			VulkanHelper::InitPipelineMultisampleStateCreateInfo(
+			VK_SAMPLE_COUNT_1_BIT,
+			0);
+
+		if (shaderPtr)
+		{
+			// TODO: look at the desired shaders and uniform blocks to determine
+			// how descriptor sets are formatted
+			VKNDescriptorSetBuilder& dsBuilder = shaderPtr->GetDescriptorSetBuilder();
+
+			//layout(std140, binding = 0) uniform ProjViewBuf (or push_constant)
+			AddCameraLayout(shaderPtr);
+
+			//layout(binding = 1) uniform sampler2DArray textureMaps;
+			dsBuilder.AddToLayout(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				VK_SHADER_STAGE_FRAGMENT_BIT,
+				1);
+
+			AddCameraWrite(dsBuilder);
+
+			if (m_texPackPtr)
+			{
+				VKNTexturePackPtr vknTexPackPtr = std::dynamic_pointer_cast<VKNTexturePack, TexturePack>(m_texPackPtr);
+				if (vknTexPackPtr)
+				{
+					TextureObject* pTexObj = vknTexPackPtr->GetTextureHandle();
+					assert(pTexObj);
+					if (pTexObj)
+					{
+						dsBuilder.AddToWriteDescriptorSet(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+							1,
+							0,
+							*pTexObj);
+					}
+				}
+			}
+
+			assert(defaultFBOs[0]->renderPass);
+			VKNPipelineBuilder& pipelineBuilder = shaderPtr->GetPipelineBuilder();
+			pipelineBuilder.Add(inputAssemblyState).
+				Add(s_vertexInputState).
+				Add(rasterizationState).
+				Add(colorBlendState).
+				Add(depthStencilState).
+				Add(viewportState).
+				Add(multisampleState).
+				Add(s1_dynamicState).
+				Add(defaultFBOs[0]->renderPass);
+
+			return true;
+		}
+
+		return false;
+	}
+}
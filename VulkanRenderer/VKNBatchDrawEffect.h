@@ -1,125 +1,356 @@
-// VKNBatchDrawEffect.h
-// Vulkan implementation derived from BatchDrawEffect
-// Using the power of TextureArrays and large vertex buffers, this type is intended to allow
-// rendering of many animated vertex objects with fewer draw calls
-#pragma once
-#ifndef VKN_BATCH_DRAW_EFFECT_H
-#define VKN_BATCH_DRAW_EFFECT_H
-
-#include "VKNDescriptorSetBuilder.h"
-#include "VKNPipelineBuilder.h"
-#include "BufferMemoryHelper.h"
-#include "VKNEffectState.h"
-
-#include "../Renderer/BatchDrawEffect.h"
-
-namespace GamePrototype
-{
-    class IVKNMultiDraw;
-    typedef std::shared_ptr<IVKNMultiDraw> VKNMultiDrawPtr;
-
-    class VKNBatchDrawEffect : public BatchDrawEffect
-    {
-    public:
-        explicit VKNBatchDrawEffect(const EffectInitInfo&);
-
-    protected:
-
-        // IEffect
-        virtual ~VKNBatchDrawEffect() override;
-        virtual bool Init() override;
-        virtual int NumPasses() const override;
-        virtual bool PrePass(int, const EffectStatePtr&) override;
-        virtual bool Collect(const Graphics::RenderObjectPtr&) override;
-        virtual bool Collect(const std::vector<Graphics::RenderObjectPtr>&) override;
-        virtual bool Collect(const Graphics::SceneNodePtr&) override;
-        virtual bool Draw(const Graphics::CameraDrawInfo&, const Graphics::RenderStateInfo&, const EffectStatePtr&) override;
-        virtual bool PostPass(const EffectStatePtr&) override;
-        virtual void ClearForNextFrame() override;
-        virtual int GetID() const override;
-        virtual void Free() override;
-        virtual int GetEffectType() const override;
-        virtual bool PostSceneGraph() override;
-
-    private:
-
-        bool DrawStaticPass(const Graphics::CameraDrawInfo&, const Graphics::RenderStateInfo&);
-        bool DrawDynamicPass(const Graphics::CameraDrawInfo&, const Graphics::RenderStateInfo&);
-
-        bool CheckBuffers();
-
-        bool UpdateUniforms(const Graphics::CameraDrawInfo&, const Graphics::RenderStateInfo&);
-
-        bool CreateMemBufferHelpers();
-
-        bool SetupStaticShadowShader(const VKNShaderPtr&, const VKNEffectState&);
-        bool SetupStaticShader(const VKNShaderPtr&, const VKNEffectState&);
-        bool SetupDynamicShadowShader(const VKNShaderPtr&, const VKNEffectState&);
-        bool SetupDynamicShader(const VKNShaderPtr&, const VKNEffectState&);
-        bool SetupStaticAlphaBlendShader(const VKNShaderPtr&, const VKNEffectState&);
-        bool SetupDynamicAlphaBlendShader(const VKNShaderPtr&, const VKNEffectState&);
-
-        // sanity testing
-        bool FakePrePass(int, const EffectStatePtr&);
-        bool FakeDraw(const Graphics::CameraDrawInfo&, const Graphics::RenderStateInfo&);
-        bool FakePostPass();
-        bool FakeSetupShader(const VKNShaderPtr&, const VKNEffectState&);
-        int FakeNumPasses() const { return 1; }
-
-        VKNMultiDrawPtr                            m_dynamicMultiDrawObjectPtr;
-        VKNMultiDrawPtr                            m_staticMultiDrawObjectPtr;
-        VKNMultiDrawPtr                            m_alphaDynamicMultiDrawObjectPtr;
-        VKNMultiDrawPtr                            m_alphaStaticMultiDrawObjectPtr;
-        int                                        m_id;
-        int                                        m_currentPass;
-        const int                                  m_effectType;            // IEffectMgr::EffectType enum
-        std::vector<ShaderPtr>                     m_cachedShaderPtrs;
-        bool                                       m_bIsFirstDynamic;
-        bool                                       m_bIsFirstStatic;
-        bool                                       m_bIsFirstAlphaDynamic;
-        bool                                       m_bIsFirstAlphaStatic;
-        bool                                       m_bIsInitialized;
-        TexturePackPtr                             m_texPackPtr;
-        std::vector<DrawPackageDataPtr>            m_staticPackages;
-        std::vector<DrawPackageDataPtr>            m_dynamicPackages;
-        bool                                       m_bSetStaticPackages;
-        bool                                       m_bSetDynamicPackages;
-
-        // this type does need its own pipeline to bind to shaders used locally
-        VKNPipelineBuilder                        m_pipelineBuilder;
-
-        // DescriptorSet (texturePack & uniform buffer for shader vars)
-        // binding = 0
-        struct UniformData
-        {
-            /* 
-                TODO: whatever uniform data each shader needs can be added to this struct,
-                and copied to mapped buffer memory and bound to the command buffer.
-                Just make sure your alignments (OpenGL std 140?) are correct.
-            */
-            float viewCam[Math::mat4::MAT4_SIZE];
-            float projCam[Math::mat4::MAT4_SIZE];
-
-            UniformData()
-            :
-            viewCam{},
-            projCam{}
-            {
-                memcpy(viewCam, Math::mat4::Identity().Get(), Math::mat4::MAT4_SIZE*sizeof(float));
-                memcpy(projCam, Math::mat4::Identity().Get(), Math::mat4::MAT4_SIZE*sizeof(float));
-            }
-
-            static bool Register(BufferMemoryHelper<UniformData>& bmh)
-            {
-                CheckOK(bmh.RegisterMember(IBufferMemoryHelper::kMemberType_Mat4, "viewCam", offsetof(UniformData, viewCam)));
-                CheckOK(bmh.RegisterMember(IBufferMemoryHelper::kMemberType_Mat4, "projCam", offsetof(UniformData, projCam)));
-                return true;
-            }
-        };
-
-        BufferMemoryHelperPtr m_uniformMemHelperPtr;
-
-        static const int VERTEX_BUFFER_BIND_ID = 0;
-    };
-}
-#endif // VKN_BATCH_DRAW_EFFECT_H
+// VKNBatchDrawEffect.h
+// Vulkan implementation derived from BatchDrawEffect
+// Using the power of TextureArrays and large vertex buffers, this type is intended to allow
+// rendering of many animated vertex objects with fewer draw calls
+#pragma once
+#ifndef VKN_BATCH_DRAW_EFFECT_H
+#define VKN_BATCH_DRAW_EFFECT_H
+
+#include "VKNDescriptorSetBuilder.h"
+#include "VKNPipelineBuilder.h"
+#include "BufferMemoryHelper.h"
+#include "BufferMemberHandle.h"
+#include "VKNEffectState.h"
+#include "VKNComputeSkinner.h"
+#include "VKNDrawCommandRing.h"
+#include "VKNGPUCuller.h"
+#include "VKNOITTargets.h"
+#include "VKNPipelineCache.h"
+#include "VKNUniformRing.h"
+
+#include "../Renderer/BatchDrawEffect.h"
+#include "../Renderer/InstanceTransform.h"
+
+namespace GamePrototype
+{
+    class IVKNMultiDraw;
+    typedef std::shared_ptr<IVKNMultiDraw> VKNMultiDrawPtr;
+
+    class VKNBatchDrawEffect : public BatchDrawEffect
+    {
+    public:
+        explicit VKNBatchDrawEffect(const EffectInitInfo&);
+
+        // The Record*() and OIT calls below are made by the renderer while it records a frame, each only when
+        // its feature is on. After Collect() and PostSceneGraph(), in this order:
+        //   outside a render pass      RecordComputeSkinning(), then RecordGPUCulling() with the main camera
+        //   GBuffer pass               the opaque Draw()s (with occlusion culling: the first phase)
+        //   outside a render pass      RecordGPUOcclusionRetest(), then the GBuffer pass again, loading,
+        //                              for the second phase
+        //   shadow passes              Draw() per light, anywhere after the skinning
+        //   BeginOITPass()             the translucent Draw()s, then EndOITPass()
+        //   final pass                 RecordOITComposite()
+        // and ClearForNextFrame() once the frame is submitted. The barriers between the compute passes and
+        // the draws are recorded by the calls themselves
+
+        // GPU driven culling: every frame's packages are handed to a VKNGPUCuller, which culls them in a
+        // compute pass and writes the indirect draws, each built by the draw command function (see
+        // SetDrawCommandFunc(), which has to be set). Draw() then draws the culler's output for every non
+        // shadow pass drawn with the camera given to RecordGPUCulling(), everything for the others. Fails
+        // while CPU frustum culling, LOD selection or depth sorting is on, which can not be turned on with it
+        // either. bDrawIndirectCount: the device has the drawIndirectCount feature enabled
+        bool SetGPUCulling(bool bEnable, const std::string& shaderPath, bool bDrawIndirectCount);
+        bool IsGPUCulling() const { return m_gpuCullerPtr != nullptr; }
+
+        // records this frame's culling dispatches. Outside a render pass, before the geometry passes
+        bool RecordGPUCulling(VkCommandBuffer, const Graphics::CameraDrawInfo&);
+
+        // the device was created with the multiDrawIndirect feature. Off (the default), the effect's indirect
+        // draws are recorded one command per vkCmdDrawIndirect(), and the GPU culler does not compact. Fails if
+        // the device does not support it. Set before SetGPUCulling()
+        bool SetMultiDrawIndirect(bool bEnabled);
+        bool IsMultiDrawIndirect() const { return m_bMultiDrawIndirect; }
+
+        // Hi-Z occlusion on top of GPU culling. The geometry pass is split in two: the first draws what was
+        // not hidden behind last frame's depth, RecordGPUOcclusionRetest() then rebuilds the depth pyramid from
+        // the GBuffer depth and picks out what was wrongly hidden, which the second draws (loading, not clearing,
+        // the GBuffer). Nothing that becomes visible pops in a frame late
+        bool SetOcclusionCulling(bool bEnable, const std::string& pyramidShaderPath = std::string());
+        bool IsOcclusionCulling() const { return m_gpuCullerPtr && m_gpuCullerPtr->IsOcclusion(); }
+
+        // between the two halves of the geometry pass, outside a render pass. imageIndex picks the swap chain
+        // image's GBuffer, whose depth must be in DEPTH_STENCIL_READ_ONLY_OPTIMAL
+        bool RecordGPUOcclusionRetest(VkCommandBuffer, const VKNEffectState&, uint32_t imageIndex);
+
+        // records a bin's indirect draw, with its IMultiDraw object's pipeline and vertex buffers bound.
+        // Draw() gets those bound through IVKNMultiDraw::RenderWith(const std::function<void(VkCommandBuffer)>&),
+        // not part of this tree: it must do what Render() does (pipeline, descriptor sets, push constants and
+        // vertex buffers on the current command buffer), then call the function with that command buffer
+        // instead of recording the draws it was fed. Returns false if it could not bind. DrawVisible() uses it too
+        void RecordGPUDraw(VkCommandBuffer, DrawPackageBins::BinIndex, VKNGPUCuller::Phase = VKNGPUCuller::kFirstPhase) const;
+
+        // GPU skinning of the dynamic packages: a VKNComputeSkinner poses their vertices in a compute pass,
+        // straight into the dynamic IMultiDraw objects' vertex buffers, instead of the CPU posing them every
+        // frame (skinned packages carry their vertices unposed). The function names a package's skinned mesh (AddSkinnedMesh()), its
+        // bone palette for this frame and its first vertex in its IMultiDraw object. false: not skinned.
+        // The skinned ranges must stay put between passes, so it fails while CPU frustum culling, LOD selection
+        // or depth sorting is on, and those refuse to turn on while it is. Call after Init()
+        struct SkinInstance
+        {
+            uint32_t                    meshId;
+            const float*                pBoneMatrices;      // the mesh's numBones column major 4x4s
+            uint32_t                    firstVertex;
+        };
+        typedef std::function<bool(const DrawPackageData&, SkinInstance&)> SkinInstanceFunc;
+        bool SetComputeSkinning(bool bEnable, const std::string& shaderPath, const VKNComputeSkinner::VertexLayout&,
+            uint32_t maxBindPoseVertices, const SkinInstanceFunc&);
+        bool IsComputeSkinning() const { return m_computeSkinnerPtr != nullptr; }
+
+        // bind pose of a skinned mesh, uploaded with the next RecordComputeSkinning()
+        bool AddSkinnedMesh(const std::vector<VKNComputeSkinner::SkinVertex>&, uint32_t numBones, uint32_t& meshId);
+
+        // records this frame's skinning dispatches. Outside a render pass, before the geometry passes
+        bool RecordComputeSkinning(VkCommandBuffer);
+
+        // CPU frustum culling, LOD selection and depth sorting run in the CPU culling path, none of them can be
+        // combined with GPU culling or compute skinning
+        virtual bool SetFrustumCulling(bool bEnable) override;
+        virtual bool SetLodSelection(bool bEnable) override;
+        virtual bool SetDepthSorting(bool bEnable) override;
+
+        // sets up and compiles all six pipelines ahead of the first frame (during loading), one job per
+        // pipeline on the worker pool (null: the effect's pool), so the first PrePass() has nothing left to
+        // do. Call after Init() on the render thread. Returns once the jobs are queued. doneFunc is called
+        // once all of them have finished, on a worker thread. The effect may already be gone by then, so it
+        // must not use it. A PrePass() arriving before that waits, and sets the pipelines up again itself if
+        // the warm-up failed
+        typedef std::function<void(bool bSucceeded)> WarmUpDoneFunc;
+        bool WarmUpPipelines(const EffectStatePtr&, const WarmUpDoneFunc& doneFunc = WarmUpDoneFunc(), const WorkerPoolPtr& = WorkerPoolPtr());
+        bool IsWarmUpDone() const;
+
+        // false if any pipeline of the last warm-up failed. Reported once, a later warm-up starts clean
+        bool WaitForWarmUp();
+
+        // the effect's pipelines are compiled through a VKNPipelineCache kept in this file between runs, loaded
+        // in Init() and saved in Free(). Set before Init(). An empty path keeps the cache in memory only
+        void SetPipelineCacheFile(const std::string& filePath) { m_pipelineCacheFile = filePath; }
+
+        // encoding of the static instance buffers' world matrices (see InstanceTransform). The static shaders
+        // have to be built with the matching BATCH_DRAW_INSTANCE_FORMAT (Shaders/BatchDrawInstances.glsl). Set before Init()
+        void SetInstanceTransformFormat(InstanceTransform::Format format) { m_instanceFormat = format; }
+        InstanceTransform::Format GetInstanceTransformFormat() const { return m_instanceFormat; }
+
+        // hits and misses count the pipelines of the first frame as one batch: a hit when none of them had
+        // to be compiled
+        VKNPipelineCache::Stats GetPipelineCacheStats() const;
+
+        // weighted blended order independent transparency for the alpha passes (see VKNOITTargets). The
+        // translucent Draw()s are recorded between BeginOITPass() and EndOITPass() rather than in the final
+        // pass, and RecordOITComposite() blends their result in the final pass afterwards. The alpha
+        // materials' fragment shaders write through WriteOIT() (Shaders/BatchDrawOIT.glsl). Pipelines are
+        // built in the first PrePass(), so the mode has to be picked before that. Alpha packages are no
+        // longer depth sorted
+        struct OITInfo
+        {
+            VkFormat                    depthFormat;                    // of the GBuffer depth
+            std::string                 compositeVertexShaderPath;      // SPIR-V of BatchDrawOITComposite_VS.vert
+            std::string                 compositeFragmentShaderPath;    // SPIR-V of BatchDrawOITComposite_FS.frag
+
+            OITInfo() : depthFormat(VK_FORMAT_UNDEFINED) {}
+        };
+        bool SetOITMode(bool bEnable, const OITInfo& = OITInfo());
+        bool IsOITMode() const { return m_bOITMode; }
+
+        // camera matrices (UniformData) as vertex stage push constants instead of uniform buffer binding 0.
+        // Every Draw() records its own camera, so passes with a camera of their own (per light shadow passes)
+        // write no buffer at all. The shaders declare the camera through Shaders/BatchDrawCamera.glsl with
+        // BATCH_DRAW_PUSH_CAMERA defined. Pipeline layouts depend on it, pick it before the first PrePass()
+        bool SetPushConstantCamera(bool bEnable);
+        bool IsPushConstantCamera() const { return m_bPushConstantCamera; }
+
+        // imageIndex picks the swap chain image's GBuffer, whose depth must be in DEPTH_STENCIL_READ_ONLY_OPTIMAL
+        bool BeginOITPass(VkCommandBuffer, const VKNEffectState&, uint32_t imageIndex);
+        void EndOITPass(VkCommandBuffer);
+
+        // inside the final pass, after EndOITPass()
+        bool RecordOITComposite(VkCommandBuffer, uint32_t imageIndex);
+
+    protected:
+
+        // IEffect
+        virtual ~VKNBatchDrawEffect() override;
+        virtual bool Init() override;
+        virtual int NumPasses() const override;
+        virtual bool PrePass(int, const EffectStatePtr&) override;
+        virtual bool Collect(const Graphics::RenderObjectPtr&) override;
+        virtual bool Collect(const std::vector<Graphics::RenderObjectPtr>&) override;
+        virtual bool Collect(const Graphics::SceneNodePtr&) override;
+        virtual bool Draw(const Graphics::CameraDrawInfo&, const Graphics::RenderStateInfo&, const EffectStatePtr&) override;
+        virtual bool PostPass(const EffectStatePtr&) override;
+        virtual void ClearForNextFrame() override;
+        virtual int GetID() const override;
+        virtual void Free() override;
+        virtual int GetEffectType() const override;
+        virtual bool PostSceneGraph() override;
+
+        // BatchDrawEffect
+        virtual DrawPackagePtr BuildDrawPackage(const Graphics::RenderObjectPtr&) override;
+
+    private:
+
+        bool DrawStaticPass(const Graphics::CameraDrawInfo&, const Graphics::RenderStateInfo&);
+        bool DrawDynamicPass(const Graphics::CameraDrawInfo&, const Graphics::RenderStateInfo&);
+
+        // draws the bin's visible set (culling in Draw()) from its command region, written first when bChanged
+        bool DrawVisible(const VKNMultiDrawPtr&, DrawPackageBins::BinIndex, bool bChanged);
+
+        // the pass is drawn from the GPU culler's output: not a shadow pass, and the camera it culled against
+        bool IsGPUCulledPass(const Graphics::CameraDrawInfo&, const Graphics::RenderStateInfo&) const;
+
+        bool CheckBuffers();
+        bool UpdateStaticBuffers();
+        void UpdateGPUCullInstances();
+        void AddGPUCullInstance(const DrawPackageData&, uint32_t instance, const BoundingSphere&);
+        void UpdateSkinInstances();
+
+        // points the shader's binding 0 at this frame's slice for the camera, written on first use
+        bool UpdateUniforms(const Graphics::CameraDrawInfo&, const Graphics::RenderStateInfo&, const VKNShaderPtr&);
+
+        bool CreateMemBufferHelpers();
+
+        // resolves m_cachedShaderPtrs and readies the shaders, on the render thread
+        bool PrepareShaders(const VKNEffectState&);
+        // the Setup function of a MyShaderPassIndex. Shaders may be set up on different threads at once
+        bool SetupShader(int shaderIndex, const VKNShaderPtr&, const VKNEffectState&);
+
+        bool SetupStaticShadowShader(const VKNShaderPtr&, const VKNEffectState&);
+        bool SetupStaticShader(const VKNShaderPtr&, const VKNEffectState&);
+        bool SetupDynamicShadowShader(const VKNShaderPtr&, const VKNEffectState&);
+        bool SetupDynamicShader(const VKNShaderPtr&, const VKNEffectState&);
+        bool SetupStaticAlphaBlendShader(const VKNShaderPtr&, const VKNEffectState&);
+        bool SetupDynamicAlphaBlendShader(const VKNShaderPtr&, const VKNEffectState&);
+
+        // binding 0 (the camera) of a Setup function's shader, or its push constant range
+        void AddCameraLayout(const VKNShaderPtr&);
+        void AddCameraWrite(VKNDescriptorSetBuilder&);
+
+        // sanity testing
+        bool FakePrePass(int, const EffectStatePtr&);
+        bool FakeDraw(const Graphics::CameraDrawInfo&, const Graphics::RenderStateInfo&);
+        bool FakePostPass();
+        bool FakeSetupShader(const VKNShaderPtr&, const VKNEffectState&);
+        int FakeNumPasses() const { return 1; }
+
+        VKNMultiDrawPtr                            m_dynamicMultiDrawObjectPtr;
+        VKNMultiDrawPtr                            m_staticMultiDrawObjectPtr;
+        VKNMultiDrawPtr                            m_alphaDynamicMultiDrawObjectPtr;
+        VKNMultiDrawPtr                            m_alphaStaticMultiDrawObjectPtr;
+        // builder inputs, filled once in Init()
+        std::vector<MultiDrawPtr>                  m_dynamicDrawList;
+        std::vector<MultiDrawPtr>                  m_staticDrawList;
+        int                                        m_id;
+        int                                        m_currentPass;
+        const int                                  m_effectType;            // IEffectMgr::EffectType enum
+        std::vector<ShaderPtr>                     m_cachedShaderPtrs;
+        bool                                       m_bIsFirstDynamic;
+        bool                                       m_bIsFirstStatic;
+        bool                                       m_bIsFirstAlphaDynamic;
+        bool                                       m_bIsFirstAlphaStatic;
+        bool                                       m_bIsInitialized;
+        TexturePackPtr                             m_texPackPtr;
+        bool                                       m_bSetStaticPackages;
+        bool                                       m_bSetDynamicPackages;
+
+        VKNGPUCullerPtr                            m_gpuCullerPtr;
+        std::vector<VKNGPUCuller::Instance>        m_gpuCullInstances;      // scratch, one bin at a time
+        float                                      m_gpuCullView[Math::mat4::MAT4_SIZE];   // this frame's RecordGPUCulling()
+        float                                      m_gpuCullProj[Math::mat4::MAT4_SIZE];
+        bool                                       m_bGPUCullRecorded;
+        VKNGPUCuller::Phase                        m_gpuDrawPhase;          // second once the occlusion re-test is recorded
+        bool                                       m_bMultiDrawIndirect;
+
+        // the draw commands of the visible sets, one region per set written this frame
+        struct CommandRegion
+        {
+            VkDeviceSize                offset;
+            uint32_t                    count;
+        };
+
+        VKNDrawCommandRingPtr                      m_drawCommandRingPtr;
+        CommandRegion                              m_commandRegions[s_kNumCommandSets][DrawPackageBins::kMaxBins];   // see GetCommandSet()
+        std::vector<DrawCommand>                   m_drawCommands;          // scratch
+
+        VKNComputeSkinnerPtr                       m_computeSkinnerPtr;
+        SkinInstanceFunc                           m_skinInstanceFunc;
+
+        std::string                                m_pipelineCacheFile;
+        VKNPipelineCachePtr                        m_pipelineCachePtr;
+        size_t                                     m_pipelineCacheSizeBefore;   // when the pipelines were set up
+        bool                                       m_bCountPipelineCache;
+
+        mutable std::mutex                         m_warmUpMutex;
+        std::condition_variable                    m_warmUpDoneCondition;
+        size_t                                     m_numWarmUpJobs;         // guarded by m_warmUpMutex
+        bool                                       m_bWarmUpFailed;         // guarded by m_warmUpMutex
+
+        OITInfo                                    m_oitInfo;
+        VKNOITTargetsPtr                           m_oitTargetsPtr;         // made in PrePass() when m_bOITMode
+        bool                                       m_bOITMode;
+        bool                                       m_bPushConstantCamera;
+        InstanceTransform::Format                  m_instanceFormat;
+
+        // this type does need its own pipeline to bind to shaders used locally
+        VKNPipelineBuilder                        m_pipelineBuilder;
+
+        // DescriptorSet (texturePack & uniform buffer for shader vars)
+        // binding = 0
+        struct UniformData
+        {
+            /* 
+                TODO: whatever uniform data each shader needs can be added to this struct,
+                and copied to mapped buffer memory and bound to the command buffer.
+                Just make sure your alignments (OpenGL std 140?) are correct.
+            */
+            float viewCam[Math::mat4::MAT4_SIZE];
+            float projCam[Math::mat4::MAT4_SIZE];
+
+            UniformData()
+            :
+            viewCam{},
+            projCam{}
+            {
+                memcpy(viewCam, Math::mat4::Identity().Get(), Math::mat4::MAT4_SIZE*sizeof(float));
+                memcpy(projCam, Math::mat4::Identity().Get(), Math::mat4::MAT4_SIZE*sizeof(float));
+            }
+
+            // names for debugging and reflection, writes go through the handles below
+            static bool Register(BufferMemoryHelper<UniformData>& bmh)
+            {
+                CheckOK(bmh.RegisterMember(IBufferMemoryHelper::kMemberType_Mat4, "viewCam", offsetof(UniformData, viewCam)));
+                CheckOK(bmh.RegisterMember(IBufferMemoryHelper::kMemberType_Mat4, "projCam", offsetof(UniformData, projCam)));
+                return true;
+            }
+        };
+
+        typedef BufferMemberHandle<UniformData, float[Math::mat4::MAT4_SIZE], &UniformData::viewCam>   UniformViewCam;
+        typedef BufferMemberHandle<UniformData, float[Math::mat4::MAT4_SIZE], &UniformData::projCam>   UniformProjCam;
+
+        // the whole of UniformData fits the push constant space every device has
+        static_assert(sizeof(UniformData) <= 128, "UniformData too large for push constants");
+
+        // describes UniformData to the shaders, the data itself lives in m_uniformRingPtr
+        BufferMemoryHelperPtr m_uniformMemHelperPtr;
+
+        // one slice of m_uniformRingPtr per camera drawn this frame
+        struct CameraSlice
+        {
+            float           viewCam[Math::mat4::MAT4_SIZE];
+            float           projCam[Math::mat4::MAT4_SIZE];
+            uint32_t        dynamicOffset;
+        };
+
+        VKNUniformRingPtr                          m_uniformRingPtr;
+        std::vector<CameraSlice>                   m_cameraSlices;          // this frame's, reset in ClearForNextFrame()
+
+        // cameras (passes, shadow views) a frame can draw with
+        static const uint32_t s_kMaxCamerasPerFrame = 16;
+
+        // draw commands of all the visible sets a frame writes
+        static const uint32_t s_kMaxDrawCommandsPerFrame = 65536;
+
+        static_assert(sizeof(DrawCommand) == sizeof(VkDrawIndirectCommand), "DrawCommand does not match VkDrawIndirectCommand");
+
+        static const int VERTEX_BUFFER_BIND_ID = 0;
+    };
+}
+#endif // VKN_BATCH_DRAW_EFFECT_H
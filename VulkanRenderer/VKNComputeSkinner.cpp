@@ -0,0 +1,608 @@
+// VKNComputeSkinner.cpp
+#include "stdafx.h"
+#include "VKNComputeSkinner.h"
+#include "VKNComputeUtils.h"
+#include "VulkanRenderContext.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace GamePrototype
+{
+	const uint32_t VKNComputeSkinner::s_kMaxGroups;
+	const uint32_t VKNComputeSkinner::s_kNoNormal;
+	const uint32_t VKNComputeSkinner::s_kLocalSize;
+	const uint32_t VKNComputeSkinner::s_kMinBones;
+	const uint32_t VKNComputeSkinner::s_kMinJobs;
+	const uint32_t VKNComputeSkinner::s_kNumBindings;
+
+	VKNComputeSkinner::FrameResources::FrameResources()
+	:
+	descriptorSets{},
+	vertexBuffers{},
+	boneCapacity(0),
+	jobCapacity(0),
+	firstJob{},
+	maxVertices{}
+	{
+	}
+
+	VKNComputeSkinner::VKNComputeSkinner(VulkanRenderContext& context)
+	:
+	m_context(context),
+	m_currentFrame(0),
+	m_bindPoseCapacity(0),
+	m_numBindPoseVertices(0),
+	m_numUploadedVertices(0),
+	m_descriptorSetLayout(VK_NULL_HANDLE),
+	m_descriptorPool(VK_NULL_HANDLE),
+	m_pipelineLayout(VK_NULL_HANDLE),
+	m_pipeline(VK_NULL_HANDLE),
+	m_bIsInitialized(false)
+	{
+	}
+
+	VKNComputeSkinner::~VKNComputeSkinner()
+	{
+		Shutdown();
+	}
+
+	bool VKNComputeSkinner::Init(const std::string& shaderPath, const VertexLayout& layout, uint32_t maxBindPoseVertices)
+	{
+		if (m_bIsInitialized)
+		{
+			return true;
+		}
+
+		// the shader addresses the vertices as a float array
+		if (layout.stride == 0 || (layout.stride % 4) != 0 || (layout.positionOffset % 4) != 0 ||
+			layout.positionOffset + 3 * sizeof(float) > layout.stride ||
+			(layout.normalOffset != s_kNoNormal && ((layout.normalOffset % 4) != 0 || layout.normalOffset + 3 * sizeof(float) > layout.stride)))
+		{
+			Log::PrintError("VKNComputeSkinner::Init() invalid vertex layout!");
+			return false;
+		}
+
+		RenderCheckOK(maxBindPoseVertices > 0);
+
+		VkDevice device = m_context.GetDevice();
+		const uint32_t numFrames = m_context.GetSwapChainImageCount();
+		assert(numFrames > 0);
+
+		// binding 0: bind pose, 1: bone palettes, 2: jobs, 3: output vertices
+		VkDescriptorSetLayoutBinding bindings[s_kNumBindings] = {};
+		for (uint32_t i = 0; i < s_kNumBindings; ++i)
+		{
+			bindings[i].binding = i;
+			bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = s_kNumBindings;
+		layoutInfo.pBindings = bindings;
+		if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNComputeSkinner::Init() failed to create descriptor set layout!");
+			return false;
+		}
+
+		VkDescriptorPoolSize poolSize = {};
+		poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSize.descriptorCount = numFrames * s_kMaxGroups * s_kNumBindings;
+
+		VkDescriptorPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = numFrames * s_kMaxGroups;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+		if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNComputeSkinner::Init() failed to create descriptor pool!");
+			Shutdown();
+			return false;
+		}
+
+		if (!CreatePipeline(shaderPath))
+		{
+			Shutdown();
+			return false;
+		}
+
+		const VkDeviceSize bindPoseSize = static_cast<VkDeviceSize>(maxBindPoseVertices) * sizeof(SkinVertex);
+		if (!CreateBuffer(bindPoseSize,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				m_bindPoseBuffer) ||
+			!CreateBuffer(bindPoseSize,
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				m_stagingBuffer))
+		{
+			Log::PrintError("VKNComputeSkinner::Init() failed to create bind pose buffers!");
+			Shutdown();
+			return false;
+		}
+
+		m_frames.resize(numFrames);
+		for (auto& frame : m_frames)
+		{
+			VkDescriptorSetLayout setLayouts[s_kMaxGroups];
+			std::fill(setLayouts, setLayouts + s_kMaxGroups, m_descriptorSetLayout);
+
+			VkDescriptorSetAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			allocInfo.descriptorPool = m_descriptorPool;
+			allocInfo.descriptorSetCount = s_kMaxGroups;
+			allocInfo.pSetLayouts = setLayouts;
+			if (vkAllocateDescriptorSets(device, &allocInfo, frame.descriptorSets) != VK_SUCCESS ||
+				!ReserveFrame(frame, s_kMinBones, s_kMinJobs))
+			{
+				Log::PrintError("VKNComputeSkinner::Init() failed to create frame resources!");
+				Shutdown();
+				return false;
+			}
+		}
+
+		m_vertexLayout = layout;
+		m_bindPoseCapacity = maxBindPoseVertices;
+		m_numBindPoseVertices = 0;
+		m_numUploadedVertices = 0;
+		m_currentFrame = 0;
+		m_bIsInitialized = true;
+
+		return true;
+	}
+
+	void VKNComputeSkinner::Shutdown()
+	{
+		VkDevice device = m_context.GetDevice();
+
+		for (auto& frame : m_frames)
+		{
+			DestroyBuffer(frame.paletteBuffer);
+			DestroyBuffer(frame.jobBuffer);
+		}
+		m_frames.clear();
+
+		DestroyBuffer(m_bindPoseBuffer);
+		DestroyBuffer(m_stagingBuffer);
+		m_bindPoseCapacity = 0;
+		m_numBindPoseVertices = 0;
+		m_numUploadedVertices = 0;
+
+		m_meshes.clear();
+		m_palette.clear();
+		for (auto& jobs : m_jobs)
+		{
+			jobs.clear();
+		}
+
+		if (m_pipeline != VK_NULL_HANDLE)
+		{
+			vkDestroyPipeline(device, m_pipeline, nullptr);
+			m_pipeline = VK_NULL_HANDLE;
+		}
+
+		if (m_pipelineLayout != VK_NULL_HANDLE)
+		{
+			vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+			m_pipelineLayout = VK_NULL_HANDLE;
+		}
+
+		// the sets go with their pool
+		if (m_descriptorPool != VK_NULL_HANDLE)
+		{
+			vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
+			m_descriptorPool = VK_NULL_HANDLE;
+		}
+
+		if (m_descriptorSetLayout != VK_NULL_HANDLE)
+		{
+			vkDestroyDescriptorSetLayout(device, m_descriptorSetLayout, nullptr);
+			m_descriptorSetLayout = VK_NULL_HANDLE;
+		}
+
+		m_bIsInitialized = false;
+	}
+
+	bool VKNComputeSkinner::AddMesh(const std::vector<SkinVertex>& vertices, uint32_t numBones, uint32_t& meshId)
+	{
+		RenderCheckOK(m_bIsInitialized);
+		RenderCheckOK(!vertices.empty() && numBones > 0);
+
+		const uint32_t numVertices = static_cast<uint32_t>(vertices.size());
+		if (numVertices > m_bindPoseCapacity - m_numBindPoseVertices)
+		{
+			Log::PrintError("VKNComputeSkinner::AddMesh() bind pose buffer is full!");
+			return false;
+		}
+
+		for (const auto& vertex : vertices)
+		{
+			for (uint32_t i = 0; i < 4; ++i)
+			{
+				if (vertex.boneWeights[i] != 0.0f && vertex.boneIndices[i] >= numBones)
+				{
+					Log::PrintError("VKNComputeSkinner::AddMesh() bone index out of range!");
+					return false;
+				}
+			}
+		}
+
+		SkinVertex* pStaging = static_cast<SkinVertex*>(m_stagingBuffer.pMapped);
+		memcpy(pStaging + m_numBindPoseVertices, vertices.data(), vertices.size() * sizeof(SkinVertex));
+
+		Mesh mesh;
+		mesh.firstVertex = m_numBindPoseVertices;
+		mesh.numVertices = numVertices;
+		mesh.numBones = numBones;
+
+		meshId = static_cast<uint32_t>(m_meshes.size());
+		m_meshes.push_back(mesh);
+		m_numBindPoseVertices += numVertices;
+
+		return true;
+	}
+
+	void VKNComputeSkinner::BeginFrame()
+	{
+		if (!m_frames.empty())
+		{
+			m_currentFrame = (m_currentFrame + 1) % static_cast<uint32_t>(m_frames.size());
+		}
+
+		m_palette.clear();
+		for (auto& jobs : m_jobs)
+		{
+			jobs.clear();
+		}
+	}
+
+	bool VKNComputeSkinner::AddInstance(uint32_t group, uint32_t meshId, const float* pBoneMatrices, uint32_t firstVertex)
+	{
+		assert(group < s_kMaxGroups && meshId < m_meshes.size() && pBoneMatrices);
+		RenderCheckOK(group < s_kMaxGroups && meshId < m_meshes.size() && pBoneMatrices);
+
+		const Mesh& mesh = m_meshes[meshId];
+
+		Job job;
+		job.firstBindVertex = mesh.firstVertex;
+		job.numVertices = mesh.numVertices;
+		job.firstBone = static_cast<uint32_t>(m_palette.size() / 16);
+		job.firstOutputVertex = firstVertex;
+		m_jobs[group].push_back(job);
+
+		m_palette.insert(m_palette.end(), pBoneMatrices, pBoneMatrices + mesh.numBones * 16);
+
+		return true;
+	}
+
+	bool VKNComputeSkinner::RecordSkinning(VkCommandBuffer cmd, const BufferObject* const pVertexBuffers[s_kMaxGroups])
+	{
+		RenderCheckOK(m_bIsInitialized);
+
+		FrameResources& frame = m_frames[m_currentFrame];
+
+		uint32_t numJobs = 0;
+		for (uint32_t group = 0; group < s_kMaxGroups; ++group)
+		{
+			if (pVertexBuffers[group])
+			{
+				numJobs += static_cast<uint32_t>(m_jobs[group].size());
+			}
+		}
+
+		// meshes added since the last frame, even with nothing to skin yet
+		RecordBindPoseUpload(cmd);
+
+		if (numJobs == 0)
+		{
+			return true;
+		}
+
+		const uint32_t numBones = static_cast<uint32_t>(m_palette.size() / 16);
+		if (!ReserveFrame(frame, numBones, numJobs))
+		{
+			Log::PrintError("VKNComputeSkinner::RecordSkinning() failed to grow frame buffers!");
+			return false;
+		}
+
+		memcpy(frame.paletteBuffer.pMapped, m_palette.data(), m_palette.size() * sizeof(float));
+
+		Job* pJobs = static_cast<Job*>(frame.jobBuffer.pMapped);
+		uint32_t firstJob = 0;
+		VkBufferMemoryBarrier barriers[s_kMaxGroups] = {};
+		uint32_t numBarriers = 0;
+		for (uint32_t group = 0; group < s_kMaxGroups; ++group)
+		{
+			frame.firstJob[group] = firstJob;
+			frame.maxVertices[group] = 0;
+
+			const std::vector<Job>& jobs = m_jobs[group];
+			if (!pVertexBuffers[group] || jobs.empty())
+			{
+				continue;
+			}
+
+			memcpy(pJobs + firstJob, jobs.data(), jobs.size() * sizeof(Job));
+			firstJob += static_cast<uint32_t>(jobs.size());
+
+			for (const auto& job : jobs)
+			{
+				frame.maxVertices[group] = std::max(frame.maxVertices[group], job.numVertices);
+			}
+
+			const VkBuffer vertexBuffer = pVertexBuffers[group]->buffer;
+			if (frame.vertexBuffers[group] != vertexBuffer)
+			{
+				WriteDescriptorSet(frame, group, vertexBuffer);
+			}
+
+			// the previous frame's draws may still read the vertices, and the multi-draw uploads the other
+			// attributes with transfers
+			VkBufferMemoryBarrier& barrier = barriers[numBarriers++];
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.buffer = vertexBuffer;
+			barrier.offset = 0;
+			barrier.size = VK_WHOLE_SIZE;
+		}
+
+		vkCmdPipelineBarrier(cmd,
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0,
+			0, nullptr,
+			numBarriers, barriers,
+			0, nullptr);
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+
+		for (uint32_t group = 0; group < s_kMaxGroups; ++group)
+		{
+			if (frame.maxVertices[group] == 0)
+			{
+				continue;
+			}
+
+			SkinGroup skinGroup;
+			skinGroup.firstJob = frame.firstJob[group];
+			skinGroup.vertexStride = m_vertexLayout.stride / 4;
+			skinGroup.positionOffset = m_vertexLayout.positionOffset / 4;
+			skinGroup.normalOffset = (m_vertexLayout.normalOffset != s_kNoNormal) ? m_vertexLayout.normalOffset / 4 : s_kNoNormal;
+
+			// x: the job's vertices, y: one job per instance. Threads past a smaller job's end do nothing
+			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &frame.descriptorSets[group], 0, nullptr);
+			vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SkinGroup), &skinGroup);
+			vkCmdDispatch(cmd, (frame.maxVertices[group] + s_kLocalSize - 1) / s_kLocalSize, static_cast<uint32_t>(m_jobs[group].size()), 1);
+		}
+
+		// the skinned vertices are consumed by this frame's draws
+		for (uint32_t i = 0; i < numBarriers; ++i)
+		{
+			barriers[i].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			barriers[i].dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+		}
+
+		vkCmdPipelineBarrier(cmd,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+			0,
+			0, nullptr,
+			numBarriers, barriers,
+			0, nullptr);
+
+		return true;
+	}
+
+	uint32_t VKNComputeSkinner::GetNumInstances(uint32_t group) const
+	{
+		assert(group < s_kMaxGroups);
+		return (group < s_kMaxGroups) ? static_cast<uint32_t>(m_jobs[group].size()) : 0;
+	}
+
+	void VKNComputeSkinner::RecordBindPoseUpload(VkCommandBuffer cmd)
+	{
+		if (m_numUploadedVertices == m_numBindPoseVertices)
+		{
+			return;
+		}
+
+		VkBufferCopy region = {};
+		region.srcOffset = static_cast<VkDeviceSize>(m_numUploadedVertices) * sizeof(SkinVertex);
+		region.dstOffset = region.srcOffset;
+		region.size = static_cast<VkDeviceSize>(m_numBindPoseVertices - m_numUploadedVertices) * sizeof(SkinVertex);
+		vkCmdCopyBuffer(cmd, m_stagingBuffer.buffer, m_bindPoseBuffer.buffer, 1, &region);
+
+		VkBufferMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = m_bindPoseBuffer.buffer;
+		barrier.offset = region.dstOffset;
+		barrier.size = region.size;
+
+		vkCmdPipelineBarrier(cmd,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0,
+			0, nullptr,
+			1, &barrier,
+			0, nullptr);
+
+		// NOTE: the staged vertices are never rewritten, so nothing waits for the copy to finish
+		m_numUploadedVertices = m_numBindPoseVertices;
+	}
+
+	bool VKNComputeSkinner::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, Buffer& buffer)
+	{
+		VkDevice device = m_context.GetDevice();
+
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size;
+		bufferInfo.usage = usage;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer.buffer) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNComputeSkinner::CreateBuffer() failed to create buffer!");
+			return false;
+		}
+
+		VkMemoryRequirements memReqs;
+		vkGetBufferMemoryRequirements(device, buffer.buffer, &memReqs);
+
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = memReqs.size;
+		if (!VKNComputeUtils::FindMemoryType(m_context, memReqs.memoryTypeBits, properties, allocInfo.memoryTypeIndex) ||
+			vkAllocateMemory(device, &allocInfo, nullptr, &buffer.memory) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNComputeSkinner::CreateBuffer() failed to allocate memory!");
+			DestroyBuffer(buffer);
+			return false;
+		}
+
+		RenderCheckOK(vkBindBufferMemory(device, buffer.buffer, buffer.memory, 0) == VK_SUCCESS);
+		buffer.size = size;
+
+		// host visible buffers stay mapped for their lifetime
+		if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			RenderCheckOK(vkMapMemory(device, buffer.memory, 0, size, 0, &buffer.pMapped) == VK_SUCCESS);
+		}
+
+		return true;
+	}
+
+	void VKNComputeSkinner::DestroyBuffer(Buffer& buffer)
+	{
+		VkDevice device = m_context.GetDevice();
+
+		if (buffer.pMapped)
+		{
+			vkUnmapMemory(device, buffer.memory);
+		}
+
+		if (buffer.buffer != VK_NULL_HANDLE)
+		{
+			vkDestroyBuffer(device, buffer.buffer, nullptr);
+		}
+
+		if (buffer.memory != VK_NULL_HANDLE)
+		{
+			vkFreeMemory(device, buffer.memory, nullptr);
+		}
+
+		buffer = Buffer();
+	}
+
+	bool VKNComputeSkinner::ReserveFrame(FrameResources& frame, uint32_t numBones, uint32_t numJobs)
+	{
+		const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+		// NOTE: this frame's buffers were last used a full swap chain cycle ago, so they are free to replace
+		bool bReplaced = false;
+		if (numBones > frame.boneCapacity)
+		{
+			uint32_t capacity = (frame.boneCapacity > 0) ? frame.boneCapacity : s_kMinBones;
+			while (capacity < numBones)
+			{
+				capacity *= 2;
+			}
+
+			DestroyBuffer(frame.paletteBuffer);
+			frame.boneCapacity = 0;
+			RenderCheckOK(CreateBuffer(static_cast<VkDeviceSize>(capacity) * 16 * sizeof(float),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				hostVisible,
+				frame.paletteBuffer));
+			frame.boneCapacity = capacity;
+			bReplaced = true;
+		}
+
+		if (numJobs > frame.jobCapacity)
+		{
+			uint32_t capacity = (frame.jobCapacity > 0) ? frame.jobCapacity : s_kMinJobs;
+			while (capacity < numJobs)
+			{
+				capacity *= 2;
+			}
+
+			DestroyBuffer(frame.jobBuffer);
+			frame.jobCapacity = 0;
+			RenderCheckOK(CreateBuffer(static_cast<VkDeviceSize>(capacity) * sizeof(Job),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				hostVisible,
+				frame.jobBuffer));
+			frame.jobCapacity = capacity;
+			bReplaced = true;
+		}
+
+		// rewritten with the new buffers when next dispatched
+		if (bReplaced)
+		{
+			std::fill(frame.vertexBuffers, frame.vertexBuffers + s_kMaxGroups, VkBuffer(VK_NULL_HANDLE));
+		}
+
+		return true;
+	}
+
+	void VKNComputeSkinner::WriteDescriptorSet(FrameResources& frame, uint32_t group, VkBuffer vertexBuffer)
+	{
+		const VkBuffer buffers[s_kNumBindings] = { m_bindPoseBuffer.buffer, frame.paletteBuffer.buffer, frame.jobBuffer.buffer, vertexBuffer };
+
+		VkDescriptorBufferInfo bufferInfos[s_kNumBindings] = {};
+		VkWriteDescriptorSet writes[s_kNumBindings] = {};
+		for (uint32_t i = 0; i < s_kNumBindings; ++i)
+		{
+			bufferInfos[i].buffer = buffers[i];
+			bufferInfos[i].offset = 0;
+			bufferInfos[i].range = VK_WHOLE_SIZE;
+
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = frame.descriptorSets[group];
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].pBufferInfo = &bufferInfos[i];
+		}
+
+		vkUpdateDescriptorSets(m_context.GetDevice(), s_kNumBindings, writes, 0, nullptr);
+		frame.vertexBuffers[group] = vertexBuffer;
+	}
+
+	bool VKNComputeSkinner::CreatePipeline(const std::string& shaderPath)
+	{
+		VkDevice device = m_context.GetDevice();
+
+		VkPushConstantRange pushConstantRange = {};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(SkinGroup);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+		if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNComputeSkinner::CreatePipeline() failed to create pipeline layout!");
+			return false;
+		}
+
+		return VKNComputeUtils::CreateComputePipeline(m_context, shaderPath, m_pipelineLayout, m_pipeline);
+	}
+}
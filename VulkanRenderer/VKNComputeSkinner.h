@@ -0,0 +1,165 @@
+// VKNComputeSkinner.h
+// Compute pre-pass that poses the batch draw effect's animated vertices on the GPU. A skinned mesh's bind
+// pose (position, normal, up to four bone indices and weights per vertex) is uploaded once, to a device
+// local buffer. Every frame the CPU only writes the bone palettes (column major 4x4s) and one job per drawn
+// instance, to host visible buffers kept per swap chain image. BatchDrawSkin_CS.comp blends every vertex by
+// its bones and writes position and normal into the dynamic IMultiDraw objects' vertex buffers in place,
+// leaving the other attributes as they were uploaded.
+// Instances are split into groups (one per dynamic IMultiDraw object), each skinned by one dispatch into
+// its own vertex buffer
+#pragma once
+#ifndef VKN_COMPUTE_SKINNER_H
+#define VKN_COMPUTE_SKINNER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "VulkanHelper.h"
+
+namespace GamePrototype
+{
+    class VulkanRenderContext;
+
+    class VKNComputeSkinner
+    {
+    public:
+        // std430 layout of one bind pose vertex (BatchDrawSkin_CS SkinVertex)
+        struct SkinVertex
+        {
+            float                   position[4];        // w unused
+            float                   normal[4];          // w unused
+            uint32_t                boneIndices[4];     // into the mesh's palette
+            float                   boneWeights[4];     // summing to 1
+        };
+
+        // where position and normal (three floats each) sit in a vertex of the destination buffers.
+        // Bytes, multiples of 4
+        struct VertexLayout
+        {
+            uint32_t                stride;
+            uint32_t                positionOffset;
+            uint32_t                normalOffset;       // s_kNoNormal: the vertices have none
+
+            VertexLayout() : stride(0), positionOffset(0), normalOffset(s_kNoNormal) {}
+        };
+
+        static const uint32_t s_kMaxGroups = 2;
+        static const uint32_t s_kNoNormal = 0xffffffff;
+
+        explicit VKNComputeSkinner(VulkanRenderContext&);
+        ~VKNComputeSkinner();
+
+        VKNComputeSkinner(const VKNComputeSkinner&) = delete;
+        VKNComputeSkinner& operator=(const VKNComputeSkinner&) = delete;
+
+        // shaderPath: compiled SPIR-V of BatchDrawSkin_CS.comp. maxBindPoseVertices: room for the bind
+        // poses of every mesh added later
+        bool Init(const std::string& shaderPath, const VertexLayout&, uint32_t maxBindPoseVertices);
+        void Shutdown();
+
+        // stages a mesh's bind pose, uploaded by the next RecordSkinning(). numBones: its palette size
+        bool AddMesh(const std::vector<SkinVertex>&, uint32_t numBones, uint32_t& meshId);
+        uint32_t GetNumMeshes() const { return static_cast<uint32_t>(m_meshes.size()); }
+
+        // moves on to the next swap chain image's buffers. Call once per frame before AddInstance()
+        void BeginFrame();
+
+        // one drawn instance of a mesh this frame: its palette (the mesh's numBones matrices, column major)
+        // and where its vertices start in the group's vertex buffer
+        bool AddInstance(uint32_t group, uint32_t meshId, const float* pBoneMatrices, uint32_t firstVertex);
+
+        // uploads this frame's palettes and jobs and records the dispatches, skinning into each group's
+        // vertex buffer (null: the group is skipped). The buffers need VK_BUFFER_USAGE_STORAGE_BUFFER_BIT.
+        // Outside a render pass, before the draws reading the vertices
+        bool RecordSkinning(VkCommandBuffer, const BufferObject* const pVertexBuffers[s_kMaxGroups]);
+
+        uint32_t GetNumInstances(uint32_t group) const;
+
+    private:
+
+        struct Mesh
+        {
+            uint32_t                firstVertex;        // in the bind pose buffer
+            uint32_t                numVertices;
+            uint32_t                numBones;
+        };
+
+        // std430 (BatchDrawSkin_CS SkinJob)
+        struct Job
+        {
+            uint32_t                firstBindVertex;
+            uint32_t                numVertices;
+            uint32_t                firstBone;
+            uint32_t                firstOutputVertex;
+        };
+
+        // push constants (BatchDrawSkin_CS SkinGroup). Vertex layout in floats
+        struct SkinGroup
+        {
+            uint32_t                firstJob;
+            uint32_t                vertexStride;
+            uint32_t                positionOffset;
+            uint32_t                normalOffset;
+        };
+
+        struct Buffer
+        {
+            VkBuffer                buffer;
+            VkDeviceMemory          memory;
+            VkDeviceSize            size;
+            void*                   pMapped;        // host visible buffers only
+
+            Buffer() : buffer(VK_NULL_HANDLE), memory(VK_NULL_HANDLE), size(0), pMapped(nullptr) {}
+        };
+
+        // everything one frame in flight owns
+        struct FrameResources
+        {
+            Buffer                  paletteBuffer;      // host visible, mat4[boneCapacity]
+            Buffer                  jobBuffer;          // host visible, Job[jobCapacity]
+            VkDescriptorSet         descriptorSets[s_kMaxGroups];
+            VkBuffer                vertexBuffers[s_kMaxGroups];    // what descriptorSets were written with
+            uint32_t                boneCapacity;
+            uint32_t                jobCapacity;
+            uint32_t                firstJob[s_kMaxGroups];
+            uint32_t                maxVertices[s_kMaxGroups];      // largest job of the group, dispatch width
+
+            FrameResources();
+        };
+
+        bool CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, Buffer&);
+        void DestroyBuffer(Buffer&);
+        bool ReserveFrame(FrameResources&, uint32_t numBones, uint32_t numJobs);
+        void WriteDescriptorSet(FrameResources&, uint32_t group, VkBuffer vertexBuffer);
+        bool CreatePipeline(const std::string& shaderPath);
+        void RecordBindPoseUpload(VkCommandBuffer);
+
+        VulkanRenderContext&                m_context;
+        std::vector<FrameResources>         m_frames;
+        uint32_t                            m_currentFrame;
+        Buffer                              m_bindPoseBuffer;       // device local, SkinVertex[]
+        Buffer                              m_stagingBuffer;        // host visible, same size
+        uint32_t                            m_bindPoseCapacity;     // vertices
+        uint32_t                            m_numBindPoseVertices;
+        uint32_t                            m_numUploadedVertices;
+        std::vector<Mesh>                   m_meshes;
+        std::vector<Job>                    m_jobs[s_kMaxGroups];
+        std::vector<float>                  m_palette;              // this frame's, 16 floats per bone
+        VertexLayout                        m_vertexLayout;
+        VkDescriptorSetLayout               m_descriptorSetLayout;
+        VkDescriptorPool                    m_descriptorPool;
+        VkPipelineLayout                    m_pipelineLayout;
+        VkPipeline                          m_pipeline;
+        bool                                m_bIsInitialized;
+
+        static const uint32_t s_kLocalSize = 64;
+        static const uint32_t s_kMinBones = 1024;
+        static const uint32_t s_kMinJobs = 256;
+        static const uint32_t s_kNumBindings = 4;
+    };
+
+    typedef std::shared_ptr<VKNComputeSkinner> VKNComputeSkinnerPtr;
+}
+
+#endif // VKN_COMPUTE_SKINNER_H
@@ -0,0 +1,110 @@
+// VKNComputeUtils.cpp
+#include "stdafx.h"
+#include "VKNComputeUtils.h"
+#include "VulkanRenderContext.h"
+
+#include <fstream>
+#include <vector>
+
+namespace GamePrototype
+{
+	namespace VKNComputeUtils
+	{
+		bool FindMemoryType(VulkanRenderContext& context, uint32_t typeBits, VkMemoryPropertyFlags properties, uint32_t& typeIndex)
+		{
+			VkPhysicalDeviceMemoryProperties memProps;
+			vkGetPhysicalDeviceMemoryProperties(context.GetPhysicalDevice(), &memProps);
+
+			for (uint32_t i = 0; i < memProps.memoryTypeCount; ++i)
+			{
+				if ((typeBits & (1u << i)) && (memProps.memoryTypes[i].propertyFlags & properties) == properties)
+				{
+					typeIndex = i;
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		bool CreateShaderModule(VulkanRenderContext& context, const std::string& shaderPath, VkShaderModule& shaderModule)
+		{
+			std::ifstream file(shaderPath, std::ios::binary | std::ios::ate);
+			if (!file.is_open())
+			{
+				Log::PrintError("VKNComputeUtils::CreateShaderModule() failed to open shader!");
+				return false;
+			}
+
+			const size_t codeSize = static_cast<size_t>(file.tellg());
+			if (codeSize == 0 || (codeSize % sizeof(uint32_t)) != 0)
+			{
+				Log::PrintError("VKNComputeUtils::CreateShaderModule() shader is not valid SPIR-V!");
+				return false;
+			}
+
+			std::vector<uint32_t> code(codeSize / sizeof(uint32_t));
+			file.seekg(0);
+			file.read(reinterpret_cast<char*>(code.data()), codeSize);
+
+			VkShaderModuleCreateInfo moduleInfo = {};
+			moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+			moduleInfo.codeSize = codeSize;
+			moduleInfo.pCode = code.data();
+
+			if (vkCreateShaderModule(context.GetDevice(), &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS)
+			{
+				Log::PrintError("VKNComputeUtils::CreateShaderModule() failed to create shader module!");
+				return false;
+			}
+
+			return true;
+		}
+
+		bool CreateComputePipeline(VulkanRenderContext& context, const std::string& shaderPath, VkPipelineLayout layout, VkPipeline& pipeline)
+		{
+			VkDevice device = context.GetDevice();
+
+			VkShaderModule shaderModule = VK_NULL_HANDLE;
+			if (!CreateShaderModule(context, shaderPath, shaderModule))
+			{
+				return false;
+			}
+
+			VkComputePipelineCreateInfo pipelineInfo = {};
+			pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+			pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+			pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+			pipelineInfo.stage.module = shaderModule;
+			pipelineInfo.stage.pName = "main";
+			pipelineInfo.layout = layout;
+
+			const bool bResult = (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) == VK_SUCCESS);
+
+			// the pipeline keeps what it needs
+			vkDestroyShaderModule(device, shaderModule, nullptr);
+
+			if (!bResult)
+			{
+				Log::PrintError("VKNComputeUtils::CreateComputePipeline() failed to create compute pipeline!");
+			}
+
+			return bResult;
+		}
+
+		void RecordDrawIndirect(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, bool bMultiDrawIndirect)
+		{
+			const uint32_t stride = sizeof(VkDrawIndirectCommand);
+			if (bMultiDrawIndirect)
+			{
+				vkCmdDrawIndirect(cmd, buffer, offset, drawCount, stride);
+				return;
+			}
+
+			for (uint32_t i = 0; i < drawCount; ++i)
+			{
+				vkCmdDrawIndirect(cmd, buffer, offset + static_cast<VkDeviceSize>(i)*stride, 1, stride);
+			}
+		}
+	}
+}
@@ -0,0 +1,33 @@
+// VKNComputeUtils.h
+// Small helpers shared by the passes the batch draw effect records itself (GPU culling, depth pyramid,
+// the OIT composite)
+#pragma once
+#ifndef VKN_COMPUTE_UTILS_H
+#define VKN_COMPUTE_UTILS_H
+
+#include <string>
+
+#include "VulkanHelper.h"
+
+namespace GamePrototype
+{
+    class VulkanRenderContext;
+
+    namespace VKNComputeUtils
+    {
+        // first memory type allowed by typeBits that has all of the properties
+        bool FindMemoryType(VulkanRenderContext&, uint32_t typeBits, VkMemoryPropertyFlags properties, uint32_t& typeIndex);
+
+        // module from a SPIR-V file. The caller destroys it once its pipelines are created
+        bool CreateShaderModule(VulkanRenderContext&, const std::string& shaderPath, VkShaderModule&);
+
+        // compute pipeline from a SPIR-V file, entry point "main"
+        bool CreateComputePipeline(VulkanRenderContext&, const std::string& shaderPath, VkPipelineLayout, VkPipeline&);
+
+        // drawCount tightly packed VkDrawIndirectCommands. Without the multiDrawIndirect feature (bMultiDrawIndirect
+        // false) a vkCmdDrawIndirect() may only draw one, so they are recorded one call each
+        void RecordDrawIndirect(VkCommandBuffer, VkBuffer, VkDeviceSize offset, uint32_t drawCount, bool bMultiDrawIndirect);
+    }
+}
+
+#endif // VKN_COMPUTE_UTILS_H
@@ -0,0 +1,531 @@
+// VKNDepthPyramid.cpp
+#include "stdafx.h"
+#include "VKNDepthPyramid.h"
+#include "VKNComputeUtils.h"
+#include "VulkanRenderContext.h"
+
+#include <cassert>
+
+namespace GamePrototype
+{
+	const uint32_t VKNDepthPyramid::s_kMaxMips;
+	const uint32_t VKNDepthPyramid::s_kMaxDepthViews;
+	const uint32_t VKNDepthPyramid::s_kLocalSize;
+
+	VKNDepthPyramid::VKNDepthPyramid(VulkanRenderContext& context)
+	:
+	m_context(context),
+	m_image(VK_NULL_HANDLE),
+	m_memory(VK_NULL_HANDLE),
+	m_view(VK_NULL_HANDLE),
+	m_sampler(VK_NULL_HANDLE),
+	m_width(0),
+	m_height(0),
+	m_numMips(0),
+	m_pendingWidth(0),
+	m_pendingHeight(0),
+	m_generation(0),
+	m_bValid(false),
+	m_bLayoutReady(false),
+	m_descriptorSetLayout(VK_NULL_HANDLE),
+	m_descriptorPool(VK_NULL_HANDLE),
+	m_pipelineLayout(VK_NULL_HANDLE),
+	m_pipeline(VK_NULL_HANDLE)
+	{
+	}
+
+	VKNDepthPyramid::~VKNDepthPyramid()
+	{
+		Shutdown();
+	}
+
+	bool VKNDepthPyramid::Init()
+	{
+		if (m_image != VK_NULL_HANDLE)
+		{
+			return true;
+		}
+
+		VkDevice device = m_context.GetDevice();
+
+		// the reduction reads with texelFetch(), the culler picks a mip with textureLod()
+		VkSamplerCreateInfo samplerInfo = {};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_NEAREST;
+		samplerInfo.minFilter = VK_FILTER_NEAREST;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.minLod = 0.0f;
+		samplerInfo.maxLod = static_cast<float>(s_kMaxMips);
+		samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+		if (vkCreateSampler(device, &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNDepthPyramid::Init() failed to create sampler!");
+			return false;
+		}
+
+		// binding 0: source level, binding 1: destination level
+		VkDescriptorSetLayoutBinding bindings[2] = {};
+		bindings[0].binding = 0;
+		bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		bindings[0].descriptorCount = 1;
+		bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		bindings[1].binding = 1;
+		bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		bindings[1].descriptorCount = 1;
+		bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = 2;
+		layoutInfo.pBindings = bindings;
+		if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNDepthPyramid::Init() failed to create descriptor set layout!");
+			Shutdown();
+			return false;
+		}
+
+		const uint32_t maxSets = s_kMaxMips + s_kMaxDepthViews;
+
+		VkDescriptorPoolSize poolSizes[2] = {};
+		poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		poolSizes[0].descriptorCount = maxSets;
+		poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		poolSizes[1].descriptorCount = maxSets;
+
+		VkDescriptorPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+		poolInfo.maxSets = maxSets;
+		poolInfo.poolSizeCount = 2;
+		poolInfo.pPoolSizes = poolSizes;
+		if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNDepthPyramid::Init() failed to create descriptor pool!");
+			Shutdown();
+			return false;
+		}
+
+		m_mipDescriptorSets.resize(s_kMaxMips, VK_NULL_HANDLE);
+		std::vector<VkDescriptorSetLayout> layouts(s_kMaxMips, m_descriptorSetLayout);
+
+		VkDescriptorSetAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = m_descriptorPool;
+		allocInfo.descriptorSetCount = s_kMaxMips;
+		allocInfo.pSetLayouts = layouts.data();
+		if (vkAllocateDescriptorSets(device, &allocInfo, m_mipDescriptorSets.data()) != VK_SUCCESS ||
+			!CreateImage(1, 1))
+		{
+			Log::PrintError("VKNDepthPyramid::Init() failed to create the pyramid!");
+			Shutdown();
+			return false;
+		}
+
+		return true;
+	}
+
+	void VKNDepthPyramid::Shutdown()
+	{
+		VkDevice device = m_context.GetDevice();
+
+		DestroyImage();
+
+		if (m_pipeline != VK_NULL_HANDLE)
+		{
+			vkDestroyPipeline(device, m_pipeline, nullptr);
+			m_pipeline = VK_NULL_HANDLE;
+		}
+
+		if (m_pipelineLayout != VK_NULL_HANDLE)
+		{
+			vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+			m_pipelineLayout = VK_NULL_HANDLE;
+		}
+
+		// the sets go with their pool
+		m_mipDescriptorSets.clear();
+		m_depthDescriptorSets.clear();
+		if (m_descriptorPool != VK_NULL_HANDLE)
+		{
+			vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
+			m_descriptorPool = VK_NULL_HANDLE;
+		}
+
+		if (m_descriptorSetLayout != VK_NULL_HANDLE)
+		{
+			vkDestroyDescriptorSetLayout(device, m_descriptorSetLayout, nullptr);
+			m_descriptorSetLayout = VK_NULL_HANDLE;
+		}
+
+		if (m_sampler != VK_NULL_HANDLE)
+		{
+			vkDestroySampler(device, m_sampler, nullptr);
+			m_sampler = VK_NULL_HANDLE;
+		}
+
+		m_pendingWidth = 0;
+		m_pendingHeight = 0;
+	}
+
+	bool VKNDepthPyramid::CreatePipeline(const std::string& shaderPath)
+	{
+		if (m_pipeline != VK_NULL_HANDLE)
+		{
+			return true;
+		}
+
+		RenderCheckOK(m_descriptorSetLayout != VK_NULL_HANDLE);
+
+		VkPushConstantRange pushConstantRange = {};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(Level);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+		if (m_pipelineLayout == VK_NULL_HANDLE &&
+			vkCreatePipelineLayout(m_context.GetDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNDepthPyramid::CreatePipeline() failed to create pipeline layout!");
+			return false;
+		}
+
+		return VKNComputeUtils::CreateComputePipeline(m_context, shaderPath, m_pipelineLayout, m_pipeline);
+	}
+
+	void VKNDepthPyramid::PrepareForFrame(VkCommandBuffer cmd)
+	{
+		if (m_pendingWidth != 0 && (m_pendingWidth != m_width || m_pendingHeight != m_height))
+		{
+			// earlier frames may still sample the old image
+			vkDeviceWaitIdle(m_context.GetDevice());
+
+			DestroyImage();
+			if (!CreateImage(m_pendingWidth, m_pendingHeight))
+			{
+				Log::PrintError("VKNDepthPyramid::PrepareForFrame() failed to resize the pyramid!");
+				CreateImage(1, 1);
+			}
+
+			// a new size usually comes with new depth buffers, the old views may be gone
+			for (const auto& entry : m_depthDescriptorSets)
+			{
+				vkFreeDescriptorSets(m_context.GetDevice(), m_descriptorPool, 1, &entry.second);
+			}
+			m_depthDescriptorSets.clear();
+		}
+
+		m_pendingWidth = 0;
+		m_pendingHeight = 0;
+
+		if (!m_bLayoutReady && m_image != VK_NULL_HANDLE)
+		{
+			VkImageMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = m_image;
+			barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_numMips, 0, 1 };
+
+			vkCmdPipelineBarrier(cmd,
+				VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0,
+				0, nullptr,
+				0, nullptr,
+				1, &barrier);
+
+			m_bLayoutReady = true;
+		}
+	}
+
+	bool VKNDepthPyramid::Build(VkCommandBuffer cmd, const TextureObject& depth, uint32_t width, uint32_t height)
+	{
+		if (!CanBuild() || width == 0 || height == 0)
+		{
+			return false;
+		}
+
+		if (width != m_width || height != m_height)
+		{
+			m_pendingWidth = width;
+			m_pendingHeight = height;
+			return false;
+		}
+
+		// PrepareForFrame() has to have moved the image out of UNDEFINED
+		assert(m_bLayoutReady);
+
+		VkDescriptorSet depthSet = GetDepthDescriptorSet(depth.view);
+		if (depthSet == VK_NULL_HANDLE)
+		{
+			return false;
+		}
+
+		// depth writes of the geometry pass, and last frame's culling reads of the pyramid, come first
+		VkImageMemoryBarrier barriers[2] = {};
+		barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barriers[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barriers[0].oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		barriers[0].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[0].image = depth.image;
+		barriers[0].subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+
+		barriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barriers[1].srcAccessMask = 0;
+		barriers[1].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barriers[1].oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[1].image = m_image;
+		barriers[1].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_numMips, 0, 1 };
+
+		vkCmdPipelineBarrier(cmd,
+			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0,
+			0, nullptr,
+			0, nullptr,
+			2, barriers);
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+
+		for (uint32_t mip = 0; mip < m_numMips; ++mip)
+		{
+			Level level;
+			level.srcSize[0] = static_cast<int32_t>(mip == 0 ? m_width : GetMipSize(m_width, mip - 1));
+			level.srcSize[1] = static_cast<int32_t>(mip == 0 ? m_height : GetMipSize(m_height, mip - 1));
+			level.dstSize[0] = static_cast<int32_t>(GetMipSize(m_width, mip));
+			level.dstSize[1] = static_cast<int32_t>(GetMipSize(m_height, mip));
+
+			VkDescriptorSet set = (mip == 0) ? depthSet : m_mipDescriptorSets[mip];
+			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &set, 0, nullptr);
+			vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Level), &level);
+			vkCmdDispatch(cmd,
+				(level.dstSize[0] + s_kLocalSize - 1) / s_kLocalSize,
+				(level.dstSize[1] + s_kLocalSize - 1) / s_kLocalSize,
+				1);
+
+			// the next level (and the culling pass after the last one) reads this one
+			VkImageMemoryBarrier mipBarrier = barriers[1];
+			mipBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			mipBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			mipBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, mip, 1, 0, 1 };
+
+			vkCmdPipelineBarrier(cmd,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0,
+				0, nullptr,
+				0, nullptr,
+				1, &mipBarrier);
+		}
+
+		m_bValid = true;
+
+		return true;
+	}
+
+	bool VKNDepthPyramid::CreateImage(uint32_t width, uint32_t height)
+	{
+		VkDevice device = m_context.GetDevice();
+
+		m_numMips = 1;
+		while (m_numMips < s_kMaxMips && ((width | height) >> m_numMips) != 0)
+		{
+			++m_numMips;
+		}
+
+		VkImageCreateInfo imageInfo = {};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = VK_FORMAT_R32_SFLOAT;
+		imageInfo.extent = { width, height, 1 };
+		imageInfo.mipLevels = m_numMips;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		if (vkCreateImage(device, &imageInfo, nullptr, &m_image) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNDepthPyramid::CreateImage() failed to create image!");
+			return false;
+		}
+
+		VkMemoryRequirements memReqs;
+		vkGetImageMemoryRequirements(device, m_image, &memReqs);
+
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = memReqs.size;
+		if (!VKNComputeUtils::FindMemoryType(m_context, memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, allocInfo.memoryTypeIndex) ||
+			vkAllocateMemory(device, &allocInfo, nullptr, &m_memory) != VK_SUCCESS ||
+			vkBindImageMemory(device, m_image, m_memory, 0) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNDepthPyramid::CreateImage() failed to allocate memory!");
+			DestroyImage();
+			return false;
+		}
+
+		VkImageViewCreateInfo viewInfo = {};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = m_image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = VK_FORMAT_R32_SFLOAT;
+		viewInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+		viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_numMips, 0, 1 };
+		if (vkCreateImageView(device, &viewInfo, nullptr, &m_view) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNDepthPyramid::CreateImage() failed to create image view!");
+			DestroyImage();
+			return false;
+		}
+
+		m_mipViews.resize(m_numMips, VK_NULL_HANDLE);
+		for (uint32_t mip = 0; mip < m_numMips; ++mip)
+		{
+			viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, mip, 1, 0, 1 };
+			if (vkCreateImageView(device, &viewInfo, nullptr, &m_mipViews[mip]) != VK_SUCCESS)
+			{
+				Log::PrintError("VKNDepthPyramid::CreateImage() failed to create mip view!");
+				DestroyImage();
+				return false;
+			}
+		}
+
+		for (uint32_t mip = 1; mip < m_numMips; ++mip)
+		{
+			WriteDescriptorSet(m_mipDescriptorSets[mip], m_mipViews[mip - 1], mip);
+		}
+
+		m_width = width;
+		m_height = height;
+		m_bValid = false;
+		m_bLayoutReady = false;
+		++m_generation;
+
+		return true;
+	}
+
+	void VKNDepthPyramid::DestroyImage()
+	{
+		VkDevice device = m_context.GetDevice();
+
+		for (VkImageView view : m_mipViews)
+		{
+			if (view != VK_NULL_HANDLE)
+			{
+				vkDestroyImageView(device, view, nullptr);
+			}
+		}
+		m_mipViews.clear();
+
+		if (m_view != VK_NULL_HANDLE)
+		{
+			vkDestroyImageView(device, m_view, nullptr);
+			m_view = VK_NULL_HANDLE;
+		}
+
+		if (m_image != VK_NULL_HANDLE)
+		{
+			vkDestroyImage(device, m_image, nullptr);
+			m_image = VK_NULL_HANDLE;
+		}
+
+		if (m_memory != VK_NULL_HANDLE)
+		{
+			vkFreeMemory(device, m_memory, nullptr);
+			m_memory = VK_NULL_HANDLE;
+		}
+
+		m_width = 0;
+		m_height = 0;
+		m_numMips = 0;
+		m_bValid = false;
+		m_bLayoutReady = false;
+	}
+
+	void VKNDepthPyramid::WriteDescriptorSet(VkDescriptorSet set, VkImageView srcView, uint32_t dstMip)
+	{
+		// mip 0's source is a depth buffer, the others are the level above in GENERAL
+		VkDescriptorImageInfo imageInfos[2] = {};
+		imageInfos[0].sampler = m_sampler;
+		imageInfos[0].imageView = srcView;
+		imageInfos[0].imageLayout = (dstMip == 0) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+		imageInfos[1].imageView = m_mipViews[dstMip];
+		imageInfos[1].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		VkWriteDescriptorSet writes[2] = {};
+		for (uint32_t i = 0; i < 2; ++i)
+		{
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = set;
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = (i == 0) ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			writes[i].pImageInfo = &imageInfos[i];
+		}
+
+		vkUpdateDescriptorSets(m_context.GetDevice(), 2, writes, 0, nullptr);
+	}
+
+	VkDescriptorSet VKNDepthPyramid::GetDepthDescriptorSet(VkImageView depthView)
+	{
+		for (const auto& entry : m_depthDescriptorSets)
+		{
+			if (entry.first == depthView)
+			{
+				return entry.second;
+			}
+		}
+
+		if (m_depthDescriptorSets.size() >= s_kMaxDepthViews)
+		{
+			Log::PrintError("VKNDepthPyramid::GetDepthDescriptorSet() too many depth buffers!");
+			return VK_NULL_HANDLE;
+		}
+
+		VkDescriptorSetAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = m_descriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &m_descriptorSetLayout;
+
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		if (vkAllocateDescriptorSets(m_context.GetDevice(), &allocInfo, &set) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNDepthPyramid::GetDepthDescriptorSet() failed to allocate descriptor set!");
+			return VK_NULL_HANDLE;
+		}
+
+		WriteDescriptorSet(set, depthView, 0);
+		m_depthDescriptorSets.emplace_back(depthView, set);
+
+		return set;
+	}
+
+	uint32_t VKNDepthPyramid::GetMipSize(uint32_t size, uint32_t mip) const
+	{
+		const uint32_t mipSize = size >> mip;
+		return (mipSize > 0) ? mipSize : 1;
+	}
+}
@@ -0,0 +1,105 @@
+// VKNDepthPyramid.h
+// Hierarchical depth (Hi-Z) for GPU occlusion culling. Mip 0 is a copy of a depth buffer, every following
+// mip keeps the farthest depth of the texels it covers, so a single sample at the right mip tells whether
+// anything in a screen rectangle could be nearer than what was drawn there.
+// The pyramid stays in VK_IMAGE_LAYOUT_GENERAL. It starts out as a 1x1 image so it can always be bound.
+// A depth buffer of a different size only takes effect at the next PrepareForFrame(), since the image may
+// already be referenced by the command buffer being recorded
+#pragma once
+#ifndef VKN_DEPTH_PYRAMID_H
+#define VKN_DEPTH_PYRAMID_H
+
+#include <string>
+#include <vector>
+
+#include "VulkanHelper.h"
+
+namespace GamePrototype
+{
+    class VulkanRenderContext;
+
+    class VKNDepthPyramid
+    {
+    public:
+        explicit VKNDepthPyramid(VulkanRenderContext&);
+        ~VKNDepthPyramid();
+
+        VKNDepthPyramid(const VKNDepthPyramid&) = delete;
+        VKNDepthPyramid& operator=(const VKNDepthPyramid&) = delete;
+
+        // the image and sampler only, enough to be bound
+        bool Init();
+        void Shutdown();
+
+        // shaderPath: compiled SPIR-V of BatchDrawDepthPyramid_CS.comp. Needed before Build()
+        bool CreatePipeline(const std::string& shaderPath);
+        bool CanBuild() const { return m_pipeline != VK_NULL_HANDLE; }
+
+        // call before anything in the command buffer references the pyramid. Applies a pending resize
+        // (waiting for the device) and moves a new image into GENERAL layout
+        void PrepareForFrame(VkCommandBuffer);
+
+        // records the reduction of a depth buffer into the pyramid, outside a render pass. The depth buffer
+        // must be in DEPTH_STENCIL_READ_ONLY_OPTIMAL (the final layout of its render pass) and its view must be
+        // depth aspect only. Returns false if nothing was recorded (no pipeline, or the size changed)
+        bool Build(VkCommandBuffer, const TextureObject& depth, uint32_t width, uint32_t height);
+
+        // whole mip chain, for sampling with textureLod()
+        VkImageView GetView() const { return m_view; }
+        VkSampler GetSampler() const { return m_sampler; }
+        uint32_t GetWidth() const { return m_width; }
+        uint32_t GetHeight() const { return m_height; }
+
+        // bumped whenever the image is recreated, descriptor sets holding GetView() need rewriting
+        uint32_t GetGeneration() const { return m_generation; }
+
+        // false until Build() filled the current image
+        bool IsValid() const { return m_bValid; }
+
+    private:
+
+        // push constants (BatchDrawDepthPyramid_CS Level)
+        struct Level
+        {
+            int32_t                 srcSize[2];
+            int32_t                 dstSize[2];
+        };
+
+        bool CreateImage(uint32_t width, uint32_t height);
+        void DestroyImage();
+        void WriteDescriptorSet(VkDescriptorSet, VkImageView srcView, uint32_t dstMip);
+        VkDescriptorSet GetDepthDescriptorSet(VkImageView depthView);
+        uint32_t GetMipSize(uint32_t size, uint32_t mip) const;
+
+        VulkanRenderContext&                m_context;
+        VkImage                             m_image;
+        VkDeviceMemory                      m_memory;
+        VkImageView                         m_view;
+        std::vector<VkImageView>            m_mipViews;
+        VkSampler                           m_sampler;
+        uint32_t                            m_width;
+        uint32_t                            m_height;
+        uint32_t                            m_numMips;
+        uint32_t                            m_pendingWidth;
+        uint32_t                            m_pendingHeight;
+        uint32_t                            m_generation;
+        bool                                m_bValid;
+        bool                                m_bLayoutReady;     // moved out of UNDEFINED
+
+        VkDescriptorSetLayout               m_descriptorSetLayout;
+        VkDescriptorPool                    m_descriptorPool;
+        std::vector<VkDescriptorSet>        m_mipDescriptorSets;    // mip n-1 -> mip n, index n
+
+        // mip 0 sources. Swap chain images each have their own depth buffer, so each gets a set
+        // (sets can not be rewritten while an earlier frame may still use them)
+        std::vector<std::pair<VkImageView, VkDescriptorSet>>   m_depthDescriptorSets;
+        VkPipelineLayout                    m_pipelineLayout;
+        VkPipeline                          m_pipeline;
+
+        static const uint32_t s_kMaxMips = 16;
+        static const uint32_t s_kMaxDepthViews = 8;
+        static const uint32_t s_kLocalSize = 8;
+    };
+}
+
+#endif // VKN_DEPTH_PYRAMID_H
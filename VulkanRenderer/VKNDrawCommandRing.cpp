@@ -0,0 +1,130 @@
+// VKNDrawCommandRing.cpp
+#include "stdafx.h"
+#include "VKNDrawCommandRing.h"
+#include "VKNComputeUtils.h"
+#include "VulkanRenderContext.h"
+
+namespace GamePrototype
+{
+	VKNDrawCommandRing::VKNDrawCommandRing(VulkanRenderContext& context)
+	:
+	m_context(context),
+	m_bufferObject{},
+	m_pMapped(nullptr),
+	m_numFrames(0),
+	m_commandsPerFrame(0),
+	m_frame(0),
+	m_used(0)
+	{
+	}
+
+	VKNDrawCommandRing::~VKNDrawCommandRing()
+	{
+		Shutdown();
+	}
+
+	bool VKNDrawCommandRing::Init(uint32_t numFrames, uint32_t commandsPerFrame)
+	{
+		assert(numFrames > 0 && commandsPerFrame > 0);
+		if (m_bufferObject.buffer != VK_NULL_HANDLE)
+		{
+			return true;
+		}
+
+		VkDevice device = m_context.GetDevice();
+
+		m_numFrames = numFrames;
+		m_commandsPerFrame = commandsPerFrame;
+		m_frame = 0;
+		m_used = 0;
+
+		const VkDeviceSize size = static_cast<VkDeviceSize>(sizeof(VkDrawIndirectCommand)) * m_numFrames * m_commandsPerFrame;
+
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size;
+		bufferInfo.usage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		if (vkCreateBuffer(device, &bufferInfo, nullptr, &m_bufferObject.buffer) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNDrawCommandRing::Init() failed to create buffer!");
+			m_bufferObject.buffer = VK_NULL_HANDLE;
+			return false;
+		}
+
+		VkMemoryRequirements memReqs;
+		vkGetBufferMemoryRequirements(device, m_bufferObject.buffer, &memReqs);
+
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = memReqs.size;
+		if (!VKNComputeUtils::FindMemoryType(m_context, memReqs.memoryTypeBits,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, allocInfo.memoryTypeIndex) ||
+			vkAllocateMemory(device, &allocInfo, nullptr, &m_bufferObject.memory) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNDrawCommandRing::Init() failed to allocate memory!");
+			Shutdown();
+			return false;
+		}
+
+		void* pMapped = nullptr;
+		if (vkBindBufferMemory(device, m_bufferObject.buffer, m_bufferObject.memory, 0) != VK_SUCCESS ||
+			vkMapMemory(device, m_bufferObject.memory, 0, size, 0, &pMapped) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNDrawCommandRing::Init() failed to map memory!");
+			Shutdown();
+			return false;
+		}
+
+		m_pMapped = static_cast<VkDrawIndirectCommand*>(pMapped);
+		return true;
+	}
+
+	void VKNDrawCommandRing::Shutdown()
+	{
+		VkDevice device = m_context.GetDevice();
+
+		if (m_pMapped)
+		{
+			vkUnmapMemory(device, m_bufferObject.memory);
+			m_pMapped = nullptr;
+		}
+
+		if (m_bufferObject.buffer != VK_NULL_HANDLE)
+		{
+			vkDestroyBuffer(device, m_bufferObject.buffer, nullptr);
+		}
+
+		if (m_bufferObject.memory != VK_NULL_HANDLE)
+		{
+			vkFreeMemory(device, m_bufferObject.memory, nullptr);
+		}
+
+		m_bufferObject = BufferObject{};
+	}
+
+	void VKNDrawCommandRing::BeginFrame()
+	{
+		if (m_numFrames > 0)
+		{
+			m_frame = (m_frame + 1) % m_numFrames;
+		}
+
+		m_used = 0;
+	}
+
+	VkDrawIndirectCommand* VKNDrawCommandRing::Allocate(uint32_t count, VkDeviceSize& offset)
+	{
+		if (!m_pMapped || count > m_commandsPerFrame - m_used)
+		{
+			Log::PrintError("VKNDrawCommandRing::Allocate() out of draw commands for this frame!");
+			return nullptr;
+		}
+
+		const uint32_t first = m_frame * m_commandsPerFrame + m_used;
+		m_used += count;
+
+		offset = static_cast<VkDeviceSize>(first) * sizeof(VkDrawIndirectCommand);
+		return m_pMapped + first;
+	}
+}
@@ -0,0 +1,53 @@
+// VKNDrawCommandRing.h
+// Ring of indirect draw commands in one persistently mapped, host coherent buffer. Each frame in flight owns
+// commandsPerFrame commands, handed out front to back, so a region one pass of the frame recorded its draw
+// against is never rewritten by a later pass, and not by a later frame until the ring comes back around to
+// its frame. Like VKNUniformRing, that only holds while no more frames are in flight than the ring has frames
+#pragma once
+#ifndef VKN_DRAW_COMMAND_RING_H
+#define VKN_DRAW_COMMAND_RING_H
+
+#include <memory>
+
+#include "VulkanHelper.h"
+
+namespace GamePrototype
+{
+    class VulkanRenderContext;
+
+    class VKNDrawCommandRing
+    {
+    public:
+        explicit VKNDrawCommandRing(VulkanRenderContext&);
+        ~VKNDrawCommandRing();
+
+        VKNDrawCommandRing(const VKNDrawCommandRing&) = delete;
+        VKNDrawCommandRing& operator=(const VKNDrawCommandRing&) = delete;
+
+        bool Init(uint32_t numFrames, uint32_t commandsPerFrame);
+        void Shutdown();
+
+        // moves on to the next frame's commands, which the GPU is done with by now
+        void BeginFrame();
+
+        // count free commands of this frame, and their byte offset for vkCmdDrawIndirect(). nullptr when the
+        // frame has fewer than count left
+        VkDrawIndirectCommand* Allocate(uint32_t count, VkDeviceSize& offset);
+
+        VkBuffer GetBuffer() const { return m_bufferObject.buffer; }
+
+    private:
+
+        VulkanRenderContext&                m_context;
+        BufferObject                        m_bufferObject;
+        VkDrawIndirectCommand*              m_pMapped;
+        uint32_t                            m_numFrames;
+        uint32_t                            m_commandsPerFrame;
+        uint32_t                            m_frame;
+        uint32_t                            m_used;             // commands handed out in m_frame
+    };
+
+    typedef std::shared_ptr<VKNDrawCommandRing> VKNDrawCommandRingPtr;
+}
+
+#endif // VKN_DRAW_COMMAND_RING_H
@@ -0,0 +1,633 @@
+// VKNGPUCuller.cpp
+#include "stdafx.h"
+#include "VKNGPUCuller.h"
+#include "VKNComputeUtils.h"
+#include "VulkanRenderContext.h"
+
+#include "../Renderer/FrustumCuller.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace GamePrototype
+{
+	const uint32_t VKNGPUCuller::s_kMaxGroups;
+	const uint32_t VKNGPUCuller::s_kLocalSize;
+	const uint32_t VKNGPUCuller::s_kMinCapacity;
+	const uint32_t VKNGPUCuller::s_kNumBindings;
+
+	VKNGPUCuller::FrameResources::FrameResources()
+	:
+	descriptorSet(VK_NULL_HANDLE),
+	pyramidGeneration(0),
+	capacity(0),
+	first{},
+	count{}
+	{
+	}
+
+	VKNGPUCuller::VKNGPUCuller(VulkanRenderContext& context)
+	:
+	m_context(context),
+	m_currentFrame(0),
+	m_descriptorSetLayout(VK_NULL_HANDLE),
+	m_descriptorPool(VK_NULL_HANDLE),
+	m_pipelineLayout(VK_NULL_HANDLE),
+	m_pipeline(VK_NULL_HANDLE),
+	m_pfnDrawIndirectCount(nullptr),
+	m_bMultiDrawIndirect(false),
+	m_bIsInitialized(false),
+	m_depthPyramid(context),
+	m_viewProj{},
+	m_pyramidViewProj{},
+	m_bOcclusion(false),
+	m_bRetestRecorded(false)
+	{
+	}
+
+	VKNGPUCuller::~VKNGPUCuller()
+	{
+		Shutdown();
+	}
+
+	bool VKNGPUCuller::Init(const std::string& shaderPath, bool bDrawIndirectCount, bool bMultiDrawIndirect)
+	{
+		if (m_bIsInitialized)
+		{
+			return true;
+		}
+
+		VkDevice device = m_context.GetDevice();
+		const uint32_t numFrames = m_context.GetSwapChainImageCount();
+		assert(numFrames > 0);
+
+		// binding 0: camera, 1: instances, 2: output commands, 3: draw counts, 4: phase flags, 5: depth pyramid
+		VkDescriptorSetLayoutBinding bindings[s_kNumBindings] = {};
+		for (uint32_t i = 0; i < s_kNumBindings; ++i)
+		{
+			bindings[i].binding = i;
+			bindings[i].descriptorType = GetDescriptorType(i);
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = s_kNumBindings;
+		layoutInfo.pBindings = bindings;
+		if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNGPUCuller::Init() failed to create descriptor set layout!");
+			return false;
+		}
+
+		VkDescriptorPoolSize poolSizes[3] = {};
+		poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		poolSizes[0].descriptorCount = numFrames;
+		poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSizes[1].descriptorCount = numFrames * 4;
+		poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		poolSizes[2].descriptorCount = numFrames;
+
+		VkDescriptorPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = numFrames;
+		poolInfo.poolSizeCount = 3;
+		poolInfo.pPoolSizes = poolSizes;
+		if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNGPUCuller::Init() failed to create descriptor pool!");
+			Shutdown();
+			return false;
+		}
+
+		// the pyramid is bound whether occlusion is on or not
+		if (!CreatePipeline(shaderPath) || !m_depthPyramid.Init())
+		{
+			Shutdown();
+			return false;
+		}
+
+		m_frames.resize(numFrames);
+		for (auto& frame : m_frames)
+		{
+			VkDescriptorSetAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			allocInfo.descriptorPool = m_descriptorPool;
+			allocInfo.descriptorSetCount = 1;
+			allocInfo.pSetLayouts = &m_descriptorSetLayout;
+			if (vkAllocateDescriptorSets(device, &allocInfo, &frame.descriptorSet) != VK_SUCCESS ||
+				!CreateFrameResources(frame, s_kMinCapacity))
+			{
+				Log::PrintError("VKNGPUCuller::Init() failed to create frame resources!");
+				Shutdown();
+				return false;
+			}
+
+			WriteDescriptorSet(frame);
+		}
+
+		// core in 1.2, the KHR entry point before that. Without it every command is drawn, culled ones with no instances.
+		// NOTE: a count buffer draw is a multi-draw, so it is only used with the multiDrawIndirect feature
+		m_bMultiDrawIndirect = bMultiDrawIndirect;
+		if (bDrawIndirectCount && bMultiDrawIndirect)
+		{
+			m_pfnDrawIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndirectCount>(vkGetDeviceProcAddr(device, "vkCmdDrawIndirectCount"));
+			if (!m_pfnDrawIndirectCount)
+			{
+				m_pfnDrawIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndirectCount>(vkGetDeviceProcAddr(device, "vkCmdDrawIndirectCountKHR"));
+			}
+		}
+
+		m_currentFrame = 0;
+		m_bIsInitialized = true;
+
+		return true;
+	}
+
+	void VKNGPUCuller::Shutdown()
+	{
+		VkDevice device = m_context.GetDevice();
+
+		for (auto& frame : m_frames)
+		{
+			DestroyFrameResources(frame);
+		}
+		m_frames.clear();
+
+		for (auto& instances : m_groups)
+		{
+			instances.clear();
+		}
+
+		m_depthPyramid.Shutdown();
+		m_bOcclusion = false;
+		m_bRetestRecorded = false;
+
+		if (m_pipeline != VK_NULL_HANDLE)
+		{
+			vkDestroyPipeline(device, m_pipeline, nullptr);
+			m_pipeline = VK_NULL_HANDLE;
+		}
+
+		if (m_pipelineLayout != VK_NULL_HANDLE)
+		{
+			vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+			m_pipelineLayout = VK_NULL_HANDLE;
+		}
+
+		// the sets go with their pool
+		if (m_descriptorPool != VK_NULL_HANDLE)
+		{
+			vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
+			m_descriptorPool = VK_NULL_HANDLE;
+		}
+
+		if (m_descriptorSetLayout != VK_NULL_HANDLE)
+		{
+			vkDestroyDescriptorSetLayout(device, m_descriptorSetLayout, nullptr);
+			m_descriptorSetLayout = VK_NULL_HANDLE;
+		}
+
+		m_pfnDrawIndirectCount = nullptr;
+		m_bMultiDrawIndirect = false;
+		m_bIsInitialized = false;
+	}
+
+	bool VKNGPUCuller::EnableOcclusion(bool bEnable, const std::string& pyramidShaderPath)
+	{
+		RenderCheckOK(m_bIsInitialized);
+
+		if (bEnable && !m_depthPyramid.CanBuild() && !m_depthPyramid.CreatePipeline(pyramidShaderPath))
+		{
+			Log::PrintError("VKNGPUCuller::EnableOcclusion() failed to create depth pyramid pipeline!");
+			return false;
+		}
+
+		m_bOcclusion = bEnable;
+
+		return true;
+	}
+
+	void VKNGPUCuller::BeginFrame()
+	{
+		if (!m_frames.empty())
+		{
+			m_currentFrame = (m_currentFrame + 1) % static_cast<uint32_t>(m_frames.size());
+		}
+
+		for (auto& instances : m_groups)
+		{
+			instances.clear();
+		}
+	}
+
+	void VKNGPUCuller::SetInstances(uint32_t group, const std::vector<Instance>& instances)
+	{
+		assert(group < s_kMaxGroups);
+		if (group < s_kMaxGroups)
+		{
+			m_groups[group] = instances;
+		}
+	}
+
+	bool VKNGPUCuller::RecordCull(VkCommandBuffer cmd, const float* pViewMat, const float* pProjMat)
+	{
+		RenderCheckOK(m_bIsInitialized);
+		assert(pViewMat && pProjMat);
+
+		FrameResources& frame = m_frames[m_currentFrame];
+
+		// nothing in this command buffer may reference the pyramid before it is resized
+		m_depthPyramid.PrepareForFrame(cmd);
+		if (frame.pyramidGeneration != m_depthPyramid.GetGeneration())
+		{
+			WriteDescriptorSet(frame);
+		}
+
+		size_t total = 0;
+		for (const auto& instances : m_groups)
+		{
+			total += instances.size();
+		}
+
+		// NOTE: this frame's buffers were last used a full swap chain cycle ago, so they are free to replace
+		if (total > frame.capacity)
+		{
+			uint32_t capacity = (frame.capacity > 0) ? frame.capacity : s_kMinCapacity;
+			while (capacity < total)
+			{
+				capacity *= 2;
+			}
+
+			DestroyFrameResources(frame);
+			if (!CreateFrameResources(frame, capacity))
+			{
+				Log::PrintError("VKNGPUCuller::RecordCull() failed to grow instance buffers!");
+				return false;
+			}
+
+			WriteDescriptorSet(frame);
+		}
+
+		Instance* pInstances = static_cast<Instance*>(frame.instanceBuffer.pMapped);
+		uint32_t first = 0;
+		for (uint32_t group = 0; group < s_kMaxGroups; ++group)
+		{
+			const std::vector<Instance>& instances = m_groups[group];
+			frame.first[group] = first;
+			frame.count[group] = static_cast<uint32_t>(instances.size());
+			if (!instances.empty())
+			{
+				memcpy(pInstances + first, instances.data(), instances.size() * sizeof(Instance));
+			}
+			first += frame.count[group];
+		}
+
+		CameraData* pCamera = static_cast<CameraData*>(frame.cameraBuffer.pMapped);
+		memcpy(pCamera->viewCam, pViewMat, sizeof(pCamera->viewCam));
+		memcpy(pCamera->projCam, pProjMat, sizeof(pCamera->projCam));
+
+		FrustumCuller::Multiply(pProjMat, pViewMat, m_viewProj);
+		m_bRetestRecorded = false;
+
+		if (total == 0)
+		{
+			return true;
+		}
+
+		// the counts are bumped atomically by the shader, so they start from zero every frame
+		vkCmdFillBuffer(cmd, frame.countBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+
+		VkBufferMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = frame.countBuffer.buffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+
+		vkCmdPipelineBarrier(cmd,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0,
+			0, nullptr,
+			1, &barrier,
+			0, nullptr);
+
+		// last frame's pyramid, seen from the camera it was built with
+		const bool bOcclusion = m_bOcclusion && m_depthPyramid.IsValid();
+		RecordDispatches(cmd, frame, kFirstPhase, m_pyramidViewProj, bOcclusion);
+
+		return true;
+	}
+
+	bool VKNGPUCuller::RecordOcclusionRetest(VkCommandBuffer cmd, const TextureObject& depth, uint32_t width, uint32_t height)
+	{
+		RenderCheckOK(m_bIsInitialized);
+
+		if (!m_bOcclusion)
+		{
+			return true;
+		}
+
+		const FrameResources& frame = m_frames[m_currentFrame];
+
+		// a pyramid that could not be built this frame (e.g. the depth buffer changed size) draws every
+		// phase 1 reject rather than letting it pop in a frame late
+		const bool bBuilt = m_depthPyramid.Build(cmd, depth, width, height);
+		if (bBuilt)
+		{
+			memcpy(m_pyramidViewProj, m_viewProj, sizeof(m_viewProj));
+		}
+
+		size_t total = 0;
+		for (const auto& instances : m_groups)
+		{
+			total += instances.size();
+		}
+
+		if (total > 0)
+		{
+			RecordDispatches(cmd, frame, kSecondPhase, m_viewProj, bBuilt);
+			m_bRetestRecorded = true;
+		}
+
+		return true;
+	}
+
+	void VKNGPUCuller::RecordDispatches(VkCommandBuffer cmd, const FrameResources& frame, Phase phase, const float* pOcclusionViewProj, bool bOcclusion)
+	{
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &frame.descriptorSet, 0, nullptr);
+
+		for (uint32_t group = 0; group < s_kMaxGroups; ++group)
+		{
+			if (frame.count[group] == 0)
+			{
+				continue;
+			}
+
+			CullGroup cullGroup;
+			memcpy(cullGroup.occlusionViewProj, pOcclusionViewProj, sizeof(cullGroup.occlusionViewProj));
+			cullGroup.pyramidSize[0] = static_cast<float>(m_depthPyramid.GetWidth());
+			cullGroup.pyramidSize[1] = static_cast<float>(m_depthPyramid.GetHeight());
+			cullGroup.first = frame.first[group];
+			cullGroup.count = frame.count[group];
+			cullGroup.countIndex = phase * s_kMaxGroups + group;
+			cullGroup.commandOffset = phase * frame.capacity;
+			cullGroup.compact = IsCompacting() ? 1 : 0;
+			cullGroup.phase = phase;
+			cullGroup.occlusion = bOcclusion ? 1 : 0;
+
+			vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullGroup), &cullGroup);
+			vkCmdDispatch(cmd, (cullGroup.count + s_kLocalSize - 1) / s_kLocalSize, 1, 1);
+		}
+
+		// output commands and counts are consumed by the indirect draws, the phase flags by phase 2
+		VkBufferMemoryBarrier barriers[3] = {};
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			barriers[i].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barriers[i].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			barriers[i].dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+			barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barriers[i].offset = 0;
+			barriers[i].size = VK_WHOLE_SIZE;
+		}
+		barriers[0].buffer = frame.commandBuffer.buffer;
+		barriers[1].buffer = frame.countBuffer.buffer;
+		barriers[1].dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		barriers[2].buffer = frame.flagBuffer.buffer;
+		barriers[2].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(cmd,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0,
+			0, nullptr,
+			3, barriers,
+			0, nullptr);
+	}
+
+	void VKNGPUCuller::RecordDraw(VkCommandBuffer cmd, uint32_t group, Phase phase) const
+	{
+		assert(group < s_kMaxGroups);
+		if (!m_bIsInitialized || group >= s_kMaxGroups)
+		{
+			return;
+		}
+
+		const FrameResources& frame = m_frames[m_currentFrame];
+		if (frame.count[group] == 0 || (phase == kSecondPhase && !m_bRetestRecorded))
+		{
+			return;
+		}
+
+		const VkDeviceSize offset = (phase * frame.capacity + frame.first[group]) * sizeof(VkDrawIndirectCommand);
+		if (m_pfnDrawIndirectCount)
+		{
+			m_pfnDrawIndirectCount(cmd,
+				frame.commandBuffer.buffer,
+				offset,
+				frame.countBuffer.buffer,
+				(phase * s_kMaxGroups + group) * sizeof(uint32_t),
+				frame.count[group],
+				sizeof(VkDrawIndirectCommand));
+		}
+		else
+		{
+			VKNComputeUtils::RecordDrawIndirect(cmd, frame.commandBuffer.buffer, offset, frame.count[group], m_bMultiDrawIndirect);
+		}
+	}
+
+	uint32_t VKNGPUCuller::GetNumInstances(uint32_t group) const
+	{
+		assert(group < s_kMaxGroups);
+		return (group < s_kMaxGroups) ? static_cast<uint32_t>(m_groups[group].size()) : 0;
+	}
+
+	bool VKNGPUCuller::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, Buffer& buffer)
+	{
+		VkDevice device = m_context.GetDevice();
+
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size;
+		bufferInfo.usage = usage;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer.buffer) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNGPUCuller::CreateBuffer() failed to create buffer!");
+			return false;
+		}
+
+		VkMemoryRequirements memReqs;
+		vkGetBufferMemoryRequirements(device, buffer.buffer, &memReqs);
+
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = memReqs.size;
+		if (!VKNComputeUtils::FindMemoryType(m_context, memReqs.memoryTypeBits, properties, allocInfo.memoryTypeIndex) ||
+			vkAllocateMemory(device, &allocInfo, nullptr, &buffer.memory) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNGPUCuller::CreateBuffer() failed to allocate memory!");
+			DestroyBuffer(buffer);
+			return false;
+		}
+
+		RenderCheckOK(vkBindBufferMemory(device, buffer.buffer, buffer.memory, 0) == VK_SUCCESS);
+		buffer.size = size;
+
+		// host visible buffers stay mapped for their lifetime
+		if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			RenderCheckOK(vkMapMemory(device, buffer.memory, 0, size, 0, &buffer.pMapped) == VK_SUCCESS);
+		}
+
+		return true;
+	}
+
+	void VKNGPUCuller::DestroyBuffer(Buffer& buffer)
+	{
+		VkDevice device = m_context.GetDevice();
+
+		if (buffer.pMapped)
+		{
+			vkUnmapMemory(device, buffer.memory);
+		}
+
+		if (buffer.buffer != VK_NULL_HANDLE)
+		{
+			vkDestroyBuffer(device, buffer.buffer, nullptr);
+		}
+
+		if (buffer.memory != VK_NULL_HANDLE)
+		{
+			vkFreeMemory(device, buffer.memory, nullptr);
+		}
+
+		buffer = Buffer();
+	}
+
+	bool VKNGPUCuller::CreateFrameResources(FrameResources& frame, uint32_t capacity)
+	{
+		const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+		RenderCheckOK(CreateBuffer(capacity * sizeof(Instance),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			hostVisible,
+			frame.instanceBuffer));
+
+		RenderCheckOK(CreateBuffer(kMaxPhases * capacity * sizeof(VkDrawIndirectCommand),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			frame.commandBuffer));
+
+		RenderCheckOK(CreateBuffer(capacity * sizeof(uint32_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			frame.flagBuffer));
+
+		RenderCheckOK(CreateBuffer(kMaxPhases * s_kMaxGroups * sizeof(uint32_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			frame.countBuffer));
+
+		RenderCheckOK(CreateBuffer(sizeof(CameraData),
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			hostVisible,
+			frame.cameraBuffer));
+
+		frame.capacity = capacity;
+
+		return true;
+	}
+
+	void VKNGPUCuller::DestroyFrameResources(FrameResources& frame)
+	{
+		DestroyBuffer(frame.instanceBuffer);
+		DestroyBuffer(frame.commandBuffer);
+		DestroyBuffer(frame.countBuffer);
+		DestroyBuffer(frame.flagBuffer);
+		DestroyBuffer(frame.cameraBuffer);
+		frame.capacity = 0;
+
+		for (uint32_t group = 0; group < s_kMaxGroups; ++group)
+		{
+			frame.first[group] = 0;
+			frame.count[group] = 0;
+		}
+	}
+
+	void VKNGPUCuller::WriteDescriptorSet(FrameResources& frame)
+	{
+		const Buffer* pBuffers[s_kNumBindings - 1] = { &frame.cameraBuffer, &frame.instanceBuffer, &frame.commandBuffer, &frame.countBuffer, &frame.flagBuffer };
+
+		VkDescriptorBufferInfo bufferInfos[s_kNumBindings - 1] = {};
+		VkWriteDescriptorSet writes[s_kNumBindings] = {};
+		for (uint32_t i = 0; i < s_kNumBindings; ++i)
+		{
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = frame.descriptorSet;
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = GetDescriptorType(i);
+
+			if (i < s_kNumBindings - 1)
+			{
+				bufferInfos[i].buffer = pBuffers[i]->buffer;
+				bufferInfos[i].offset = 0;
+				bufferInfos[i].range = pBuffers[i]->size;
+				writes[i].pBufferInfo = &bufferInfos[i];
+			}
+		}
+
+		VkDescriptorImageInfo pyramidInfo = {};
+		pyramidInfo.sampler = m_depthPyramid.GetSampler();
+		pyramidInfo.imageView = m_depthPyramid.GetView();
+		pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		writes[s_kNumBindings - 1].pImageInfo = &pyramidInfo;
+
+		vkUpdateDescriptorSets(m_context.GetDevice(), s_kNumBindings, writes, 0, nullptr);
+		frame.pyramidGeneration = m_depthPyramid.GetGeneration();
+	}
+
+	VkDescriptorType VKNGPUCuller::GetDescriptorType(uint32_t binding)
+	{
+		if (binding == 0)
+		{
+			return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		}
+
+		return (binding == s_kNumBindings - 1) ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	}
+
+	bool VKNGPUCuller::CreatePipeline(const std::string& shaderPath)
+	{
+		VkDevice device = m_context.GetDevice();
+
+		VkPushConstantRange pushConstantRange = {};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(CullGroup);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+		if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNGPUCuller::CreatePipeline() failed to create pipeline layout!");
+			return false;
+		}
+
+		return VKNComputeUtils::CreateComputePipeline(m_context, shaderPath, m_pipelineLayout, m_pipeline);
+	}
+}
@@ -0,0 +1,173 @@
+// VKNGPUCuller.h
+// Compute pre-pass that frustum culls per-instance bounding spheres on the GPU and writes the
+// surviving VkDrawIndirectCommands, compacted, plus a draw count per group for vkCmdDrawIndirectCount.
+// Instances are split into groups (one per IMultiDraw object) that are culled in one dispatch each
+// and drawn with one indirect call each.
+// Buffers are kept per swap chain image, so the CPU fills the next frame's instances while the GPU
+// is still reading the previous ones. Without drawIndirectCount support, culled commands are written
+// in place with instanceCount = 0 and drawn with plain vkCmdDrawIndirect instead. Without the
+// multiDrawIndirect feature too, one vkCmdDrawIndirect per command.
+// With occlusion on, culling runs in two phases around the geometry pass:
+//   phase 1 (RecordCull()): frustum + occlusion against the depth pyramid of the previous frame,
+//                           reprojected with the camera it was built with. Draw phase 1.
+//   phase 2 (RecordOcclusionRetest()): build the pyramid from this frame's depth, and re-test only
+//                           what phase 1 found occluded. Draw phase 2 (the disoccluded objects).
+// The pyramid built in phase 2 is the next frame's phase 1 occluder
+#pragma once
+#ifndef VKN_GPU_CULLER_H
+#define VKN_GPU_CULLER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "VulkanHelper.h"
+#include "VKNDepthPyramid.h"
+
+namespace GamePrototype
+{
+    class VulkanRenderContext;
+
+    class VKNGPUCuller;
+    typedef std::shared_ptr<VKNGPUCuller> VKNGPUCullerPtr;
+
+    class VKNGPUCuller
+    {
+    public:
+        // std430 layout of one element of the instance buffer (BatchDrawCull_CS)
+        struct Instance
+        {
+            float                   bounds[4];      // world space sphere center, radius. FLT_MAX radius is never culled
+            VkDrawIndirectCommand   command;
+        };
+
+        enum Phase
+        {
+            kFirstPhase,
+            kSecondPhase,
+            kMaxPhases
+        };
+
+        static const uint32_t s_kMaxGroups = 4;
+
+        explicit VKNGPUCuller(VulkanRenderContext&);
+        ~VKNGPUCuller();
+
+        VKNGPUCuller(const VKNGPUCuller&) = delete;
+        VKNGPUCuller& operator=(const VKNGPUCuller&) = delete;
+
+        // shaderPath: compiled SPIR-V of BatchDrawCull_CS.comp. bDrawIndirectCount: the device was created
+        // with the drawIndirectCount feature (Vulkan 1.2 or VK_KHR_draw_indirect_count). bMultiDrawIndirect:
+        // with the multiDrawIndirect feature, which compaction needs as well (a group is one multi-draw)
+        bool Init(const std::string& shaderPath, bool bDrawIndirectCount, bool bMultiDrawIndirect);
+        void Shutdown();
+
+        // pyramidShaderPath: compiled SPIR-V of BatchDrawDepthPyramid_CS.comp
+        bool EnableOcclusion(bool bEnable, const std::string& pyramidShaderPath = std::string());
+        bool IsOcclusion() const { return m_bOcclusion; }
+
+        // moves on to the next swap chain image's buffers. Call once per frame before SetInstances()
+        void BeginFrame();
+
+        // this frame's instances for a group, kept until the next BeginFrame()
+        void SetInstances(uint32_t group, const std::vector<Instance>& instances);
+
+        // uploads the groups (growing the current frame's buffers as needed) and records the culling
+        // dispatches. Must be recorded outside a render pass, before the draws consuming the output.
+        // Matrices are column major, as in the effect's UniformData
+        bool RecordCull(VkCommandBuffer, const float* pViewMat, const float* pProjMat);
+
+        // occlusion only: builds the depth pyramid from this frame's depth (phase 1 drawn, render pass ended,
+        // see VKNDepthPyramid::Build()) and records the phase 2 re-test. Same camera as RecordCull()
+        bool RecordOcclusionRetest(VkCommandBuffer, const TextureObject& depth, uint32_t width, uint32_t height);
+
+        // records one indirect draw for the group, with its pipeline and vertex buffers already bound
+        void RecordDraw(VkCommandBuffer, uint32_t group, Phase = kFirstPhase) const;
+
+        bool IsCompacting() const { return m_pfnDrawIndirectCount != nullptr; }
+        uint32_t GetNumInstances(uint32_t group) const;
+
+    private:
+
+        struct CameraData
+        {
+            float                   viewCam[16];
+            float                   projCam[16];
+        };
+
+        // push constants (BatchDrawCull_CS CullGroup)
+        struct CullGroup
+        {
+            float                   occlusionViewProj[16];  // camera the depth pyramid was built with
+            float                   pyramidSize[2];
+            uint32_t                first;
+            uint32_t                count;
+            uint32_t                countIndex;             // phase * s_kMaxGroups + group
+            uint32_t                commandOffset;          // phase * capacity
+            uint32_t                compact;
+            uint32_t                phase;
+            uint32_t                occlusion;
+        };
+
+        struct Buffer
+        {
+            VkBuffer                buffer;
+            VkDeviceMemory          memory;
+            VkDeviceSize            size;
+            void*                   pMapped;        // host visible buffers only
+
+            Buffer() : buffer(VK_NULL_HANDLE), memory(VK_NULL_HANDLE), size(0), pMapped(nullptr) {}
+        };
+
+        // everything one frame in flight owns
+        struct FrameResources
+        {
+            Buffer                  instanceBuffer;     // host visible, Instance[]
+            Buffer                  commandBuffer;      // device local, VkDrawIndirectCommand[capacity] per phase
+            Buffer                  countBuffer;        // device local, one uint32_t per group per phase
+            Buffer                  flagBuffer;         // device local, uint32_t[capacity], 0 == re-test in phase 2
+            Buffer                  cameraBuffer;       // host visible, CameraData
+            VkDescriptorSet         descriptorSet;
+            uint32_t                pyramidGeneration;  // of the pyramid view in descriptorSet
+            uint32_t                capacity;           // instances
+            uint32_t                first[s_kMaxGroups];
+            uint32_t                count[s_kMaxGroups];
+
+            FrameResources();
+        };
+
+        bool CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, Buffer&);
+        void DestroyBuffer(Buffer&);
+        bool CreateFrameResources(FrameResources&, uint32_t capacity);
+        void DestroyFrameResources(FrameResources&);
+        void WriteDescriptorSet(FrameResources&);
+        bool CreatePipeline(const std::string& shaderPath);
+        static VkDescriptorType GetDescriptorType(uint32_t binding);
+        void RecordDispatches(VkCommandBuffer, const FrameResources&, Phase, const float* pOcclusionViewProj, bool bOcclusion);
+
+        VulkanRenderContext&                m_context;
+        std::vector<FrameResources>         m_frames;
+        uint32_t                            m_currentFrame;
+        std::vector<Instance>               m_groups[s_kMaxGroups];
+        VkDescriptorSetLayout               m_descriptorSetLayout;
+        VkDescriptorPool                    m_descriptorPool;
+        VkPipelineLayout                    m_pipelineLayout;
+        VkPipeline                          m_pipeline;
+        PFN_vkCmdDrawIndirectCount          m_pfnDrawIndirectCount;
+        bool                                m_bMultiDrawIndirect;
+        bool                                m_bIsInitialized;
+
+        // occlusion
+        VKNDepthPyramid                     m_depthPyramid;
+        float                               m_viewProj[16];         // this frame's camera, from RecordCull()
+        float                               m_pyramidViewProj[16];  // camera m_depthPyramid was built with
+        bool                                m_bOcclusion;
+        bool                                m_bRetestRecorded;     // phase 2 commands exist this frame
+
+        static const uint32_t s_kLocalSize = 64;
+        static const uint32_t s_kMinCapacity = 1024;
+        static const uint32_t s_kNumBindings = 6;
+    };
+}
+
+#endif // VKN_GPU_CULLER_H
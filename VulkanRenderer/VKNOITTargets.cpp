@@ -0,0 +1,651 @@
+// VKNOITTargets.cpp
+#include "stdafx.h"
+#include "VKNOITTargets.h"
+#include "VKNComputeUtils.h"
+#include "VulkanRenderContext.h"
+
+#include <cassert>
+
+namespace GamePrototype
+{
+	const uint32_t VKNOITTargets::s_kMaxImages;
+
+	VKNOITTargets::VKNOITTargets(VulkanRenderContext& context)
+	:
+	m_context(context),
+	m_renderPass(VK_NULL_HANDLE),
+	m_sampler(VK_NULL_HANDLE),
+	m_descriptorSetLayout(VK_NULL_HANDLE),
+	m_descriptorPool(VK_NULL_HANDLE),
+	m_pipelineLayout(VK_NULL_HANDLE),
+	m_compositePipeline(VK_NULL_HANDLE)
+	{
+	}
+
+	VKNOITTargets::~VKNOITTargets()
+	{
+		Shutdown();
+	}
+
+	bool VKNOITTargets::Init(VkFormat depthFormat, VkRenderPass compositeRenderPass,
+		const std::string& compositeVertexShaderPath, const std::string& compositeFragmentShaderPath)
+	{
+		if (m_renderPass != VK_NULL_HANDLE)
+		{
+			return true;
+		}
+
+		RenderCheckOK(compositeRenderPass != VK_NULL_HANDLE);
+
+		VkDevice device = m_context.GetDevice();
+
+		if (!CreateRenderPass(depthFormat))
+		{
+			Shutdown();
+			return false;
+		}
+
+		// the composite reads one texel per pixel
+		VkSamplerCreateInfo samplerInfo = {};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_NEAREST;
+		samplerInfo.minFilter = VK_FILTER_NEAREST;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.maxLod = 0.0f;
+		samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+		if (vkCreateSampler(device, &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNOITTargets::Init() failed to create sampler!");
+			Shutdown();
+			return false;
+		}
+
+		// binding 0: accumulation, binding 1: revealage
+		VkDescriptorSetLayoutBinding bindings[2] = {};
+		for (uint32_t i = 0; i < 2; ++i)
+		{
+			bindings[i].binding = i;
+			bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		}
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = 2;
+		layoutInfo.pBindings = bindings;
+		if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNOITTargets::Init() failed to create descriptor set layout!");
+			Shutdown();
+			return false;
+		}
+
+		VkDescriptorPoolSize poolSize = {};
+		poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		poolSize.descriptorCount = 2 * s_kMaxImages;
+
+		VkDescriptorPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+		poolInfo.maxSets = s_kMaxImages;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+		if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNOITTargets::Init() failed to create descriptor pool!");
+			Shutdown();
+			return false;
+		}
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
+		if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNOITTargets::Init() failed to create pipeline layout!");
+			Shutdown();
+			return false;
+		}
+
+		if (!CreateCompositePipeline(compositeRenderPass, compositeVertexShaderPath, compositeFragmentShaderPath))
+		{
+			Shutdown();
+			return false;
+		}
+
+		return true;
+	}
+
+	void VKNOITTargets::Shutdown()
+	{
+		VkDevice device = m_context.GetDevice();
+
+		for (Targets& targets : m_targets)
+		{
+			DestroyTargets(targets);
+		}
+		m_targets.clear();
+
+		if (m_compositePipeline != VK_NULL_HANDLE)
+		{
+			vkDestroyPipeline(device, m_compositePipeline, nullptr);
+			m_compositePipeline = VK_NULL_HANDLE;
+		}
+
+		if (m_pipelineLayout != VK_NULL_HANDLE)
+		{
+			vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+			m_pipelineLayout = VK_NULL_HANDLE;
+		}
+
+		if (m_descriptorPool != VK_NULL_HANDLE)
+		{
+			vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
+			m_descriptorPool = VK_NULL_HANDLE;
+		}
+
+		if (m_descriptorSetLayout != VK_NULL_HANDLE)
+		{
+			vkDestroyDescriptorSetLayout(device, m_descriptorSetLayout, nullptr);
+			m_descriptorSetLayout = VK_NULL_HANDLE;
+		}
+
+		if (m_sampler != VK_NULL_HANDLE)
+		{
+			vkDestroySampler(device, m_sampler, nullptr);
+			m_sampler = VK_NULL_HANDLE;
+		}
+
+		if (m_renderPass != VK_NULL_HANDLE)
+		{
+			vkDestroyRenderPass(device, m_renderPass, nullptr);
+			m_renderPass = VK_NULL_HANDLE;
+		}
+	}
+
+	VkPipelineColorBlendAttachmentState VKNOITTargets::GetAccumBlendState()
+	{
+		// sum of weighted premultiplied color (rgb) and weighted coverage (a)
+		VkPipelineColorBlendAttachmentState accumBlendState
+		{
+			VK_TRUE,							// blendEnable
+			VK_BLEND_FACTOR_ONE,				// srcColorBlendFactor
+			VK_BLEND_FACTOR_ONE,				// dstColorBlendFactor
+			VK_BLEND_OP_ADD,					// colorBlendOp
+			VK_BLEND_FACTOR_ONE,				// srcAlphaBlendFactor
+			VK_BLEND_FACTOR_ONE,				// dstAlphaBlendFactor
+			VK_BLEND_OP_ADD,					// alphaBlendOp
+			VK_COLOR_COMPONENT_R_BIT |
+			VK_COLOR_COMPONENT_G_BIT |
+			VK_COLOR_COMPONENT_B_BIT |
+			VK_COLOR_COMPONENT_A_BIT			// colorWriteMask
+		};
+
+		return accumBlendState;
+	}
+
+	VkPipelineColorBlendAttachmentState VKNOITTargets::GetRevealageBlendState()
+	{
+		// product of (1 - alpha) over every surface, the shader writes alpha to r
+		VkPipelineColorBlendAttachmentState revealageBlendState
+		{
+			VK_TRUE,							// blendEnable
+			VK_BLEND_FACTOR_ZERO,				// srcColorBlendFactor
+			VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR,// dstColorBlendFactor
+			VK_BLEND_OP_ADD,					// colorBlendOp
+			VK_BLEND_FACTOR_ZERO,				// srcAlphaBlendFactor
+			VK_BLEND_FACTOR_ONE,				// dstAlphaBlendFactor
+			VK_BLEND_OP_ADD,					// alphaBlendOp
+			VK_COLOR_COMPONENT_R_BIT			// colorWriteMask
+		};
+
+		return revealageBlendState;
+	}
+
+	bool VKNOITTargets::Begin(VkCommandBuffer cmd, uint32_t imageIndex, const TextureObject& depth, uint32_t width, uint32_t height)
+	{
+		RenderCheckOK(m_renderPass != VK_NULL_HANDLE);
+
+		if (imageIndex >= s_kMaxImages || width == 0 || height == 0)
+		{
+			Log::PrintError("VKNOITTargets::Begin() invalid swap chain image or size!");
+			return false;
+		}
+
+		if (imageIndex >= m_targets.size())
+		{
+			m_targets.resize(imageIndex + 1, Targets{});
+		}
+
+		Targets& targets = m_targets[imageIndex];
+		if (targets.framebuffer == VK_NULL_HANDLE || targets.depthView != depth.view ||
+			targets.width != width || targets.height != height)
+		{
+			if (targets.framebuffer != VK_NULL_HANDLE)
+			{
+				// earlier frames may still use the old targets
+				vkDeviceWaitIdle(m_context.GetDevice());
+				DestroyTargets(targets);
+			}
+
+			if (!CreateTargets(targets, depth, width, height))
+			{
+				DestroyTargets(targets);
+				return false;
+			}
+		}
+
+		// nothing accumulated, everything revealed
+		VkClearValue clearValues[2] = {};
+		clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+		clearValues[1].color = { { 1.0f, 1.0f, 1.0f, 1.0f } };
+
+		VkRenderPassBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		beginInfo.renderPass = m_renderPass;
+		beginInfo.framebuffer = targets.framebuffer;
+		beginInfo.renderArea.offset = { 0, 0 };
+		beginInfo.renderArea.extent = { width, height };
+		beginInfo.clearValueCount = 2;
+		beginInfo.pClearValues = clearValues;
+		vkCmdBeginRenderPass(cmd, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+		VkViewport viewport = { 0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f, 1.0f };
+		VkRect2D scissor = { { 0, 0 }, { width, height } };
+		vkCmdSetViewport(cmd, 0, 1, &viewport);
+		vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+		return true;
+	}
+
+	void VKNOITTargets::End(VkCommandBuffer cmd)
+	{
+		vkCmdEndRenderPass(cmd);
+	}
+
+	bool VKNOITTargets::RecordComposite(VkCommandBuffer cmd, uint32_t imageIndex)
+	{
+		if (m_compositePipeline == VK_NULL_HANDLE || imageIndex >= m_targets.size() ||
+			m_targets[imageIndex].framebuffer == VK_NULL_HANDLE)
+		{
+			return false;
+		}
+
+		const Targets& targets = m_targets[imageIndex];
+
+		VkViewport viewport = { 0.0f, 0.0f, static_cast<float>(targets.width), static_cast<float>(targets.height), 0.0f, 1.0f };
+		VkRect2D scissor = { { 0, 0 }, { targets.width, targets.height } };
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_compositePipeline);
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &targets.descriptorSet, 0, nullptr);
+		vkCmdSetViewport(cmd, 0, 1, &viewport);
+		vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+		// one triangle covering the screen, made up in the vertex shader
+		vkCmdDraw(cmd, 3, 1, 0, 0);
+
+		return true;
+	}
+
+	bool VKNOITTargets::CreateRenderPass(VkFormat depthFormat)
+	{
+		VkAttachmentDescription attachments[3] = {};
+
+		// accumulation and revealage, sampled by the composite afterwards
+		attachments[0].format = s_kAccumFormat;
+		attachments[1].format = s_kRevealageFormat;
+		for (uint32_t i = 0; i < 2; ++i)
+		{
+			attachments[i].samples = VK_SAMPLE_COUNT_1_BIT;
+			attachments[i].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachments[i].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			attachments[i].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachments[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachments[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			attachments[i].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		}
+
+		// the GBuffer depth, tested against but left as it is
+		attachments[2].format = depthFormat;
+		attachments[2].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachments[2].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		attachments[2].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachments[2].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		attachments[2].stencilStoreOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachments[2].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		attachments[2].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+		VkAttachmentReference colorRefs[2] =
+		{
+			{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+			{ 1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL }
+		};
+		VkAttachmentReference depthRef = { 2, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = 2;
+		subpass.pColorAttachments = colorRefs;
+		subpass.pDepthStencilAttachment = &depthRef;
+
+		VkSubpassDependency dependencies[2] = {};
+
+		// the geometry pass's depth writes, and the previous composite's reads of the targets, come first
+		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[0].dstSubpass = 0;
+		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT;
+		dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+		// the composite samples what was accumulated
+		dependencies[1].srcSubpass = 0;
+		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		VkRenderPassCreateInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = 3;
+		renderPassInfo.pAttachments = attachments;
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+		renderPassInfo.dependencyCount = 2;
+		renderPassInfo.pDependencies = dependencies;
+
+		if (vkCreateRenderPass(m_context.GetDevice(), &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNOITTargets::CreateRenderPass() failed to create render pass!");
+			return false;
+		}
+
+		return true;
+	}
+
+	bool VKNOITTargets::CreateCompositePipeline(VkRenderPass renderPass, const std::string& vertexShaderPath, const std::string& fragmentShaderPath)
+	{
+		VkDevice device = m_context.GetDevice();
+
+		VkShaderModule vertexModule = VK_NULL_HANDLE;
+		VkShaderModule fragmentModule = VK_NULL_HANDLE;
+		if (!VKNComputeUtils::CreateShaderModule(m_context, vertexShaderPath, vertexModule) ||
+			!VKNComputeUtils::CreateShaderModule(m_context, fragmentShaderPath, fragmentModule))
+		{
+			if (vertexModule != VK_NULL_HANDLE)
+			{
+				vkDestroyShaderModule(device, vertexModule, nullptr);
+			}
+			return false;
+		}
+
+		VkPipelineShaderStageCreateInfo stages[2] = {};
+		stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+		stages[0].module = vertexModule;
+		stages[0].pName = "main";
+		stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+		stages[1].module = fragmentModule;
+		stages[1].pName = "main";
+
+		// no vertex buffers, the vertex shader works from gl_VertexIndex
+		VkPipelineVertexInputStateCreateInfo vertexInputState = {};
+		vertexInputState.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState =
+			VulkanHelper::InitPipelineInputAssemblyStateCreateInfo(
+			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+			0,
+			VK_FALSE);
+
+		VkPipelineRasterizationStateCreateInfo rasterizationState =
+			VulkanHelper::InitPipelineRasterizationStateCreateInfo(
+			VK_POLYGON_MODE_FILL,
+			VK_CULL_MODE_NONE,
+			VK_FRONT_FACE_COUNTER_CLOCKWISE,
+			0);
+
+		// out = average color * (1 - revealage) + dst * revealage. Destination alpha is kept
+		VkPipelineColorBlendAttachmentState compositeBlendState
+		{
+			VK_TRUE,							// blendEnable
+			VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,// srcColorBlendFactor
+			VK_BLEND_FACTOR_SRC_ALPHA,			// dstColorBlendFactor
+			VK_BLEND_OP_ADD,					// colorBlendOp
+			VK_BLEND_FACTOR_ZERO,				// srcAlphaBlendFactor
+			VK_BLEND_FACTOR_ONE,				// dstAlphaBlendFactor
+			VK_BLEND_OP_ADD,					// alphaBlendOp
+			VK_COLOR_COMPONENT_R_BIT |
+			VK_COLOR_COMPONENT_G_BIT |
+			VK_COLOR_COMPONENT_B_BIT |
+			VK_COLOR_COMPONENT_A_BIT			// colorWriteMask
+		};
+
+		VkPipelineColorBlendStateCreateInfo colorBlendState
+		{
+			VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+			0,									// pNext
+			0,									// flags
+			VK_FALSE,							// logicOpEnable
+			VK_LOGIC_OP_CLEAR,					// logicOp
+			1,									// attachmentCount
+			&compositeBlendState,				// pAttachments
+			{ 1.f, 1.f, 1.f, 1.f }				// blend constants
+		};
+
+		VkPipelineDepthStencilStateCreateInfo depthStencilState =
+			VulkanHelper::InitPipelineDepthStencilStateCreateInfo(
+			VK_FALSE,
+			VK_FALSE,
+			VK_COMPARE_OP_ALWAYS);
+
+		VkPipelineViewportStateCreateInfo viewportState =
+			VulkanHelper::InitPipelineViewportStateCreateInfo(1, 1, 0);
+
+		VkPipelineMultisampleStateCreateInfo multisampleState =
+			VulkanHelper::InitPipelineMultisampleStateCreateInfo(
+			VK_SAMPLE_COUNT_1_BIT,
+			0);
+
+		const VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+		VkPipelineDynamicStateCreateInfo dynamicState =
+			VulkanHelper::InitPipelineDynamicStateCreateInfo(
+			dynamicStates,
+			2,
+			0);
+
+		VkGraphicsPipelineCreateInfo pipelineInfo = {};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineInfo.stageCount = 2;
+		pipelineInfo.pStages = stages;
+		pipelineInfo.pVertexInputState = &vertexInputState;
+		pipelineInfo.pInputAssemblyState = &inputAssemblyState;
+		pipelineInfo.pViewportState = &viewportState;
+		pipelineInfo.pRasterizationState = &rasterizationState;
+		pipelineInfo.pMultisampleState = &multisampleState;
+		pipelineInfo.pDepthStencilState = &depthStencilState;
+		pipelineInfo.pColorBlendState = &colorBlendState;
+		pipelineInfo.pDynamicState = &dynamicState;
+		pipelineInfo.layout = m_pipelineLayout;
+		pipelineInfo.renderPass = renderPass;
+		pipelineInfo.subpass = 0;
+
+		const bool bResult = (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_compositePipeline) == VK_SUCCESS);
+
+		vkDestroyShaderModule(device, vertexModule, nullptr);
+		vkDestroyShaderModule(device, fragmentModule, nullptr);
+
+		if (!bResult)
+		{
+			Log::PrintError("VKNOITTargets::CreateCompositePipeline() failed to create composite pipeline!");
+		}
+
+		return bResult;
+	}
+
+	bool VKNOITTargets::CreateTargets(Targets& targets, const TextureObject& depth, uint32_t width, uint32_t height)
+	{
+		VkDevice device = m_context.GetDevice();
+
+		if (!CreateImage(s_kAccumFormat, width, height, targets.accum) ||
+			!CreateImage(s_kRevealageFormat, width, height, targets.revealage))
+		{
+			return false;
+		}
+
+		VkImageView attachments[3] = { targets.accum.view, targets.revealage.view, depth.view };
+
+		VkFramebufferCreateInfo framebufferInfo = {};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = m_renderPass;
+		framebufferInfo.attachmentCount = 3;
+		framebufferInfo.pAttachments = attachments;
+		framebufferInfo.width = width;
+		framebufferInfo.height = height;
+		framebufferInfo.layers = 1;
+		if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &targets.framebuffer) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNOITTargets::CreateTargets() failed to create framebuffer!");
+			return false;
+		}
+
+		VkDescriptorSetAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = m_descriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &m_descriptorSetLayout;
+		if (vkAllocateDescriptorSets(device, &allocInfo, &targets.descriptorSet) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNOITTargets::CreateTargets() failed to allocate descriptor set!");
+			return false;
+		}
+
+		VkDescriptorImageInfo imageInfos[2] = {};
+		imageInfos[0].sampler = m_sampler;
+		imageInfos[0].imageView = targets.accum.view;
+		imageInfos[0].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageInfos[1].sampler = m_sampler;
+		imageInfos[1].imageView = targets.revealage.view;
+		imageInfos[1].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkWriteDescriptorSet writes[2] = {};
+		for (uint32_t i = 0; i < 2; ++i)
+		{
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = targets.descriptorSet;
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writes[i].pImageInfo = &imageInfos[i];
+		}
+
+		vkUpdateDescriptorSets(device, 2, writes, 0, nullptr);
+
+		targets.depthView = depth.view;
+		targets.width = width;
+		targets.height = height;
+
+		return true;
+	}
+
+	void VKNOITTargets::DestroyTargets(Targets& targets)
+	{
+		VkDevice device = m_context.GetDevice();
+
+		if (targets.descriptorSet != VK_NULL_HANDLE)
+		{
+			vkFreeDescriptorSets(device, m_descriptorPool, 1, &targets.descriptorSet);
+		}
+
+		if (targets.framebuffer != VK_NULL_HANDLE)
+		{
+			vkDestroyFramebuffer(device, targets.framebuffer, nullptr);
+		}
+
+		DestroyImage(targets.accum);
+		DestroyImage(targets.revealage);
+
+		targets = Targets{};
+	}
+
+	bool VKNOITTargets::CreateImage(VkFormat format, uint32_t width, uint32_t height, Image& image)
+	{
+		VkDevice device = m_context.GetDevice();
+
+		VkImageCreateInfo imageInfo = {};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = format;
+		imageInfo.extent = { width, height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		if (vkCreateImage(device, &imageInfo, nullptr, &image.image) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNOITTargets::CreateImage() failed to create image!");
+			return false;
+		}
+
+		VkMemoryRequirements memReqs;
+		vkGetImageMemoryRequirements(device, image.image, &memReqs);
+
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = memReqs.size;
+		if (!VKNComputeUtils::FindMemoryType(m_context, memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, allocInfo.memoryTypeIndex) ||
+			vkAllocateMemory(device, &allocInfo, nullptr, &image.memory) != VK_SUCCESS ||
+			vkBindImageMemory(device, image.image, image.memory, 0) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNOITTargets::CreateImage() failed to allocate memory!");
+			return false;
+		}
+
+		VkImageViewCreateInfo viewInfo = {};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = image.image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = format;
+		viewInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+		viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		if (vkCreateImageView(device, &viewInfo, nullptr, &image.view) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNOITTargets::CreateImage() failed to create image view!");
+			return false;
+		}
+
+		return true;
+	}
+
+	void VKNOITTargets::DestroyImage(Image& image)
+	{
+		VkDevice device = m_context.GetDevice();
+
+		if (image.view != VK_NULL_HANDLE)
+		{
+			vkDestroyImageView(device, image.view, nullptr);
+		}
+
+		if (image.image != VK_NULL_HANDLE)
+		{
+			vkDestroyImage(device, image.image, nullptr);
+		}
+
+		if (image.memory != VK_NULL_HANDLE)
+		{
+			vkFreeMemory(device, image.memory, nullptr);
+		}
+
+		image = Image{};
+	}
+}
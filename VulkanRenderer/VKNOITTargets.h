@@ -0,0 +1,99 @@
+// VKNOITTargets.h
+// Weighted blended order independent transparency (McGuire/Bavoil) for the batch draw effect's alpha
+// passes. Translucent surfaces are drawn in any order into two targets: an additive RGBA16F accumulation
+// of depth weighted premultiplied color, and an R16F revealage that multiplies down by (1 - alpha). A full
+// screen composite then blends the weighted average color over the opaque image, so no sorting is needed.
+// The pass tests against the GBuffer depth without writing it, which must be in
+// DEPTH_STENCIL_READ_ONLY_OPTIMAL. Targets are made per swap chain image the first time it is used, and
+// remade (waiting for the device) when its depth buffer or size changes
+#pragma once
+#ifndef VKN_OIT_TARGETS_H
+#define VKN_OIT_TARGETS_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "VulkanHelper.h"
+
+namespace GamePrototype
+{
+    class VulkanRenderContext;
+
+    class VKNOITTargets
+    {
+    public:
+        explicit VKNOITTargets(VulkanRenderContext&);
+        ~VKNOITTargets();
+
+        VKNOITTargets(const VKNOITTargets&) = delete;
+        VKNOITTargets& operator=(const VKNOITTargets&) = delete;
+
+        // depthFormat: format of the GBuffer depth the pass tests against. compositeRenderPass: the pass
+        // RecordComposite() is recorded in (subpass 0). Shader paths: compiled SPIR-V of
+        // BatchDrawOITComposite_VS.vert and BatchDrawOITComposite_FS.frag
+        bool Init(VkFormat depthFormat, VkRenderPass compositeRenderPass,
+            const std::string& compositeVertexShaderPath, const std::string& compositeFragmentShaderPath);
+        void Shutdown();
+
+        // what the translucent pipelines are built against: attachment 0 accumulation, 1 revealage
+        VkRenderPass GetRenderPass() const { return m_renderPass; }
+
+        // blending of the two color attachments, in attachment order
+        static VkPipelineColorBlendAttachmentState GetAccumBlendState();
+        static VkPipelineColorBlendAttachmentState GetRevealageBlendState();
+
+        // begins the accumulation pass over imageIndex's targets (clearing them), with viewport and scissor
+        // set to the whole target
+        bool Begin(VkCommandBuffer, uint32_t imageIndex, const TextureObject& depth, uint32_t width, uint32_t height);
+        void End(VkCommandBuffer);
+
+        // blends imageIndex's result over whatever is bound, inside compositeRenderPass. Begin()/End() of
+        // the same image must come first
+        bool RecordComposite(VkCommandBuffer, uint32_t imageIndex);
+
+    private:
+
+        struct Image
+        {
+            VkImage                 image;
+            VkDeviceMemory          memory;
+            VkImageView             view;
+        };
+
+        struct Targets
+        {
+            Image                   accum;
+            Image                   revealage;
+            VkFramebuffer           framebuffer;
+            VkDescriptorSet         descriptorSet;
+            VkImageView             depthView;          // what framebuffer was made with
+            uint32_t                width;
+            uint32_t                height;
+        };
+
+        bool CreateRenderPass(VkFormat depthFormat);
+        bool CreateCompositePipeline(VkRenderPass, const std::string& vertexShaderPath, const std::string& fragmentShaderPath);
+        bool CreateTargets(Targets&, const TextureObject& depth, uint32_t width, uint32_t height);
+        void DestroyTargets(Targets&);
+        bool CreateImage(VkFormat, uint32_t width, uint32_t height, Image&);
+        void DestroyImage(Image&);
+
+        VulkanRenderContext&                m_context;
+        VkRenderPass                        m_renderPass;
+        VkSampler                           m_sampler;
+        VkDescriptorSetLayout               m_descriptorSetLayout;
+        VkDescriptorPool                    m_descriptorPool;
+        VkPipelineLayout                    m_pipelineLayout;
+        VkPipeline                          m_compositePipeline;
+        std::vector<Targets>                m_targets;          // per swap chain image
+
+        static const VkFormat s_kAccumFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+        static const VkFormat s_kRevealageFormat = VK_FORMAT_R16_SFLOAT;
+        static const uint32_t s_kMaxImages = 8;
+    };
+
+    typedef std::shared_ptr<VKNOITTargets> VKNOITTargetsPtr;
+}
+
+#endif // VKN_OIT_TARGETS_H
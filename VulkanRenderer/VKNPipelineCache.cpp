@@ -0,0 +1,224 @@
+// VKNPipelineCache.cpp
+#include "stdafx.h"
+#include "VKNPipelineCache.h"
+#include "VulkanRenderContext.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace GamePrototype
+{
+	const uint32_t VKNPipelineCache::s_kMagic;
+	const uint32_t VKNPipelineCache::s_kVersion;
+
+	VKNPipelineCache::VKNPipelineCache(VulkanRenderContext& context)
+	:
+	m_context(context),
+	m_cache(VK_NULL_HANDLE)
+	{
+	}
+
+	VKNPipelineCache::~VKNPipelineCache()
+	{
+		Shutdown();
+	}
+
+	bool VKNPipelineCache::Init(const std::string& filePath)
+	{
+		if (m_cache != VK_NULL_HANDLE)
+		{
+			return true;
+		}
+
+		m_filePath = filePath;
+		m_stats = Stats();
+
+		std::vector<char> data;
+		if (!m_filePath.empty())
+		{
+			std::ifstream file(m_filePath, std::ios::binary | std::ios::ate);
+			if (file.is_open())
+			{
+				const size_t fileSize = static_cast<size_t>(file.tellg());
+
+				FileHeader header = {};
+				if (fileSize >= sizeof(header))
+				{
+					file.seekg(0);
+					file.read(reinterpret_cast<char*>(&header), sizeof(header));
+				}
+
+				if (fileSize >= sizeof(header) && header.dataSize == fileSize - sizeof(header))
+				{
+					data.resize(static_cast<size_t>(header.dataSize));
+					file.read(data.data(), data.size());
+				}
+
+				if (!file || data.empty() || !IsCompatible(header, data.data(), data.size()))
+				{
+					data.clear();
+					m_stats.loadResult = kRejected;
+				}
+				else
+				{
+					m_stats.loadResult = kLoaded;
+					m_stats.loadedBytes = data.size();
+				}
+			}
+		}
+
+		VkPipelineCacheCreateInfo cacheInfo = {};
+		cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		cacheInfo.initialDataSize = data.size();
+		cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+		if (vkCreatePipelineCache(m_context.GetDevice(), &cacheInfo, nullptr, &m_cache) != VK_SUCCESS)
+		{
+			// the driver may still refuse data that looked right, start over without it
+			m_stats.loadResult = kRejected;
+			m_stats.loadedBytes = 0;
+
+			cacheInfo.initialDataSize = 0;
+			cacheInfo.pInitialData = nullptr;
+			if (vkCreatePipelineCache(m_context.GetDevice(), &cacheInfo, nullptr, &m_cache) != VK_SUCCESS)
+			{
+				Log::PrintError("VKNPipelineCache::Init() failed to create pipeline cache!");
+				m_cache = VK_NULL_HANDLE;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void VKNPipelineCache::Shutdown()
+	{
+		if (m_cache == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		Save();
+
+		vkDestroyPipelineCache(m_context.GetDevice(), m_cache, nullptr);
+		m_cache = VK_NULL_HANDLE;
+	}
+
+	bool VKNPipelineCache::Save() const
+	{
+		if (m_cache == VK_NULL_HANDLE || m_filePath.empty())
+		{
+			return true;
+		}
+
+		VkDevice device = m_context.GetDevice();
+
+		size_t dataSize = 0;
+		if (vkGetPipelineCacheData(device, m_cache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+		{
+			Log::PrintError("VKNPipelineCache::Save() failed to query pipeline cache size!");
+			return false;
+		}
+
+		std::vector<char> data(dataSize);
+		if (vkGetPipelineCacheData(device, m_cache, &dataSize, data.data()) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNPipelineCache::Save() failed to read pipeline cache!");
+			return false;
+		}
+
+		FileHeader header;
+		FillHeader(header, dataSize);
+
+		// a crash half way through must not leave a truncated cache behind
+		const std::string tempPath = m_filePath + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(data.data(), dataSize);
+			if (!file)
+			{
+				Log::PrintError("VKNPipelineCache::Save() failed to write pipeline cache file!");
+				file.close();
+				std::remove(tempPath.c_str());
+				return false;
+			}
+		}
+
+		std::remove(m_filePath.c_str());
+		if (std::rename(tempPath.c_str(), m_filePath.c_str()) != 0)
+		{
+			Log::PrintError("VKNPipelineCache::Save() failed to replace pipeline cache file!");
+			return false;
+		}
+
+		return true;
+	}
+
+	size_t VKNPipelineCache::GetDataSize() const
+	{
+		size_t dataSize = 0;
+		if (m_cache != VK_NULL_HANDLE)
+		{
+			vkGetPipelineCacheData(m_context.GetDevice(), m_cache, &dataSize, nullptr);
+		}
+
+		return dataSize;
+	}
+
+	void VKNPipelineCache::CountCreation(size_t dataSizeBefore)
+	{
+		if (GetDataSize() > dataSizeBefore)
+		{
+			++m_stats.misses;
+		}
+		else
+		{
+			++m_stats.hits;
+		}
+	}
+
+	bool VKNPipelineCache::IsCompatible(const FileHeader& header, const char* pData, size_t dataSize) const
+	{
+		FileHeader expected;
+		FillHeader(expected, dataSize);
+
+		if (header.magic != expected.magic || header.version != expected.version ||
+			header.vendorID != expected.vendorID || header.deviceID != expected.deviceID ||
+			header.driverVersion != expected.driverVersion ||
+			memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+		{
+			return false;
+		}
+
+		// the driver's own header has to agree too
+		VkPipelineCacheHeaderVersionOne cacheHeader;
+		if (dataSize < sizeof(cacheHeader))
+		{
+			return false;
+		}
+
+		memcpy(&cacheHeader, pData, sizeof(cacheHeader));
+		return cacheHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+			cacheHeader.vendorID == expected.vendorID &&
+			cacheHeader.deviceID == expected.deviceID &&
+			memcmp(cacheHeader.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+
+	void VKNPipelineCache::FillHeader(FileHeader& header, size_t dataSize) const
+	{
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties(m_context.GetPhysicalDevice(), &props);
+
+		memset(&header, 0, sizeof(header));
+		header.magic = s_kMagic;
+		header.version = s_kVersion;
+		header.vendorID = props.vendorID;
+		header.deviceID = props.deviceID;
+		header.driverVersion = props.driverVersion;
+		memcpy(header.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE);
+		header.dataSize = dataSize;
+	}
+}
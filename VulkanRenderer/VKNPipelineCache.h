@@ -0,0 +1,95 @@
+// VKNPipelineCache.h
+// VkPipelineCache kept on disk between runs, so the batch draw effect's pipelines are not compiled cold at
+// every launch. The file is the driver's cache data behind a small header naming the device and driver it
+// came from. Data from another device, pipeline cache UUID or driver version is dropped (an older driver's
+// data would only miss anyway) and the cache starts out empty
+#pragma once
+#ifndef VKN_PIPELINE_CACHE_H
+#define VKN_PIPELINE_CACHE_H
+
+#include <memory>
+#include <string>
+
+#include "VulkanHelper.h"
+
+namespace GamePrototype
+{
+    class VulkanRenderContext;
+
+    class VKNPipelineCache
+    {
+    public:
+        explicit VKNPipelineCache(VulkanRenderContext&);
+        ~VKNPipelineCache();
+
+        VKNPipelineCache(const VKNPipelineCache&) = delete;
+        VKNPipelineCache& operator=(const VKNPipelineCache&) = delete;
+
+        // loads filePath if it holds usable data. Succeeds with an empty cache when it does not. An empty
+        // path keeps the cache in memory only
+        bool Init(const std::string& filePath);
+
+        // saves, then destroys the cache
+        void Shutdown();
+
+        // writes the cache to the file given to Init(), replacing it only once the new one is complete
+        bool Save() const;
+
+        VkPipelineCache GetHandle() const { return m_cache; }
+
+        // size of the cache's data right now
+        size_t GetDataSize() const;
+
+        // a batch of pipelines created with the cache since dataSizeBefore = GetDataSize() was taken is a
+        // hit when the cache did not grow (everything was in it), a miss when something had to be compiled
+        void CountCreation(size_t dataSizeBefore);
+
+        enum LoadResult
+        {
+            kNotLoaded,         // no file (or no path)
+            kLoaded,
+            kRejected           // other device or driver, or not a cache file
+        };
+
+        struct Stats
+        {
+            LoadResult          loadResult;
+            size_t              loadedBytes;
+            uint32_t            hits;
+            uint32_t            misses;
+
+            Stats() : loadResult(kNotLoaded), loadedBytes(0), hits(0), misses(0) {}
+        };
+
+        const Stats& GetStats() const { return m_stats; }
+
+    private:
+
+        // in front of the driver's data in the file
+        struct FileHeader
+        {
+            uint32_t            magic;
+            uint32_t            version;
+            uint32_t            vendorID;
+            uint32_t            deviceID;
+            uint32_t            driverVersion;
+            uint8_t             pipelineCacheUUID[VK_UUID_SIZE];
+            uint64_t            dataSize;
+        };
+
+        bool IsCompatible(const FileHeader&, const char* pData, size_t dataSize) const;
+        void FillHeader(FileHeader&, size_t dataSize) const;
+
+        VulkanRenderContext&                m_context;
+        VkPipelineCache                     m_cache;
+        std::string                         m_filePath;
+        Stats                               m_stats;
+
+        static const uint32_t s_kMagic = 0x43504b56;    // "VKPC"
+        static const uint32_t s_kVersion = 1;
+    };
+
+    typedef std::shared_ptr<VKNPipelineCache> VKNPipelineCachePtr;
+}
+
+#endif // VKN_PIPELINE_CACHE_H
@@ -0,0 +1,144 @@
+// VKNUniformRing.cpp
+#include "stdafx.h"
+#include "VKNUniformRing.h"
+#include "VKNComputeUtils.h"
+#include "VulkanRenderContext.h"
+
+namespace GamePrototype
+{
+	VKNUniformRing::VKNUniformRing(VulkanRenderContext& context)
+	:
+	m_context(context),
+	m_bufferObject{},
+	m_pMapped(nullptr),
+	m_sliceStride(0),
+	m_numFrames(0),
+	m_slotsPerFrame(0),
+	m_frame(0),
+	m_slot(0)
+	{
+	}
+
+	VKNUniformRing::~VKNUniformRing()
+	{
+		Shutdown();
+	}
+
+	bool VKNUniformRing::Init(uint32_t sliceSize, uint32_t numFrames, uint32_t slotsPerFrame)
+	{
+		assert(sliceSize > 0 && numFrames > 0 && slotsPerFrame > 0);
+		if (m_bufferObject.buffer != VK_NULL_HANDLE)
+		{
+			return true;
+		}
+
+		VkDevice device = m_context.GetDevice();
+
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties(m_context.GetPhysicalDevice(), &props);
+		const uint32_t alignment = static_cast<uint32_t>(props.limits.minUniformBufferOffsetAlignment);
+
+		m_sliceStride = sliceSize;
+		if (alignment > 1)
+		{
+			m_sliceStride = (sliceSize + alignment - 1) / alignment * alignment;
+		}
+
+		m_numFrames = numFrames;
+		m_slotsPerFrame = slotsPerFrame;
+		m_frame = 0;
+		m_slot = 0;
+
+		const VkDeviceSize size = static_cast<VkDeviceSize>(m_sliceStride) * m_numFrames * m_slotsPerFrame;
+
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size;
+		bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		if (vkCreateBuffer(device, &bufferInfo, nullptr, &m_bufferObject.buffer) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNUniformRing::Init() failed to create buffer!");
+			m_bufferObject.buffer = VK_NULL_HANDLE;
+			return false;
+		}
+
+		VkMemoryRequirements memReqs;
+		vkGetBufferMemoryRequirements(device, m_bufferObject.buffer, &memReqs);
+
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = memReqs.size;
+		if (!VKNComputeUtils::FindMemoryType(m_context, memReqs.memoryTypeBits,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, allocInfo.memoryTypeIndex) ||
+			vkAllocateMemory(device, &allocInfo, nullptr, &m_bufferObject.memory) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNUniformRing::Init() failed to allocate memory!");
+			Shutdown();
+			return false;
+		}
+
+		if (vkBindBufferMemory(device, m_bufferObject.buffer, m_bufferObject.memory, 0) != VK_SUCCESS ||
+			vkMapMemory(device, m_bufferObject.memory, 0, size, 0, &m_pMapped) != VK_SUCCESS)
+		{
+			Log::PrintError("VKNUniformRing::Init() failed to map memory!");
+			m_pMapped = nullptr;
+			Shutdown();
+			return false;
+		}
+
+		// dynamic descriptors see one slice, the bind time offset picks which
+		m_bufferObject.descriptor.buffer = m_bufferObject.buffer;
+		m_bufferObject.descriptor.offset = 0;
+		m_bufferObject.descriptor.range = sliceSize;
+
+		return true;
+	}
+
+	void VKNUniformRing::Shutdown()
+	{
+		VkDevice device = m_context.GetDevice();
+
+		if (m_pMapped)
+		{
+			vkUnmapMemory(device, m_bufferObject.memory);
+			m_pMapped = nullptr;
+		}
+
+		if (m_bufferObject.buffer != VK_NULL_HANDLE)
+		{
+			vkDestroyBuffer(device, m_bufferObject.buffer, nullptr);
+		}
+
+		if (m_bufferObject.memory != VK_NULL_HANDLE)
+		{
+			vkFreeMemory(device, m_bufferObject.memory, nullptr);
+		}
+
+		m_bufferObject = BufferObject{};
+	}
+
+	void VKNUniformRing::BeginFrame()
+	{
+		if (m_numFrames > 0)
+		{
+			m_frame = (m_frame + 1) % m_numFrames;
+		}
+
+		m_slot = 0;
+	}
+
+	void* VKNUniformRing::Allocate(uint32_t& dynamicOffset)
+	{
+		if (!m_pMapped || m_slot >= m_slotsPerFrame)
+		{
+			Log::PrintError("VKNUniformRing::Allocate() out of uniform slices for this frame!");
+			return nullptr;
+		}
+
+		dynamicOffset = (m_frame * m_slotsPerFrame + m_slot) * m_sliceStride;
+		++m_slot;
+
+		return static_cast<char*>(m_pMapped) + dynamicOffset;
+	}
+}
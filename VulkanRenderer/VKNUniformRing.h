@@ -0,0 +1,60 @@
+// VKNUniformRing.h
+// Ring of uniform slices in one persistently mapped, host coherent buffer, bound as
+// UNIFORM_BUFFER_DYNAMIC. Each frame in flight owns slotsPerFrame slices. A slice is written once on the
+// CPU and picked at bind time with its dynamic offset, so a slice the GPU may still be reading is never
+// overwritten until the ring comes back around to its frame. That only holds while no more frames are in
+// flight than the ring has frames (one per swap chain image)
+#pragma once
+#ifndef VKN_UNIFORM_RING_H
+#define VKN_UNIFORM_RING_H
+
+#include <memory>
+
+#include "VulkanHelper.h"
+
+namespace GamePrototype
+{
+    class VulkanRenderContext;
+
+    class VKNUniformRing
+    {
+    public:
+        explicit VKNUniformRing(VulkanRenderContext&);
+        ~VKNUniformRing();
+
+        VKNUniformRing(const VKNUniformRing&) = delete;
+        VKNUniformRing& operator=(const VKNUniformRing&) = delete;
+
+        // sliceSize: bytes of one slice, the range a dynamic descriptor sees. Slices are placed at the
+        // device's minUniformBufferOffsetAlignment
+        bool Init(uint32_t sliceSize, uint32_t numFrames, uint32_t slotsPerFrame);
+        void Shutdown();
+
+        // moves on to the next frame's slices, which the GPU is done with by now
+        void BeginFrame();
+
+        // a free slice of this frame, and its offset for vkCmdBindDescriptorSets(). nullptr when all of the
+        // frame's slots are in use
+        void* Allocate(uint32_t& dynamicOffset);
+
+        // for the descriptor writes, range is one slice
+        const BufferObject& GetBufferObject() const { return m_bufferObject; }
+
+        uint32_t GetSliceStride() const { return m_sliceStride; }
+
+    private:
+
+        VulkanRenderContext&                m_context;
+        BufferObject                        m_bufferObject;
+        void*                               m_pMapped;
+        uint32_t                            m_sliceStride;
+        uint32_t                            m_numFrames;
+        uint32_t                            m_slotsPerFrame;
+        uint32_t                            m_frame;
+        uint32_t                            m_slot;             // next free one in m_frame
+    };
+
+    typedef std::shared_ptr<VKNUniformRing> VKNUniformRingPtr;
+}
+
+#endif // VKN_UNIFORM_RING_H